@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Path vectors converted to device-space cairo path data once, for repeated rendering.
+ *//*
+ * Authors:
+ *   see git history
+ *
+ * Copyright (C) 2022 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "display/cairo-path.h"
+
+#include <2geom/pathvector.h>
+
+#include "display/cairo-utils.h"
+
+namespace Inkscape {
+
+namespace {
+
+/// A context of each thread to convert paths with; its surface is never drawn to.
+cairo_t *scratch_context()
+{
+    struct Scratch
+    {
+        Scratch()
+        {
+            cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_A8, 1, 1);
+            ct = cairo_create(surface);
+            cairo_surface_destroy(surface);
+        }
+        ~Scratch() { cairo_destroy(ct); }
+        cairo_t *ct;
+    };
+    thread_local Scratch scratch;
+    return scratch.ct;
+}
+
+bool same_linear(cairo_matrix_t const &a, cairo_matrix_t const &b)
+{
+    return a.xx == b.xx && a.yx == b.yx && a.xy == b.xy && a.yy == b.yy;
+}
+
+} // namespace
+
+CairoPath::Device::Device(Geom::PathVector const &pathv, cairo_matrix_t const &m)
+    : ctm(m)
+{
+    // Feed the path with the transformation matrix of the target, then read it back in device
+    // space.
+    cairo_t *ct = scratch_context();
+    cairo_new_path(ct);
+    cairo_set_matrix(ct, &ctm);
+    feed_pathvector_to_cairo(ct, pathv);
+    cairo_identity_matrix(ct);
+    path = cairo_copy_path(ct);
+    cairo_new_path(ct);
+}
+
+CairoPath::Device::~Device()
+{
+    cairo_path_destroy(path);
+}
+
+CairoPath::CairoPath(Geom::PathVector const *pathv)
+    : _pathv(pathv)
+{
+}
+
+void CairoPath::set(Geom::PathVector const *pathv)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _pathv = pathv;
+    _device.reset();
+    _has_last_ctm = false;
+}
+
+bool CairoPath::empty() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return !_pathv || _pathv->empty();
+}
+
+void CairoPath::append(cairo_t *ct) const
+{
+    cairo_matrix_t ctm;
+    cairo_get_matrix(ct, &ctm);
+
+    Geom::PathVector const *pathv;
+    std::shared_ptr<Device const> device;
+    bool convert = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        pathv = _pathv;
+        device = _device;
+        if (!device || !same_linear(device->ctm, ctm)) {
+            device.reset();
+            convert = _has_last_ctm && same_linear(_last_ctm, ctm);
+            _last_ctm = ctm;
+            _has_last_ctm = true;
+        }
+    }
+    if (!pathv || pathv->empty()) {
+        return;
+    }
+
+    if (convert) {
+        device = std::make_shared<Device const>(*pathv, ctm);
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_pathv == pathv) {
+            _device = device;
+        }
+    }
+    if (!device || device->path->status != CAIRO_STATUS_SUCCESS) {
+        feed_pathvector_to_cairo(ct, *pathv);
+        return;
+    }
+
+    // The kept path is in device space; only shift it to the translation of the context.
+    cairo_matrix_t shift;
+    cairo_matrix_init_translate(&shift, ctm.x0 - device->ctm.x0, ctm.y0 - device->ctm.y0);
+    cairo_set_matrix(ct, &shift);
+    cairo_append_path(ct, device->path);
+    cairo_set_matrix(ct, &ctm);
+}
+
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Path vectors converted to device-space cairo path data once, for repeated rendering.
+ *//*
+ * Authors:
+ *   see git history
+ *
+ * Copyright (C) 2022 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_INKSCAPE_DISPLAY_CAIRO_PATH_H
+#define SEEN_INKSCAPE_DISPLAY_CAIRO_PATH_H
+
+#include <memory>
+#include <mutex>
+#include <cairo.h>
+#include <2geom/forward.h>
+
+namespace Inkscape {
+
+/**
+ * A path vector kept as cairo path data in device space, for repeated rendering.
+ *
+ * Feeding a path vector to cairo walks its curves, converts every one of them and transforms
+ * every point by the current transformation matrix. Drawing items render the same path for
+ * every tile they intersect, so the path is fed once and the resulting device-space path is
+ * kept; later renders append it as it is.
+ *
+ * Tiles of one view only differ in their translation, so the cache is keyed by the linear part
+ * of the transformation matrix and the kept path is shifted by the difference in translation.
+ * When the linear part changes, e.g. on zoom, the path vector is fed directly; the path is only
+ * converted again once the same linear part is used a second time, so items drawn with ever
+ * changing transformations cost no more than before. Curves are kept as curves, and arcs go
+ * through feed_pathvector_to_cairo(), so the result is the same as feeding the path vector.
+ *
+ * Only one transformation is kept, so every drawing item keeps its own object. The path vector
+ * is not copied and must outlive the object, or be replaced with set(). The cache may be used
+ * from several rendering threads at once.
+ */
+class CairoPath
+{
+public:
+    explicit CairoPath(Geom::PathVector const *pathv = nullptr);
+    CairoPath(CairoPath const &) = delete;
+    CairoPath &operator=(CairoPath const &) = delete;
+
+    /// Change the path vector, dropping the kept path.
+    void set(Geom::PathVector const *pathv);
+
+    bool empty() const;
+
+    /// Append the path to the current path of the context, in its user space.
+    void append(cairo_t *ct) const;
+
+private:
+    struct Device
+    {
+        Device(Geom::PathVector const &pathv, cairo_matrix_t const &ctm);
+        ~Device();
+        cairo_path_t *path;
+        cairo_matrix_t ctm; ///< the transformation matrix the path was made with
+    };
+
+    Geom::PathVector const *_pathv;
+    mutable std::mutex _mutex;
+    mutable std::shared_ptr<Device const> _device;
+    mutable cairo_matrix_t _last_ctm; ///< the transformation matrix of the last miss
+    mutable bool _has_last_ctm = false;
+};
+
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_DISPLAY_CAIRO_PATH_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,239 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Span kernels shared by all vector instruction sets.
+ *//*
+ * Authors:
+ *   see git history
+ *
+ * Copyright (C) 2022 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+// No include guard: this file is included by cairo-simd.cpp once per instruction set,
+// inside a namespace which already defines a matching "Ops" struct with the primitive
+// operations on vectors of Ops::N 32-bit lanes. Everything here is written in terms of
+// Ops only, so that each copy is compiled for its own target.
+//
+// The integer formulas are the ones of the scalar functions in cairo-simd.h, evaluated
+// with 32-bit wrap-around arithmetic in the same way. Integer divisions are replaced by
+// exact equivalents:
+//  - (x + 127) / 255 for 0 <= x <= 255*255 by the shift-and-add form below;
+//  - divisions with a numerator below 2^24 by a float division truncated towards zero,
+//    which is exact when numerator + denominator < 2^24.
+
+using V = Ops::V;
+
+inline V load_n(guint32 const *p, int n)
+{
+    if (n >= Ops::N) {
+        return Ops::load(p);
+    }
+    guint32 buf[Ops::N] = {};
+    for (int i = 0; i < n; ++i) {
+        buf[i] = p[i];
+    }
+    return Ops::load(buf);
+}
+
+inline void store_n(guint32 *p, V v, int n)
+{
+    if (n >= Ops::N) {
+        Ops::store(p, v);
+        return;
+    }
+    guint32 buf[Ops::N];
+    Ops::store(buf, v);
+    for (int i = 0; i < n; ++i) {
+        p[i] = buf[i];
+    }
+}
+
+inline void unpack(V px, V &a, V &r, V &g, V &b)
+{
+    V const mask = Ops::set1(0xff);
+    a = Ops::srli<24>(px);
+    r = Ops::and_(Ops::srli<16>(px), mask);
+    g = Ops::and_(Ops::srli<8>(px), mask);
+    b = Ops::and_(px, mask);
+}
+
+inline V pack(V a, V r, V g, V b)
+{
+    return Ops::or_(Ops::or_(Ops::slli<24>(a), Ops::slli<16>(r)), Ops::or_(Ops::slli<8>(g), b));
+}
+
+inline V clamp(V v, V low, V high)
+{
+    return Ops::min(Ops::max(v, low), high);
+}
+
+/// (x + 127) / 255 for 0 <= x <= 255*255.
+inline V div255_round(V x)
+{
+    V y = Ops::add(x, Ops::set1(127));
+    return Ops::srli<8>(Ops::add(Ops::add(y, Ops::set1(1)), Ops::srli<8>(y)));
+}
+
+/// premul_alpha() for components and alpha in 0..255.
+inline V premul(V c, V a)
+{
+    V t = Ops::add(Ops::mullo16(a, c), Ops::set1(128));
+    return Ops::srli<8>(Ops::add(t, Ops::srli<8>(t)));
+}
+
+/// unpremul_alpha() for components and alpha in 0..255; lanes with zero alpha give 255.
+inline V unpremul(V c, V a)
+{
+    V num = Ops::add(Ops::mullo16(c, Ops::set1(255)), Ops::srli<1>(a));
+    V q = Ops::div(num, Ops::max(a, Ops::set1(1)));
+    return Ops::select(Ops::cmpgt(a, c), q, Ops::set1(255));
+}
+
+inline void unpremul_rgb(V a, V &r, V &g, V &b)
+{
+    V nonzero = Ops::cmpgt(a, Ops::zero());
+    r = Ops::select(nonzero, unpremul(r, a), r);
+    g = Ops::select(nonzero, unpremul(g, a), g);
+    b = Ops::select(nonzero, unpremul(b, a), b);
+}
+
+inline V premultiply_px(V px)
+{
+    V a, r, g, b;
+    unpack(px, a, r, g, b);
+    V res = pack(a, premul(r, a), premul(g, a), premul(b, a));
+    return Ops::select(Ops::cmpeq(a, Ops::zero()), px, res);
+}
+
+inline V unpremultiply_px(V px)
+{
+    V a, r, g, b;
+    unpack(px, a, r, g, b);
+    unpremul_rgb(a, r, g, b);
+    return pack(a, r, g, b);
+}
+
+inline V matrix_row(V r, V g, V b, V a, gint32 const *row)
+{
+    V sum = Ops::add(Ops::mullo32(r, Ops::set1(row[0])), Ops::mullo32(g, Ops::set1(row[1])));
+    sum = Ops::add(sum, Ops::mullo32(b, Ops::set1(row[2])));
+    sum = Ops::add(sum, Ops::mullo32(a, Ops::set1(row[3])));
+    sum = Ops::add(sum, Ops::set1(row[4]));
+    return div255_round(clamp(sum, Ops::zero(), Ops::set1(255*255)));
+}
+
+inline V color_matrix_px(V px, gint32 const v[20])
+{
+    V a, r, g, b;
+    unpack(px, a, r, g, b);
+    unpremul_rgb(a, r, g, b);
+    V ro = matrix_row(r, g, b, a, v);
+    V go = matrix_row(r, g, b, a, v + 5);
+    V bo = matrix_row(r, g, b, a, v + 10);
+    V ao = matrix_row(r, g, b, a, v + 15);
+    return pack(ao, premul(ro, ao), premul(go, ao), premul(bo, ao));
+}
+
+inline V hue_row(V r, V g, V b, V maxpx, gint32 const *row)
+{
+    V sum = Ops::add(Ops::mullo32(r, Ops::set1(row[0])), Ops::mullo32(g, Ops::set1(row[1])));
+    sum = Ops::add(sum, Ops::mullo32(b, Ops::set1(row[2])));
+    return div255_round(clamp(sum, Ops::zero(), maxpx));
+}
+
+inline V hue_rotate_px(V px, gint32 const v[9])
+{
+    V a, r, g, b;
+    unpack(px, a, r, g, b);
+    V maxpx = Ops::mullo16(a, Ops::set1(255));
+    return pack(a, hue_row(r, g, b, maxpx, v), hue_row(r, g, b, maxpx, v + 3), hue_row(r, g, b, maxpx, v + 6));
+}
+
+inline V luminance_to_alpha_px(V px)
+{
+    V a, r, g, b;
+    unpack(px, a, r, g, b);
+    unpremul_rgb(a, r, g, b);
+    V lum = Ops::add(Ops::add(Ops::mullo16(r, Ops::set1(54)), Ops::mullo16(g, Ops::set1(182))),
+                     Ops::mullo16(b, Ops::set1(18)));
+    return Ops::slli<24>(div255_round(lum));
+}
+
+inline V arithmetic_channel(V c1, V c2, gint32 const k[4])
+{
+    V sum = Ops::add(Ops::mullo32(Ops::mullo32(c1, c2), Ops::set1(k[0])), Ops::mullo32(c1, Ops::set1(k[1])));
+    return Ops::add(Ops::add(sum, Ops::mullo32(c2, Ops::set1(k[2]))), Ops::set1(k[3]));
+}
+
+/// (x + 255*255/2) / (255*255) for 0 <= x <= 255^3.
+inline V div65025_round(V x)
+{
+    return Ops::div(Ops::add(x, Ops::set1(255*255/2)), Ops::set1(255*255));
+}
+
+inline V arithmetic_px(V px1, V px2, gint32 const k[4])
+{
+    V a1, r1, g1, b1, a2, r2, g2, b2;
+    unpack(px1, a1, r1, g1, b1);
+    unpack(px2, a2, r2, g2, b2);
+    V zero = Ops::zero();
+    V ao = clamp(arithmetic_channel(a1, a2, k), zero, Ops::set1(255*255*255));
+    V ro = div65025_round(clamp(arithmetic_channel(r1, r2, k), zero, ao));
+    V go = div65025_round(clamp(arithmetic_channel(g1, g2, k), zero, ao));
+    V bo = div65025_round(clamp(arithmetic_channel(b1, b2, k), zero, ao));
+    return pack(div65025_round(ao), ro, go, bo);
+}
+
+void premultiply(guint32 const *in, guint32 *out, int n)
+{
+    for (int i = 0; i < n; i += Ops::N) {
+        store_n(out + i, premultiply_px(load_n(in + i, n - i)), n - i);
+    }
+}
+
+void unpremultiply(guint32 const *in, guint32 *out, int n)
+{
+    for (int i = 0; i < n; i += Ops::N) {
+        store_n(out + i, unpremultiply_px(load_n(in + i, n - i)), n - i);
+    }
+}
+
+void color_matrix(guint32 const *in, guint32 *out, int n, gint32 const v[20])
+{
+    for (int i = 0; i < n; i += Ops::N) {
+        store_n(out + i, color_matrix_px(load_n(in + i, n - i), v), n - i);
+    }
+}
+
+void hue_rotate(guint32 const *in, guint32 *out, int n, gint32 const v[9])
+{
+    for (int i = 0; i < n; i += Ops::N) {
+        store_n(out + i, hue_rotate_px(load_n(in + i, n - i), v), n - i);
+    }
+}
+
+void luminance_to_alpha(guint32 const *in, guint32 *out, int n)
+{
+    for (int i = 0; i < n; i += Ops::N) {
+        store_n(out + i, luminance_to_alpha_px(load_n(in + i, n - i)), n - i);
+    }
+}
+
+void arithmetic(guint32 const *in1, guint32 const *in2, guint32 *out, int n, gint32 const k[4])
+{
+    for (int i = 0; i < n; i += Ops::N) {
+        store_n(out + i, arithmetic_px(load_n(in1 + i, n - i), load_n(in2 + i, n - i), k), n - i);
+    }
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
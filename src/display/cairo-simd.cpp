@@ -0,0 +1,221 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Vectorized pixel kernels for the common filter functors.
+ *//*
+ * Authors:
+ *   see git history
+ *
+ * Copyright (C) 2022 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "display/cairo-simd.h"
+
+// The vector code is compiled with GCC and Clang on x86. SSE2 is part of the baseline of
+// x86-64; the AVX2 variant is compiled for that target only and selected at run time.
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+#define INK_PIXEL_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace Inkscape {
+
+namespace {
+
+#if INK_PIXEL_SIMD_X86
+
+namespace sse2 {
+
+struct Ops
+{
+    using V = __m128i;
+    static constexpr int N = 4;
+
+    static V load(guint32 const *p) { return _mm_loadu_si128(reinterpret_cast<__m128i const *>(p)); }
+    static void store(guint32 *p, V v) { _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v); }
+    static V set1(gint32 x) { return _mm_set1_epi32(x); }
+    static V zero() { return _mm_setzero_si128(); }
+
+    static V add(V a, V b) { return _mm_add_epi32(a, b); }
+    static V and_(V a, V b) { return _mm_and_si128(a, b); }
+    static V or_(V a, V b) { return _mm_or_si128(a, b); }
+    template <int k> static V srli(V a) { return _mm_srli_epi32(a, k); }
+    template <int k> static V slli(V a) { return _mm_slli_epi32(a, k); }
+
+    /// Product of lanes whose values and product fit in 16 bits.
+    static V mullo16(V a, V b) { return _mm_mullo_epi16(a, b); }
+    static V mullo32(V a, V b)
+    {
+        // SSE2 only multiplies the even lanes into 64-bit results.
+        V even = _mm_mul_epu32(a, b);
+        V odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+        return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                                  _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    }
+
+    static V cmpeq(V a, V b) { return _mm_cmpeq_epi32(a, b); }
+    static V cmpgt(V a, V b) { return _mm_cmpgt_epi32(a, b); }
+    static V select(V mask, V a, V b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+    static V min(V a, V b) { return select(_mm_cmpgt_epi32(a, b), b, a); }
+    static V max(V a, V b) { return select(_mm_cmpgt_epi32(a, b), a, b); }
+
+    /// Truncated quotient of non-negative lanes, exact while a + b < 2^24.
+    static V div(V a, V b) { return _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(a), _mm_cvtepi32_ps(b))); }
+};
+
+#include "display/cairo-simd-kernels.h"
+
+} // namespace sse2
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+namespace avx2 {
+
+struct Ops
+{
+    using V = __m256i;
+    static constexpr int N = 8;
+
+    static V load(guint32 const *p) { return _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p)); }
+    static void store(guint32 *p, V v) { _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v); }
+    static V set1(gint32 x) { return _mm256_set1_epi32(x); }
+    static V zero() { return _mm256_setzero_si256(); }
+
+    static V add(V a, V b) { return _mm256_add_epi32(a, b); }
+    static V and_(V a, V b) { return _mm256_and_si256(a, b); }
+    static V or_(V a, V b) { return _mm256_or_si256(a, b); }
+    template <int k> static V srli(V a) { return _mm256_srli_epi32(a, k); }
+    template <int k> static V slli(V a) { return _mm256_slli_epi32(a, k); }
+
+    static V mullo16(V a, V b) { return _mm256_mullo_epi16(a, b); }
+    static V mullo32(V a, V b) { return _mm256_mullo_epi32(a, b); }
+
+    static V cmpeq(V a, V b) { return _mm256_cmpeq_epi32(a, b); }
+    static V cmpgt(V a, V b) { return _mm256_cmpgt_epi32(a, b); }
+    static V select(V mask, V a, V b) { return _mm256_blendv_epi8(b, a, mask); }
+    static V min(V a, V b) { return _mm256_min_epi32(a, b); }
+    static V max(V a, V b) { return _mm256_max_epi32(a, b); }
+
+    static V div(V a, V b)
+    {
+        return _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(a), _mm256_cvtepi32_ps(b)));
+    }
+};
+
+#include "display/cairo-simd-kernels.h"
+
+} // namespace avx2
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif // INK_PIXEL_SIMD_X86
+
+PixelSimd detect_pixel_simd()
+{
+#if INK_PIXEL_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return PixelSimd::AVX2;
+    }
+    return PixelSimd::SSE2;
+#else
+    return PixelSimd::SCALAR;
+#endif
+}
+
+} // namespace
+
+PixelSimd pixel_simd_best()
+{
+    static PixelSimd const best = detect_pixel_simd();
+    return best;
+}
+
+bool pixel_simd_supported(PixelSimd level)
+{
+    return level <= pixel_simd_best();
+}
+
+// Run the kernel with the requested instruction set, or the closest one available.
+#if INK_PIXEL_SIMD_X86
+#define INK_PIXEL_DISPATCH(level, kernel, scalar, ...) \
+    do { \
+        if (level >= PixelSimd::AVX2 && pixel_simd_supported(PixelSimd::AVX2)) { \
+            avx2::kernel(__VA_ARGS__); \
+        } else if (level >= PixelSimd::SSE2) { \
+            sse2::kernel(__VA_ARGS__); \
+        } else { \
+            scalar; \
+        } \
+    } while (0)
+#else
+#define INK_PIXEL_DISPATCH(level, kernel, scalar, ...) do { scalar; } while (0)
+#endif
+
+void pixels_premultiply(guint32 const *in, guint32 *out, int n, PixelSimd level)
+{
+    INK_PIXEL_DISPATCH(level, premultiply,
+                       for (int i = 0; i < n; ++i) out[i] = pixel_premultiply(in[i]),
+                       in, out, n);
+}
+
+void pixels_unpremultiply(guint32 const *in, guint32 *out, int n, PixelSimd level)
+{
+    INK_PIXEL_DISPATCH(level, unpremultiply,
+                       for (int i = 0; i < n; ++i) out[i] = pixel_unpremultiply(in[i]),
+                       in, out, n);
+}
+
+void pixels_color_matrix(guint32 const *in, guint32 *out, int n, gint32 const v[20], PixelSimd level)
+{
+    INK_PIXEL_DISPATCH(level, color_matrix,
+                       for (int i = 0; i < n; ++i) out[i] = pixel_color_matrix(in[i], v),
+                       in, out, n, v);
+}
+
+void pixels_hue_rotate(guint32 const *in, guint32 *out, int n, gint32 const v[9], PixelSimd level)
+{
+    INK_PIXEL_DISPATCH(level, hue_rotate,
+                       for (int i = 0; i < n; ++i) out[i] = pixel_hue_rotate(in[i], v),
+                       in, out, n, v);
+}
+
+void pixels_luminance_to_alpha(guint32 const *in, guint32 *out, int n, PixelSimd level)
+{
+    INK_PIXEL_DISPATCH(level, luminance_to_alpha,
+                       for (int i = 0; i < n; ++i) out[i] = pixel_luminance_to_alpha(in[i]),
+                       in, out, n);
+}
+
+void pixels_arithmetic(guint32 const *in1, guint32 const *in2, guint32 *out, int n, gint32 const k[4],
+                       PixelSimd level)
+{
+    INK_PIXEL_DISPATCH(level, arithmetic,
+                       for (int i = 0; i < n; ++i) out[i] = pixel_arithmetic(in1[i], in2[i], k),
+                       in1, in2, out, n, k);
+}
+
+#undef INK_PIXEL_DISPATCH
+
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,184 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Vectorized pixel kernels for the common filter functors.
+ *//*
+ * Authors:
+ *   see git history
+ *
+ * Copyright (C) 2022 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_INKSCAPE_DISPLAY_CAIRO_SIMD_H
+#define SEEN_INKSCAPE_DISPLAY_CAIRO_SIMD_H
+
+#include <algorithm>
+#include <glib.h>
+#include "display/cairo-utils.h"
+
+/*
+ * Every kernel comes in two forms: an inline function processing one premultiplied ARGB32
+ * pixel, which is the reference implementation used by the filter functors, and a span
+ * function processing n pixels with the widest instruction set available at run time.
+ * The span functions produce exactly the same output as the per-pixel functions; this is
+ * checked by the unit tests. Spans may be processed in place (in == out).
+ */
+
+namespace Inkscape {
+
+/// Instruction sets the span functions can use.
+enum class PixelSimd
+{
+    SCALAR,
+    SSE2,
+    AVX2
+};
+
+/// The widest instruction set supported by both the build and the CPU.
+PixelSimd pixel_simd_best();
+/// Whether span functions can be run with the given instruction set.
+bool pixel_simd_supported(PixelSimd level);
+
+/// Premultiply the color components. Pixels with zero alpha are left unchanged.
+G_GNUC_CONST inline guint32 pixel_premultiply(guint32 in)
+{
+    EXTRACT_ARGB32(in, a, r, g, b)
+    if (a == 0) {
+        return in;
+    }
+    r = premul_alpha(r, a);
+    g = premul_alpha(g, a);
+    b = premul_alpha(b, a);
+    ASSEMBLE_ARGB32(out, a, r, g, b)
+    return out;
+}
+
+/// Divide the color components by alpha. Pixels with zero alpha are left unchanged.
+G_GNUC_CONST inline guint32 pixel_unpremultiply(guint32 in)
+{
+    EXTRACT_ARGB32(in, a, r, g, b)
+    if (a == 0) {
+        return in;
+    }
+    r = unpremul_alpha(r, a);
+    g = unpremul_alpha(g, a);
+    b = unpremul_alpha(b, a);
+    ASSEMBLE_ARGB32(out, a, r, g, b)
+    return out;
+}
+
+/**
+ * feColorMatrix type="matrix" on a premultiplied pixel.
+ * @param v The matrix in row-major order, scaled by 255 (by 255*255 for the last column).
+ */
+inline guint32 pixel_color_matrix(guint32 in, gint32 const v[20])
+{
+    EXTRACT_ARGB32(in, a, r, g, b)
+    // we need to un-premultiply alpha values for this type of matrix
+    // TODO: unpremul can be ignored if there is an identity mapping on the alpha channel
+    if (a != 0) {
+        r = unpremul_alpha(r, a);
+        g = unpremul_alpha(g, a);
+        b = unpremul_alpha(b, a);
+    }
+
+    gint32 ro = r*v[0]  + g*v[1]  + b*v[2]  + a*v[3]  + v[4];
+    gint32 go = r*v[5]  + g*v[6]  + b*v[7]  + a*v[8]  + v[9];
+    gint32 bo = r*v[10] + g*v[11] + b*v[12] + a*v[13] + v[14];
+    gint32 ao = r*v[15] + g*v[16] + b*v[17] + a*v[18] + v[19];
+    ro = (std::clamp(ro, 0, 255*255) + 127) / 255;
+    go = (std::clamp(go, 0, 255*255) + 127) / 255;
+    bo = (std::clamp(bo, 0, 255*255) + 127) / 255;
+    ao = (std::clamp(ao, 0, 255*255) + 127) / 255;
+
+    ro = premul_alpha(ro, ao);
+    go = premul_alpha(go, ao);
+    bo = premul_alpha(bo, ao);
+
+    ASSEMBLE_ARGB32(pxout, ao, ro, go, bo)
+    return pxout;
+}
+
+/**
+ * feColorMatrix type="hueRotate" on a premultiplied pixel.
+ * @param v The 3x3 rotation matrix in row-major order, scaled by 255.
+ */
+inline guint32 pixel_hue_rotate(guint32 in, gint32 const v[9])
+{
+    EXTRACT_ARGB32(in, a, r, g, b)
+    gint32 maxpx = a*255;
+    gint32 ro = r*v[0] + g*v[1] + b*v[2];
+    gint32 go = r*v[3] + g*v[4] + b*v[5];
+    gint32 bo = r*v[6] + g*v[7] + b*v[8];
+    ro = (std::clamp(ro, 0, maxpx) + 127) / 255;
+    go = (std::clamp(go, 0, maxpx) + 127) / 255;
+    bo = (std::clamp(bo, 0, maxpx) + 127) / 255;
+
+    ASSEMBLE_ARGB32(pxout, a, ro, go, bo)
+    return pxout;
+}
+
+/// feColorMatrix type="luminanceToAlpha" on a premultiplied pixel.
+G_GNUC_CONST inline guint32 pixel_luminance_to_alpha(guint32 in)
+{
+    // original computation in double: r*0.2125 + g*0.7154 + b*0.0721
+    EXTRACT_ARGB32(in, a, r, g, b)
+    // unpremultiply color values
+    if (a != 0) {
+        r = unpremul_alpha(r, a);
+        g = unpremul_alpha(g, a);
+        b = unpremul_alpha(b, a);
+    }
+    guint32 ao = r*54 + g*182 + b*18;
+    return ((ao + 127) / 255) << 24;
+}
+
+/**
+ * feComposite operator="arithmetic" on two premultiplied pixels.
+ * @param k The coefficients k1 to k4, scaled by 255, 255^2, 255^2 and 255^3 respectively.
+ */
+inline guint32 pixel_arithmetic(guint32 in1, guint32 in2, gint32 const k[4])
+{
+    EXTRACT_ARGB32(in1, aa, ra, ga, ba)
+    EXTRACT_ARGB32(in2, ab, rb, gb, bb)
+
+    gint32 ao = k[0]*aa*ab + k[1]*aa + k[2]*ab + k[3];
+    gint32 ro = k[0]*ra*rb + k[1]*ra + k[2]*rb + k[3];
+    gint32 go = k[0]*ga*gb + k[1]*ga + k[2]*gb + k[3];
+    gint32 bo = k[0]*ba*bb + k[1]*ba + k[2]*bb + k[3];
+
+    ao = std::clamp(ao, 0, 255*255*255); // r, g and b are premultiplied, so should be clamped to the alpha channel
+    ro = (std::clamp(ro, 0, ao) + (255*255/2)) / (255*255);
+    go = (std::clamp(go, 0, ao) + (255*255/2)) / (255*255);
+    bo = (std::clamp(bo, 0, ao) + (255*255/2)) / (255*255);
+    ao = (ao + (255*255/2)) / (255*255);
+
+    ASSEMBLE_ARGB32(pxout, ao, ro, go, bo)
+    return pxout;
+}
+
+void pixels_premultiply(guint32 const *in, guint32 *out, int n, PixelSimd level = pixel_simd_best());
+void pixels_unpremultiply(guint32 const *in, guint32 *out, int n, PixelSimd level = pixel_simd_best());
+void pixels_color_matrix(guint32 const *in, guint32 *out, int n, gint32 const v[20],
+                         PixelSimd level = pixel_simd_best());
+void pixels_hue_rotate(guint32 const *in, guint32 *out, int n, gint32 const v[9],
+                       PixelSimd level = pixel_simd_best());
+void pixels_luminance_to_alpha(guint32 const *in, guint32 *out, int n, PixelSimd level = pixel_simd_best());
+void pixels_arithmetic(guint32 const *in1, guint32 const *in2, guint32 *out, int n, gint32 const k[4],
+                       PixelSimd level = pixel_simd_best());
+
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_DISPLAY_CAIRO_SIMD_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -29,9 +29,59 @@ static const int OPENMP_THRESHOLD = 2048;
 #include <algorithm>
 #include <cairo.h>
 #include <cmath>
+#include <type_traits>
 #include "display/nr-3dutils.h"
 #include "display/cairo-utils.h"
 
+/*
+ * Functors may additionally provide span members processing a run of 32-bit pixels at once,
+ * typically with the vector kernels from cairo-simd.h:
+ *   void filter_span(guint32 const *in, guint32 *out, int n) const;
+ *   void blend_span(guint32 const *in1, guint32 const *in2, guint32 *out, int n) const;
+ * They must give the same result as calling the functor on every pixel, also in place.
+ * The templates below use them for ARGB32 surfaces and fall back to per-pixel calls.
+ */
+
+// number of pixels handed to a span member at once
+static const int PIXEL_SPAN_LENGTH = 4096;
+
+template <typename Filter, typename = void>
+struct ink_has_filter_span : std::false_type {};
+template <typename Filter>
+struct ink_has_filter_span<Filter, std::void_t<decltype(std::declval<Filter const &>().filter_span(
+    std::declval<guint32 const *>(), std::declval<guint32 *>(), 0))>> : std::true_type {};
+
+template <typename Blend, typename = void>
+struct ink_has_blend_span : std::false_type {};
+template <typename Blend>
+struct ink_has_blend_span<Blend, std::void_t<decltype(std::declval<Blend const &>().blend_span(
+    std::declval<guint32 const *>(), std::declval<guint32 const *>(), std::declval<guint32 *>(), 0))>>
+    : std::true_type {};
+
+template <typename Filter>
+inline void ink_filter_span(Filter &filter, guint32 const *in, guint32 *out, int n)
+{
+    if constexpr (ink_has_filter_span<Filter>::value) {
+        filter.filter_span(in, out, n);
+    } else {
+        for (int i = 0; i < n; ++i) {
+            out[i] = filter(in[i]);
+        }
+    }
+}
+
+template <typename Blend>
+inline void ink_blend_span(Blend &blend, guint32 const *in1, guint32 const *in2, guint32 *out, int n)
+{
+    if constexpr (ink_has_blend_span<Blend>::value) {
+        blend.blend_span(in1, in2, out, n);
+    } else {
+        for (int i = 0; i < n; ++i) {
+            out[i] = blend(in1[i], in2[i]);
+        }
+    }
+}
+
 /**
  * Blend two surfaces using the supplied functor.
  * This template blends two Cairo image surfaces using a blending functor that takes
@@ -85,11 +135,14 @@ void ink_cairo_surface_blend(cairo_surface_t *in1, cairo_surface_t *in2, cairo_s
     if (bpp1 == 4) {
         if (bpp2 == 4) {
             if (fast_path) {
+                int spans = (limit + PIXEL_SPAN_LENGTH - 1) / PIXEL_SPAN_LENGTH;
                 #if HAVE_OPENMP
                 #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
                 #endif
-                for (int i = 0; i < limit; ++i) {
-                    *(out_data + i) = blend(*(in1_data + i), *(in2_data + i));
+                for (int i = 0; i < spans; ++i) {
+                    int start = i * PIXEL_SPAN_LENGTH;
+                    int n = std::min(PIXEL_SPAN_LENGTH, limit - start);
+                    ink_blend_span(blend, in1_data + start, in2_data + start, out_data + start, n);
                 }
             } else {
                 #if HAVE_OPENMP
@@ -99,10 +152,7 @@ void ink_cairo_surface_blend(cairo_surface_t *in1, cairo_surface_t *in2, cairo_s
                     guint32 *in1_p = in1_data + i * stride1/4;
                     guint32 *in2_p = in2_data + i * stride2/4;
                     guint32 *out_p = out_data + i * strideout/4;
-                    for (int j = 0; j < w; ++j) {
-                        *out_p = blend(*in1_p, *in2_p);
-                        ++in1_p; ++in2_p; ++out_p;
-                    }
+                    ink_blend_span(blend, in1_p, in2_p, out_p, w);
                 }
             }
         } else {
@@ -212,11 +262,14 @@ void ink_cairo_surface_filter(cairo_surface_t *in, cairo_surface_t *out, Filter
     // this is provided just in case, to avoid problems with strict aliasing rules
     if (in == out) {
         if (bppin == 4) {
+            int spans = (limit + PIXEL_SPAN_LENGTH - 1) / PIXEL_SPAN_LENGTH;
             #if HAVE_OPENMP
             #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
             #endif
-            for (int i = 0; i < limit; ++i) {
-                *(in_data + i) = filter(*(in_data + i));
+            for (int i = 0; i < spans; ++i) {
+                int start = i * PIXEL_SPAN_LENGTH;
+                int n = std::min(PIXEL_SPAN_LENGTH, limit - start);
+                ink_filter_span(filter, in_data + start, in_data + start, n);
             }
         } else {
             #if HAVE_OPENMP
@@ -237,11 +290,14 @@ void ink_cairo_surface_filter(cairo_surface_t *in, cairo_surface_t *out, Filter
         if (bppout == 4) {
             // bppin == 4, bppout == 4
             if (fast_path) {
+                int spans = (limit + PIXEL_SPAN_LENGTH - 1) / PIXEL_SPAN_LENGTH;
                 #if HAVE_OPENMP
                 #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
                 #endif
-                for (int i = 0; i < limit; ++i) {
-                    *(out_data + i) = filter(*(in_data + i));
+                for (int i = 0; i < spans; ++i) {
+                    int start = i * PIXEL_SPAN_LENGTH;
+                    int n = std::min(PIXEL_SPAN_LENGTH, limit - start);
+                    ink_filter_span(filter, in_data + start, out_data + start, n);
                 }
             } else {
                 #if HAVE_OPENMP
@@ -250,10 +306,7 @@ void ink_cairo_surface_filter(cairo_surface_t *in, cairo_surface_t *out, Filter
                 for (int i = 0; i < h; ++i) {
                     guint32 *in_p = in_data + i * stridein/4;
                     guint32 *out_p = out_data + i * strideout/4;
-                    for (int j = 0; j < w; ++j) {
-                        *out_p = filter(*in_p);
-                        ++in_p; ++out_p;
-                    }
+                    ink_filter_span(filter, in_p, out_p, w);
                 }
             }
         } else {
@@ -265,10 +318,22 @@ void ink_cairo_surface_filter(cairo_surface_t *in, cairo_surface_t *out, Filter
             for (int i = 0; i < h; ++i) {
                 guint32 *in_p = in_data + i * stridein/4;
                 guint8 *out_p = reinterpret_cast<guint8*>(out_data) + i * strideout;
-                for (int j = 0; j < w; ++j) {
-                    guint32 out_px = filter(*in_p);
-                    *out_p = out_px >> 24;
-                    ++in_p; ++out_p;
+                if constexpr (ink_has_filter_span<Filter>::value) {
+                    // compute whole pixels into a small buffer and keep their alpha
+                    guint32 buf[256];
+                    for (int j = 0; j < w; j += 256) {
+                        int n = std::min(256, w - j);
+                        filter.filter_span(in_p + j, buf, n);
+                        for (int k = 0; k < n; ++k) {
+                            out_p[j + k] = buf[k] >> 24;
+                        }
+                    }
+                } else {
+                    for (int j = 0; j < w; ++j) {
+                        guint32 out_px = filter(*in_p);
+                        *out_p = out_px >> 24;
+                        ++in_p; ++out_p;
+                    }
                 }
             }
         }
@@ -35,6 +35,7 @@
 #include "preferences.h"
 #include "util/units.h"
 #include "helper/pixbuf-ops.h"
+#include "display/image-cache.h"
 
 
 /**
@@ -406,6 +407,139 @@ Pixbuf *Pixbuf::create_from_file(std::string const &fn, double svgdpi)
     return pb;
 }
 
+namespace {
+
+/// Bytes of an image read at most to find its size.
+constexpr gsize SIZE_READ_LIMIT = 1 << 20;
+
+/**
+ * Feeds the start of an image to a pixbuf loader until the loader knows the size of the image,
+ * which most formats store in a header.
+ */
+class SizeReader
+{
+public:
+    SizeReader()
+        : _loader(gdk_pixbuf_loader_new())
+    {
+        g_signal_connect(_loader, "size-prepared", G_CALLBACK(&SizeReader::_sizePrepared), this);
+        g_signal_connect(_loader, "area-prepared", G_CALLBACK(&SizeReader::_areaPrepared), this);
+    }
+
+    ~SizeReader()
+    {
+        // The loader reports the image as truncated.
+        gdk_pixbuf_loader_close(_loader, nullptr);
+        g_object_unref(_loader);
+    }
+
+    /// Returns false once no more data is needed.
+    bool write(guchar const *data, gsize len)
+    {
+        if (!gdk_pixbuf_loader_write(_loader, data, len, nullptr)) {
+            return false;
+        }
+        return !_area_prepared;
+    }
+
+    bool size(int &width, int &height) const
+    {
+        if (_width <= 0 || _height <= 0) {
+            return false;
+        }
+        width = _width;
+        height = _height;
+        // Pixbuf::apply_embedded_orientation() transposes images with these orientations.
+        GdkPixbuf *pb = _area_prepared ? gdk_pixbuf_loader_get_pixbuf(_loader) : nullptr;
+        if (char const *orientation = pb ? gdk_pixbuf_get_option(pb, "orientation") : nullptr) {
+            int const o = atoi(orientation);
+            if (o >= 5 && o <= 8) {
+                std::swap(width, height);
+            }
+        }
+        return true;
+    }
+
+private:
+    static void _sizePrepared(GdkPixbufLoader *loader, int width, int height, gpointer data)
+    {
+        auto self = static_cast<SizeReader *>(data);
+        self->_width = width;
+        self->_height = height;
+        // Only the options of the image are wanted; don't allocate its pixels.
+        gdk_pixbuf_loader_set_size(loader, 1, 1);
+    }
+
+    static void _areaPrepared(GdkPixbufLoader *, gpointer data)
+    {
+        static_cast<SizeReader *>(data)->_area_prepared = true;
+    }
+
+    GdkPixbufLoader *_loader;
+    int _width = 0;
+    int _height = 0;
+    bool _area_prepared = false;
+};
+
+} // namespace
+
+bool Pixbuf::size_from_data_uri(gchar const *uri_data, int &width, int &height)
+{
+    gchar const *data = strchr(uri_data, ',');
+    if (!data) {
+        return false;
+    }
+    // Like create_from_data_uri(), only decode base64 data, and leave SVG images to documents.
+    std::string const header(uri_data, data);
+    if (header.find("base64") == std::string::npos || header.find("image/svg+xml") != std::string::npos) {
+        return false;
+    }
+    ++data;
+
+    SizeReader reader;
+    gint state = 0;
+    guint save = 0;
+    constexpr gsize chunk = 4096;
+    guchar decoded[chunk / 4 * 3 + 3];
+    for (gsize read = 0; read < SIZE_READ_LIMIT;) {
+        gsize const len = strnlen(data + read, chunk);
+        if (len == 0) {
+            break;
+        }
+        gsize const decoded_len = g_base64_decode_step(data + read, len, decoded, &state, &save);
+        read += len;
+        if (!reader.write(decoded, decoded_len)) {
+            break;
+        }
+    }
+    return reader.size(width, height);
+}
+
+bool Pixbuf::size_from_file(std::string const &fn, int &width, int &height)
+{
+    // Like create_from_buffer(), leave SVG files to documents.
+    auto const idx = fn.rfind('.');
+    if (idx != std::string::npos && boost::iequals(fn.substr(idx + 1), "svg")) {
+        return false;
+    }
+    FILE *file = g_fopen(fn.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    SizeReader reader;
+    guchar buffer[4096];
+    for (gsize read = 0; read < SIZE_READ_LIMIT;) {
+        gsize const len = fread(buffer, 1, sizeof(buffer), file);
+        if (len == 0 || !reader.write(buffer, len)) {
+            break;
+        }
+        read += len;
+    }
+    fclose(file);
+    return reader.size(width, height);
+}
+
 GdkPixbuf *Pixbuf::apply_embedded_orientation(GdkPixbuf *buf)
 {
     GdkPixbuf *old = buf;
@@ -623,6 +757,8 @@ guchar *Pixbuf::pixels() {
 }
 void Pixbuf::markDirty() {
     cairo_surface_mark_dirty(_surface);
+    // The smaller versions of the image drawn when zoomed out are outdated.
+    ImageCache::get().forget(_surface);
 }
 
 void Pixbuf::_forceAlpha()
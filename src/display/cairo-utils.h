@@ -122,6 +122,11 @@ public:
     static Pixbuf *create_from_file(std::string const &fn, double svgddpi = 0);
     static Pixbuf *create_from_buffer(std::string const &, double svgddpi = 0, std::string const &fn = "");
 
+    /// Read the size of a raster image in a data URI from its header, without decoding it.
+    static bool size_from_data_uri(gchar const *uri, int &width, int &height);
+    /// Read the size of a raster image file from its header, without decoding it.
+    static bool size_from_file(std::string const &fn, int &width, int &height);
+
   private:
     static Pixbuf *create_from_buffer(gchar *&&, gsize, double svgddpi = 0, std::string const &fn = "");
     static GdkPixbuf *apply_embedded_orientation(GdkPixbuf *buf);
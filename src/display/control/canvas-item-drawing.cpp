@@ -176,7 +176,8 @@ void CanvasItemDrawing::update(Geom::Affine const &affine)
 }
 
 /**
- * Render drawing to screen via Cairo.
+ * Render drawing to screen via Cairo. The drawing must be up to date, see Drawing::update(); tiles
+ * may be rendered concurrently, so this only reads it.
  */
 void CanvasItemDrawing::render(Inkscape::CanvasItemBuffer *buf)
 {
@@ -190,7 +191,6 @@ void CanvasItemDrawing::render(Inkscape::CanvasItemBuffer *buf)
     }
 
     Inkscape::DrawingContext dc(buf->cr->cobj(), buf->rect.min());
-    _drawing->update();
     _drawing->render(dc, buf->rect);
 }
 
@@ -189,12 +189,12 @@ void CanvasItemRect::render(Inkscape::CanvasItemBuffer *buf)
     // fill background?
     if (_background) {
         buf->cr->save();
+        // counter fill scaling (necessary for checkerboard pattern) by setting the source before
+        // the transform; the pattern is not changed, as tiles may be rendered concurrently
+        buf->cr->set_source(_background);
         Cairo::Matrix m(_affine[0], _affine[1], _affine[2], _affine[3], _affine[4], _affine[5]);
         buf->cr->transform(m);
         buf->cr->rectangle(rect.corner(0)[X], rect.corner(0)[Y], rect.width(), rect.height());
-        // counter fill scaling (necessary for checkerboard pattern)
-        _background->set_matrix(m);
-        buf->cr->set_source(_background);
         buf->cr->fill();
         buf->cr->restore();
     }
@@ -12,6 +12,7 @@
 
 #include "display/drawing-context.h"
 #include "display/drawing-surface.h"
+#include "display/cairo-path.h"
 #include "display/cairo-utils.h"
 
 namespace Inkscape {
@@ -121,6 +122,10 @@ void DrawingContext::path(Geom::PathVector const &pv) {
     feed_pathvector_to_cairo(_ct, pv);
 }
 
+void DrawingContext::path(CairoPath const &path) {
+    path.append(_ct);
+}
+
 void DrawingContext::paint(double alpha) {
     if (alpha == 1.0) cairo_paint(_ct);
     else cairo_paint_with_alpha(_ct, alpha);
@@ -21,6 +21,7 @@ typedef unsigned int guint32;
 
 namespace Inkscape {
 
+class CairoPath;
 class DrawingSurface;
 
 class DrawingContext
@@ -87,6 +88,7 @@ public:
     void newPath() { cairo_new_path(_ct); }
     void newSubpath() { cairo_new_sub_path(_ct); }
     void path(Geom::PathVector const &pv);
+    void path(CairoPath const &path);
 
     void paint(double alpha = 1.0);
     void fill() { cairo_fill(_ct); }
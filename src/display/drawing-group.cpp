@@ -78,6 +78,8 @@ DrawingGroup::_updateItem(Geom::IntRect const &area, UpdateContext const &ctx, u
         child_ctx.ctm = *_child_transform * ctx.ctm;
     }
     for (auto & i : _children) {
+        // propagate antialias setting here, as rendering must not change the items
+        i.setAntialiasing(_antialias);
         i.update(area, child_ctx, flags, reset);
     }
     if (beststate & STATE_BBOX) {
@@ -97,7 +99,6 @@ DrawingGroup::_renderItem(DrawingContext &dc, Geom::IntRect const &area, unsigne
     if (stop_at == nullptr) {
         // normal rendering
         for (auto &i : _children) {
-            i.setAntialiasing(_antialias);
             i.render(dc, area, flags, stop_at);
         }
     } else {
@@ -107,11 +108,9 @@ DrawingGroup::_renderItem(DrawingContext &dc, Geom::IntRect const &area, unsigne
                 return RENDER_OK; // do not render the stop_at item at all
             if (i.isAncestorOf(stop_at)) {
                 // render its ancestors without masks, opacity or filters
-                i.setAntialiasing(_antialias);
                 i.render(dc, area, flags | RENDER_FILTER_BACKGROUND, stop_at);
                 return RENDER_OK;
             } else {
-                i.setAntialiasing(_antialias);
                 i.render(dc, area, flags, stop_at);
             }
         }
@@ -123,7 +122,6 @@ void
 DrawingGroup::_clipItem(DrawingContext &dc, Geom::IntRect const &area)
 {
     for (auto & i : _children) {
-        i.setAntialiasing(_antialias);
         i.clip(dc, area);
     }
 }
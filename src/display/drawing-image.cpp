@@ -10,11 +10,13 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <algorithm>
 #include <2geom/bezier-curve.h>
 
 #include "display/drawing.h"
 #include "display/drawing-context.h"
 #include "display/drawing-image.h"
+#include "display/image-cache.h"
 #include "preferences.h"
 
 #include "display/cairo-utils.h"
@@ -39,6 +41,15 @@ DrawingImage::setPixbuf(Inkscape::Pixbuf *pb)
     _markForUpdate(STATE_ALL, false);
 }
 
+void
+DrawingImage::setPlaceholder(bool placeholder)
+{
+    if (_placeholder != placeholder) {
+        _placeholder = placeholder;
+        _markForUpdate(STATE_ALL, false);
+    }
+}
+
 void
 DrawingImage::setScale(double sx, double sy)
 {
@@ -82,8 +93,13 @@ DrawingImage::_updateItem(Geom::IntRect const &, UpdateContext const &, unsigned
 {
     _markForRendering();
 
-    // Calculate bbox
     if (_pixbuf) {
+        // Convert the pixels here, as the image may be rendered on several threads at once.
+        _pixbuf->ensurePixelFormat(Inkscape::Pixbuf::PF_CAIRO);
+    }
+
+    // Calculate bbox
+    if (_pixbuf || _placeholder) {
         Geom::Rect r = bounds() * _ctm;
         _bbox = r.roundOutwards();
     } else {
@@ -101,7 +117,17 @@ unsigned DrawingImage::_renderItem(DrawingContext &dc, Geom::IntRect const &/*ar
     bool imgoutline = prefs->getBool("/options/rendering/imageinoutlinemode", false);
 
     if (!outline || imgoutline) {
-        if (!_pixbuf) return RENDER_OK;
+        if (!_pixbuf) {
+            if (_placeholder) {
+                Inkscape::DrawingContext::Save save(dc);
+                dc.transform(_ctm);
+                dc.newPath();
+                dc.rectangle(_clipbox);
+                dc.setSource(0x80808040);
+                dc.fill();
+            }
+            return RENDER_OK;
+        }
 
         Inkscape::DrawingContext::Save save(dc);
         dc.transform(_ctm);
@@ -111,9 +137,9 @@ unsigned DrawingImage::_renderItem(DrawingContext &dc, Geom::IntRect const &/*ar
 
         dc.translate(_origin);
         dc.scale(_scale);
-        dc.setSource(_pixbuf->getSurfaceRaw(), 0, 0);
-        dc.patternSetExtend(CAIRO_EXTEND_PAD);
 
+        // In recent Cairo, BEST used Lanczos3, which is prohibitively slow
+        cairo_filter_t filter = CAIRO_FILTER_GOOD;
         if (_style) {
             // See: http://www.w3.org/TR/SVG/painting.html#ImageRenderingProperty
             //      https://drafts.csswg.org/css-images-3/#the-image-rendering
@@ -127,17 +153,39 @@ unsigned DrawingImage::_renderItem(DrawingContext &dc, Geom::IntRect const &/*ar
                 case SP_CSS_IMAGE_RENDERING_PIXELATED:
                 // we don't have an implementation for crisp-edges, but it should *not* smooth or blur
                 case SP_CSS_IMAGE_RENDERING_CRISPEDGES:
-                    dc.patternSetFilter( CAIRO_FILTER_NEAREST );
+                    filter = CAIRO_FILTER_NEAREST;
                     break;
                 case SP_CSS_IMAGE_RENDERING_AUTO:
                 case SP_CSS_IMAGE_RENDERING_OPTIMIZEQUALITY:
                 default:
-                    // In recent Cairo, BEST used Lanczos3, which is prohibitively slow
-                    dc.patternSetFilter( CAIRO_FILTER_GOOD );
                     break;
             }
         }
 
+        cairo_surface_t *image = _pixbuf->getSurfaceRaw(false); // converted during the update
+        cairo_surface_t *target = cairo_get_group_target(dc.raw());
+        cairo_surface_t *source = nullptr;
+        if (filter != CAIRO_FILTER_NEAREST && cairo_surface_get_type(target) == CAIRO_SURFACE_TYPE_IMAGE) {
+            // Zoomed out, draw from a smaller version of the image, so that all of its pixels
+            // are not resampled again for every tile.
+            double scale_x = 1.0, scale_y = 1.0;
+            cairo_surface_get_device_scale(target, &scale_x, &scale_y);
+            cairo_matrix_t cm;
+            cairo_get_matrix(dc.raw(), &cm);
+            Geom::Affine ctm;
+            ink_matrix_to_2geom(ctm, cm);
+            ctm *= Geom::Scale(scale_x, scale_y);
+            source = ImageCache::get().mipmap(image, std::max(ctm.expansionX(), ctm.expansionY()));
+            dc.scale(double(cairo_image_surface_get_width(image)) / cairo_image_surface_get_width(source),
+                     double(cairo_image_surface_get_height(image)) / cairo_image_surface_get_height(source));
+        } else {
+            source = cairo_surface_reference(image);
+        }
+        dc.setSource(source, 0, 0);
+        cairo_surface_destroy(source);
+        dc.patternSetExtend(CAIRO_EXTEND_PAD);
+        dc.patternSetFilter(filter);
+
         dc.paint(1);
 
     } else { // outline; draw a rect instead
@@ -185,7 +233,9 @@ distance_to_segment (Geom::Point const &p, Geom::Point const &a1, Geom::Point co
 DrawingItem *
 DrawingImage::_pickItem(Geom::Point const &p, double delta, unsigned /*sticky*/)
 {
-    if (!_pixbuf) return nullptr;
+    if (!_pixbuf) {
+        return _placeholder && bounds().contains(p * _ctm.inverse()) ? this : nullptr;
+    }
 
     bool outline = _drawing.outline() || _drawing.outlineOverlay() || _drawing.getOutlineSensitive();
 
@@ -30,6 +30,8 @@ public:
     ~DrawingImage() override;
 
     void setPixbuf(Inkscape::Pixbuf *pb);
+    /// Show a box in place of a missing pixbuf, e.g. while the image is decoded.
+    void setPlaceholder(bool placeholder);
     void setScale(double sx, double sy);
     void setOrigin(Geom::Point const &o);
     void setClipbox(Geom::Rect const &box);
@@ -43,6 +45,7 @@ protected:
     DrawingItem *_pickItem(Geom::Point const &p, double delta, unsigned flags) override;
 
     Inkscape::Pixbuf *_pixbuf;
+    bool _placeholder = false;
 
     // TODO: the following three should probably be merged into a new Geom::Viewbox object
     Geom::Rect _clipbox; ///< for preserveAspectRatio
@@ -16,6 +16,7 @@
 #include "display/drawing-group.h"
 #include "display/drawing-item.h"
 #include "display/drawing-pattern.h"
+#include "display/drawing-sampler.h"
 #include "display/drawing-surface.h"
 #include "display/drawing-text.h"
 #include "display/drawing.h"
@@ -70,6 +71,7 @@ DrawingItem::DrawingItem(Drawing &drawing)
     , _filter(nullptr)
     , _item(nullptr)
     , _cache(nullptr)
+    , _index_handle(-1)
     , _state(0)
     , _child_type(CHILD_ORPHAN)
     , _background_new(0)
@@ -106,6 +108,7 @@ DrawingItem::~DrawingItem()
 
     // remove from the set of cached items and delete cache
     setCached(false, true);
+    _removeFromIndex();
     // remove this item from parent's children list
     // due to the effect of clearChildren(), this only happens for the top-level deleted item
     if (_parent) {
@@ -251,7 +254,16 @@ DrawingItem::setAntialiasing(unsigned a)
 {
     if (_antialias != a) {
         _antialias = a;
+        // propagate antialias setting to clip and mask
+        if (_clip) {
+            _clip->setAntialiasing(a);
+        }
+        if (_mask) {
+            _mask->setAntialiasing(a);
+        }
         _markForRendering();
+        // groups pass the setting on to their children during the update
+        _markForUpdate(STATE_RENDER, true);
     }
 }
 
@@ -394,6 +406,7 @@ DrawingItem::setClip(DrawingItem *item)
         item->_parent = this;
         assert(item->_child_type == CHILD_ORPHAN);
         item->_child_type = CHILD_CLIP;
+        item->setAntialiasing(_antialias);
     }
     _markForUpdate(STATE_ALL, true);
 }
@@ -408,6 +421,7 @@ DrawingItem::setMask(DrawingItem *item)
         item->_parent = this;
         assert(item->_child_type == CHILD_ORPHAN);
         item->_child_type = CHILD_MASK;
+        item->setAntialiasing(_antialias);
     }
     _markForUpdate(STATE_ALL, true);
 }
@@ -592,6 +606,7 @@ DrawingItem::update(Geom::IntRect const &area, UpdateContext const &ctx, unsigne
                 _drawbox.intersectWith(_mask->_drawbox);
             }
         }
+        _updateIndex();
     }
     if (to_update & STATE_CACHE) {
         // Update cache score for this item
@@ -632,7 +647,20 @@ DrawingItem::update(Geom::IntRect const &area, UpdateContext const &ctx, unsigne
                 setCached(false, true);
             }
         }
+
+        // Filtered items are always cached when they are within the cache limit.
+        if (_filter && render_filters) {
+            setCached(bool(_cacheRect()), true);
+        }
+    }
+
+    // Items which no longer need an intermediate rendering drop their cache. This and the
+    // above are done here rather than while rendering, which may happen on several threads.
+    bool const nir = _needsIntermediateRendering();
+    if (_prev_nir && !nir) {
+        setCached(false, true);
     }
+    _prev_nir = nir;
 
     if (to_update & STATE_RENDER) {
         // now that we know drawbox, dirty the corresponding rect on canvas
@@ -709,6 +737,10 @@ DrawingItem::render(DrawingContext &dc, Geom::IntRect const &area, unsigned flag
     // Note 2: We only need to render carea of clip and mask, but
     //         iarea of the object.
     
+    // Whether the item is cached is decided during the update. The cache itself is shared by
+    // all threads rendering this item.
+    std::unique_lock<std::mutex> cache_lock(_cache_mutex);
+
     Geom::OptIntRect iarea = carea;
     // expand carea to contain the dependent area of filters.
     if (_filter && render_filters) {
@@ -717,9 +749,6 @@ DrawingItem::render(DrawingContext &dc, Geom::IntRect const &area, unsigned flag
             iarea = carea;
             _filter->area_enlarge(*iarea, this);
             iarea.intersectWith(_drawbox);
-            setCached(false, true);
-        } else {
-            setCached(true, true);
         }
     }
 
@@ -743,7 +772,7 @@ DrawingItem::render(DrawingContext &dc, Geom::IntRect const &area, unsigned flag
         if (_cache) {
             _cache->prepare();
             dc.setOperator(ink_css_blend_to_cairo_operator(_mix_blend_mode));
-            _cache->paintFromCache(dc, carea, _filter && render_filters);
+            _cache->paintFromCache(dc, carea);
             if (!carea) {
                 dc.setSource(0, 0, 0, 0);
                 return RENDER_OK;
@@ -761,24 +790,26 @@ DrawingItem::render(DrawingContext &dc, Geom::IntRect const &area, unsigned flag
         // deleted in setCached()
     }
 
+    // A cached filter only needs to recompute the outdated part of the cache, from the
+    // area this part depends on. If that is most of the cache anyway, recompute all of it
+    // at once, so that the following tiles are painted from the cache.
+    bool filter_partial = false;
+    if (_filter && render_filters && _cached && _cache && !(flags & RENDER_BYPASS_CACHE)) {
+        Geom::OptIntRect needed = carea;
+        _filter->area_enlarge(*needed, this);
+        needed.intersectWith(_drawbox);
+        if (needed && 2.0 * needed->width() * needed->height() < 1.0 * iarea->width() * iarea->height()) {
+            iarea = needed;
+            filter_partial = true;
+        }
+    }
+
     // determine whether this shape needs intermediate rendering.
-    bool needs_intermediate_rendering = false;
+    bool needs_intermediate_rendering = _needsIntermediateRendering();
     bool &nir = needs_intermediate_rendering;
-    bool needs_opacity = (_opacity < 0.995);
-
-    // this item needs an intermediate rendering if:                      
-    nir |= (_clip != nullptr);                       // 1. it has a clipping path
-    nir |= (_mask != nullptr);                       // 2. it has a mask
-    nir |= (_filter != nullptr && render_filters);   // 3. it has a filter
-    nir |= needs_opacity;                            // 4. it is non-opaque
-    nir |= (_mix_blend_mode != SP_CSS_BLEND_NORMAL); // 5. it has blend mode           
-    nir |= (_isolation == SP_CSS_ISOLATION_ISOLATE); // 6. it is isolated    
-    nir |= !parent();                                // 7. is root, need isolation from background
-    if (_prev_nir && !needs_intermediate_rendering) {
-        setCached(false, true);
-    }
-    _prev_nir = needs_intermediate_rendering;
-    nir |= (_cache != nullptr);                      // 5. it is to be cached
+    nir |= (_cache != nullptr);                      // 8. it is to be cached
+    bool const to_cache = _cached && _cache;
+    cache_lock.unlock();
 
     /* How the rendering is done.
      *
@@ -827,7 +858,6 @@ DrawingItem::render(DrawingContext &dc, Geom::IntRect const &area, unsigned flag
     ict.paint();
     if (_clip) {
         ict.pushGroup();
-        _clip->setAntialiasing(_antialias); // propagate antialias setting
         _clip->clip(ict, *carea);
         ict.popGroupToSource();
         ict.setOperator(CAIRO_OPERATOR_IN);
@@ -838,7 +868,6 @@ DrawingItem::render(DrawingContext &dc, Geom::IntRect const &area, unsigned flag
     // 2. Render the mask if present and compose it with the clipping path + opacity.
     if (_mask) {
         ict.pushGroup();
-        _mask->setAntialiasing(_antialias); // propagate antialias setting
         _mask->render(ict, *carea, flags);
 
         cairo_surface_t *mask_s = ict.rawTarget();
@@ -884,19 +913,23 @@ DrawingItem::render(DrawingContext &dc, Geom::IntRect const &area, unsigned flag
     ict.paint();
 
     // 6. Paint the completed rendering onto the base context (or into cache)
-    if (_cached && _cache) {
+    cache_lock.lock();
+    if (to_cache && _cached && _cache) {
+        // Filter results are only valid where their whole input was rendered.
+        Geom::IntRect const &valid = filter_partial ? *carea : *iarea;
         DrawingContext cachect(*_cache);
-        cachect.rectangle(*iarea);
+        cachect.rectangle(valid);
         cachect.setOperator(CAIRO_OPERATOR_SOURCE);
         cachect.setSource(&intermediate);
         cachect.fill();
         Geom::OptIntRect cl = _cacheRect();
-        if (_filter && render_filters && cl) {
+        if (_filter && render_filters && cl && !filter_partial) {
             _cache->markClean(*cl);
         } else {
-            _cache->markClean(*iarea);
+            _cache->markClean(valid);
         }
     }
+    cache_lock.unlock();
 
     dc.rectangle(*carea);
     dc.setSource(&intermediate);
@@ -925,19 +958,32 @@ DrawingItem::_renderOutline(DrawingContext &dc, Geom::IntRect const &area, unsig
     _renderItem(dc, *carea, flags, nullptr);
 
     // render clip and mask, if any
-    guint32 saved_rgba = _drawing.outlinecolor; // save current outline color
     // render clippath as an object, using a different color
-    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
     if (_clip) {
-        _drawing.outlinecolor = prefs->getInt("/options/wireframecolors/clips", 0x00ff00ff); // green clips
-        _clip->render(dc, *carea, flags);
+        _clip->render(dc, *carea, flags | RENDER_OUTLINE_CLIP);
     }
     // render mask as an object, using a different color
     if (_mask) {
-        _drawing.outlinecolor = prefs->getInt("/options/wireframecolors/masks", 0x0000ffff); // blue masks
-        _mask->render(dc, *carea, flags);
+        _mask->render(dc, *carea, flags | RENDER_OUTLINE_MASK);
     }
-    _drawing.outlinecolor = saved_rgba; // restore outline color
+}
+
+/**
+ * Color of the outline of this item in outline mode. Clips and masks are shown in their own
+ * colors; the flags say whether the item is part of one, as the drawing is not changed while
+ * rendering.
+ */
+uint32_t
+DrawingItem::_outlineColor(unsigned flags) const
+{
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    if (flags & RENDER_OUTLINE_CLIP) {
+        return prefs->getInt("/options/wireframecolors/clips", 0x00ff00ff); // green clips
+    }
+    if (flags & RENDER_OUTLINE_MASK) {
+        return prefs->getInt("/options/wireframecolors/masks", 0x0000ffff); // blue masks
+    }
+    return _drawing.outlinecolor;
 }
 
 /**
@@ -1108,6 +1154,8 @@ DrawingItem::_markForRendering()
         bkg_root->_invalidateFilterBackground(*dirty);
     }
 
+    _drawing._sampler->invalidate(*dirty);
+
     //_drawing.signal_request_render.emit(*dirty);
     if (drawing().getCanvasItemDrawing()) {
         Geom::Rect area = *dirty;
@@ -1213,6 +1261,24 @@ DrawingItem::_cacheScore()
     return score;
 }
 
+/**
+ * Whether the item is rendered to an intermediate surface, rather than straight onto the
+ * context, even when it is not cached.
+ */
+bool DrawingItem::_needsIntermediateRendering() const
+{
+    bool nir = false;
+    // this item needs an intermediate rendering if:
+    nir |= (_clip != nullptr);                                 // 1. it has a clipping path
+    nir |= (_mask != nullptr);                                 // 2. it has a mask
+    nir |= (_filter != nullptr && _drawing.renderFilters());   // 3. it has a filter
+    nir |= (_opacity < 0.995);                                 // 4. it is non-opaque
+    nir |= (_mix_blend_mode != SP_CSS_BLEND_NORMAL);           // 5. it has blend mode
+    nir |= (_isolation == SP_CSS_ISOLATION_ISOLATE);           // 6. it is isolated
+    nir |= !_parent;                                           // 7. is root, need isolation from background
+    return nir;
+}
+
 inline void expandByScale(Geom::IntRect &rect, double scale)
 {
     double fraction = (scale - 1) / 2;
@@ -1242,6 +1308,40 @@ Geom::OptIntRect DrawingItem::_cacheRect()
     return r;
 }
 
+/**
+ * Store the current bounds of this item in the spatial index of the drawing.
+ *
+ * Only items created for an SPItem and reachable from the root through regular
+ * children are indexed; everything else (clips, masks, patterns and their contents,
+ * glyphs) is found through its owner.
+ */
+void DrawingItem::_updateIndex()
+{
+    Geom::OptIntRect box = _bbox;
+    box.unionWith(_drawbox);
+
+    bool indexed = _item && box;
+    for (DrawingItem *i = this; indexed && i->_child_type != CHILD_ROOT; i = i->_parent) {
+        indexed = i->_child_type == CHILD_NORMAL;
+    }
+
+    if (!indexed) {
+        _removeFromIndex();
+    } else if (_index_handle == -1) {
+        _index_handle = _drawing._index.insert(*box, this);
+    } else {
+        _drawing._index.update(_index_handle, *box);
+    }
+}
+
+void DrawingItem::_removeFromIndex()
+{
+    if (_index_handle != -1) {
+        _drawing._index.remove(_index_handle);
+        _index_handle = -1;
+    }
+}
+
 // apply antialias setting to cairo
 void DrawingItem::_applyAntialias(DrawingContext &dc, unsigned _antialias)
 {
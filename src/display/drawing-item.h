@@ -18,8 +18,10 @@
 #include <boost/operators.hpp>
 #include <boost/utility.hpp>
 #include <boost/intrusive/list.hpp>
+#include <cstdint>
 #include <exception>
 #include <list>
+#include <mutex>
 
 #include "style-enums.h"
 
@@ -76,7 +78,9 @@ public:
         RENDER_DEFAULT = 0,
         RENDER_CACHE_ONLY = 1,
         RENDER_BYPASS_CACHE = 2,
-        RENDER_FILTER_BACKGROUND = 4
+        RENDER_FILTER_BACKGROUND = 4,
+        RENDER_OUTLINE_CLIP = 8, ///< Outline mode: the item is rendered as part of a clipping path
+        RENDER_OUTLINE_MASK = 16 ///< Outline mode: the item is rendered as part of a mask
     };
     enum StateFlags {
         STATE_NONE = 0,
@@ -160,11 +164,15 @@ protected:
         RENDER_STOP = 1
     };
     void _renderOutline(DrawingContext &dc, Geom::IntRect const &area, unsigned flags);
+    uint32_t _outlineColor(unsigned flags) const;
     void _markForUpdate(unsigned state, bool propagate);
     void _markForRendering();
     void _invalidateFilterBackground(Geom::IntRect const &area);
     double _cacheScore();
     Geom::OptIntRect _cacheRect();
+    bool _needsIntermediateRendering() const;
+    void _updateIndex();
+    void _removeFromIndex();
     virtual unsigned _updateItem(Geom::IntRect const &/*area*/, UpdateContext const &/*ctx*/,
                                  unsigned /*flags*/, unsigned /*reset*/) { return 0; }
     virtual unsigned _renderItem(DrawingContext &/*dc*/, Geom::IntRect const &/*area*/, unsigned /*flags*/,
@@ -213,9 +221,11 @@ protected:
     Inkscape::Filters::Filter *_filter;
     SPItem *_item; ///< Used to associate DrawingItems with SPItems that created them
     DrawingCache *_cache;
+    std::mutex _cache_mutex; ///< Guards _cache while the item is rendered on several threads
     bool _prev_nir;
 
     CacheList::iterator _cache_iterator;
+    int _index_handle; ///< Leaf of Drawing::_index holding this item, or -1
 
     unsigned _state : 8;
     unsigned _propagate_state : 8;
@@ -0,0 +1,205 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Average colors of rectangles of a drawing, from cached summed-area tables.
+ *//*
+ * Authors:
+ *   see git history
+ *
+ * Copyright (C) 2022 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "display/drawing-sampler.h"
+
+#include <algorithm>
+#include <limits>
+#include <cairo.h>
+
+#include "display/cairo-utils.h"
+#include "display/drawing-context.h"
+#include "display/drawing.h"
+
+namespace Inkscape {
+
+namespace {
+
+int floor_div(int a, int b)
+{
+    return a / b - (a % b < 0);
+}
+
+} // namespace
+
+DrawingSampler::DrawingSampler(Drawing &drawing)
+    : _drawing(drawing)
+{}
+
+std::uint64_t DrawingSampler::_key(int tx, int ty)
+{
+    return (std::uint64_t(std::uint32_t(tx)) << 32) | std::uint32_t(ty);
+}
+
+Geom::IntRect DrawingSampler::_tileRect(int tx, int ty)
+{
+    return Geom::IntRect::from_xywh(tx * TILE_SIZE, ty * TILE_SIZE, TILE_SIZE, TILE_SIZE);
+}
+
+void DrawingSampler::average(Geom::IntRect const &area, double &R, double &G, double &B, double &A)
+{
+    R = G = B = A = 0.0;
+    if (area.hasZeroArea()) {
+        return;
+    }
+
+    std::uint64_t sums[4] = {0, 0, 0, 0};
+    int const stride = TILE_SIZE + 1;
+
+    int const tx0 = floor_div(area.left(), TILE_SIZE);
+    int const tx1 = floor_div(area.right() - 1, TILE_SIZE);
+    int const ty0 = floor_div(area.top(), TILE_SIZE);
+    int const ty1 = floor_div(area.bottom() - 1, TILE_SIZE);
+
+    for (int ty = ty0; ty <= ty1; ++ty) {
+        for (int tx = tx0; tx <= tx1; ++tx) {
+            Geom::IntRect const rect = _tileRect(tx, ty);
+            Geom::IntRect const part = *Geom::intersect(area, rect);
+            int const x0 = part.left() - rect.left();
+            int const x1 = part.right() - rect.left();
+            int const y0 = part.top() - rect.top();
+            int const y1 = part.bottom() - rect.top();
+
+            auto accumulate = [&] (Tile const &tile) {
+                auto const &a = tile.table[y0 * stride + x0];
+                auto const &b = tile.table[y0 * stride + x1];
+                auto const &c = tile.table[y1 * stride + x0];
+                auto const &d = tile.table[y1 * stride + x1];
+                for (int i = 0; i < 4; ++i) {
+                    sums[i] += d[i] - b[i] - c[i] + a[i];
+                }
+            };
+
+            std::unique_lock<std::mutex> lock(_mutex);
+            auto const key = _key(tx, ty);
+            if (auto tile = _tiles.find(key)) {
+                tile->last_use = ++_clock;
+                accumulate(*tile);
+                continue;
+            }
+
+            // Render without holding the lock, since rendering may invalidate other tiles.
+            auto const generation = _generation;
+            lock.unlock();
+            Tile tile = _render(tx, ty);
+            lock.lock();
+
+            accumulate(tile);
+            if (generation == _generation) {
+                tile.last_use = ++_clock;
+                _tiles.insert_or_assign(key, std::move(tile));
+                _evict();
+            }
+        }
+    }
+
+    double const count = double(area.width()) * area.height() * 255.0;
+    R = sums[0] / count;
+    G = sums[1] / count;
+    B = sums[2] / count;
+    A = sums[3] / count;
+}
+
+/// Render a tile and compute the summed-area table of its pixels.
+DrawingSampler::Tile DrawingSampler::_render(int tx, int ty)
+{
+    Geom::IntRect const rect = _tileRect(tx, ty);
+    cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, TILE_SIZE, TILE_SIZE);
+    {
+        DrawingContext dc(surface, rect.min());
+        _drawing.render(dc, rect);
+    }
+    cairo_surface_flush(surface);
+
+    int const stride = TILE_SIZE + 1;
+    int const data_stride = cairo_image_surface_get_stride(surface);
+    unsigned char const *data = cairo_image_surface_get_data(surface);
+
+    Tile tile;
+    tile.table.assign(stride * stride, Sums{0, 0, 0, 0});
+    for (int y = 0; y < TILE_SIZE; ++y, data += data_stride) {
+        Sums row = {0, 0, 0, 0};
+        auto const *above = &tile.table[y * stride];
+        auto *out = &tile.table[(y + 1) * stride];
+        for (int x = 0; x < TILE_SIZE; ++x) {
+            guint32 px = reinterpret_cast<guint32 const *>(data)[x];
+            EXTRACT_ARGB32(px, a, r, g, b)
+            row[0] += r;
+            row[1] += g;
+            row[2] += b;
+            row[3] += a;
+            for (int i = 0; i < 4; ++i) {
+                out[x + 1][i] = above[x + 1][i] + row[i];
+            }
+        }
+    }
+
+    cairo_surface_destroy(surface);
+    return tile;
+}
+
+/// Drop the least recently used tiles above the limit.
+void DrawingSampler::_evict()
+{
+    while (_tiles.size() > MAX_TILES) {
+        std::uint64_t oldest_key = 0;
+        std::uint64_t oldest_use = std::numeric_limits<std::uint64_t>::max();
+        _tiles.for_each([&] (std::uint64_t key, Tile const &tile) {
+            if (tile.last_use < oldest_use) {
+                oldest_use = tile.last_use;
+                oldest_key = key;
+            }
+        });
+        _tiles.erase(oldest_key);
+    }
+}
+
+void DrawingSampler::invalidate(Geom::IntRect const &area)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_generation;
+    if (_tiles.empty()) {
+        return;
+    }
+
+    std::vector<std::uint64_t> stale;
+    _tiles.for_each([&] (std::uint64_t key, Tile const &) {
+        int const tx = std::int32_t(key >> 32);
+        int const ty = std::int32_t(key & 0xffffffff);
+        if (_tileRect(tx, ty).intersects(area)) {
+            stale.push_back(key);
+        }
+    });
+    for (auto key : stale) {
+        _tiles.erase(key);
+    }
+}
+
+void DrawingSampler::clear()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_generation;
+    _tiles.clear();
+}
+
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Average colors of rectangles of a drawing, from cached summed-area tables.
+ *//*
+ * Authors:
+ *   see git history
+ *
+ * Copyright (C) 2022 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_INKSCAPE_DISPLAY_DRAWING_SAMPLER_H
+#define SEEN_INKSCAPE_DISPLAY_DRAWING_SAMPLER_H
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <2geom/int-rect.h>
+
+#include "util/flat-hash-map.h"
+
+namespace Inkscape {
+
+class Drawing;
+
+/**
+ * Answers average color queries for a drawing without rendering the queried area every time.
+ *
+ * The drawing is rendered in square tiles of device pixels, the first time a query touches
+ * them. Each tile keeps the summed-area table of its premultiplied channels instead of its
+ * pixels, so the sum over any rectangle of the tile takes four lookups, and the average over
+ * any rectangle of the drawing costs a few lookups per tile it covers.
+ *
+ * Tiles are dropped when the drawing marks an area intersecting them for rendering, when its
+ * rendering settings change, and, least recently used first, when there are too many of them.
+ * The drawing must be up to date when it is queried, like for Drawing::render().
+ */
+class DrawingSampler
+{
+public:
+    explicit DrawingSampler(Drawing &drawing);
+
+    /// Average premultiplied color of an area, with channels in the range 0..1.
+    void average(Geom::IntRect const &area, double &R, double &G, double &B, double &A);
+
+    /// Forget what is known about an area, because it will render differently.
+    void invalidate(Geom::IntRect const &area);
+
+    /// Forget everything.
+    void clear();
+
+private:
+    static constexpr int TILE_SIZE = 128;
+    static constexpr std::size_t MAX_TILES = 256; ///< about 64 MiB of tables
+
+    using Sums = std::array<std::uint32_t, 4>; ///< sums of the R, G, B and A bytes
+
+    struct Tile
+    {
+        std::vector<Sums> table; ///< (TILE_SIZE + 1)^2 sums of the pixels above and left of each entry
+        std::uint64_t last_use = 0;
+    };
+
+    static std::uint64_t _key(int tx, int ty);
+    static Geom::IntRect _tileRect(int tx, int ty);
+    Tile _render(int tx, int ty);
+    void _evict();
+
+    Drawing &_drawing;
+    std::mutex _mutex;
+    Util::FlatHashMap<std::uint64_t, Tile> _tiles;
+    std::uint64_t _clock = 0;      ///< counts tile uses, for eviction
+    std::uint64_t _generation = 0; ///< counts invalidations
+};
+
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_DISPLAY_DRAWING_SAMPLER_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -53,6 +53,7 @@ DrawingShape::setPath(SPCurve *curve)
     _markForRendering();
 
     _curve = curve ? curve->ref() : nullptr;
+    _cairo_path.set(_curve ? &_curve->get_pathvector() : nullptr);
 
     _markForUpdate(STATE_ALL, false);
 }
@@ -155,7 +156,7 @@ DrawingShape::_renderFill(DrawingContext &dc)
     bool has_fill =  _nrstyle.prepareFill(dc, _item_bbox, _fill_pattern);
 
     if( has_fill ) {
-        dc.path(_curve->get_pathvector());
+        dc.path(_cairo_path);
         _nrstyle.applyFill(dc);
         dc.fillPreserve();
         dc.newPath(); // clear path
@@ -175,7 +176,7 @@ DrawingShape::_renderStroke(DrawingContext &dc)
 
     if( has_stroke ) {
         // TODO: remove segments outside of bbox when no dashes present
-        dc.path(_curve->get_pathvector());
+        dc.path(_cairo_path);
         if (_style && _style->vector_effect.stroke) {
             dc.restore();
             dc.save();
@@ -215,12 +216,12 @@ DrawingShape::_renderItem(DrawingContext &dc, Geom::IntRect const &area, unsigne
     bool outline = _drawing.outline();
 
     if (outline) {
-        guint32 rgba = _drawing.outlinecolor;
+        guint32 rgba = _outlineColor(flags);
 
         // paint-order doesn't matter
         {   Inkscape::DrawingContext::Save save(dc);
             dc.transform(_ctm);
-            dc.path(_curve->get_pathvector());
+            dc.path(_cairo_path);
         }
         {   Inkscape::DrawingContext::Save save(dc);
             dc.setSource(rgba);
@@ -250,7 +251,7 @@ DrawingShape::_renderItem(DrawingContext &dc, Geom::IntRect const &area, unsigne
             bool has_stroke = _nrstyle.prepareStroke(dc, _item_bbox, _stroke_pattern);
             has_stroke &= (_nrstyle.stroke_width != 0 || _nrstyle.hairline == true);
             if (has_fill || has_stroke) {
-                dc.path(_curve->get_pathvector());
+                dc.path(_cairo_path);
                 // TODO: remove segments outside of bbox when no dashes present
                 if (has_fill) {
                     _nrstyle.applyFill(dc);
@@ -317,7 +318,7 @@ void DrawingShape::_clipItem(DrawingContext &dc, Geom::IntRect const & /*area*/)
         }
     }
     dc.transform(_ctm);
-    dc.path(_curve->get_pathvector());
+    dc.path(_cairo_path);
     dc.fill();
 }
 
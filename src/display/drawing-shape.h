@@ -13,6 +13,7 @@
 #ifndef SEEN_INKSCAPE_DISPLAY_DRAWING_SHAPE_H
 #define SEEN_INKSCAPE_DISPLAY_DRAWING_SHAPE_H
 
+#include "display/cairo-path.h"
 #include "display/drawing-item.h"
 #include "display/nr-style.h"
 
@@ -49,6 +50,7 @@ protected:
                         DrawingItem *stop_at);
 
     std::unique_ptr<SPCurve> _curve;
+    CairoPath _cairo_path; ///< _curve kept in device space for rendering
     NRStyle _nrstyle;
 
     DrawingItem *_last_pick;
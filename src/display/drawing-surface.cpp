@@ -308,7 +308,7 @@ DrawingCache::prepare()
  * Paints the clean area from cache and modifies the @a area
  * parameter to the bounds of the region that must be repainted.
  */
-void DrawingCache::paintFromCache(DrawingContext &dc, Geom::OptIntRect &area, bool is_filter)
+void DrawingCache::paintFromCache(DrawingContext &dc, Geom::OptIntRect &area)
 {
     if (!area) return;
 
@@ -322,9 +322,6 @@ void DrawingCache::paintFromCache(DrawingContext &dc, Geom::OptIntRect &area, bo
     cairo_region_t *cache_region = cairo_region_copy(dirty_region);
     cairo_region_subtract(dirty_region, _clean_region);
 
-    if (is_filter && !cairo_region_is_empty(dirty_region)) { // To allow fast panning on high zoom on filters
-        return;
-    }
     if (cairo_region_is_empty(dirty_region)) {
         area = Geom::OptIntRect();
     } else {
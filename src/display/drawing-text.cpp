@@ -19,6 +19,7 @@
 #include "display/drawing-surface.h"
 #include "display/drawing-text.h"
 #include "display/drawing.h"
+#include "display/glyph-cache.h"
 
 #include "helper/geom.h"
 
@@ -52,6 +53,7 @@ DrawingGlyphs::setGlyph(font_instance *font, int glyph, Geom::Affine const &tran
     if (_font) _font->Unref();
     _font = font;
     _glyph = glyph;
+    _cairo_path.set(font ? font->PathVector(glyph) : nullptr);
 
     _markForUpdate(STATE_ALL, false);
 }
@@ -456,10 +458,10 @@ void DrawingText::decorateItem(DrawingContext &dc, double phase_length, bool und
     }
 }
 
-unsigned DrawingText::_renderItem(DrawingContext &dc, Geom::IntRect const &/*area*/, unsigned /*flags*/, DrawingItem * /*stop_at*/)
+unsigned DrawingText::_renderItem(DrawingContext &dc, Geom::IntRect const &/*area*/, unsigned flags, DrawingItem * /*stop_at*/)
 {
     if (_drawing.outline()) {
-        guint32 rgba = _drawing.outlinecolor;
+        guint32 rgba = _outlineColor(flags);
         Inkscape::DrawingContext::Save save(dc);
         dc.setSource(rgba);
         dc.setTolerance(0.5); // low quality, but good enough for outline mode
@@ -473,7 +475,7 @@ unsigned DrawingText::_renderItem(DrawingContext &dc, Geom::IntRect const &/*are
             if (g->_ctm.isSingular()) continue;
             dc.transform(g->_ctm);
             if(g->_drawable){
-                dc.path(*g->_font->PathVector(g->_glyph));
+                dc.path(g->_cairo_path);
                 dc.fill();
             }
         }
@@ -593,6 +595,11 @@ unsigned DrawingText::_renderItem(DrawingContext &dc, Geom::IntRect const &/*are
             dc.newPath(); // Clear text-decoration path
         }
 
+        // Plain filled text is composited from cached glyph coverage masks. Glyphs that cannot
+        // be cached are accumulated into the path like all others.
+        bool const use_glyph_cache = has_fill && !has_stroke &&
+            _nrstyle.fill.type == NRStyle::PAINT_COLOR && _nrstyle.fill.opacity >= 1.0;
+
         // Accumulate the path that represents the glyphs and/or draw SVG glyphs.
         for (auto & i : _children) {
             DrawingGlyphs *g = dynamic_cast<DrawingGlyphs *>(&i);
@@ -625,10 +632,16 @@ unsigned DrawingText::_renderItem(DrawingContext &dc, Geom::IntRect const &/*are
                             dc.paint(1);
                         }
                     } else {
-                        dc.path(*g->_font->PathVector(g->_glyph));
+                        dc.path(g->_cairo_path);
+                    }
+                } else if (use_glyph_cache) {
+                    // The fill is a solid color, so it does not depend on the transform.
+                    _nrstyle.applyFill(dc);
+                    if (!GlyphCache::get().paint(dc, g->_font, g->_glyph, _nrstyle.fill_rule)) {
+                        dc.path(g->_cairo_path);
                     }
                 } else {
-                    dc.path(*g->_font->PathVector(g->_glyph));
+                    dc.path(g->_cairo_path);
                 }
             }
         }
@@ -732,7 +745,7 @@ void DrawingText::_clipItem(DrawingContext &dc, Geom::IntRect const &/*area*/)
         Inkscape::DrawingContext::Save save(dc);
         dc.transform(g->_ctm);
         if(g->_drawable){
-            dc.path(*g->_font->PathVector(g->_glyph));
+            dc.path(g->_cairo_path);
         }
     }
     dc.fill();
@@ -13,6 +13,7 @@
 #ifndef SEEN_INKSCAPE_DISPLAY_DRAWING_TEXT_H
 #define SEEN_INKSCAPE_DISPLAY_DRAWING_TEXT_H
 
+#include "display/cairo-path.h"
 #include "display/drawing-group.h"
 #include "display/nr-style.h"
 
@@ -45,6 +46,7 @@ public:
     float          _dsc;            //
     float          _pl;             // phase length
     Geom::IntRect  _pick_bbox;
+    CairoPath      _cairo_path;     ///< glyph outline kept in device space for rendering
 
     friend class DrawingText;
 };
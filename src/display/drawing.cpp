@@ -15,10 +15,12 @@
 #include "display/control/canvas-item-drawing.h"
 #include "nr-filter-gaussian.h"
 #include "nr-filter-types.h"
+#include "preferences.h"
 
 //grayscale colormode:
 #include "cairo-templates.h"
 #include "drawing-context.h"
+#include "drawing-sampler.h"
 
 
 namespace Inkscape {
@@ -32,7 +34,8 @@ static const gdouble grayscale_value_matrix[20] = {
 };
 
 Drawing::Drawing(Inkscape::CanvasItemDrawing *canvas_item_drawing)
-    : _canvas_item_drawing(canvas_item_drawing)
+    : _sampler(std::make_unique<DrawingSampler>(*this))
+    , _canvas_item_drawing(canvas_item_drawing)
     , _grayscale_colormatrix(std::vector<gdouble>(grayscale_value_matrix, grayscale_value_matrix + 20))
 {
     // _canvas_item_drawing can be null. Used this way by Eraser tool.
@@ -48,6 +51,7 @@ Drawing::setRoot(DrawingItem *item)
 {
     delete _root;
     _root = item;
+    _sampler->clear();
     if (item) {
         assert(item->_child_type == DrawingItem::CHILD_ORPHAN);
         item->_child_type = DrawingItem::CHILD_ROOT;
@@ -106,27 +110,42 @@ Drawing::filterQuality() const
 void
 Drawing::setRenderMode(RenderMode mode)
 {
-    _rendermode = mode;
+    if (_rendermode != mode) {
+        _rendermode = mode;
+        _sampler->clear();
+    }
 }
 void
 Drawing::setColorMode(ColorMode mode)
 {
-    _colormode = mode;
+    if (_colormode != mode) {
+        _colormode = mode;
+        _sampler->clear();
+    }
 }
 void
 Drawing::setBlurQuality(int q)
 {
-    _blur_quality = q;
+    if (_blur_quality != q) {
+        _blur_quality = q;
+        _sampler->clear();
+    }
 }
 void
 Drawing::setFilterQuality(int q)
 {
-    _filter_quality = q;
+    if (_filter_quality != q) {
+        _filter_quality = q;
+        _sampler->clear();
+    }
 }
 void
 Drawing::setExact(bool e)
 {
-    _exact = e;
+    if (_exact != e) {
+        _exact = e;
+        _sampler->clear();
+    }
 }
 
 void Drawing::setOutlineSensitive(bool e) { _outline_sensitive = e; };
@@ -140,11 +159,9 @@ void
 Drawing::setCacheLimit(Geom::OptIntRect const &r, bool update_cache)
 {
     _cache_limit = r;
-    if (update_cache) {
-        for (auto _cached_item : _cached_items)
-        {
-            _cached_item->_markForUpdate(DrawingItem::STATE_CACHE, false);
-        }
+    if (update_cache && _root) {
+        // Not only the cached items: filtered items are cached whenever they are within the limit.
+        _root->_markForUpdate(DrawingItem::STATE_CACHE, true);
     }
 }
 void
@@ -158,11 +175,22 @@ void
 Drawing::setGrayscaleMatrix(gdouble value_matrix[20]) {
     _grayscale_colormatrix = Filters::FilterColorMatrix::ColorMatrixMatrix( 
         std::vector<gdouble> (value_matrix, value_matrix + 20) );
+    _sampler->clear();
 }
 
 void
 Drawing::update(Geom::IntRect const &area, unsigned flags, unsigned reset)
 {
+    // Filters follow the quality preferences. These are read here rather than while rendering,
+    // which may happen on several threads at once.
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    setFilterQuality(prefs->getInt("/options/filterquality/value", 0));
+    setBlurQuality(prefs->getInt("/options/blurquality/value", 0));
+
+    if (reset) {
+        // Items whose state is reset, e.g. on zoom, only mark where they are after the update.
+        _sampler->clear();
+    }
     if (_root) {
         auto ctx = _canvas_item_drawing ? _canvas_item_drawing->get_context() : UpdateContext();
         _root->update(area, ctx, flags, reset);
@@ -210,6 +238,23 @@ Drawing::pick(Geom::Point const &p, double delta, unsigned flags)
     return nullptr;
 }
 
+/**
+ * Return the items associated with an SPItem whose bounds touch the given area.
+ *
+ * Only items on the main rendering tree are considered, i.e. not clips, masks or
+ * patterns. The result is a superset of what pick() could return for any point of
+ * the area and is in no particular order. Call update() first to get current bounds.
+ *
+ * @param area Area in drawing (display) coordinates
+ */
+std::vector<DrawingItem *>
+Drawing::itemsInArea(Geom::Rect const &area) const
+{
+    std::vector<DrawingItem *> result;
+    _index.query(area, [&] (DrawingItem *item) { result.push_back(item); });
+    return result;
+}
+
 void
 Drawing::_pickItemsForCaching()
 {
@@ -239,15 +284,27 @@ Drawing::_pickItemsForCaching()
 
 /*
  * Return average color over area. Used by Calligraphic, Dropper, and Spray tools.
+ * The color is premultiplied by the average alpha.
  */
 void
 Drawing::average_color(Geom::IntRect const &area, double &R, double &G, double &B, double &A)
 {
-    auto surface = Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32, area.width(), area.height());
-    Inkscape::DrawingContext dc(surface->cobj(), area.min());
-    render(dc, area);
+    _sampler->average(area, R, G, B, A);
+}
 
-    ink_cairo_surface_average_color_premul(surface->cobj(), R, G, B, A);
+/*
+ * Return average color over area, not premultiplied, like ink_cairo_surface_average_color().
+ * Used by the Clone Tiler to trace the drawing.
+ */
+void
+Drawing::average_color_unpremul(Geom::IntRect const &area, double &R, double &G, double &B, double &A)
+{
+    _sampler->average(area, R, G, B, A);
+    if (A > 0) {
+        R = CLAMP(R / A, 0.0, 1.0);
+        G = CLAMP(G / A, 0.0, 1.0);
+        B = CLAMP(B / A, 0.0, 1.0);
+    }
 }
 
 
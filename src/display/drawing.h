@@ -16,19 +16,23 @@
 #include <2geom/rect.h>
 #include <boost/operators.hpp>
 #include <boost/utility.hpp>
+#include <memory>
 #include <set>
+#include <vector>
 #include <sigc++/sigc++.h>
 
 #include "display/drawing-item.h"
 #include "display/rendermode.h"
 #include "nr-filter-gaussian.h" // BLUR_QUALITY_BEST
 #include "nr-filter-colormatrix.h"
+#include "util/aabb-tree.h"
 
 typedef unsigned int guint32;
 
 namespace Inkscape {
 
 class DrawingItem;
+class DrawingSampler;
 class CanvasItemDrawing;
 
 class Drawing
@@ -79,8 +83,10 @@ public:
 
     void render(DrawingContext &dc, Geom::IntRect const &area, unsigned flags = 0, int antialiasing = -1);
     DrawingItem *pick(Geom::Point const &p, double delta, unsigned flags);
+    std::vector<DrawingItem *> itemsInArea(Geom::Rect const &area) const;
 
     void average_color(Geom::IntRect const &area, double &R, double &G, double &B, double &A);
+    void average_color_unpremul(Geom::IntRect const &area, double &R, double &G, double &B, double &A);
 
     sigc::signal<void, DrawingItem *> signal_request_update;
     sigc::signal<void, Geom::IntRect const &> signal_request_render;
@@ -94,6 +100,8 @@ private:
     DrawingItem *_root = nullptr;
     std::set<DrawingItem *> _cached_items; // modified by DrawingItem::setCached()
     CandidateList _candidate_items;        // keep this list always sorted with std::greater
+    Util::AABBTree<DrawingItem *> _index;  // visual bounds of items with an SPItem, see DrawingItem::_updateIndex()
+    std::unique_ptr<DrawingSampler> _sampler; // answers average_color(), see DrawingItem::_markForRendering()
 
 public:
     // TODO: remove these temporarily public members
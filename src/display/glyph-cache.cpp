@@ -0,0 +1,275 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Cache of rasterized glyph coverage masks.
+ *//*
+ * Authors:
+ *   see git history
+ *
+ * Copyright (C) 2022 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "display/glyph-cache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <2geom/pathvector.h>
+
+#include "display/cairo-utils.h"
+#include "display/drawing-context.h"
+#include "helper/geom.h"
+#include "libnrtype/font-instance.h"
+
+namespace Inkscape {
+
+namespace {
+
+/// Total size of the masks kept in the cache, in bytes.
+constexpr std::size_t CACHE_BUDGET = 32 << 20;
+
+/// Glyphs larger than this on screen are rendered from their outlines.
+constexpr int MAX_MASK_SIZE = 256;
+
+/// Subdivisions of a device pixel used to quantize the linear part of the transform.
+constexpr double LINEAR_STEPS = 64.0;
+
+/// Subdivisions of a device pixel used to quantize the position of the glyph origin.
+constexpr int SUBPIXEL_STEPS = 4;
+
+} // namespace
+
+GlyphCache &GlyphCache::get()
+{
+    // Never destroyed, since fonts may still forget their glyphs during shutdown.
+    static GlyphCache *instance = new GlyphCache();
+    return *instance;
+}
+
+bool GlyphCache::Key::operator==(Key const &other) const
+{
+    return font == other.font && glyph == other.glyph &&
+           std::equal(linear, linear + 4, other.linear) &&
+           subpixel[0] == other.subpixel[0] && subpixel[1] == other.subpixel[1] &&
+           fill_rule == other.fill_rule && antialias == other.antialias;
+}
+
+std::size_t GlyphCache::KeyHash::operator()(Key const &key) const
+{
+    std::size_t h = std::hash<void const *>()(key.font);
+    auto combine = [&] (std::size_t v) { h ^= v + 0x9e3779b9 + (h << 6) + (h >> 2); };
+    combine(key.glyph);
+    for (long l : key.linear) {
+        combine(std::hash<long>()(l));
+    }
+    combine(key.subpixel[0] * SUBPIXEL_STEPS + key.subpixel[1]);
+    combine(key.fill_rule * 16 + key.antialias);
+    return h;
+}
+
+bool GlyphCache::paint(DrawingContext &dc, font_instance *font, int glyph, cairo_fill_rule_t fill_rule)
+{
+    if (!font || !font->PathVector(glyph)) {
+        return false;
+    }
+
+    cairo_t *ct = dc.raw();
+    cairo_surface_t *target = cairo_get_group_target(ct);
+    // Vector output must keep the outlines.
+    if (cairo_surface_get_type(target) != CAIRO_SURFACE_TYPE_IMAGE) {
+        return false;
+    }
+    double scale_x = 1.0, scale_y = 1.0;
+    cairo_surface_get_device_scale(target, &scale_x, &scale_y);
+
+    cairo_matrix_t cm;
+    cairo_get_matrix(ct, &cm);
+    Geom::Affine ctm;
+    ink_matrix_to_2geom(ctm, cm);
+    ctm *= Geom::Scale(scale_x, scale_y);
+
+    Key key;
+    key.font = font;
+    key.glyph = glyph;
+    for (int i = 0; i < 4; ++i) {
+        key.linear[i] = std::lround(ctm[i] * LINEAR_STEPS);
+    }
+    // Split the origin into whole pixels, where the mask is composited, and a subpixel offset
+    // the mask is rendered with.
+    long origin[2];
+    for (int i = 0; i < 2; ++i) {
+        double const t = ctm[4 + i];
+        if (!std::isfinite(t)) {
+            return false;
+        }
+        origin[i] = static_cast<long>(std::floor(t));
+        key.subpixel[i] = std::lround((t - origin[i]) * SUBPIXEL_STEPS);
+        if (key.subpixel[i] == SUBPIXEL_STEPS) {
+            ++origin[i];
+            key.subpixel[i] = 0;
+        }
+    }
+    key.fill_rule = fill_rule;
+    key.antialias = cairo_get_antialias(ct);
+
+    cairo_surface_t *mask = nullptr;
+    int x = 0, y = 0;
+    bool found = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _entries.find(key);
+        if (it != _entries.end()) {
+            auto &entry = it->second;
+            _lru.splice(_lru.begin(), _lru, entry.lru);
+            mask = entry.mask ? cairo_surface_reference(entry.mask) : nullptr;
+            x = entry.x;
+            y = entry.y;
+            found = true;
+        }
+    }
+
+    if (!found) {
+        // Rasterize without holding the lock, so that other threads are not held up.
+        // If another thread adds the same glyph meanwhile, its mask is used instead.
+        bool too_large = false;
+        mask = _rasterize(font, glyph, key, x, y, too_large);
+        if (too_large) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto inserted = _entries.emplace(key, Entry{mask, x, y, _lru.end()});
+        auto &entry = inserted.first->second;
+        if (inserted.second) {
+            entry.lru = _lru.insert(_lru.begin(), key);
+            if (mask) {
+                _size += cairo_image_surface_get_stride(mask) * cairo_image_surface_get_height(mask);
+                cairo_surface_reference(mask);
+            }
+            _evict();
+        } else {
+            if (mask) {
+                cairo_surface_destroy(mask);
+            }
+            mask = entry.mask ? cairo_surface_reference(entry.mask) : nullptr;
+            x = entry.x;
+            y = entry.y;
+        }
+    }
+
+    if (mask) {
+        // The mask is aligned to device pixels.
+        cairo_save(ct);
+        cairo_identity_matrix(ct);
+        cairo_scale(ct, 1.0 / scale_x, 1.0 / scale_y);
+        cairo_mask_surface(ct, mask, origin[Geom::X] + x, origin[Geom::Y] + y);
+        cairo_restore(ct);
+        cairo_surface_destroy(mask);
+    }
+    return true;
+}
+
+/**
+ * Render the coverage of a glyph at the transform described by a key.
+ *
+ * @param x, y Receive the position of the mask relative to the glyph origin pixel.
+ * @param too_large Set if the glyph is too large to be cached.
+ * @return The mask, or null if the glyph has no coverage.
+ */
+cairo_surface_t *GlyphCache::_rasterize(font_instance *font, int glyph, Key const &key,
+                                        int &x, int &y, bool &too_large)
+{
+    Geom::Affine const trans(key.linear[0] / LINEAR_STEPS, key.linear[1] / LINEAR_STEPS,
+                             key.linear[2] / LINEAR_STEPS, key.linear[3] / LINEAR_STEPS,
+                             double(key.subpixel[0]) / SUBPIXEL_STEPS,
+                             double(key.subpixel[1]) / SUBPIXEL_STEPS);
+
+    Geom::PathVector const *pathv = font->PathVector(glyph);
+    Geom::OptRect bounds = pathv ? bounds_exact_transformed(*pathv, trans) : Geom::OptRect();
+    if (!bounds || trans.isSingular()) {
+        return nullptr;
+    }
+    if (bounds->width() > MAX_MASK_SIZE || bounds->height() > MAX_MASK_SIZE) {
+        too_large = true;
+        return nullptr;
+    }
+
+    // Leave a pixel of room for antialiasing.
+    Geom::IntRect area = bounds->roundOutwards();
+    area.expandBy(1);
+    x = area.left();
+    y = area.top();
+
+    cairo_surface_t *mask = cairo_image_surface_create(CAIRO_FORMAT_A8, area.width(), area.height());
+    cairo_t *ct = cairo_create(mask);
+    cairo_set_antialias(ct, key.antialias);
+    cairo_set_fill_rule(ct, key.fill_rule);
+    cairo_translate(ct, -x, -y);
+    ink_cairo_transform(ct, trans);
+    feed_pathvector_to_cairo(ct, *font->PathVector(glyph));
+    cairo_fill(ct);
+    cairo_destroy(ct);
+    cairo_surface_flush(mask);
+    return mask;
+}
+
+/// Drop the least recently used masks until the cache is within its budget. Requires the lock.
+void GlyphCache::_evict()
+{
+    while (_size > CACHE_BUDGET && !_lru.empty()) {
+        auto it = _entries.find(_lru.back());
+        if (it->second.mask) {
+            cairo_surface_t *mask = it->second.mask;
+            _size -= cairo_image_surface_get_stride(mask) * cairo_image_surface_get_height(mask);
+            cairo_surface_destroy(mask);
+        }
+        _entries.erase(it);
+        _lru.pop_back();
+    }
+}
+
+void GlyphCache::forget(font_instance const *font)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto it = _lru.begin(); it != _lru.end();) {
+        if (it->font != font) {
+            ++it;
+            continue;
+        }
+        auto entry = _entries.find(*it);
+        if (entry->second.mask) {
+            cairo_surface_t *mask = entry->second.mask;
+            _size -= cairo_image_surface_get_stride(mask) * cairo_image_surface_get_height(mask);
+            cairo_surface_destroy(mask);
+        }
+        _entries.erase(entry);
+        it = _lru.erase(it);
+    }
+}
+
+void GlyphCache::clear()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto &entry : _entries) {
+        if (entry.second.mask) {
+            cairo_surface_destroy(entry.second.mask);
+        }
+    }
+    _entries.clear();
+    _lru.clear();
+    _size = 0;
+}
+
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Cache of rasterized glyph coverage masks.
+ *//*
+ * Authors:
+ *   see git history
+ *
+ * Copyright (C) 2022 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_INKSCAPE_DISPLAY_GLYPH_CACHE_H
+#define SEEN_INKSCAPE_DISPLAY_GLYPH_CACHE_H
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <cairo.h>
+#include <2geom/forward.h>
+
+class font_instance;
+
+namespace Inkscape {
+
+class DrawingContext;
+
+/**
+ * Coverage masks of glyphs, shared by all drawings.
+ *
+ * Text is usually made of a few glyphs repeated many times at the same size, so instead of
+ * filling every glyph outline, the outline is rasterized once into an A8 mask and the mask is
+ * composited wherever the glyph appears. Masks are keyed by font, glyph, the linear part of the
+ * transform to device pixels (which includes the font size), the subpixel offset of the glyph
+ * origin quantized to a quarter pixel, the fill rule and the antialiasing mode.
+ *
+ * The least recently used masks are dropped once the cache exceeds its budget. The cache may be
+ * used from several rendering threads at once.
+ */
+class GlyphCache
+{
+public:
+    static GlyphCache &get();
+
+    /**
+     * Mask the current source of the context with the coverage of a glyph, whose outline is
+     * in the current user space of the context.
+     *
+     * @return False if the glyph cannot be cached at this transform, e.g. because it is too
+     *         large on screen; the caller should then render its outline.
+     */
+    bool paint(DrawingContext &dc, font_instance *font, int glyph, cairo_fill_rule_t fill_rule);
+
+    /// Drop all masks of a font, e.g. because it is being destroyed.
+    void forget(font_instance const *font);
+
+    /// Drop all masks.
+    void clear();
+
+private:
+    GlyphCache() = default;
+    GlyphCache(GlyphCache const &) = delete;
+    GlyphCache &operator=(GlyphCache const &) = delete;
+
+    struct Key
+    {
+        font_instance const *font;
+        int glyph;
+        long linear[4];   ///< linear part of the transform, in 1/64 device pixel per em
+        int subpixel[2];  ///< quarter pixel offset of the glyph origin
+        cairo_fill_rule_t fill_rule;
+        cairo_antialias_t antialias;
+
+        bool operator==(Key const &other) const;
+    };
+
+    struct KeyHash
+    {
+        std::size_t operator()(Key const &key) const;
+    };
+
+    struct Entry
+    {
+        cairo_surface_t *mask; ///< null for glyphs without any coverage
+        int x, y;              ///< position of the mask relative to the glyph origin pixel
+        std::list<Key>::iterator lru;
+    };
+
+    static cairo_surface_t *_rasterize(font_instance *font, int glyph, Key const &key,
+                                       int &x, int &y, bool &too_large);
+    void _evict();
+
+    std::mutex _mutex;
+    std::list<Key> _lru; ///< most recently used first
+    std::unordered_map<Key, Entry, KeyHash> _entries;
+    std::size_t _size = 0;
+};
+
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_DISPLAY_GLYPH_CACHE_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,452 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Decoded images shared between image elements, and their mip pyramids.
+ *//*
+ * Authors:
+ *   see git history
+ *
+ * Copyright (C) 2022 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "display/image-cache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <glib/gstdio.h>
+#include <glibmm/checksum.h>
+#include <sigc++/signal.h>
+
+#include "display/cairo-utils.h"
+#include "preferences.h"
+
+namespace Inkscape {
+
+namespace {
+
+/// Total size of the mip levels kept in the cache, in bytes.
+constexpr std::size_t CACHE_BUDGET = 256 << 20;
+
+/// Key of the user data attached to images which have mip levels in the cache.
+cairo_user_data_key_t const pyramid_key{};
+
+void forget_pyramid(void *image)
+{
+    ImageCache::get().forget(static_cast<cairo_surface_t const *>(image));
+}
+
+std::string dpi_suffix(double svgdpi)
+{
+    return "@" + std::to_string(svgdpi);
+}
+
+} // namespace
+
+struct ImageCache::Task
+{
+    enum State { QUEUED, RUNNING, DONE };
+
+    std::string key;
+    std::function<Pixbuf *()> decode;
+    State state = QUEUED;
+    std::shared_ptr<Pixbuf> result;
+    sigc::signal<void> ready; ///< only used from the main loop
+};
+
+ImageCache &ImageCache::get()
+{
+    // Never destroyed, since images may still be destroyed during shutdown.
+    static ImageCache *instance = new ImageCache();
+    return *instance;
+}
+
+std::size_t ImageCache::KeyHash::operator()(Key const &key) const
+{
+    std::size_t h = std::hash<void const *>()(key.image);
+    return h ^ (key.level + 0x9e3779b9 + (h << 6) + (h >> 2));
+}
+
+std::string ImageCache::data_uri_key(char const *uri, double svgdpi)
+{
+    return "data:" + Glib::Checksum::compute_checksum(Glib::Checksum::CHECKSUM_SHA256, uri) +
+           dpi_suffix(svgdpi);
+}
+
+std::string ImageCache::file_key(std::string const &filename, double svgdpi)
+{
+    // Pixbuf::create_from_file() records the modification time to find out whether the file
+    // changed; a file changed since it was loaded gets a new key.
+    GStatBuf st;
+    if (filename.empty() || g_stat(filename.c_str(), &st) != 0) {
+        return {};
+    }
+    return "file:" + filename + "#" + std::to_string(st.st_mtime) + "#" + std::to_string(st.st_size) +
+           dpi_suffix(svgdpi);
+}
+
+std::shared_ptr<Pixbuf> ImageCache::pixbuf(std::string const &key, std::function<Pixbuf *()> const &decode)
+{
+    if (key.empty()) {
+        return std::shared_ptr<Pixbuf>(decode());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _pixbufs.find(key);
+        if (it != _pixbufs.end()) {
+            if (auto shared = it->second.lock()) {
+                return shared;
+            }
+        }
+    }
+
+    std::shared_ptr<Pixbuf> decoded(decode());
+    if (!decoded) {
+        return decoded;
+    }
+    // Convert now, so that the pixels of a shared image are not converted in place while
+    // another image element draws it.
+    decoded->ensurePixelFormat(Pixbuf::PF_CAIRO);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _share(key, std::move(decoded));
+}
+
+/**
+ * Share a decoded image under a key, unless another thread decoded the same image meanwhile, in
+ * which case that image is returned. Requires the lock.
+ */
+std::shared_ptr<Pixbuf> ImageCache::_share(std::string const &key, std::shared_ptr<Pixbuf> decoded)
+{
+    auto &entry = _pixbufs[key];
+    if (auto shared = entry.lock()) {
+        return shared;
+    }
+    entry = decoded;
+    if (_pixbufs.size() >= _prune_at) {
+        for (auto it = _pixbufs.begin(); it != _pixbufs.end();) {
+            it = it->second.expired() ? _pixbufs.erase(it) : std::next(it);
+        }
+        _prune_at = 2 * _pixbufs.size() + 64;
+    }
+    return decoded;
+}
+
+ImageCache::Pending ImageCache::pixbuf_async(std::string const &key, std::function<Pixbuf *()> decode)
+{
+    int const threads = Inkscape::Preferences::get()->getIntLimited("/options/threading/numthreads",
+                                                                    std::max(1u, std::thread::hardware_concurrency()), 1, 256);
+    Pending pending;
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!key.empty()) {
+        auto shared = _pixbufs.find(key);
+        if (shared != _pixbufs.end()) {
+            if (auto pixbuf = shared->second.lock()) {
+                pending._task = std::make_shared<Task>();
+                pending._task->state = Task::DONE;
+                pending._task->result = std::move(pixbuf);
+                return pending;
+            }
+        }
+        auto running = _pending.find(key);
+        if (running != _pending.end()) {
+            if ((pending._task = running->second.lock())) {
+                return pending;
+            }
+        }
+    }
+
+    pending._task = std::make_shared<Task>();
+    pending._task->key = key;
+    pending._task->decode = std::move(decode);
+    if (!key.empty()) {
+        _pending[key] = pending._task;
+    }
+    _queue.push_back(pending._task);
+
+    if (_workers < threads && _workers < static_cast<int>(_queue.size())) {
+        // Workers are never stopped, like the cache itself.
+        std::thread(&ImageCache::_work, this).detach();
+        ++_workers;
+    }
+    _queued.notify_one();
+    return pending;
+}
+
+void ImageCache::_work()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+        _queued.wait(lock, [this] { return !_queue.empty(); });
+        auto task = std::move(_queue.front());
+        _queue.pop_front();
+        if (task->state != Task::QUEUED) {
+            // Already decoded by a thread waiting for it.
+            continue;
+        }
+        task->state = Task::RUNNING;
+        if (task.use_count() == 1) {
+            // Nobody wants the image anymore.
+            task->state = Task::DONE;
+            task->decode = nullptr;
+            _forgetPending(task);
+            continue;
+        }
+        lock.unlock();
+        _run(task);
+        lock.lock();
+    }
+}
+
+/// Decode the image of a task, which the calling thread has set running.
+void ImageCache::_run(std::shared_ptr<Task> const &task)
+{
+    std::shared_ptr<Pixbuf> decoded(task->decode());
+    if (decoded) {
+        decoded->ensurePixelFormat(Pixbuf::PF_CAIRO);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (decoded && !task->key.empty()) {
+            decoded = _share(task->key, std::move(decoded));
+        }
+        _forgetPending(task);
+        task->result = std::move(decoded);
+        task->decode = nullptr;
+        task->state = Task::DONE;
+        _finished.push_back(task);
+        if (!_idle_scheduled) {
+            // Safe from any thread, unlike connecting to Glib::signal_idle().
+            g_idle_add(&ImageCache::_emitReady, nullptr);
+            _idle_scheduled = true;
+        }
+    }
+    _decoded.notify_all();
+}
+
+/// Stop sharing a task which is done with image elements asking for its key. Requires the lock.
+void ImageCache::_forgetPending(std::shared_ptr<Task> const &task)
+{
+    auto pending = _pending.find(task->key);
+    if (pending != _pending.end() && pending->second.lock() == task) {
+        _pending.erase(pending);
+    }
+}
+
+/// Tell the main loop about the images decoded by the workers.
+gboolean ImageCache::_emitReady(gpointer)
+{
+    auto &cache = get();
+    std::vector<std::weak_ptr<Task>> finished;
+    {
+        std::lock_guard<std::mutex> lock(cache._mutex);
+        finished.swap(cache._finished);
+        cache._idle_scheduled = false;
+    }
+    for (auto const &weak : finished) {
+        if (auto task = weak.lock()) {
+            task->ready.emit();
+        }
+    }
+    return FALSE;
+}
+
+bool ImageCache::Pending::ready() const
+{
+    auto &cache = ImageCache::get();
+    std::lock_guard<std::mutex> lock(cache._mutex);
+    return _task && _task->state == Task::DONE;
+}
+
+std::shared_ptr<Pixbuf> ImageCache::Pending::get()
+{
+    if (!_task) {
+        return nullptr;
+    }
+    auto &cache = ImageCache::get();
+    std::unique_lock<std::mutex> lock(cache._mutex);
+    if (_task->state == Task::QUEUED) {
+        // Don't wait behind the images queued before this one.
+        _task->state = Task::RUNNING;
+        lock.unlock();
+        cache._run(_task);
+        lock.lock();
+    }
+    cache._decoded.wait(lock, [this] { return _task->state == Task::DONE; });
+    return _task->result;
+}
+
+sigc::connection ImageCache::Pending::connectReady(sigc::slot<void> const &slot)
+{
+    return _task ? _task->ready.connect(slot) : sigc::connection();
+}
+
+cairo_surface_t *ImageCache::mipmap(cairo_surface_t *image, double scale)
+{
+    if (cairo_surface_get_type(image) != CAIRO_SURFACE_TYPE_IMAGE ||
+        cairo_image_surface_get_format(image) != CAIRO_FORMAT_ARGB32) {
+        return cairo_surface_reference(image);
+    }
+
+    // Halve the image while it is still at least twice as large as needed.
+    int level = 0;
+    int w = cairo_image_surface_get_width(image);
+    int h = cairo_image_surface_get_height(image);
+    while (scale > 0 && scale <= 0.5 && (w > 1 || h > 1)) {
+        scale *= 2;
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+        ++level;
+    }
+    if (level == 0) {
+        return cairo_surface_reference(image);
+    }
+
+    int built = level;
+    cairo_surface_t *larger = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        // Start from the closest level which exists, or the image itself.
+        for (; built > 0; --built) {
+            auto it = _levels.find({image, built});
+            if (it != _levels.end()) {
+                _lru.splice(_lru.begin(), _lru, it->second.lru);
+                larger = cairo_surface_reference(it->second.surface);
+                break;
+            }
+        }
+    }
+    if (built == level) {
+        return larger;
+    }
+    if (!larger) {
+        larger = cairo_surface_reference(image);
+    }
+
+    // Build the missing levels outside the lock; drawing is not blocked for other images.
+    std::vector<cairo_surface_t *> levels;
+    for (cairo_surface_t *source = larger; built < level; ++built) {
+        source = _downsample(source);
+        levels.push_back(source);
+    }
+    cairo_surface_destroy(larger);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!cairo_surface_get_user_data(image, &pyramid_key)) {
+        cairo_surface_set_user_data(image, &pyramid_key, image, forget_pyramid);
+    }
+    cairo_surface_t *result = nullptr;
+    int k = level - static_cast<int>(levels.size());
+    for (auto surface : levels) {
+        Key const built_key{image, ++k};
+        auto it = _levels.find(built_key);
+        if (it != _levels.end()) {
+            // Another thread built the same level meanwhile.
+            cairo_surface_destroy(surface);
+            surface = it->second.surface;
+            _lru.splice(_lru.begin(), _lru, it->second.lru);
+        } else {
+            _lru.push_front(built_key);
+            _levels.emplace(built_key, Entry{surface, _lru.begin()});
+            _size += cairo_image_surface_get_stride(surface) * cairo_image_surface_get_height(surface);
+        }
+        if (k == level) {
+            result = cairo_surface_reference(surface);
+        }
+    }
+    _evict();
+    return result;
+}
+
+/**
+ * Halve an ARGB32 image by averaging blocks of 2x2 premultiplied pixels. An odd last row or
+ * column is averaged with itself.
+ *
+ * The source is either the image of a Pixbuf or a level built here, which are complete when
+ * shared, so its data is read as it is. It is not flushed: the image is shared with other
+ * threads, and flushing it drops the original file data kept with it for vector output.
+ *
+ * @return A new surface.
+ */
+cairo_surface_t *ImageCache::_downsample(cairo_surface_t *surface)
+{
+    int const w = cairo_image_surface_get_width(surface);
+    int const h = cairo_image_surface_get_height(surface);
+    int const stride = cairo_image_surface_get_stride(surface);
+    unsigned char const *data = cairo_image_surface_get_data(surface);
+
+    int const w2 = (w + 1) / 2;
+    int const h2 = (h + 1) / 2;
+    cairo_surface_t *result = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, w2, h2);
+    int const stride2 = cairo_image_surface_get_stride(result);
+    unsigned char *data2 = cairo_image_surface_get_data(result);
+
+    for (int y = 0; y < h2; ++y) {
+        auto row0 = reinterpret_cast<std::uint32_t const *>(data + 2 * y * stride);
+        auto row1 = reinterpret_cast<std::uint32_t const *>(data + std::min(2 * y + 1, h - 1) * stride);
+        auto out = reinterpret_cast<std::uint32_t *>(data2 + y * stride2);
+        for (int x = 0; x < w2; ++x) {
+            int const x0 = 2 * x;
+            int const x1 = std::min(x0 + 1, w - 1);
+            std::uint32_t const p[4] = {row0[x0], row0[x1], row1[x0], row1[x1]};
+            std::uint32_t pixel = 0;
+            for (int shift = 0; shift < 32; shift += 8) {
+                std::uint32_t sum = 2;
+                for (auto v : p) {
+                    sum += (v >> shift) & 0xff;
+                }
+                pixel |= (sum >> 2) << shift;
+            }
+            out[x] = pixel;
+        }
+    }
+
+    cairo_surface_mark_dirty(result);
+    return result;
+}
+
+/// Drop the least recently used levels until the cache fits its budget. Requires the lock.
+void ImageCache::_evict()
+{
+    while (_size > CACHE_BUDGET && !_lru.empty()) {
+        auto it = _levels.find(_lru.back());
+        cairo_surface_t *surface = it->second.surface;
+        _size -= cairo_image_surface_get_stride(surface) * cairo_image_surface_get_height(surface);
+        cairo_surface_destroy(surface);
+        _levels.erase(it);
+        _lru.pop_back();
+    }
+}
+
+void ImageCache::forget(cairo_surface_t const *image)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto it = _lru.begin(); it != _lru.end();) {
+        if (it->image != image) {
+            ++it;
+            continue;
+        }
+        auto entry = _levels.find(*it);
+        cairo_surface_t *surface = entry->second.surface;
+        _size -= cairo_image_surface_get_stride(surface) * cairo_image_surface_get_height(surface);
+        cairo_surface_destroy(surface);
+        _levels.erase(entry);
+        it = _lru.erase(it);
+    }
+}
+
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,174 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Decoded images shared between image elements, and their mip pyramids.
+ *//*
+ * Authors:
+ *   see git history
+ *
+ * Copyright (C) 2022 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_INKSCAPE_DISPLAY_IMAGE_CACHE_H
+#define SEEN_INKSCAPE_DISPLAY_IMAGE_CACHE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cairo.h>
+#include <glib.h>
+#include <sigc++/connection.h>
+#include <sigc++/functors/slot.h>
+
+namespace Inkscape {
+
+class Pixbuf;
+
+/**
+ * Decoded images, and smaller versions of them for drawing them zoomed out.
+ *
+ * Images are shared by content: all image elements asking for the same key while one of them
+ * still holds the image get the same Pixbuf, so an image embedded or linked many times is only
+ * decoded and kept in memory once. Shared images must not be modified. Images can be decoded on
+ * a pool of worker threads, so that opening a document linking many large images is not blocked
+ * until all of them are decoded.
+ *
+ * Drawing a large image at a small scale resamples all of its pixels for every tile. Instead,
+ * mipmap() returns the level of a pyramid of images, each half the size of the previous one,
+ * closest to the scale the image is drawn at. Levels are built on demand from the closest
+ * larger level. The least recently used levels are dropped once the cache exceeds its budget,
+ * and all levels of an image when its surface is destroyed. Levels may be asked for from
+ * several rendering threads at once.
+ */
+class ImageCache
+{
+    struct Task;
+
+public:
+    /// An image being decoded on a worker thread.
+    class Pending
+    {
+    public:
+        explicit operator bool() const { return bool(_task); }
+
+        /// Whether the image is decoded, so that get() does not block.
+        bool ready() const;
+
+        /**
+         * Get the image, decoding it on the calling thread if no worker has started yet, else
+         * waiting for the worker. Returns null if decoding failed.
+         */
+        std::shared_ptr<Pixbuf> get();
+
+        /// Call a slot from the main loop once the image is decoded by a worker.
+        sigc::connection connectReady(sigc::slot<void> const &slot);
+
+    private:
+        friend class ImageCache;
+        std::shared_ptr<Task> _task;
+    };
+
+    static ImageCache &get();
+
+    /// Key of an image embedded as a data URI (without the "data:" prefix).
+    static std::string data_uri_key(char const *uri, double svgdpi);
+
+    /// Key of a linked image file, or an empty string if the file cannot be found.
+    static std::string file_key(std::string const &filename, double svgdpi);
+
+    /**
+     * Get the image with the given key, calling decode() to create it unless another image
+     * element still holds it. Images with an empty key are not shared.
+     */
+    std::shared_ptr<Pixbuf> pixbuf(std::string const &key, std::function<Pixbuf *()> const &decode);
+
+    /**
+     * Like pixbuf(), but call decode() on a worker thread, so it must not use anything but the
+     * image data. Image elements asking for an image being decoded wait for the same decoding.
+     * Decoding is skipped if all returned handles are dropped before a worker starts it.
+     */
+    Pending pixbuf_async(std::string const &key, std::function<Pixbuf *()> decode);
+
+    /**
+     * Get the surface to draw an ARGB32 image surface from, at a scale of the given number of
+     * device pixels per image pixel: the smallest level of its pyramid which is not smaller
+     * than the image at that scale, or the image itself.
+     *
+     * @return A new reference to the surface, which the caller must destroy.
+     */
+    cairo_surface_t *mipmap(cairo_surface_t *image, double scale);
+
+    /// Drop the pyramid of an image, e.g. because its pixels have changed.
+    void forget(cairo_surface_t const *image);
+
+private:
+    ImageCache() = default;
+    ImageCache(ImageCache const &) = delete;
+    ImageCache &operator=(ImageCache const &) = delete;
+
+    struct Key
+    {
+        cairo_surface_t const *image;
+        int level;
+
+        bool operator==(Key const &other) const { return image == other.image && level == other.level; }
+    };
+
+    struct KeyHash
+    {
+        std::size_t operator()(Key const &key) const;
+    };
+
+    struct Entry
+    {
+        cairo_surface_t *surface;
+        std::list<Key>::iterator lru;
+    };
+
+    static cairo_surface_t *_downsample(cairo_surface_t *surface);
+    std::shared_ptr<Pixbuf> _share(std::string const &key, std::shared_ptr<Pixbuf> decoded);
+    void _run(std::shared_ptr<Task> const &task);
+    void _forgetPending(std::shared_ptr<Task> const &task);
+    void _work();
+    static gboolean _emitReady(gpointer);
+    void _evict();
+
+    std::mutex _mutex;
+    std::unordered_map<std::string, std::weak_ptr<Pixbuf>> _pixbufs;
+    std::size_t _prune_at = 64; ///< size of _pixbufs at which expired entries are removed
+
+    std::unordered_map<std::string, std::weak_ptr<Task>> _pending; ///< tasks by key
+    std::deque<std::shared_ptr<Task>> _queue;
+    std::condition_variable _queued;  ///< notified when a task is queued
+    std::condition_variable _decoded; ///< notified when a task is done
+    int _workers = 0;
+    std::vector<std::weak_ptr<Task>> _finished; ///< tasks done since the last main loop idle
+    bool _idle_scheduled = false;
+
+    std::list<Key> _lru; ///< most recently used first
+    std::unordered_map<Key, Entry, KeyHash> _levels;
+    std::size_t _size = 0;
+};
+
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_DISPLAY_IMAGE_CACHE_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -53,6 +53,7 @@ public:
     struct ColorMatrixMatrix {
         ColorMatrixMatrix(std::vector<double> const &values);
         guint32 operator()(guint32 in);
+        void filter_span(guint32 const *in, guint32 *out, int n) const;
     private:
         gint32 _v[20];
     };
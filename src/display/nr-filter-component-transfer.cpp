@@ -12,6 +12,7 @@
  */
 
 #include <cmath>
+#include "display/cairo-simd.h"
 #include "display/cairo-templates.h"
 #include "display/cairo-utils.h"
 #include "display/nr-filter-component-transfer.h"
@@ -30,32 +31,6 @@ FilterPrimitive * FilterComponentTransfer::create() {
 FilterComponentTransfer::~FilterComponentTransfer()
 = default;
 
-struct UnmultiplyAlpha {
-    guint32 operator()(guint32 in) {
-        EXTRACT_ARGB32(in, a, r, g, b);
-        if (a == 0 )
-            return in;
-        r = unpremul_alpha(r, a);
-        g = unpremul_alpha(g, a);
-        b = unpremul_alpha(b, a);
-        ASSEMBLE_ARGB32(out, a, r, g, b);
-        return out;
-    }
-};
-
-struct MultiplyAlpha {
-    guint32 operator()(guint32 in) {
-        EXTRACT_ARGB32(in, a, r, g, b);
-        if (a == 0 )
-            return in;
-        r = premul_alpha(r, a);
-        g = premul_alpha(g, a);
-        b = premul_alpha(b, a);
-        ASSEMBLE_ARGB32(out, a, r, g, b);
-        return out;
-    }
-};
-
 struct ComponentTransfer {
     ComponentTransfer(guint32 color)
         : _shift(color * 8)
@@ -155,6 +130,47 @@ private:
     double _offset;
 };
 
+/**
+ * Applies the transfer functions of all four channels in a single pass over the pixels.
+ * Each of the functions above only depends on its own channel, so it is tabulated for the
+ * 256 possible values. We need to operate on color values not multiplied by alpha,
+ * otherwise a change in alpha screws up the premultiplied r, g, b values.
+ */
+struct ComponentTransferLookup {
+    ComponentTransferLookup() {
+        for (auto &table : _table) {
+            for (unsigned i = 0; i < 256; ++i) {
+                table[i] = i;
+            }
+        }
+    }
+    template <typename Transfer>
+    void set(guint32 color, Transfer transfer) {
+        guint32 shift = color * 8;
+        for (guint32 i = 0; i < 256; ++i) {
+            _table[color][i] = (transfer(i << shift) >> shift) & 0xff;
+        }
+    }
+    guint32 operator()(guint32 in) {
+        return pixel_premultiply(lookup(pixel_unpremultiply(in)));
+    }
+    void filter_span(guint32 const *in, guint32 *out, int n) const {
+        pixels_unpremultiply(in, out, n);
+        for (int i = 0; i < n; ++i) {
+            out[i] = lookup(out[i]);
+        }
+        pixels_premultiply(out, out, n);
+    }
+private:
+    guint32 lookup(guint32 in) const {
+        return (guint32(_table[3][in >> 24]) << 24)
+             | (guint32(_table[2][(in >> 16) & 0xff]) << 16)
+             | (guint32(_table[1][(in >> 8) & 0xff]) << 8)
+             | guint32(_table[0][in & 0xff]);
+    }
+    guint8 _table[4][256]; // indexed by Cairo channel
+};
+
 void FilterComponentTransfer::render_cairo(FilterSlot &slot)
 {
     cairo_surface_t *input = slot.getcairo(_input);
@@ -170,12 +186,7 @@ void FilterComponentTransfer::render_cairo(FilterSlot &slot)
     }
     set_cairo_surface_ci( input, ci_fp );
 
-    //cairo_surface_t *outtemp = ink_cairo_surface_create_identical(out);
-    ink_cairo_surface_blit(input, out);
-
-    // We need to operate on unmultipled by alpha color values otherwise a change in alpha screws
-    // up the premultiplied by alpha r, g, b values.
-    ink_cairo_surface_filter(out, out, UnmultiplyAlpha());
+    ComponentTransferLookup lookup;
 
     // parameters: R = 0, G = 1, B = 2, A = 3
     // Cairo:      R = 2, G = 1, B = 0, A = 3
@@ -188,37 +199,31 @@ void FilterComponentTransfer::render_cairo(FilterSlot &slot)
         switch (type[i]) {
         case COMPONENTTRANSFER_TYPE_TABLE:
             if(!tableValues[i].empty()) {
-              ink_cairo_surface_filter(out, out,
-                  ComponentTransferTable(color, tableValues[i]));
+                lookup.set(color, ComponentTransferTable(color, tableValues[i]));
             }
             break;
         case COMPONENTTRANSFER_TYPE_DISCRETE:
             if(!tableValues[i].empty()) {
-                ink_cairo_surface_filter(out, out,
-                    ComponentTransferDiscrete(color, tableValues[i]));
+                lookup.set(color, ComponentTransferDiscrete(color, tableValues[i]));
             }
             break;
         case COMPONENTTRANSFER_TYPE_LINEAR:
-            ink_cairo_surface_filter(out, out,
-                ComponentTransferLinear(color, intercept[i], slope[i]));
+            lookup.set(color, ComponentTransferLinear(color, intercept[i], slope[i]));
             break;
         case COMPONENTTRANSFER_TYPE_GAMMA:
-            ink_cairo_surface_filter(out, out,
-                ComponentTransferGamma(color, amplitude[i], exponent[i], offset[i]));
+            lookup.set(color, ComponentTransferGamma(color, amplitude[i], exponent[i], offset[i]));
             break;
         case COMPONENTTRANSFER_TYPE_ERROR:
         case COMPONENTTRANSFER_TYPE_IDENTITY:
         default:
             break;
         }
-        //ink_cairo_surface_blit(out, outtemp);
     }
 
-    ink_cairo_surface_filter(out, out, MultiplyAlpha());
+    ink_cairo_surface_filter(input, out, lookup);
 
     slot.set(_output, out);
     cairo_surface_destroy(out);
-    //cairo_surface_destroy(outtemp);
 }
 
 bool FilterComponentTransfer::can_handle_affine(Geom::Affine const &)
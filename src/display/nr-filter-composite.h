@@ -33,6 +33,7 @@ public:
 
     void set_input(int input) override;
     void set_input(int input, int slot) override;
+    std::vector<int> get_inputs() const override { return {_input, _input2}; }
 
     void set_operator(FeCompositeOperator op);
     void set_arithmetic(double k1, double k2, double k3, double k4);
@@ -23,10 +23,15 @@
 #include "display/nr-filter-units.h"
 #include "enums.h"
 #include <glibmm/fileutils.h>
+#include <mutex>
 
 namespace Inkscape {
 namespace Filters {
 
+// Loading the image and showing the referenced element modify shared state,
+// and tiles of the canvas can be rendered from several threads.
+static std::mutex render_mutex;
+
 FilterImage::FilterImage()
     : SVGElem(nullptr)
     , document(nullptr)
@@ -52,6 +57,8 @@ void FilterImage::render_cairo(FilterSlot &slot)
     if (!feImageHref)
         return;
 
+    std::lock_guard<std::mutex> lock(render_mutex);
+
     //cairo_surface_t *input = slot.getcairo(_input);
 
     // Viewport is filter primitive area (in user coordinates).
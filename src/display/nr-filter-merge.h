@@ -32,6 +32,7 @@ public:
 
     void set_input(int input) override;
     void set_input(int input, int slot) override;
+    std::vector<int> get_inputs() const override { return _input_image; }
 
     Glib::ustring name() override { return Glib::ustring("Merge"); }
 
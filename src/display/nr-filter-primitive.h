@@ -12,6 +12,7 @@
 #ifndef SEEN_NR_FILTER_PRIMITIVE_H
 #define SEEN_NR_FILTER_PRIMITIVE_H
 
+#include <vector>
 #include <2geom/forward.h>
 #include <2geom/rect.h>
 
@@ -69,6 +70,17 @@ public:
      */
     virtual void set_output(int slot);
 
+    /**
+     * Returns the slots read by render_cairo(), in the same form as passed to
+     * set_input(). Used to find out which primitives of a filter depend on each other.
+     */
+    virtual std::vector<int> get_inputs() const { return {_input}; }
+
+    /**
+     * Returns the slot written by render_cairo(), as passed to set_output().
+     */
+    int get_output() const { return _output; }
+
     // returns cache score factor, reflecting the cost of rendering this filter
     // this should return how many times slower this primitive is that normal rendering
     virtual double complexity(Geom::Affine const &/*ctm*/) { return 1.0; }
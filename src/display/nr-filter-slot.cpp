@@ -35,6 +35,7 @@ FilterSlot::FilterSlot(DrawingItem *item, DrawingContext *bgdc,
     , _background_area(bgdc ? bgdc->targetLogicalBounds().roundOutwards() : Geom::IntRect()) // fixme
     , _units(u)
     , _last_out(NR_FILTER_SOURCEGRAPHIC)
+    , _has_output(false)
     , filterquality(FILTER_QUALITY_BEST)
     , blurquality(BLUR_QUALITY_BEST)
 {
@@ -231,6 +232,42 @@ void FilterSlot::set(int slot_nr, cairo_surface_t *surface)
 
     _set_internal(slot_nr, surface);
     _last_out = slot_nr;
+    _has_output = true;
+}
+
+void FilterSlot::set_input(int slot_nr, cairo_surface_t *surface, Geom::OptRect const &area)
+{
+    g_return_if_fail(surface != nullptr);
+
+    if (slot_nr == NR_FILTER_SLOT_NOT_SET) {
+        slot_nr = NR_FILTER_UNNAMED_SLOT;
+        _last_out = slot_nr;
+    }
+
+    _set_internal(slot_nr, surface);
+    if (area) {
+        _primitiveAreas[slot_nr] = *area;
+    }
+}
+
+cairo_surface_t *FilterSlot::get_output()
+{
+    if (!_has_output) {
+        return nullptr;
+    }
+    return _slots[_last_out];
+}
+
+Geom::OptRect FilterSlot::get_output_area()
+{
+    if (!_has_output) {
+        return Geom::OptRect();
+    }
+    PrimitiveAreaMap::iterator s = _primitiveAreas.find(_last_out);
+    if (s == _primitiveAreas.end()) {
+        return Geom::OptRect();
+    }
+    return s->second;
 }
 
 void FilterSlot::set_primitive_area(int slot_nr, Geom::Rect &area)
@@ -55,6 +55,19 @@ public:
 
     cairo_surface_t *get_result(int slot_nr);
 
+    /** Makes an image available in the given slot without making it the last
+     * output, along with its primitive area if known.
+     * NR_FILTER_SLOT_NOT_SET stands for the output of the previous primitive.
+     */
+    void set_input(int slot, cairo_surface_t *s, Geom::OptRect const &area);
+
+    /** Returns the pixblock stored by the last call to set(), or NULL if there
+     * was none. The slot keeps its reference. */
+    cairo_surface_t *get_output();
+
+    /** Returns the primitive area stored for the last output, if any. */
+    Geom::OptRect get_output_area();
+
     void set_primitive_area(int slot, Geom::Rect &area);
     Geom::Rect get_primitive_area(int slot);
     
@@ -103,6 +116,7 @@ private:
     Geom::IntRect _background_area; ///< needed to extract background
     FilterUnits const &_units;
     int _last_out;
+    bool _has_output;
     FilterQuality filterquality;
     int blurquality;
     int device_scale;
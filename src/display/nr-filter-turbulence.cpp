@@ -24,7 +24,18 @@
 #include "display/nr-filter-turbulence.h"
 #include "display/nr-filter-units.h"
 #include "display/nr-filter-utils.h"
+#include "util/flat-hash-map.h"
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <vector>
+
+#if defined(__SSE2__)
+#define INK_TURBULENCE_SSE2 1
+#include <emmintrin.h>
+#endif
 
 namespace Inkscape {
 namespace Filters{
@@ -66,14 +77,14 @@ public:
                 _latticeSelector[i] = i;
 
                 do {
-                  _gradient[i][k][0] = static_cast<double>(_random() % (BSize*2) - BSize) / BSize;
-                  _gradient[i][k][1] = static_cast<double>(_random() % (BSize*2) - BSize) / BSize;
-                } while(_gradient[i][k][0] == 0 && _gradient[i][k][1] == 0);
+                  _gradient[i][0][k] = static_cast<double>(_random() % (BSize*2) - BSize) / BSize;
+                  _gradient[i][1][k] = static_cast<double>(_random() % (BSize*2) - BSize) / BSize;
+                } while(_gradient[i][0][k] == 0 && _gradient[i][1][k] == 0);
 
                 // normalize gradient
-                double s = hypot(_gradient[i][k][0], _gradient[i][k][1]);
-                _gradient[i][k][0] /= s;
-                _gradient[i][k][1] /= s;
+                double s = hypot(_gradient[i][0][k], _gradient[i][1][k]);
+                _gradient[i][0][k] /= s;
+                _gradient[i][1][k] /= s;
             }
         }
         while (--i) {
@@ -88,8 +99,8 @@ public:
             _latticeSelector[BSize + i] = _latticeSelector[i];
 
             for(int k = 0; k < 4; ++k) {
-                _gradient[BSize + i][k][0] = _gradient[i][k][0];
-                _gradient[BSize + i][k][1] = _gradient[i][k][1];
+                _gradient[BSize + i][0][k] = _gradient[i][0][k];
+                _gradient[BSize + i][1][k] = _gradient[i][1][k];
             }
         }
 
@@ -128,8 +139,16 @@ public:
         double y = p[Geom::Y] * _baseFreq[Geom::Y];
         double ratio = 1.0;
 
+#if INK_TURBULENCE_SSE2
+        // The four channels are evaluated two at a time, with the same operations in the
+        // same order as the scalar code below, so both give identical results.
+        __m128d pixel_rg = _mm_setzero_pd();
+        __m128d pixel_ba = _mm_setzero_pd();
+        __m128d const sign = _mm_set1_pd(-0.0);
+#else
         for (double & k : pixel)
             k = 0.0;
+#endif
 
         for(int octave = 0; octave < _octaves; ++octave)
         {
@@ -164,17 +183,28 @@ public:
             double sx = _scurve(rx0);
             double sy = _scurve(ry0);
 
-            double result[4];
             // channel numbering: R=0, G=1, B=2, A=3
+#if INK_TURBULENCE_SSE2
+            __m128d const vsx = _mm_set1_pd(sx), vsy = _mm_set1_pd(sy), vratio = _mm_set1_pd(ratio);
+            __m128d const vrx0 = _mm_set1_pd(rx0), vrx1 = _mm_set1_pd(rx1);
+            __m128d const vry0 = _mm_set1_pd(ry0), vry1 = _mm_set1_pd(ry1);
+            for (int k = 0; k < 4; k += 2) {
+                __m128d a = _lerp(vsx, _dot(_gradient[b00], k, vrx0, vry0), _dot(_gradient[b10], k, vrx1, vry0));
+                __m128d b = _lerp(vsx, _dot(_gradient[b01], k, vrx0, vry1), _dot(_gradient[b11], k, vrx1, vry1));
+                __m128d result = _lerp(vsy, a, b);
+                if (!_fractalnoise) {
+                    result = _mm_andnot_pd(sign, result);
+                }
+                __m128d &px = k == 0 ? pixel_rg : pixel_ba;
+                px = _mm_add_pd(px, _mm_div_pd(result, vratio));
+            }
+#else
+            double result[4];
             for (int k = 0; k < 4; ++k) {
-                double const *qxa = _gradient[b00][k];
-                double const *qxb = _gradient[b10][k];
-                double a = _lerp(sx, rx0 * qxa[0] + ry0 * qxa[1],
-                                     rx1 * qxb[0] + ry0 * qxb[1]);
-                double const *qya = _gradient[b01][k];
-                double const *qyb = _gradient[b11][k];
-                double b = _lerp(sx, rx0 * qya[0] + ry1 * qya[1],
-                                     rx1 * qyb[0] + ry1 * qyb[1]);
+                double a = _lerp(sx, rx0 * _gradient[b00][0][k] + ry0 * _gradient[b00][1][k],
+                                     rx1 * _gradient[b10][0][k] + ry0 * _gradient[b10][1][k]);
+                double b = _lerp(sx, rx0 * _gradient[b01][0][k] + ry1 * _gradient[b01][1][k],
+                                     rx1 * _gradient[b11][0][k] + ry1 * _gradient[b11][1][k]);
                 result[k] = _lerp(sy, a, b);
             }
 
@@ -185,6 +215,7 @@ public:
                 for (int k = 0; k < 4; ++k)
                     pixel[k] += fabs(result[k]) / ratio;
             }
+#endif
 
             x *= 2;
             y *= 2;
@@ -201,6 +232,11 @@ public:
             }
         }
 
+#if INK_TURBULENCE_SSE2
+        _mm_storeu_pd(pixel, pixel_rg);
+        _mm_storeu_pd(pixel + 2, pixel_ba);
+#endif
+
         if (_fractalnoise) {
             guint32 r = CLAMP_D_TO_U8((pixel[0]*255.0 + 255.0) / 2);
             guint32 g = CLAMP_D_TO_U8((pixel[1]*255.0 + 255.0) / 2);
@@ -275,6 +311,16 @@ private:
     static inline double _lerp(double t, double a, double b) {
         return a + t * (b-a);
     }
+#if INK_TURBULENCE_SSE2
+    static inline __m128d _lerp(__m128d t, __m128d a, __m128d b) {
+        return _mm_add_pd(a, _mm_mul_pd(t, _mm_sub_pd(b, a)));
+    }
+    /// rx * gradient x + ry * gradient y for the channels k and k + 1.
+    static inline __m128d _dot(double const (*gradient)[4], int k, __m128d rx, __m128d ry) {
+        return _mm_add_pd(_mm_mul_pd(rx, _mm_loadu_pd(gradient[0] + k)),
+                          _mm_mul_pd(ry, _mm_loadu_pd(gradient[1] + k)));
+    }
+#endif
 
     // random number generator constants
     static long const
@@ -292,7 +338,7 @@ private:
     Geom::Rect _tile;
     Geom::Point _baseFreq;
     int _latticeSelector[2*BSize + 2];
-    double _gradient[2*BSize + 2][4][2];
+    double _gradient[2*BSize + 2][2][4]; // [lattice point][x, y][channel]
     long _seed;
     int _octaves;
     bool _stitchTiles;
@@ -374,6 +420,99 @@ private:
     int _x0, _y0;
 };
 
+namespace {
+
+/// Generated noise is cached in square blocks of this size, aligned to the pixel grid of the
+/// filter, so that the tiles of a redraw reuse every block they overlap.
+int const NOISE_BLOCK_SIZE = 128;
+
+/// Number of cached blocks (64 MiB), shared by all turbulence primitives.
+std::size_t const NOISE_CACHE_BLOCKS = 1024;
+
+int block_index(int x)
+{
+    return x >= 0 ? x / NOISE_BLOCK_SIZE : -((NOISE_BLOCK_SIZE - 1 - x) / NOISE_BLOCK_SIZE);
+}
+
+/// Everything the noise of a block depends on.
+struct NoiseBlockKey {
+    double seed = 0;
+    double freq[2] = {};
+    double tile[4] = {};
+    double trans[6] = {};
+    int octaves = 0;
+    bool fractalnoise = false;
+    bool stitch = false;
+    int x = 0; ///< position of the block, in blocks
+    int y = 0;
+
+    bool operator==(NoiseBlockKey const &other) const {
+        return seed == other.seed && octaves == other.octaves && fractalnoise == other.fractalnoise &&
+               stitch == other.stitch && x == other.x && y == other.y &&
+               std::equal(freq, freq + 2, other.freq) && std::equal(tile, tile + 4, other.tile) &&
+               std::equal(trans, trans + 6, other.trans);
+    }
+};
+
+struct NoiseBlockKeyHash {
+    std::size_t operator()(NoiseBlockKey const &key) const {
+        std::size_t h = std::hash<int>()(key.x);
+        auto combine = [&] (std::size_t v) { h ^= v + 0x9e3779b9 + (h << 6) + (h >> 2); };
+        combine(std::hash<int>()(key.y));
+        combine(std::hash<int>()(key.octaves * 4 + key.fractalnoise * 2 + key.stitch));
+        combine(std::hash<double>()(key.seed));
+        for (double v : key.freq) combine(std::hash<double>()(v));
+        for (double v : key.tile) combine(std::hash<double>()(v));
+        for (double v : key.trans) combine(std::hash<double>()(v));
+        return h;
+    }
+};
+
+using NoiseBlock = std::shared_ptr<std::vector<guint32> const>;
+
+/// Least recently used noise blocks. Blocks are immutable once inserted, so they can be read
+/// without holding the lock.
+class NoiseCache {
+public:
+    static NoiseCache &get() {
+        static NoiseCache cache;
+        return cache;
+    }
+
+    NoiseBlock find(NoiseBlockKey const &key) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto entry = _index.find(key);
+        if (!entry) {
+            return {};
+        }
+        _entries.splice(_entries.begin(), _entries, *entry);
+        return (*entry)->second;
+    }
+
+    void insert(NoiseBlockKey const &key, NoiseBlock block) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_index.contains(key)) {
+            // generated concurrently by another thread
+            return;
+        }
+        _entries.emplace_front(key, std::move(block));
+        _index.insert_or_assign(key, _entries.begin());
+        if (_entries.size() > NOISE_CACHE_BLOCKS) {
+            _index.erase(_entries.back().first);
+            _entries.pop_back();
+        }
+    }
+
+private:
+    using Entries = std::list<std::pair<NoiseBlockKey, NoiseBlock>>;
+
+    std::mutex _mutex;
+    Entries _entries;
+    Inkscape::Util::FlatHashMap<NoiseBlockKey, Entries::iterator, NoiseBlockKeyHash> _index;
+};
+
+} // namespace
+
 void FilterTurbulence::render_cairo(FilterSlot &slot)
 {
     cairo_surface_t *input = slot.getcairo(_input);
@@ -397,6 +536,7 @@ void FilterTurbulence::render_cairo(FilterSlot &slot)
         set_cairo_surface_ci(out, (SPColorInterpolation)_style->color_interpolation_filters.computed );
     }
 
+    std::unique_lock<std::mutex> lock(gen_mutex);
     if (!gen->ready()) {
         Geom::Point ta(fTileX, fTileY);
         Geom::Point tb(fTileX + fTileWidth, fTileY + fTileHeight);
@@ -404,12 +544,101 @@ void FilterTurbulence::render_cairo(FilterSlot &slot)
             Geom::Point(XbaseFrequency, YbaseFrequency), stitchTiles,
             type == TURBULENCE_FRACTALNOISE, numOctaves);
     }
+    lock.unlock();
 
     Geom::Affine unit_trans = slot.get_units().get_matrix_primitiveunits2pb().inverse();
     Geom::Rect slot_area = slot.get_slot_area();
-    double x0 = slot_area.min()[Geom::X];
-    double y0 = slot_area.min()[Geom::Y];
-    ink_cairo_surface_synthesize(temp, Turbulence(*gen, unit_trans, x0, y0));
+    int x0 = slot_area.min()[Geom::X];
+    int y0 = slot_area.min()[Geom::Y];
+
+    // Look up the blocks covering the surface, and generate the missing ones.
+    NoiseBlockKey key;
+    key.seed = seed;
+    key.freq[0] = XbaseFrequency;
+    key.freq[1] = YbaseFrequency;
+    key.tile[0] = fTileX;
+    key.tile[1] = fTileY;
+    key.tile[2] = fTileWidth;
+    key.tile[3] = fTileHeight;
+    for (int i = 0; i < 6; ++i) {
+        key.trans[i] = unit_trans[i];
+    }
+    key.octaves = numOctaves;
+    key.fractalnoise = type == TURBULENCE_FRACTALNOISE;
+    key.stitch = stitchTiles;
+
+    int bx0 = block_index(x0);
+    int by0 = block_index(y0);
+    int bcols = block_index(x0 + width - 1) - bx0 + 1;
+    int brows = block_index(y0 + height - 1) - by0 + 1;
+
+    auto &cache = NoiseCache::get();
+    std::vector<NoiseBlock> blocks(bcols * brows);
+    std::vector<int> missing;
+    for (int i = 0; i < brows; ++i) {
+        for (int j = 0; j < bcols; ++j) {
+            key.x = bx0 + j;
+            key.y = by0 + i;
+            blocks[i * bcols + j] = cache.find(key);
+            if (!blocks[i * bcols + j]) {
+                missing.push_back(i * bcols + j);
+            }
+        }
+    }
+
+    if (!missing.empty()) {
+        std::vector<std::shared_ptr<std::vector<guint32>>> generated(missing.size());
+        for (auto &block : generated) {
+            block = std::make_shared<std::vector<guint32>>(NOISE_BLOCK_SIZE * NOISE_BLOCK_SIZE);
+        }
+
+        // Rows of all missing blocks are generated in parallel.
+        int rows = missing.size() * NOISE_BLOCK_SIZE;
+        #if HAVE_OPENMP
+        int limit = rows * NOISE_BLOCK_SIZE;
+        Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+        int numOfThreads = prefs->getIntLimited("/options/threading/numthreads", omp_get_num_procs(), 1, 256);
+        if (numOfThreads){} // inform compiler we are using it.
+        #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
+        #endif
+        for (int r = 0; r < rows; ++r) {
+            int b = missing[r / NOISE_BLOCK_SIZE];
+            int i = r % NOISE_BLOCK_SIZE;
+            Turbulence synth(*gen, unit_trans, (bx0 + b % bcols) * NOISE_BLOCK_SIZE,
+                             (by0 + b / bcols) * NOISE_BLOCK_SIZE);
+            guint32 *row = generated[r / NOISE_BLOCK_SIZE]->data() + i * NOISE_BLOCK_SIZE;
+            for (int j = 0; j < NOISE_BLOCK_SIZE; ++j) {
+                row[j] = synth(j, i);
+            }
+        }
+
+        for (std::size_t m = 0; m < missing.size(); ++m) {
+            int b = missing[m];
+            key.x = bx0 + b % bcols;
+            key.y = by0 + b / bcols;
+            blocks[b] = generated[m];
+            cache.insert(key, blocks[b]);
+        }
+    }
+
+    // Copy the covered part of each block row by row.
+    cairo_surface_flush(temp);
+    unsigned char *temp_data = cairo_image_surface_get_data(temp);
+    int stride = cairo_image_surface_get_stride(temp);
+    for (int y = 0; y < height; ++y) {
+        int by = block_index(y0 + y);
+        int i = y0 + y - by * NOISE_BLOCK_SIZE;
+        guint32 *out_row = reinterpret_cast<guint32*>(temp_data + y * stride);
+        for (int x = 0; x < width; ) {
+            int bx = block_index(x0 + x);
+            int j = x0 + x - bx * NOISE_BLOCK_SIZE;
+            int n = std::min(NOISE_BLOCK_SIZE - j, width - x);
+            auto const &block = *blocks[(by - by0) * bcols + bx - bx0];
+            std::memcpy(out_row + x, block.data() + i * NOISE_BLOCK_SIZE + j, n * sizeof(guint32));
+            x += n;
+        }
+    }
+    cairo_surface_mark_dirty(temp);
 
     // cairo_surface_write_to_png( temp, "turbulence0.png" );
 
@@ -22,6 +22,7 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <mutex>
 #include <2geom/point.h>
 
 #include "display/nr-filter-primitive.h"
@@ -61,6 +62,7 @@ public:
 private:
 
     TurbulenceGenerator *gen;
+    std::mutex gen_mutex; // the generator is initialised lazily from the rendering threads
 
     void turbulenceInit(long seed);
 
@@ -10,11 +10,22 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#ifdef HAVE_CONFIG_H
+# include "config.h"  // only include where actually required!
+#endif
+
 #include <glib.h>
+#include <algorithm>
 #include <cmath>
 #include <cstring>
+#include <limits>
+#include <map>
+#include <set>
 #include <string>
 #include <cairo.h>
+#if HAVE_OPENMP
+#include <omp.h>
+#endif
 
 #include "display/nr-filter.h"
 #include "display/nr-filter-primitive.h"
@@ -108,9 +119,6 @@ int Filter::render(Inkscape::DrawingItem const *item, DrawingContext &graphic, D
         graphic.setOperator(CAIRO_OPERATOR_OVER);
         return 1;
     }
-    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
-    item->drawing().setFilterQuality(prefs->getInt("/options/filterquality/value", 0));
-    item->drawing().setBlurQuality(prefs->getInt("/options/blurquality/value", 0));
     FilterQuality const filterquality = (FilterQuality)item->drawing().filterQuality();
     int const blurquality = item->drawing().blurQuality();
 
@@ -152,17 +160,18 @@ int Filter::render(Inkscape::DrawingItem const *item, DrawingContext &graphic, D
         }
     }
 
-    FilterSlot slot(const_cast<Inkscape::DrawingItem*>(item), bgdc, graphic, units);
-    slot.set_quality(filterquality);
-    slot.set_blurquality(blurquality);
-    slot.set_device_scale(graphic.surface()->device_scale());
-
-    for (auto & i : _primitive) {
-        i->render_cairo(slot);
-    }
+    auto create_slot = [&] {
+        auto slot = std::make_unique<FilterSlot>(const_cast<Inkscape::DrawingItem*>(item), bgdc, graphic, units);
+        slot->set_quality(filterquality);
+        slot->set_blurquality(blurquality);
+        slot->set_device_scale(graphic.surface()->device_scale());
+        return slot;
+    };
+    auto slot = create_slot();
+    int const result_slot = _render_primitives(*slot, create_slot);
 
     Geom::Point origin = graphic.targetLogicalBounds().min();
-    cairo_surface_t *result = slot.get_result(_output_slot);
+    cairo_surface_t *result = slot->get_result(result_slot);
 
     // Assume for the moment that we paint the filter in sRGB
     set_cairo_surface_ci( result, SP_CSS_COLOR_INTERPOLATION_SRGB );
@@ -176,6 +185,154 @@ int Filter::render(Inkscape::DrawingItem const *item, DrawingContext &graphic, D
     return 0;
 }
 
+/**
+ * Renders the primitives of the filter and returns the slot of @a slot holding the result.
+ *
+ * The primitives form a graph through the slots they read and write. Each primitive is
+ * rendered in a slot of its own created by @a create_slot, holding only its inputs, once
+ * the primitives it depends on are done. Primitives at the same depth of the graph, like
+ * the branches of a drop shadow, are rendered concurrently. Intermediate images are
+ * released as soon as all of their consumers are rendered.
+ */
+int Filter::_render_primitives(FilterSlot &slot, std::function<std::unique_ptr<FilterSlot>()> const &create_slot)
+{
+    // An input that no primitive produced reads as a transparent image.
+    int const NO_SOURCE = std::numeric_limits<int>::min();
+    int const count = _primitive.size();
+
+    // Resolve the inputs of each primitive to the earlier primitive producing them,
+    // or to one of the predefined images (negative numbers).
+    std::vector<std::vector<int>> inputs(count);
+    std::vector<std::vector<int>> sources(count);
+    std::vector<std::vector<int>> dependencies(count);
+    std::vector<int> depth(count, 0);
+    std::vector<int> consumers(count, 0);
+    std::map<int, int> producers;
+    auto resolve = [&] (int input, int previous) {
+        if (input == NR_FILTER_SLOT_NOT_SET) {
+            return previous >= 0 ? previous : static_cast<int>(NR_FILTER_SOURCEGRAPHIC);
+        }
+        if (input < 0) {
+            return input;
+        }
+        auto it = producers.find(input);
+        return it != producers.end() ? it->second : NO_SOURCE;
+    };
+
+    int max_depth = 0;
+    for (int i = 0; i < count; ++i) {
+        inputs[i] = _primitive[i]->get_inputs();
+        for (int input : inputs[i]) {
+            int source = resolve(input, i - 1);
+            sources[i].push_back(source);
+            if (source >= 0) {
+                dependencies[i].push_back(source);
+                depth[i] = std::max(depth[i], depth[source] + 1);
+            } else if (source != NO_SOURCE) {
+                slot.getcairo(source); // create predefined images up front
+            }
+        }
+        std::sort(dependencies[i].begin(), dependencies[i].end());
+        dependencies[i].erase(std::unique(dependencies[i].begin(), dependencies[i].end()), dependencies[i].end());
+        for (int source : dependencies[i]) {
+            ++consumers[source];
+        }
+
+        int output = _primitive[i]->get_output();
+        producers[output == NR_FILTER_SLOT_NOT_SET ? NR_FILTER_UNNAMED_SLOT : output] = i;
+        max_depth = std::max(max_depth, depth[i]);
+    }
+
+    int const result = resolve(_output_slot, count - 1);
+    if (result >= 0) {
+        ++consumers[result];
+    }
+
+#if HAVE_OPENMP
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    int const num_threads = prefs->getIntLimited("/options/threading/numthreads", omp_get_num_procs(), 1, 256);
+#endif
+
+    std::vector<cairo_surface_t *> images(count, nullptr);
+    std::vector<Geom::OptRect> areas(count);
+
+    for (int d = 0; d <= max_depth; ++d) {
+        std::vector<int> batch;
+        for (int i = 0; i < count; ++i) {
+            if (depth[i] == d) {
+                batch.push_back(i);
+            }
+        }
+
+        // Set up the slots of this batch. Primitives may convert the color interpolation
+        // of their inputs in place, so concurrent primitives get their own copy of an image.
+        std::vector<std::unique_ptr<FilterSlot>> batch_slots;
+        std::set<cairo_surface_t *> used;
+        for (int i : batch) {
+            auto primitive_slot = create_slot();
+            std::map<cairo_surface_t *, cairo_surface_t *> given;
+            for (unsigned k = 0; k < inputs[i].size(); ++k) {
+                int source = sources[i][k];
+                if (source == NO_SOURCE) {
+                    continue;
+                }
+                cairo_surface_t *image = source >= 0 ? images[source] : slot.getcairo(source);
+                if (!image) {
+                    continue; // the producer did not output anything
+                }
+                auto it = given.find(image);
+                if (it == given.end()) {
+                    bool shared = !used.insert(image).second;
+                    it = given.emplace(image, shared ? ink_cairo_surface_copy(image) : cairo_surface_reference(image)).first;
+                }
+                primitive_slot->set_input(inputs[i][k], it->second, source >= 0 ? areas[source] : Geom::OptRect());
+            }
+            for (auto &g : given) {
+                cairo_surface_destroy(g.second);
+            }
+            batch_slots.push_back(std::move(primitive_slot));
+        }
+
+        int const batch_size = batch.size();
+        #if HAVE_OPENMP
+        int const threads = std::min(num_threads, batch_size);
+        #pragma omp parallel for num_threads(threads) schedule(dynamic, 1) if (threads > 1)
+        #endif
+        for (int j = 0; j < batch_size; ++j) {
+            _primitive[batch[j]]->render_cairo(*batch_slots[j]);
+        }
+
+        for (int j = 0; j < batch_size; ++j) {
+            int const i = batch[j];
+            if (cairo_surface_t *output = batch_slots[j]->get_output()) {
+                images[i] = cairo_surface_reference(output);
+                areas[i] = batch_slots[j]->get_output_area();
+            }
+            batch_slots[j].reset();
+            if (consumers[i] == 0) {
+                cairo_surface_destroy(images[i]);
+                images[i] = nullptr;
+            }
+            for (int source : dependencies[i]) {
+                if (--consumers[source] == 0) {
+                    cairo_surface_destroy(images[source]);
+                    images[source] = nullptr;
+                }
+            }
+        }
+    }
+
+    if (result >= 0) {
+        if (images[result]) {
+            slot.set(NR_FILTER_UNNAMED_SLOT, images[result]);
+            cairo_surface_destroy(images[result]);
+        }
+        return NR_FILTER_UNNAMED_SLOT;
+    }
+    // a predefined image, or an empty one if the output slot was never written
+    return result == NO_SOURCE ? NR_FILTER_UNNAMED_SLOT : result;
+}
+
 void Filter::set_filter_units(SPFilterUnits unit) {
     _filter_units = unit;
 }
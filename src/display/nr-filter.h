@@ -15,6 +15,8 @@
 
 //#include "display/nr-arena-item.h"
 #include <cairo.h>
+#include <functional>
+#include <memory>
 #include "display/nr-filter-primitive.h"
 #include "display/nr-filter-types.h"
 #include "svg/svg-length.h"
@@ -199,6 +201,7 @@ private:
     SPFilterUnits _primitive_units;
 
     void _create_constructor_table();
+    int _render_primitives(FilterSlot &slot, std::function<std::unique_ptr<FilterSlot>()> const &create_slot);
     void _common_init();
     int _resolution_limit(FilterQuality const quality) const;
     std::pair<double,double> _filter_resolution(Geom::Rect const &area,
@@ -10,6 +10,8 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <mutex>
+
 #include "display/nr-style.h"
 #include "style.h"
 
@@ -355,24 +357,28 @@ cairo_pattern_t* NRStyle::preparePaint(Inkscape::DrawingContext &dc, Geom::OptRe
 
 bool NRStyle::prepareFill(Inkscape::DrawingContext &dc, Geom::OptRect const &paintbox, Inkscape::DrawingPattern *pattern)
 {
+    std::lock_guard<std::mutex> lock(prepare_mutex);
     if (!fill_pattern) fill_pattern = preparePaint(dc, paintbox, pattern, fill);
     return fill_pattern != nullptr;
 }
 
 bool NRStyle::prepareStroke(Inkscape::DrawingContext &dc, Geom::OptRect const &paintbox, Inkscape::DrawingPattern *pattern)
 {
+    std::lock_guard<std::mutex> lock(prepare_mutex);
     if (!stroke_pattern) stroke_pattern = preparePaint(dc, paintbox, pattern, stroke);
     return stroke_pattern != nullptr;
 }
 
 bool NRStyle::prepareTextDecorationFill(Inkscape::DrawingContext &dc, Geom::OptRect const &paintbox, Inkscape::DrawingPattern *pattern)
 {
+    std::lock_guard<std::mutex> lock(prepare_mutex);
     if (!text_decoration_fill_pattern) text_decoration_fill_pattern = preparePaint(dc, paintbox, pattern, text_decoration_fill);
     return text_decoration_fill_pattern != nullptr;
 }
 
 bool NRStyle::prepareTextDecorationStroke(Inkscape::DrawingContext &dc, Geom::OptRect const &paintbox, Inkscape::DrawingPattern *pattern)
 {
+    std::lock_guard<std::mutex> lock(prepare_mutex);
     if (!text_decoration_stroke_pattern) text_decoration_stroke_pattern = preparePaint(dc, paintbox, pattern, text_decoration_stroke);
     return text_decoration_stroke_pattern != nullptr;
 }
@@ -14,6 +14,7 @@
 #ifndef SEEN_INKSCAPE_DISPLAY_NR_ARENA_STYLE_H
 #define SEEN_INKSCAPE_DISPLAY_NR_ARENA_STYLE_H
 
+#include <mutex>
 #include <cairo.h>
 #include <2geom/rect.h>
 #include "color.h"
@@ -82,6 +83,9 @@ struct NRStyle {
     cairo_pattern_t *text_decoration_fill_pattern;
     cairo_pattern_t *text_decoration_stroke_pattern;
 
+    /// Patterns are created lazily on first render, possibly from several rendering threads.
+    std::mutex prepare_mutex;
+
     enum PaintOrderType {
         PAINT_ORDER_NORMAL,
         PAINT_ORDER_FILL,
@@ -37,6 +37,7 @@
 #define noSP_DOCUMENT_DEBUG_IDLE
 #define noSP_DOCUMENT_DEBUG_UNDO
 
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <cstring>
@@ -53,6 +54,7 @@
 #include "inkscape-window.h"
 #include "profile-manager.h"
 #include "rdf.h"
+#include "style-sheet-index.h"
 
 #include "actions/actions-edit-document.h"
 #include "actions/actions-undo-document.h"
@@ -122,7 +124,6 @@ SPDocument::SPDocument() :
     current_persp3d(nullptr),
     current_persp3d_impl(nullptr),
     _parent_document(nullptr),
-    _node_cache_valid(false),
     _activexmltree(nullptr)
 {
     Inkscape::Preferences *prefs = Inkscape::Preferences::get();
@@ -150,7 +151,6 @@ SPDocument::SPDocument() :
 
     // XXX only for testing!
     undoStackObservers.add(console_output_undo_observer);
-    _node_cache = std::deque<SPItem*>();
 
     // Actions
     action_group = Gio::SimpleActionGroup::create();
@@ -203,6 +203,7 @@ SPDocument::~SPDocument() {
     resources.clear();
 
     // This also destroys all attached stylesheets
+    _style_sheet_index.reset();
     cr_cascade_unref(style_cascade);
     style_cascade = nullptr;
 
@@ -1044,10 +1045,10 @@ void SPDocument::bindObjectToId(gchar const *id, SPObject *object) {
     if (object) {
         if(object->getId())
             iddef.erase(object->getId());
-        g_assert(iddef.find(id)==iddef.end());
-        iddef[id] = object;
+        g_assert(!iddef.contains(id));
+        iddef.insert_or_assign(id, object);
     } else {
-        g_assert(iddef.find(id)!=iddef.end());
+        g_assert(iddef.contains(id));
         iddef.erase(id);
     }
 
@@ -1063,51 +1064,53 @@ void SPDocument::bindObjectToId(gchar const *id, SPObject *object) {
     }
 }
 
-SPObject *SPDocument::getObjectById(Glib::ustring const &id) const
+/// Look up an object by id, falling back to the parent and reference documents.
+SPObject *SPDocument::_getObjectById(std::string_view id) const
 {
-    if (iddef.empty()) {
+    if (auto object = iddef.find(id)) {
+        return *object;
+    } else if (_parent_document) {
+        return _parent_document->_getObjectById(id);
+    } else if (_ref_document) {
+        return _ref_document->_getObjectById(id);
+    } else {
         return nullptr;
     }
+}
 
-    std::map<std::string, SPObject *>::const_iterator rv = iddef.find(id);
-    if (rv != iddef.end()) {
-        return (rv->second);
-    } else if (_parent_document) {
-        return _parent_document->getObjectById(id);
-    }
-    else if (_ref_document) {
-        return _ref_document->getObjectById(id);
-    } else {
+SPObject *SPDocument::getObjectById(Glib::ustring const &id) const
+{
+    if (iddef.empty()) {
         return nullptr;
     }
+
+    return _getObjectById(id.raw());
 }
 
 SPObject *SPDocument::getObjectById(gchar const *id) const
 {
-    if (id == nullptr) {
+    if (id == nullptr || iddef.empty()) {
         return nullptr;
     }
 
-    return getObjectById(Glib::ustring(id));
+    return _getObjectById(id);
 }
 
 SPObject *SPDocument::getObjectByHref(Glib::ustring const &href) const
 {
-    if (iddef.empty()) {
+    if (iddef.empty() || href.empty()) {
         return nullptr;
     }
-    Glib::ustring id = href;
-    id = id.erase(0, 1);
-    return getObjectById(id);
+    return _getObjectById(std::string_view(href.raw()).substr(1));
 }
 
 SPObject *SPDocument::getObjectByHref(gchar const *href) const
 {
-    if (href == nullptr) {
+    if (href == nullptr || iddef.empty() || *href == '\0') {
         return nullptr;
     }
 
-    return getObjectByHref(Glib::ustring(href));
+    return _getObjectById(href + 1);
 }
 
 void _getObjectsByClassRecursive(Glib::ustring const &klass, SPObject *parent, std::vector<SPObject *> &objects)
@@ -1218,10 +1221,10 @@ std::vector<SPObject *> SPDocument::getObjectsBySelector(Glib::ustring const &se
 void SPDocument::bindObjectToRepr(Inkscape::XML::Node *repr, SPObject *object)
 {
     if (object) {
-        g_assert(reprdef.find(repr)==reprdef.end());
-        reprdef[repr] = object;
+        g_assert(!reprdef.contains(repr));
+        reprdef.insert_or_assign(repr, object);
     } else {
-        g_assert(reprdef.find(repr)!=reprdef.end());
+        g_assert(reprdef.contains(repr));
         reprdef.erase(repr);
     }
 }
@@ -1229,11 +1232,26 @@ void SPDocument::bindObjectToRepr(Inkscape::XML::Node *repr, SPObject *object)
 SPObject *SPDocument::getObjectByRepr(Inkscape::XML::Node *repr) const
 {
     g_return_val_if_fail(repr != nullptr, NULL);
-    std::map<Inkscape::XML::Node *, SPObject *>::const_iterator rv = reprdef.find(repr);
-    if(rv != reprdef.end())
-        return (rv->second);
-    else
-        return nullptr;
+    auto object = reprdef.find(repr);
+    return object ? *object : nullptr;
+}
+
+/**
+ * The index of the style sheet rules of the document, built on first use after the style
+ * sheets changed.
+ */
+Inkscape::StyleSheetIndex &SPDocument::getStyleSheetIndex()
+{
+    if (!_style_sheet_index) {
+        _style_sheet_index = std::make_unique<Inkscape::StyleSheetIndex>(style_cascade);
+    }
+    return *_style_sheet_index;
+}
+
+/// Must be called whenever a style sheet of the style cascade is changed.
+void SPDocument::invalidateStyleSheetIndex()
+{
+    _style_sheet_index.reset();
 }
 
 /** Returns preferred document languages (from most to least preferred)
@@ -1464,6 +1482,68 @@ static std::vector<SPItem*> &find_items_in_area(std::vector<SPItem*> &s,
     return s;
 }
 
+/**
+ * Whether find_items_in_area() would examine item when searching root, leaving hidden items out.
+ */
+static bool is_searched_in_area(SPItem *item, SPRoot *root, unsigned int dkey,
+                                bool take_insensitive, bool take_groups, bool enter_groups)
+{
+    if (!take_insensitive && item->isLocked()) {
+        return false;
+    }
+    if (SPGroup *group = dynamic_cast<SPGroup *>(item)) {
+        if (!take_groups || group->effectiveLayerMode(dkey) == SPGroup::LAYER) {
+            return false;
+        }
+    }
+    for (SPObject *o = item; o != root; o = o->parent) {
+        SPItem *ancestor = dynamic_cast<SPItem *>(o);
+        if (!ancestor || ancestor->isHidden()) {
+            return false;
+        }
+        if (ancestor != item) {
+            SPGroup *group = dynamic_cast<SPGroup *>(ancestor);
+            if (!group || !(enter_groups || group->effectiveLayerMode(dkey) == SPGroup::LAYER)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Same as find_items_in_area() without hidden items, but only examines the items
+ * whose rendering is near the area, as found in the spatial index of the drawing.
+ *
+ * @param area Area in document coordinates
+ */
+static std::vector<SPItem*> find_items_in_area(Inkscape::Drawing &drawing, SPRoot *root, unsigned int dkey,
+                                               Geom::Rect const &area,
+                                               bool (*test)(Geom::Rect const &, Geom::Rect const &),
+                                               bool take_insensitive, bool take_groups, bool enter_groups)
+{
+    // The children of the root are displayed in document coordinates.
+    Geom::Rect drawing_area = area * root->get_arenaitem(dkey)->ctm();
+    drawing_area.expandBy(1); // drawing bounds are rounded to whole pixels
+
+    std::vector<SPItem*> s;
+    for (auto arenaitem : drawing.itemsInArea(drawing_area)) {
+        SPItem *item = arenaitem->getItem();
+        if (!item || item->get_arenaitem(dkey) != arenaitem ||
+            !is_searched_in_area(item, root, dkey, take_insensitive, take_groups, enter_groups)) {
+            continue;
+        }
+        Geom::OptRect box = item->documentVisualBounds();
+        if (box && test(area, *box)) {
+            s.push_back(item);
+        }
+    }
+    // Same order as the traversal: document order, groups after their contents.
+    std::sort(s.begin(), s.end(), sp_object_compare_position_bool);
+    s.erase(std::unique(s.begin(), s.end()), s.end());
+    return s;
+}
+
 SPItem *SPDocument::getItemFromListAtPointBottom(unsigned int dkey, SPGroup *group, std::vector<SPItem*> const &list,Geom::Point const &p, bool take_insensitive)
 {
     g_return_val_if_fail(group, NULL);
@@ -1501,61 +1581,87 @@ SPItem *SPDocument::getItemFromListAtPointBottom(unsigned int dkey, SPGroup *gro
 }
 
 /**
-Turn the SVG DOM into a flat list of nodes that can be searched from top-down.
-The list can be persisted, which improves "find at multiple points" speed.
-*/
-// TODO: study add `gboolean with_groups = false` as parameter.
-void SPDocument::build_flat_item_list(unsigned int dkey, SPGroup *group, gboolean into_groups) const
+Returns the drawing in which the document is displayed under the given key,
+brought up to date for picking, or NULL if there is no such display.
+ */
+static Inkscape::Drawing *get_updated_drawing(SPRoot *root, unsigned int dkey)
 {
-    for (auto& o: group->children) {
-        if (!SP_IS_ITEM(&o)) {
-            continue;
-        }
+    Inkscape::DrawingItem *arenaitem = root->get_arenaitem(dkey);
+    if (!arenaitem) {
+        return nullptr;
+    }
+    arenaitem->drawing().update();
+    return &arenaitem->drawing();
+}
 
-        if (SP_IS_GROUP(&o) && (SP_GROUP(&o)->effectiveLayerMode(dkey) == SPGroup::LAYER || into_groups)) {
-            build_flat_item_list(dkey, SP_GROUP(&o), into_groups);
-        } else {
-            SPItem *child = SP_ITEM(&o);
-            if (child->isVisibleAndUnlocked(dkey)) {
-                _node_cache.push_front(child);
-            }
+/**
+Returns the pickable item which contains item (possibly item itself), or NULL if
+there is none. Pickable items are the visible and unlocked descendants of root
+that are reached by recursing into layers (and into all groups if into_groups is
+set) but are not recursed into themselves.
+ */
+static SPItem *find_pickable_ancestor(SPItem *item, SPRoot *root, unsigned int dkey, bool into_groups)
+{
+    SPItem *pickable = nullptr;
+    for (SPObject *o = item; o != root; o = o->parent) {
+        SPItem *ancestor = dynamic_cast<SPItem *>(o);
+        if (!ancestor) {
+            // not rendered as part of the document, e.g. inside <defs>
+            return nullptr;
         }
+        SPGroup *group = dynamic_cast<SPGroup *>(ancestor);
+        if (!group || (!into_groups && group->effectiveLayerMode(dkey) != SPGroup::LAYER)) {
+            pickable = ancestor;
+        }
+    }
+    if (pickable && !pickable->isVisibleAndUnlocked(dkey)) {
+        return nullptr;
     }
+    return pickable;
 }
 
 /**
-Returns the items from the descendants of group (recursively) which are at the
-point p, or NULL if none. Honors into_groups on whether to recurse into non-layer
-groups or not. Honors take_insensitive on whether to return insensitive items.
-If upto != NULL, then if item upto is encountered (at any level), stops searching
-upwards in z-order and returns what it has found so far (i.e. the found items are
-guaranteed to be lower than upto). Requires a list of nodes built by build_flat_item_list.
+Returns the items from the descendants of root which are at the point p, topmost
+first. Honors into_groups on whether to recurse into non-layer groups or not.
+If upto != NULL, only items below upto in z-order are returned.
 If items_count > 0, it'll return the topmost (in z-order) items_count items.
+Candidates are taken from the spatial index of the drawing, so that only the
+items whose bounding box is near p have to be picked exactly.
  */
-static std::vector<SPItem*> find_items_at_point(std::deque<SPItem*> *nodes, unsigned int dkey,
-                                                 Geom::Point const &p, int items_count=0, SPItem* upto=nullptr)
+static std::vector<SPItem*> find_items_at_point(Inkscape::Drawing &drawing, SPRoot *root, unsigned int dkey,
+                                                 Geom::Point const &p, bool into_groups,
+                                                 int items_count=0, SPItem* upto=nullptr)
 {
     Inkscape::Preferences *prefs = Inkscape::Preferences::get();
     gdouble delta = prefs->getDouble("/options/cursortolerance/value", 1.0);
 
-    SPItem *child;
     std::vector<SPItem*> result;
-    bool seen_upto = (!upto);
-    for (auto node : *nodes) {
-        child = node;
-        if (!seen_upto){
-            if(child == upto)
-                seen_upto = true;
-            continue;
+    if (upto && find_pickable_ancestor(upto, root, dkey, into_groups) != upto) {
+        return result;
+    }
+
+    Geom::Rect area(p, p);
+    area.expandBy(delta);
+
+    std::vector<SPItem*> candidates;
+    for (auto arenaitem : drawing.itemsInArea(area)) {
+        SPItem *item = arenaitem->getItem();
+        SPItem *pickable = item ? find_pickable_ancestor(item, root, dkey, into_groups) : nullptr;
+        if (pickable && (!upto || sp_object_compare_position(pickable, upto) < 0)) {
+            candidates.push_back(pickable);
         }
+    }
+    std::sort(candidates.begin(), candidates.end(), [] (SPItem const *a, SPItem const *b) {
+        return sp_object_compare_position(a, b) > 0;
+    });
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    for (auto child : candidates) {
         Inkscape::DrawingItem *arenaitem = child->get_arenaitem(dkey);
-        if (arenaitem) {
-            arenaitem->drawing().update();
-            if (arenaitem->pick(p, delta, 1) != nullptr) {
-                result.push_back(child);
-                if (--items_count == 0) {
-                    break;
-                }
+        if (arenaitem && arenaitem->pick(p, delta, 1) != nullptr) {
+            result.push_back(child);
+            if (--items_count == 0) {
+                break;
             }
         }
     }
@@ -1563,15 +1669,6 @@ static std::vector<SPItem*> find_items_at_point(std::deque<SPItem*> *nodes, unsi
     return result;
 }
 
-static SPItem *find_item_at_point(std::deque<SPItem*> *nodes, unsigned int dkey, Geom::Point const &p, SPItem* upto=nullptr)
-{
-    auto items = find_items_at_point(nodes, dkey, p, 1, upto);
-    if (items.empty()) {
-        return nullptr;
-    }
-    return items.back();
-}
-
 /**
 Returns the topmost non-layer group from the descendants of group which is at point
 p, or NULL if none. Recurses into layers but not into groups.
@@ -1617,6 +1714,12 @@ static SPItem *find_group_at_point(unsigned int dkey, SPGroup *group, Geom::Poin
 
 std::vector<SPItem*> SPDocument::getItemsInBox(unsigned int dkey, Geom::Rect const &box, bool take_hidden, bool take_insensitive, bool take_groups, bool enter_groups) const
 {
+    // Hidden items are not necessarily displayed, so they can only be found by traversal.
+    if (!take_hidden) {
+        if (Inkscape::Drawing *drawing = get_updated_drawing(root, dkey)) {
+            return find_items_in_area(*drawing, root, dkey, box, is_within, take_insensitive, take_groups, enter_groups);
+        }
+    }
     std::vector<SPItem*> x;
     return find_items_in_area(x, this->root, dkey, box, is_within, take_hidden, take_insensitive, take_groups, enter_groups);
 }
@@ -1634,6 +1737,12 @@ std::vector<SPItem*> SPDocument::getItemsInBox(unsigned int dkey, Geom::Rect con
 
 std::vector<SPItem*> SPDocument::getItemsPartiallyInBox(unsigned int dkey, Geom::Rect const &box, bool take_hidden, bool take_insensitive, bool take_groups, bool enter_groups) const
 {
+    // Hidden items are not necessarily displayed, so they can only be found by traversal.
+    if (!take_hidden) {
+        if (Inkscape::Drawing *drawing = get_updated_drawing(root, dkey)) {
+            return find_items_in_area(*drawing, root, dkey, box, overlaps, take_insensitive, take_groups, enter_groups);
+        }
+    }
     std::vector<SPItem*> x;
     return find_items_in_area(x, this->root, dkey, box, overlaps, take_hidden, take_insensitive, take_groups, enter_groups);
 }
@@ -1641,6 +1750,10 @@ std::vector<SPItem*> SPDocument::getItemsPartiallyInBox(unsigned int dkey, Geom:
 std::vector<SPItem*> SPDocument::getItemsAtPoints(unsigned const key, std::vector<Geom::Point> points, bool all_layers, bool topmost_only, size_t limit) const
 {
     std::vector<SPItem*> result;
+    Inkscape::Drawing *drawing = get_updated_drawing(root, key);
+    if (!drawing) {
+        return result;
+    }
     Inkscape::Preferences *prefs = Inkscape::Preferences::get();
 
     // When picking along the path, we don't want small objects close together
@@ -1649,12 +1762,6 @@ std::vector<SPItem*> SPDocument::getItemsAtPoints(unsigned const key, std::vecto
     gdouble saved_delta = prefs->getDouble("/options/cursortolerance/value", 1.0);
     prefs->setDouble("/options/cursortolerance/value", 0.25);
 
-    // Cache a flattened SVG DOM to speed up selection.
-    if(!_node_cache_valid){
-        _node_cache.clear();
-        build_flat_item_list(key, this->root, true);
-        _node_cache_valid=true;
-    }
     SPObject *current_layer = nullptr;
     SPDesktop *desktop = SP_ACTIVE_DESKTOP;
     if(desktop){
@@ -1662,7 +1769,7 @@ std::vector<SPItem*> SPDocument::getItemsAtPoints(unsigned const key, std::vecto
     }
     size_t item_counter = 0;
     for(int i = points.size()-1;i>=0; i--) {
-        std::vector<SPItem*> items = find_items_at_point(&_node_cache, key, points[i], topmost_only);
+        std::vector<SPItem*> items = find_items_at_point(*drawing, root, key, points[i], true, topmost_only);
         for (SPItem *item : items) {
             if (item && result.end()==find(result.begin(), result.end(), item))
                 if(all_layers || (desktop && desktop->layerManager().layerForObject(item) == current_layer)){
@@ -1686,22 +1793,15 @@ std::vector<SPItem*> SPDocument::getItemsAtPoints(unsigned const key, std::vecto
 SPItem *SPDocument::getItemAtPoint( unsigned const key, Geom::Point const &p,
                                     bool const into_groups, SPItem *upto) const
 {
-    // Build a flattened SVG DOM for find_item_at_point.
-    std::deque<SPItem*> bak(_node_cache);
-    if(!into_groups){
-        _node_cache.clear();
-        build_flat_item_list(key, this->root, into_groups);
+    Inkscape::Drawing *drawing = get_updated_drawing(root, key);
+    if (!drawing) {
+        return nullptr;
     }
-    if(!_node_cache_valid && into_groups){
-        _node_cache.clear();
-        build_flat_item_list(key, this->root, true);
-        _node_cache_valid=true;
+    auto items = find_items_at_point(*drawing, root, key, p, into_groups, 1, upto);
+    if (items.empty()) {
+        return nullptr;
     }
-
-    SPItem *res = find_item_at_point(&_node_cache, key, p, upto);
-    if(!into_groups)
-        _node_cache = bak;
-    return res;
+    return items.back();
 }
 
 SPItem *SPDocument::getGroupAtPoint(unsigned int key, Geom::Point const &p) const
@@ -2134,7 +2234,6 @@ void SPDocument::_emitModified() {
     static guint const flags = SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_CHILD_MODIFIED_FLAG | SP_OBJECT_PARENT_MODIFIED_FLAG;
     root->emitModified(0);
     modified_signal.emit(flags);
-    _node_cache_valid=false;
 }
 
 void
@@ -23,6 +23,7 @@
 #include <deque>
 #include <map>
 #include <memory>
+#include <string_view>
 #include <vector>
 
 #include <boost/ptr_container/ptr_list.hpp>
@@ -43,6 +44,8 @@
 
 #include "inkgc/gc-managed.h"
 
+#include "util/flat-hash-map.h"
+
 #include "composite-undo-stack-observer.h"
 // XXX only for testing!
 #include "console-output-undo-observer.h"
@@ -81,6 +84,7 @@ namespace Inkscape {
     class EventLog;
     class ProfileManager;
     class PageManager;
+    class StyleSheetIndex;
     namespace XML {
         struct Document;
         class Node;
@@ -212,6 +216,8 @@ public:
 
     // Styling
     CRCascade    *getStyleCascade() { return style_cascade; }
+    Inkscape::StyleSheetIndex &getStyleSheetIndex();
+    void invalidateStyleSheetIndex();
 
     // File information --------------------
 
@@ -301,8 +307,6 @@ public:
     };
 
     // Find items by geometry --------------------
-    void build_flat_item_list(unsigned int dkey, SPGroup *group, gboolean into_groups) const;
-
     std::vector<SPItem*> getItemsInBox         (unsigned int dkey, Geom::Rect const &box, bool take_hidden = false, bool take_insensitive = false, bool take_groups = true, bool enter_groups = false) const;
     std::vector<SPItem*> getItemsPartiallyInBox(unsigned int dkey, Geom::Rect const &box, bool take_hidden = false, bool take_insensitive = false, bool take_groups = true, bool enter_groups = false) const;
     SPItem *getItemAtPoint(unsigned int key, Geom::Point const &p, bool into_groups, SPItem *upto = nullptr) const;
@@ -384,6 +388,7 @@ private:
 
     // Styling
     CRCascade *style_cascade;
+    std::unique_ptr<Inkscape::StyleSheetIndex> _style_sheet_index; ///< built on demand
 
     // Desktop geometry
     mutable Geom::Affine _doc2dt;
@@ -394,12 +399,9 @@ private:
     char *document_name;  ///< basename or other human-readable label for the document.
 
     // Find items ----------------------------
-    std::map<std::string, SPObject *> iddef;
-    std::map<Inkscape::XML::Node *, SPObject *> reprdef;
-
-    // Find items by geometry --------------------
-    mutable std::deque<SPItem*> _node_cache; // Used to speed up search.
-    mutable bool _node_cache_valid;
+    Inkscape::Util::FlatHashMap<std::string, SPObject *, Inkscape::Util::StringHash> iddef;
+    Inkscape::Util::FlatHashMap<Inkscape::XML::Node *, SPObject *> reprdef;
+    SPObject *_getObjectById(std::string_view id) const;
 
     // Box tool ----------------------------
     Persp3D *current_persp3d; /**< Currently 'active' perspective (to which, e.g., newly created boxes are attached) */
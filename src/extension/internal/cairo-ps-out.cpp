@@ -116,6 +116,7 @@ ps_print_document_to_file(SPDocument *doc, gchar const *filename, unsigned int l
         /* Render document */
         ret = renderer->setupDocument(ctx, doc, pageBoundingBox, bleedmargin_px, base);
         if (ret) {
+            renderer->prefetchBitmaps(ctx, {root});
             renderer->renderItem(ctx, root);
             ret = ctx->finish();
         }
@@ -116,6 +116,19 @@ pdf_render_document_to_file(SPDocument *doc, gchar const *filename, unsigned int
         ret = renderer->setupDocument(ctx, doc, pageBoundingBox, bleedmargin_px, base);
 
         auto pages = doc->getPageManager().getPages();
+
+        // Rasterize the filtered items of all pages in the background, while the pages are emitted.
+        std::vector<SPItem *> items;
+        if (pages.size() == 0) {
+            items.push_back(root);
+        } else {
+            for (auto &page : pages) {
+                auto overlapping = page->getOverlappingItems();
+                items.insert(items.end(), overlapping.begin(), overlapping.end());
+            }
+        }
+        renderer->prefetchBitmaps(ctx, items);
+
         if (pages.size() == 0) {
             // Output the page bounding box as already set up in the initial setupDocument.
             renderer->renderItem(ctx, root);
@@ -28,6 +28,10 @@
 
 #include <csignal>
 #include <cerrno>
+#include <deque>
+#include <future>
+#include <thread>
+#include <unordered_map>
 
 
 #include <2geom/transforms.h>
@@ -82,6 +86,9 @@
 #include "object/sp-symbol.h"
 #include "object/sp-text.h"
 #include "object/sp-use.h"
+#include "object/filters/image.h"
+
+#include "preferences.h"
 
 #include "util/units.h"
 
@@ -426,7 +433,7 @@ static void sp_image_render(SPImage *image, CairoRenderContext *ctx)
     Geom::Scale s(width / (double)w, height / (double)h);
     Geom::Affine t(s * tp);
 
-    ctx->renderImage(image->pixbuf, t, image->style);
+    ctx->renderImage(image->pixbuf.get(), t, image->style);
 }
 
 static void sp_anchor_render(SPAnchor *a, CairoRenderContext *ctx)
@@ -504,27 +511,29 @@ static void sp_root_render(SPRoot *root, CairoRenderContext *ctx)
     This function converts the item to a raster image and includes the image into the cairo renderer.
     It is only used for filters and then only when rendering filters as bitmaps is requested.
 */
-static void sp_asbitmap_render(SPItem *item, CairoRenderContext *ctx)
+static double sp_asbitmap_resolution(CairoRenderContext *ctx)
 {
-
-    // The code was adapted from sp_selection_create_bitmap_copy in selection-chemistry.cpp
-
-    // Calculate resolution
-    double res;
     /** @TODO reimplement the resolution stuff   (WHY?)
     */
-    res = ctx->getBitmapResolution();
+    double res = ctx->getBitmapResolution();
     if(res == 0) {
         res = Inkscape::Util::Quantity::convert(1, "in", "px");
     }
-    TRACE(("sp_asbitmap_render: resolution: %f\n", res ));
+    return res;
+}
 
+/**
+    Returns the area of the document, which sp_asbitmap_render() rasterizes for the item at the
+    given resolution, or nothing if the bitmap would be empty.
+*/
+static Geom::OptRect sp_asbitmap_area(SPItem *item, double res)
+{
     // Get the bounding box of the selection in desktop coordinates.
     Geom::OptRect bbox = item->documentVisualBounds();
 
     // no bbox, e.g. empty group
     if (!bbox) {
-        return;
+        return bbox;
     }
 
     Geom::Rect docrect(Geom::Rect(Geom::Point(0, 0), item->document->getDimensions()));
@@ -532,14 +541,36 @@ static void sp_asbitmap_render(SPItem *item, CairoRenderContext *ctx)
 
     // no bbox, e.g. empty group
     if (!bbox) {
-        return;
+        return bbox;
     }
 
     // The width and height of the bitmap in pixels
     unsigned width =  ceil(bbox->width() * Inkscape::Util::Quantity::convert(res, "px", "in"));
     unsigned height = ceil(bbox->height() * Inkscape::Util::Quantity::convert(res, "px", "in"));
 
-    if (width == 0 || height == 0) return;
+    if (width == 0 || height == 0) {
+        return Geom::OptRect();
+    }
+    return bbox;
+}
+
+static void sp_asbitmap_render(SPItem *item, CairoRenderContext *ctx)
+{
+
+    // The code was adapted from sp_selection_create_bitmap_copy in selection-chemistry.cpp
+
+    // Calculate resolution
+    double res = sp_asbitmap_resolution(ctx);
+    TRACE(("sp_asbitmap_render: resolution: %f\n", res ));
+
+    Geom::OptRect bbox = sp_asbitmap_area(item, res);
+    if (!bbox) {
+        return;
+    }
+
+    // The width and height of the bitmap in pixels
+    unsigned width =  ceil(bbox->width() * Inkscape::Util::Quantity::convert(res, "px", "in"));
+    unsigned height = ceil(bbox->height() * Inkscape::Util::Quantity::convert(res, "px", "in"));
 
     // Scale to exactly fit integer bitmap inside bounding box
     double scale_x = bbox->width() / width;
@@ -565,13 +596,16 @@ static void sp_asbitmap_render(SPItem *item, CairoRenderContext *ctx)
     Geom::Affine t_item =  item->i2doc_affine();
     Geom::Affine t = t_on_document * t_item.inverse();
 
-    // Do the export
-    SPDocument *document = item->document;
+    // Do the export, unless the bitmap was prefetched
+    std::unique_ptr<Inkscape::Pixbuf> pb;
+    if (!ctx->getRenderer()->takeBitmap(item, pb)) {
+        SPDocument *document = item->document;
 
-    std::vector<SPItem*> items;
-    items.push_back(item);
+        std::vector<SPItem*> items;
+        items.push_back(item);
 
-    std::unique_ptr<Inkscape::Pixbuf> pb(sp_generate_internal_bitmap(document, *bbox, res, items, true));
+        pb.reset(sp_generate_internal_bitmap(document, *bbox, res, items, true));
+    }
 
     if (pb) {
         //TEST(gdk_pixbuf_save( pb, "bitmap.png", "png", NULL, NULL ));
@@ -581,25 +615,40 @@ static void sp_asbitmap_render(SPItem *item, CairoRenderContext *ctx)
 }
 
 
-static void sp_item_invoke_render(SPItem *item, CairoRenderContext *ctx)
+/// Whether sp_item_invoke_render() skips an item.
+static bool sp_item_render_skipped(SPItem *item)
 {
     // Check item's visibility
     if (item->isHidden()) {
-        return;
+        return true;
     }
     if (item->style && item->style->filter.set) {
         // cleanup only; this is not necessary but the filter hides the item anyway
         SPFilter *filt = item->style->getFilter();
         if (filt && g_strcmp0(filt->getId(), "selectable_hidder_filter") == 0) {
-            return;
+            return true;
         }
     }
+    return false;
+}
 
+/// Whether sp_item_invoke_render() renders an item as a bitmap.
+static bool sp_item_render_as_bitmap(SPItem *item, CairoRenderContext *ctx)
+{
     // rasterize filtered items as per user setting
     // however, clipPaths ignore any filters, so do *not* rasterize
     // TODO: might apply to some degree to masks with filtered elements as well;
     //       we need to figure out where in the stack it would be safe to rasterize
-    if (ctx->getFilterToBitmap() && item->style->filter.set && !item->isInClipPath()) {
+    return ctx->getFilterToBitmap() && item->style->filter.set && !item->isInClipPath();
+}
+
+static void sp_item_invoke_render(SPItem *item, CairoRenderContext *ctx)
+{
+    if (sp_item_render_skipped(item)) {
+        return;
+    }
+
+    if (sp_item_render_as_bitmap(item, ctx)) {
         return sp_asbitmap_render(item, ctx);
     }
 
@@ -713,6 +762,184 @@ void CairoRenderer::renderItem(CairoRenderContext *ctx, SPItem *item)
     ctx->popState();
 }
 
+/**
+ * Filtered items rasterized ahead of rendering.
+ *
+ * Rasterizing an item shows the whole document in a drawing of its own, which is set up on the
+ * main thread, and renders it, which is the expensive part. The renderings run on worker threads
+ * while the main thread goes on emitting the output, so that the bitmaps of later items and pages
+ * are ready by the time they are needed. At most one rendering per thread is in flight, and the
+ * bitmaps are consumed in the order of the output, so the output does not depend on timing.
+ *
+ * Fonts are shared with the renderings: setting up later drawings and converting text to paths
+ * load glyphs on the main thread while text is rendered, which font_instance allows.
+ */
+class CairoRenderer::BitmapQueue
+{
+public:
+    struct Request
+    {
+        SPItem *item;
+        Geom::Rect area;
+    };
+
+    BitmapQueue(double resolution, std::vector<Request> requests, int window)
+        : _resolution(resolution)
+        , _window(window)
+        , _waiting(requests.begin(), requests.end())
+    {
+        for (auto const &request : _waiting) {
+            ++_queued[request.item];
+        }
+        _fill();
+    }
+
+    ~BitmapQueue()
+    {
+        while (!_running.empty()) {
+            _discard();
+        }
+    }
+
+    bool take(SPItem *item, std::unique_ptr<Inkscape::Pixbuf> &bitmap)
+    {
+        auto queued = _queued.find(item);
+        if (queued == _queued.end()) {
+            return false;
+        }
+        // The items before it were not rendered in the expected order; drop their bitmaps.
+        while (_running.front().item != item) {
+            _discard();
+        }
+        bitmap.reset(_running.front().result.get());
+        _discard();
+        return true;
+    }
+
+private:
+    struct Job
+    {
+        SPItem *item;
+        std::unique_ptr<Inkscape::InternalBitmap> bitmap;
+        std::future<Inkscape::Pixbuf *> result;
+    };
+
+    /// Start renderings until the window is full.
+    void _fill()
+    {
+        while (static_cast<int>(_running.size()) < _window && !_waiting.empty()) {
+            auto const request = _waiting.front();
+            _waiting.pop_front();
+
+            Job job;
+            job.item = request.item;
+            job.bitmap = std::make_unique<Inkscape::InternalBitmap>(request.item->document, request.area, _resolution,
+                                                                    std::vector<SPItem *>{request.item}, true);
+            auto bitmap = job.bitmap.get();
+            job.result = std::async(std::launch::async, [bitmap] { return bitmap->render(); });
+            _running.push_back(std::move(job));
+        }
+    }
+
+    /// Remove the oldest rendering, deleting its bitmap unless it was taken, and start the next.
+    void _discard()
+    {
+        auto &job = _running.front();
+        if (job.result.valid()) {
+            delete job.result.get();
+        }
+        auto queued = _queued.find(job.item);
+        if (--queued->second == 0) {
+            _queued.erase(queued);
+        }
+        _running.pop_front();
+        _fill();
+    }
+
+    double _resolution;
+    int _window;
+    std::deque<Request> _waiting;
+    std::deque<Job> _running;
+    std::unordered_map<SPItem *, int> _queued; ///< number of waiting and running jobs of each item
+};
+
+/// Append the filtered items which sp_item_invoke_render() rasterizes below an item, in order.
+static void sp_item_collect_bitmaps(SPItem *item, CairoRenderContext *ctx, std::vector<SPItem *> &items)
+{
+    if (sp_item_render_skipped(item)) {
+        return;
+    }
+    if (sp_item_render_as_bitmap(item, ctx)) {
+        items.push_back(item);
+        return;
+    }
+
+    if (auto use = dynamic_cast<SPUse *>(item)) {
+        if (use->child) {
+            sp_item_collect_bitmaps(use->child, ctx, items);
+        }
+        return;
+    }
+    if (auto symbol = dynamic_cast<SPSymbol *>(item)) {
+        if (!symbol->cloned) {
+            return;
+        }
+    }
+    if (auto group = dynamic_cast<SPGroup *>(item)) {
+        for (auto child : group->childList(false)) {
+            if (auto child_item = dynamic_cast<SPItem *>(child)) {
+                sp_item_collect_bitmaps(child_item, ctx, items);
+            }
+        }
+    }
+}
+
+/// Whether a filter of the document renders other elements, which cannot be done from a worker thread.
+static bool sp_document_has_fe_image(SPDocument *doc)
+{
+    for (auto filter : doc->getResourceList("filter")) {
+        for (auto &primitive : filter->children) {
+            if (dynamic_cast<SPFeImage *>(&primitive)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void CairoRenderer::prefetchBitmaps(CairoRenderContext *ctx, std::vector<SPItem *> const &items)
+{
+    _bitmaps.reset();
+    if (!ctx->getFilterToBitmap() || items.empty() || sp_document_has_fe_image(items.front()->document)) {
+        return;
+    }
+
+    std::vector<SPItem *> filtered;
+    for (auto item : items) {
+        sp_item_collect_bitmaps(item, ctx, filtered);
+    }
+
+    double const res = sp_asbitmap_resolution(ctx);
+    std::vector<BitmapQueue::Request> requests;
+    for (auto item : filtered) {
+        if (auto area = sp_asbitmap_area(item, res)) {
+            requests.push_back({item, *area});
+        }
+    }
+    if (requests.empty()) {
+        return;
+    }
+
+    int const threads = Inkscape::Preferences::get()->getIntLimited("/options/threading/numthreads",
+                                                                    std::max(1u, std::thread::hardware_concurrency()), 1, 256);
+    _bitmaps = std::make_unique<BitmapQueue>(res, std::move(requests), threads);
+}
+
+bool CairoRenderer::takeBitmap(SPItem *item, std::unique_ptr<Inkscape::Pixbuf> &bitmap)
+{
+    return _bitmaps && _bitmaps->take(item, bitmap);
+}
+
 void CairoRenderer::renderHatchPath(CairoRenderContext *ctx, SPHatchPath const &hatchPath, unsigned key) {
     ctx->pushState();
     ctx->setStateForStyle(hatchPath.style);
@@ -794,6 +1021,7 @@ CairoRenderer::setupDocument(CairoRenderContext *ctx, SPDocument *doc, bool page
         d = *bbox;
     }
     d.expandBy(bleedmargin_px);
+    sp_image_finish_decoding(doc, d);
 
     double px_to_ctx_units = 1.0;
     if (ctx->_vector_based_target) {
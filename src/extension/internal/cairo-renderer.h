@@ -16,8 +16,10 @@
  */
 
 #include "extension/extension.h"
+#include <memory>
 #include <set>
 #include <string>
+#include <vector>
 
 //#include "libnrtype/font-instance.h"
 #include <cairo.h>
@@ -28,6 +30,8 @@ class SPMask;
 class SPHatchPath;
 
 namespace Inkscape {
+class Pixbuf;
+
 namespace Extension {
 namespace Internal {
 
@@ -56,7 +60,19 @@ public:
     void renderItem(CairoRenderContext *ctx, SPItem *item);
     void renderHatchPath(CairoRenderContext *ctx, SPHatchPath const &hatchPath, unsigned key);
 
+    /** Starts rasterizing the filtered items which renderItem() will rasterize when rendering
+    the given items, in that order, on worker threads. Does nothing unless ctx renders filters
+    to bitmaps. */
+    void prefetchBitmaps(CairoRenderContext *ctx, std::vector<SPItem *> const &items);
+
+    /** Takes the prefetched bitmap of a filtered item, waiting for it if needed. Returns false
+    if the item was not prefetched. */
+    bool takeBitmap(SPItem *item, std::unique_ptr<Inkscape::Pixbuf> &bitmap);
+
 private:
+    class BitmapQueue;
+    std::unique_ptr<BitmapQueue> _bitmaps;
+
     /** Extract metadata from doc and set it on ctx. */
     void setMetadata(CairoRenderContext *ctx, SPDocument *doc);
 };
@@ -39,6 +39,7 @@
 #include "extension/output.h"
 #include "extension/print.h"
 #include "extension/system.h"
+#include "object/sp-image.h"
 #include "object/sp-path.h"
 #include "object/sp-root.h"
 #include "path/path-boolop.h"
@@ -94,6 +95,7 @@ Emf::print_document_to_file(SPDocument *doc, const gchar *filename)
     unsigned int ret;
 
     doc->ensureUpToDate();
+    sp_image_finish_decoding(doc);
 
     mod = Inkscape::Extension::get_print(PRINT_EMF);
     oldconst = mod->get_param_string("destination");
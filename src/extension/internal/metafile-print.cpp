@@ -253,7 +253,7 @@ void PrintMetafile::brush_classify(SPObject *parent, int depth, Inkscape::Pixbuf
     if (SP_IS_PATTERN(parent)) {
         for (SPPattern *pat_i = SP_PATTERN(parent); pat_i != nullptr; pat_i = pat_i->ref ? pat_i->ref->getObject() : nullptr) {
             if (SP_IS_IMAGE(pat_i)) {
-                *epixbuf = ((SPImage *)pat_i)->pixbuf;
+                *epixbuf = ((SPImage *)pat_i)->pixbuf.get();
                 return;
             }
             char temp[32];  // large enough
@@ -273,7 +273,7 @@ void PrintMetafile::brush_classify(SPObject *parent, int depth, Inkscape::Pixbuf
             }
         }
     } else if (SP_IS_IMAGE(parent)) {
-        *epixbuf = ((SPImage *)parent)->pixbuf;
+        *epixbuf = ((SPImage *)parent)->pixbuf.get();
         return;
     } else { // some inkscape rearrangements pass through nodes between pattern and image which are not classified as either.
         for (auto& child: parent->children) {
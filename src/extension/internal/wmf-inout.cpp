@@ -31,6 +31,7 @@
 
 #include "document.h"
 #include "object/sp-root.h" // even though it is included indirectly by wmf-inout.h
+#include "object/sp-image.h"
 #include "object/sp-path.h"
 #include "print.h"
 #include "extension/system.h"
@@ -94,6 +95,7 @@ Wmf::print_document_to_file(SPDocument *doc, const gchar *filename)
     gchar *oldoutput;
 
     doc->ensureUpToDate();
+    sp_image_finish_decoding(doc);
 
     mod = Inkscape::Extension::get_print(PRINT_WMF);
     oldconst = mod->get_param_string("destination");
@@ -21,6 +21,7 @@
 #include "document.h"
 #include "object/sp-root.h"
 #include "object/sp-defs.h"
+#include "object/sp-image.h"
 #include "object/sp-use.h"
 #include "util/units.h"
 #include "inkscape.h"
@@ -59,92 +60,111 @@ static void hide_other_items_recursively(SPObject *object, const std::vector<SPI
 }
 
 
-/**
-    generates a bitmap from given items
-    the bitmap is stored in RAM and not written to file
-    @param document Inkscape document.
-    @param area     Export area in document units.
-    @param dpi      Resolution.
-    @param items    Vector of pointers to SPItems to export. Export all items if empty.
-    @param opaque   Set items opacity to 1 (used by Cairo renderer for filtered objects rendered as bitmaps).
-    @return The created GdkPixbuf structure or nullptr if rendering failed.
-*/
-Inkscape::Pixbuf *sp_generate_internal_bitmap(SPDocument *document,
-                                              Geom::Rect const &area,
-                                              double dpi,
-                                              std::vector<SPItem *> items,
-                                              bool opaque)
+namespace Inkscape {
+
+InternalBitmap::InternalBitmap(SPDocument *document, Geom::Rect const &area, double dpi,
+                               std::vector<SPItem *> const &items, bool opaque)
+    : _document(document)
+    , _drawing(std::make_unique<Inkscape::Drawing>())
 {
     // Geometry
-    if (area.hasZeroArea()) {
-        return nullptr;
-    }
-
     Geom::Point origin = area.min();
     double scale_factor = Inkscape::Util::Quantity::convert(dpi, "px", "in");
     Geom::Affine affine = Geom::Translate(-origin) * Geom::Scale (scale_factor, scale_factor);
 
     int width  = std::ceil(scale_factor * area.width());
     int height = std::ceil(scale_factor * area.height());
+    _area = Geom::IntRect::from_xywh(0, 0, width, height);
 
     // Document
     document->ensureUpToDate();
-    unsigned dkey = SPItem::display_key_new(1);
+    sp_image_finish_decoding(document, area);
+    _dkey = SPItem::display_key_new(1);
 
     // Drawing
-    Inkscape::Drawing drawing; // New drawing for offscreen rendering.
-    drawing.setExact(true); // Maximum quality for blurs.
+    _drawing->setExact(true); // Maximum quality for blurs.
 
     /* Create ArenaItems and set transform */
-    Inkscape::DrawingItem *root = document->getRoot()->invoke_show( drawing, dkey, SP_ITEM_SHOW_DISPLAY);
+    Inkscape::DrawingItem *root = document->getRoot()->invoke_show(*_drawing, _dkey, SP_ITEM_SHOW_DISPLAY);
     root->setTransform(affine);
-    drawing.setRoot(root);
+    _drawing->setRoot(root);
 
     // Hide all items we don't want, instead of showing only requested items,
     // because that would not work if the shown item references something in defs.
     if (!items.empty()) {
-        hide_other_items_recursively(document->getRoot(), items, dkey);
+        hide_other_items_recursively(document->getRoot(), items, _dkey);
     }
 
-    Geom::IntRect final_area = Geom::IntRect::from_xywh(0, 0, width, height);
-    drawing.update(final_area);
+    _drawing->update(_area);
 
     if (opaque) {
         // Required by sp_asbitmap_render().
         for (auto item : items) {
-            if (item->get_arenaitem(dkey)) {
-                item->get_arenaitem(dkey)->setOpacity(1.0);
+            if (item->get_arenaitem(_dkey)) {
+                item->get_arenaitem(_dkey)->setOpacity(1.0);
             }
         }
     }
+}
+
+InternalBitmap::~InternalBitmap()
+{
+    // Return to previous state.
+    _document->getRoot()->invoke_hide(_dkey);
+}
 
+Inkscape::Pixbuf *InternalBitmap::render()
+{
     // Rendering
-    cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+    cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, _area.width(), _area.height());
     Inkscape::Pixbuf* pixbuf = nullptr;
 
     if (cairo_surface_status(surface) == CAIRO_STATUS_SUCCESS) {
         Inkscape::DrawingContext dc(surface, Geom::Point(0,0));
 
         // render items
-        drawing.render(dc, final_area, Inkscape::DrawingItem::RENDER_BYPASS_CACHE);
+        _drawing->render(dc, _area, Inkscape::DrawingItem::RENDER_BYPASS_CACHE);
 
         pixbuf = new Inkscape::Pixbuf(surface);
 
     } else {
 
         long long size =
-            (long long) height *
-            (long long) cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, width);
+            (long long) _area.height() *
+            (long long) cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, _area.width());
         g_warning("sp_generate_internal_bitmap: not enough memory to create pixel buffer. Need %lld.", size);
         cairo_surface_destroy(surface);
     }
 
-    // Return to previous state.
-    document->getRoot()->invoke_hide(dkey);
-
     return pixbuf;
 }
 
+} // namespace Inkscape
+
+/**
+    generates a bitmap from given items
+    the bitmap is stored in RAM and not written to file
+    @param document Inkscape document.
+    @param area     Export area in document units.
+    @param dpi      Resolution.
+    @param items    Vector of pointers to SPItems to export. Export all items if empty.
+    @param opaque   Set items opacity to 1 (used by Cairo renderer for filtered objects rendered as bitmaps).
+    @return The created GdkPixbuf structure or nullptr if rendering failed.
+*/
+Inkscape::Pixbuf *sp_generate_internal_bitmap(SPDocument *document,
+                                              Geom::Rect const &area,
+                                              double dpi,
+                                              std::vector<SPItem *> items,
+                                              bool opaque)
+{
+    if (area.hasZeroArea()) {
+        return nullptr;
+    }
+
+    Inkscape::InternalBitmap bitmap(document, area, dpi, items, opaque);
+    return bitmap.render();
+}
+
 /*
   Local Variables:
   mode:c++
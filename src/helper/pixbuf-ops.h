@@ -14,10 +14,48 @@
  */
 
 #include <glib.h>
+#include <memory>
+#include <vector>
+
+#include <2geom/rect.h>
 
 class SPDocument;
 class SPItem;
-namespace Inkscape { class Pixbuf; }
+
+namespace Inkscape {
+
+class Drawing;
+class Pixbuf;
+
+/**
+ * The offscreen rendering done by sp_generate_internal_bitmap(), split into its setup and the
+ * rendering itself, so that bitmaps can be rendered on other threads.
+ *
+ * The constructor shows the document in a new drawing and updates it, and the destructor hides
+ * it again; both must be called from the main thread. render() only uses the drawing, so it may
+ * run on another thread in the meantime.
+ */
+class InternalBitmap
+{
+public:
+    InternalBitmap(SPDocument *document, Geom::Rect const &area, double dpi,
+                   std::vector<SPItem *> const &items = std::vector<SPItem *>(), bool opaque = false);
+    ~InternalBitmap();
+
+    InternalBitmap(InternalBitmap const &) = delete;
+    InternalBitmap &operator=(InternalBitmap const &) = delete;
+
+    /// Render the bitmap, or return nullptr if it cannot be allocated.
+    Inkscape::Pixbuf *render();
+
+private:
+    SPDocument *_document;
+    unsigned _dkey;
+    std::unique_ptr<Inkscape::Drawing> _drawing;
+    Geom::IntRect _area;
+};
+
+} // namespace Inkscape
 
 Inkscape::Pixbuf *sp_generate_internal_bitmap(SPDocument *document,
                                               Geom::Rect const &area,
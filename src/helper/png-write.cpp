@@ -15,11 +15,23 @@
  */
 
 
+#ifdef HAVE_CONFIG_H
+# include "config.h"  // only include where actually required!
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 #include <2geom/rect.h>
 #include <2geom/transforms.h>
 
 #include <png.h>
 
+#if HAVE_OPENMP
+#include <omp.h>
+#endif
+
 #include "document.h"
 #include "inkscape.h"
 #include "png-write.h"
@@ -33,6 +45,7 @@
 #include "io/sys.h"
 
 #include "object/sp-defs.h"
+#include "object/sp-image.h"
 #include "object/sp-item.h"
 #include "object/sp-root.h"
 
@@ -55,11 +68,19 @@ struct SPEBP {
     unsigned long int width, height, sheight;
     guint32 background;
     Inkscape::Drawing *drawing; // it is assumed that all unneeded items are hidden
-    guchar *px;
+    Geom::IntPoint origin;      // position of the top left pixel in the drawing
+    int bands;                  // number of bands of sheight rows rendered at the same time
     unsigned (*status)(float, void *);
     void *data;
 };
 
+/// Rows of one band, as returned by get_rows.
+struct SPPNGBand {
+    std::vector<png_bytep> rows;
+    void *to_free = nullptr;
+    int num_rows = 0;
+};
+
 /* write a png file */
 
 struct SPPNGBD {
@@ -123,8 +144,56 @@ void PngTextList::add(gchar const* key, gchar const* text)
     }
 }
 
+/**
+ * Collect the text chunks of a PNG file from the metadata of a document.
+ *
+ * Reading the metadata may fix the document up, so this must not be done from several threads.
+ */
+static void
+sp_png_get_text(SPDocument *doc, PngTextList &textList)
+{
+    textList.add("Software", "www.inkscape.org"); // Made by Inkscape comment
+    {
+        const gchar* pngToDc[] = {"Title", "title",
+                               "Author", "creator",
+                               "Description", "description",
+                               //"Copyright", "",
+                               "Creation Time", "date",
+                               //"Disclaimer", "",
+                               //"Warning", "",
+                               "Source", "source"
+                               //"Comment", ""
+        };
+        for (size_t i = 0; i < G_N_ELEMENTS(pngToDc); i += 2) {
+            struct rdf_work_entity_t * entity = rdf_find_entity ( pngToDc[i + 1] );
+            if (entity) {
+                gchar const* data = rdf_get_work_entity(doc, entity);
+                if (data && *data) {
+                    textList.add(pngToDc[i], data);
+                }
+            } else {
+                g_warning("Unable to find entity [%s]", pngToDc[i + 1]);
+            }
+        }
+
+
+        struct rdf_license_t *license =  rdf_get_license(doc);
+        if (license) {
+            if (license->name && license->uri) {
+                gchar* tmp = g_strdup_printf("%s %s", license->name, license->uri);
+                textList.add("Copyright", tmp);
+                g_free(tmp);
+            } else if (license->name) {
+                textList.add("Copyright", license->name);
+            } else if (license->uri) {
+                textList.add("Copyright", license->uri);
+            }
+        }
+    }
+}
+
 static bool
-sp_png_write_rgba_striped(SPDocument *doc,
+sp_png_write_rgba_striped(PngTextList &textList,
                           gchar const *filename, unsigned long int width, unsigned long int height, double xdpi, double ydpi,
                           int (* get_rows)(guchar const **rows, void **to_free, int row, int num_rows, void *data, int color_type, int bit_depth, int antialias),
                           void *data, bool interlace, int color_type, int bit_depth, int zlib, int antialiasing)
@@ -210,46 +279,6 @@ sp_png_write_rgba_striped(SPDocument *doc,
         png_set_sBIT(png_ptr, info_ptr, &sig_bit);
     }
 
-    PngTextList textList;
-
-    textList.add("Software", "www.inkscape.org"); // Made by Inkscape comment
-    {
-        const gchar* pngToDc[] = {"Title", "title",
-                               "Author", "creator",
-                               "Description", "description",
-                               //"Copyright", "",
-                               "Creation Time", "date",
-                               //"Disclaimer", "",
-                               //"Warning", "",
-                               "Source", "source"
-                               //"Comment", ""
-        };
-        for (size_t i = 0; i < G_N_ELEMENTS(pngToDc); i += 2) {
-            struct rdf_work_entity_t * entity = rdf_find_entity ( pngToDc[i + 1] );
-            if (entity) {
-                gchar const* data = rdf_get_work_entity(doc, entity);
-                if (data && *data) {
-                    textList.add(pngToDc[i], data);
-                }
-            } else {
-                g_warning("Unable to find entity [%s]", pngToDc[i + 1]);
-            }
-        }
-
-
-        struct rdf_license_t *license =  rdf_get_license(doc);
-        if (license) {
-            if (license->name && license->uri) {
-                gchar* tmp = g_strdup_printf("%s %s", license->name, license->uri);
-                textList.add("Copyright", tmp);
-                g_free(tmp);
-            } else if (license->name) {
-                textList.add("Copyright", license->name);
-            } else if (license->uri) {
-                textList.add("Copyright", license->uri);
-            }
-        }
-    }
     if (textList.getCount() > 0) {
         png_set_text(png_ptr, info_ptr, textList.getPtext(), textList.getCount());
     }
@@ -282,23 +311,41 @@ sp_png_write_rgba_striped(SPDocument *doc,
      * use the first method if you aren't handling interlacing yourself.
      */
 
-    png_bytep* row_pointers = new png_bytep[ebp->sheight];
+    // The image is produced in bands of ebp->sheight rows. Up to ebp->bands of them are
+    // rendered concurrently and then handed to libpng in order, so that memory use depends
+    // on the band size and not on the size of the image.
+    std::vector<SPPNGBand> bands(std::max(ebp->bands, 1));
+    for (auto &band : bands) {
+        band.rows.resize(ebp->sheight);
+    }
     int number_of_passes = interlace ? png_set_interlace_handling(png_ptr) : 1;
 
     for(int i=0;i<number_of_passes; ++i){
         r = 0;
         while (r < static_cast<png_uint_32>(height)) {
-            void *to_free;
-            int n = get_rows((unsigned char const **) row_pointers, &to_free, r, height-r, data, color_type, bit_depth, antialiasing);
-            if (!n) break;
-            png_write_rows(png_ptr, row_pointers, n);
-            g_free(to_free);
-            r += n;
+            if (ebp->status && !ebp->status((float) r / height, ebp->data)) break;
+
+            int const remaining_bands = (height - r + ebp->sheight - 1) / ebp->sheight;
+            int const count = std::min<int>(bands.size(), remaining_bands);
+
+            #if HAVE_OPENMP
+            #pragma omp parallel for num_threads(count) schedule(dynamic, 1) if(count > 1)
+            #endif
+            for (int b = 0; b < count; ++b) {
+                int const row = r + b * ebp->sheight;
+                bands[b].num_rows = get_rows((unsigned char const **) bands[b].rows.data(), &bands[b].to_free,
+                                             row, height - row, data, color_type, bit_depth, antialiasing);
+            }
+
+            for (int b = 0; b < count; ++b) {
+                png_write_rows(png_ptr, bands[b].rows.data(), bands[b].num_rows);
+                g_free(bands[b].to_free);
+                bands[b].to_free = nullptr;
+                r += bands[b].num_rows;
+            }
         }
     }
 
-    delete[] row_pointers;
-
     /* You can write optional chunks like tEXt, zTXt, and tIME at the end
      * as well.
      */
@@ -320,28 +367,20 @@ sp_png_write_rgba_striped(SPDocument *doc,
 
 
 /**
+ * Render a band of at most ebp->sheight rows starting at row.
  *
+ * Called concurrently for different bands; the drawing must already be up to date.
  */
 static int
-sp_export_get_rows(guchar const **rows, void **to_free, int row, int num_rows, void *data, int color_type, int bit_depth, int antialiasing)
+sp_export_get_rows(guchar const **rows, void **to_free, int row, int num_rows, void *data, int color_type, int bit_depth, int /*antialiasing*/)
 {
     struct SPEBP *ebp = (struct SPEBP *) data;
 
-    if (ebp->status) {
-        if (!ebp->status((float) row / ebp->height, ebp->data)) return 0;
-    }
-
     num_rows = MIN(num_rows, static_cast<int>(ebp->sheight));
     num_rows = MIN(num_rows, static_cast<int>(ebp->height - row));
 
     /* Set area of interest */
-    // bbox is now set to the entire image to prevent discontinuities
-    // in the image when blur is used (the borders may still be a bit
-    // off, but that's less noticeable).
-    Geom::IntRect bbox = Geom::IntRect::from_xywh(0, row, ebp->width, num_rows);
-
-    /* Update to renderable state */
-    ebp->drawing->update(bbox);
+    Geom::IntRect bbox = Geom::IntRect::from_xywh(ebp->origin[Geom::X], ebp->origin[Geom::Y] + row, ebp->width, num_rows);
 
     int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, ebp->width);
     unsigned char *px = g_new(guchar, num_rows * stride);
@@ -354,8 +393,8 @@ sp_export_get_rows(guchar const **rows, void **to_free, int row, int num_rows, v
     dc.paint();
     dc.setOperator(CAIRO_OPERATOR_OVER);
 
-    /* Render */
-    ebp->drawing->render(dc, bbox, 0, antialiasing);
+    /* Render, antialiasing is already set on the root */
+    ebp->drawing->render(dc, bbox, 0);
     cairo_surface_destroy(s);
 
     // PNG stores data as unpremultiplied big-endian RGBA, which means
@@ -431,6 +470,7 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
     }
 
     doc->ensureUpToDate();
+    sp_image_finish_decoding(doc, area);
 
     /* Calculate translation by transforming to document coordinates (flipping Y)*/
     Geom::Point translation = -area.min();
@@ -459,6 +499,7 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
     ebp.width  = width;
     ebp.height = height;
     ebp.background = bgcolor;
+    ebp.origin = Geom::IntPoint(0, 0);
 
     /* Create new drawing */
     Inkscape::Drawing drawing;
@@ -479,15 +520,29 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
     ebp.status = status;
     ebp.data   = data;
 
-    bool write_status = false;;
+    // Set up everything the bands share before they are rendered concurrently.
+    if (antialiasing >= 0) {
+        drawing.root()->setAntialiasing(antialiasing);
+    }
 
-    ebp.sheight = 64;
-    ebp.px = g_try_new(guchar, 4 * ebp.sheight * width);
+    /* Update to renderable state */
+    drawing.update(Geom::IntRect::from_xywh(0, 0, width, height));
 
-    if (ebp.px) {
-        write_status = sp_png_write_rgba_striped(doc, filename, width, height, xdpi, ydpi, sp_export_get_rows, &ebp, interlace, color_type, bit_depth, zlib, antialiasing);
-        g_free(ebp.px);
-    }
+    // Bands of about 16 MiB, but at least 64 rows to keep the overhead of filter margins low.
+    unsigned long const band_bytes = 16 * 1024 * 1024;
+    ebp.sheight = std::min(height, std::max(band_bytes / (4 * width), 64ul));
+
+#if HAVE_OPENMP
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    ebp.bands = prefs->getIntLimited("/options/threading/numthreads", omp_get_num_procs(), 1, 256);
+#else
+    ebp.bands = 1;
+#endif
+
+    PngTextList textList;
+    sp_png_get_text(doc, textList);
+
+    bool write_status = sp_png_write_rgba_striped(textList, filename, width, height, xdpi, ydpi, sp_export_get_rows, &ebp, interlace, color_type, bit_depth, zlib, antialiasing);
 
     // Hide items, this releases arenaitem
     doc->getRoot()->invoke_hide(dkey);
@@ -495,6 +550,135 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
     return write_status ? EXPORT_OK : EXPORT_ERROR;
 }
 
+std::vector<PngExportGroup> sp_export_png_groups(std::vector<PngExportJob> const &jobs)
+{
+    // Largest distance from its exact position any corner of an area may be rendered at.
+    double const tolerance = 1.0 / 256;
+
+    std::vector<PngExportGroup> groups;
+    for (std::size_t i = 0; i < jobs.size(); ++i) {
+        auto const &job = jobs[i];
+        if (job.filename.empty() || job.width < 1 || job.height < 1 || job.area.hasZeroArea()) {
+            continue;
+        }
+        Geom::Point const size(job.width, job.height);
+
+        // Where the area lands in a drawing with this transform, if close enough.
+        auto place = [&] (Geom::Scale const &scale, Geom::Point const &fraction, Geom::IntPoint &origin) {
+            Geom::Point const min = job.area.min() * scale - fraction;
+            Geom::Point const max = job.area.max() * scale - fraction;
+            origin = Geom::IntPoint(static_cast<int>(std::round(min[Geom::X])),
+                                    static_cast<int>(std::round(min[Geom::Y])));
+            for (auto d : {Geom::X, Geom::Y}) {
+                if (std::abs(min[d] - origin[d]) > tolerance ||
+                    std::abs(max[d] - origin[d] - size[d]) > tolerance) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        Geom::IntPoint origin;
+        auto group = std::find_if(groups.begin(), groups.end(), [&] (PngExportGroup const &g) {
+            return place(g.scale, g.fraction, origin);
+        });
+        if (group == groups.end()) {
+            groups.emplace_back();
+            group = groups.end() - 1;
+            group->scale = Geom::Scale(job.width / job.area.width(), job.height / job.area.height());
+            Geom::Point const offset = job.area.min() * group->scale;
+            group->fraction = offset - Geom::Point(std::floor(offset[Geom::X]), std::floor(offset[Geom::Y]));
+            place(group->scale, group->fraction, origin);
+        }
+        group->jobs.push_back(i);
+        group->origins.push_back(origin);
+    }
+    return groups;
+}
+
+/**
+ * Export areas of a document to PNG files, sharing the drawing between them.
+ *
+ * The document is shown once. For every group of jobs sharing a transform, see
+ * sp_export_png_groups(), the drawing is given that transform and updated, then the jobs of the
+ * group are rendered at their position in the drawing.
+ */
+void sp_export_png_files(SPDocument *doc, std::vector<PngExportJob> &jobs, unsigned long bgcolor,
+                         bool interlace, int zlib, int antialiasing)
+{
+    g_return_if_fail(doc != nullptr);
+
+    doc->ensureUpToDate();
+    for (auto &job : jobs) {
+        job.result = EXPORT_ERROR;
+        sp_image_finish_decoding(doc, job.area);
+    }
+
+    auto const groups = sp_export_png_groups(jobs);
+    if (groups.empty()) {
+        return;
+    }
+
+    PngTextList textList;
+    sp_png_get_text(doc, textList);
+
+#if HAVE_OPENMP
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    int const num_threads = prefs->getIntLimited("/options/threading/numthreads", omp_get_num_procs(), 1, 256);
+#else
+    int const num_threads = 1;
+#endif
+
+    Inkscape::Drawing drawing;
+    drawing.setExact(true); // export with maximum blur rendering quality
+    unsigned const dkey = SPItem::display_key_new(1);
+    drawing.setRoot(doc->getRoot()->invoke_show(drawing, dkey, SP_ITEM_SHOW_DISPLAY));
+    if (antialiasing >= 0) {
+        drawing.root()->setAntialiasing(antialiasing);
+    }
+
+    for (auto const &group : groups) {
+        drawing.root()->setTransform(group.scale * Geom::Translate(-group.fraction));
+
+        int const count = group.jobs.size();
+        Geom::OptIntRect area;
+        for (int k = 0; k < count; ++k) {
+            auto const &job = jobs[group.jobs[k]];
+            area.unionWith(Geom::IntRect::from_xywh(group.origins[k], Geom::IntPoint(job.width, job.height)));
+        }
+        drawing.update(*area);
+
+        // A lone file is rendered in concurrent bands instead.
+        int const bands = count > 1 ? 1 : num_threads;
+
+        #if HAVE_OPENMP
+        #pragma omp parallel for num_threads(num_threads) schedule(dynamic, 1) if(count > 1)
+        #endif
+        for (int k = 0; k < count; ++k) {
+            auto &job = jobs[group.jobs[k]];
+
+            struct SPEBP ebp;
+            ebp.width  = job.width;
+            ebp.height = job.height;
+            ebp.background = bgcolor;
+            ebp.drawing = &drawing;
+            ebp.origin = group.origins[k];
+            ebp.status = nullptr;
+            ebp.data = nullptr;
+            unsigned long const band_bytes = 16 * 1024 * 1024;
+            ebp.sheight = std::min(job.height, std::max(band_bytes / (4 * job.width), 64ul));
+            ebp.bands = bands;
+
+            bool write_status = sp_png_write_rgba_striped(textList, job.filename.c_str(), job.width, job.height,
+                                                          job.xdpi, job.ydpi, sp_export_get_rows, &ebp, interlace,
+                                                          job.color_type, job.bit_depth, zlib, antialiasing);
+            job.result = write_status ? EXPORT_OK : EXPORT_ERROR;
+        }
+    }
+
+    // Hide items, this releases arenaitem
+    doc->getRoot()->invoke_hide(dkey);
+}
 
 /*
   Local Variables:
@@ -16,9 +16,11 @@
  */
 
 #include <glib.h> // Only for gchar.
+#include <string>
 #include <vector>
 
-#include <2geom/forward.h>
+#include <2geom/rect.h>
+#include <2geom/transforms.h>
 
 class SPDocument;
 class SPItem;
@@ -48,4 +50,49 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
 				unsigned int (*status) (float, void *), void *data, bool force_overwrite = false, const std::vector<SPItem*> &items_only = std::vector<SPItem*>(), 
                                 bool interlace = false, int color_type = 6, int bit_depth = 8, int zlib = 6, int antialiasing = 2);
 
+/**
+ * One file of a batch export, see sp_export_png_files().
+ */
+struct PngExportJob {
+    std::string filename;
+    Geom::Rect area; ///< Area in document coordinates
+    unsigned long int width = 0;
+    unsigned long int height = 0;
+    double xdpi = 96.0;
+    double ydpi = 96.0;
+    int color_type = 6;
+    int bit_depth = 8;
+    ExportResult result = EXPORT_ERROR;
+};
+
+/**
+ * Jobs of a batch export rendered from one drawing transform, see sp_export_png_groups().
+ */
+struct PngExportGroup {
+    Geom::Scale scale;                   ///< Scale of the drawing
+    Geom::Point fraction;                ///< Subpixel offset of the drawing, subtracted after scaling
+    std::vector<std::size_t> jobs;       ///< Indices of the jobs
+    std::vector<Geom::IntPoint> origins; ///< Pixel position of the area of each job in the drawing
+};
+
+/**
+ * Group the jobs of a batch export which can be rendered with the same drawing transform.
+ *
+ * A job joins a group if both corners of its area land within 1/256 pixel of where its own
+ * transform, Translate(-area.min()) * Scale(width / area.width(), height / area.height()), would
+ * put them. Jobs which cannot be exported are left out.
+ */
+std::vector<PngExportGroup> sp_export_png_groups(std::vector<PngExportJob> const &jobs);
+
+/**
+ * Export several areas of a document to PNG files, e.g. the objects of an icon sheet.
+ *
+ * The document is shown once for all areas. The drawing is updated once per group of areas
+ * sharing a transform, then the files of the group are rendered and written concurrently, each one
+ * as soon as it is rendered. Existing files are overwritten. The result of every job is stored in
+ * it.
+ */
+void sp_export_png_files(SPDocument *doc, std::vector<PngExportJob> &jobs, unsigned long bgcolor,
+                         bool interlace = false, int zlib = 6, int antialiasing = 2);
+
 #endif // SEEN_SP_PNG_WRITE_H
@@ -42,6 +42,8 @@
 #include <regex>
 #include <numeric>
 
+#include <gtkmm/messagedialog.h>
+
 // checking if dithering is supported
 #ifdef  WITH_PATCHED_CAIRO
 #include "3rdparty/cairo/src/cairo.h"
@@ -88,6 +90,8 @@
 
 #include "util/units.h"           // Redimension window
 
+#include "xml/repr.h"             // Background file parsing
+
 #include "actions/actions-base.h"                   // Actions
 #include "actions/actions-file.h"                   // Actions
 #include "actions/actions-edit.h"                   // Actions
@@ -802,6 +806,8 @@ InkscapeApplication::create_window(SPDocument *document, bool replace)
 
 
 /** Create a window given a Gio::File. This is what most external functions should call.
+  *
+  * SVG files are parsed in the background and their window is opened later, from the main loop.
   *
   * @param file - The filename to open as a Gio::File object
 */
@@ -813,38 +819,111 @@ InkscapeApplication::create_window(const Glib::RefPtr<Gio::File>& file)
         return;
     }
 
-    SPDocument* document = nullptr;
-    InkscapeWindow* window = nullptr;
-    bool cancelled = false;
-
     if (file) {
-        document = document_open(file, &cancelled);
-        if (document) {
-            // Remember document so much that we'll add it to recent documents
-            auto recentmanager = Gtk::RecentManager::get_default();
-            recentmanager->add_item (file->get_uri());
-
-            SPDocument* old_document = _active_document;
-            bool replace = old_document && old_document->getVirgin();
-
-            window = create_window (document, replace);
-            document_fix(window);
-        } else if (!cancelled) {
-            std::cerr << "ConcreteInkscapeApplication<T>::create_window: Failed to load: "
-                      << file->get_parse_name() << std::endl;
-
-            gchar *text = g_strdup_printf(_("Failed to load the requested file %s"), file->get_parse_name().c_str());
-            sp_ui_error_dialog(text);
-            g_free(text);
+        if (_open_in_background(file)) {
+            return;
         }
-
+        bool cancelled = false;
+        SPDocument *document = document_open(file, &cancelled);
+        _finish_open(file, document, cancelled);
     } else {
-        document = document_new ();
+        SPDocument *document = document_new ();
+        InkscapeWindow *window = nullptr;
         if (document) {
             window = window_open (document);
         } else {
             std::cerr << "ConcreteInkscapeApplication<T>::create_window: Failed to open default document!" << std::endl;
         }
+        _active_document = document;
+        _active_window   = window;
+    }
+}
+
+InkscapeApplication::BackgroundOpen::~BackgroundOpen()
+{
+    progress.disconnect();
+}
+
+/** Parse a local SVG file on a worker thread, then open it from the main loop.
+ *  Nothing else runs from within this function, so the application is not re-entered.
+ *  Returns false if the file is not parsed in the background.
+ */
+bool
+InkscapeApplication::_open_in_background(const Glib::RefPtr<Gio::File>& file)
+{
+    std::string const path = file->get_path();
+    gchar *lower = g_ascii_strdown(path.c_str(), -1);
+    bool const svg = g_str_has_suffix(lower, ".svg") || g_str_has_suffix(lower, ".svgz");
+    g_free(lower);
+    if (!svg) {
+        return false;
+    }
+
+    auto const open = _background_opens.emplace(_background_opens.end());
+    open->file = file;
+    open->job = std::make_unique<Inkscape::XML::ParseJob>(path, [this, open] (Inkscape::XML::ParseJob &job) {
+        // Building the document stays on this thread; it only skips the parse.
+        auto file = open->file;
+        bool cancelled = false;
+        SPDocument *document = nullptr;
+        {
+            Inkscape::XML::ParsedFileScope parsed(job);
+            document = document_open(file, &cancelled);
+        }
+        _background_opens.erase(open);
+        _finish_open(file, document, cancelled);
+    });
+
+    // Offer to cancel if it takes a while.
+    auto const load_start = g_get_monotonic_time();
+    open->progress = Glib::signal_timeout().connect([this, open, load_start] {
+        if (!open->progress_dialog) {
+            if (g_get_monotonic_time() - load_start < G_USEC_PER_SEC / 2) {
+                return true;
+            }
+            open->progress_dialog = std::make_unique<Gtk::MessageDialog>(
+                Glib::ustring::compose(_("Loading %1"), open->file->get_basename()),
+                false, Gtk::MESSAGE_INFO, Gtk::BUTTONS_CANCEL);
+            open->progress_dialog->signal_response().connect([this, open] (int) {
+                open->job->cancel();
+                open->progress_dialog->hide();
+                // Not from within the signal of the dialog.
+                Glib::signal_idle().connect_once([this, open] { _background_opens.erase(open); });
+            });
+            open->progress_dialog->show();
+        }
+        open->progress_dialog->set_secondary_text(
+            Glib::ustring::compose(_("%1 MB read"), open->job->bytesRead() >> 20));
+        return true;
+    }, 100);
+
+    return true;
+}
+
+/** Show a document opened from a file in a window, or report that it failed to open.
+  */
+void
+InkscapeApplication::_finish_open(const Glib::RefPtr<Gio::File>& file, SPDocument *document, bool cancelled)
+{
+    InkscapeWindow* window = nullptr;
+
+    if (document) {
+        // Remember document so much that we'll add it to recent documents
+        auto recentmanager = Gtk::RecentManager::get_default();
+        recentmanager->add_item (file->get_uri());
+
+        SPDocument* old_document = _active_document;
+        bool replace = old_document && old_document->getVirgin();
+
+        window = create_window (document, replace);
+        document_fix(window);
+    } else if (!cancelled) {
+        std::cerr << "ConcreteInkscapeApplication<T>::create_window: Failed to load: "
+                  << file->get_parse_name() << std::endl;
+
+        gchar *text = g_strdup_printf(_("Failed to load the requested file %s"), file->get_parse_name().c_str());
+        sp_ui_error_dialog(text);
+        g_free(text);
     }
 
     _active_document = document;
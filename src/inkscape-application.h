@@ -36,6 +36,12 @@ class InkscapeWindow;
 class SPDocument;
 class SPDesktop;
 
+namespace Inkscape {
+namespace XML {
+class ParseJob;
+} // namespace XML
+} // namespace Inkscape
+
 class InkscapeApplication
 {
     Glib::RefPtr<Gio::Application> _gio_application;
@@ -152,6 +158,17 @@ protected:
 
     InkFileExportCmd _file_export;
 
+    // Files being parsed in the background before they are opened (see create_window()).
+    struct BackgroundOpen
+    {
+        ~BackgroundOpen();
+        Glib::RefPtr<Gio::File> file;
+        std::unique_ptr<Inkscape::XML::ParseJob> job;
+        std::unique_ptr<Gtk::MessageDialog> progress_dialog;
+        sigc::connection progress;
+    };
+    std::list<BackgroundOpen> _background_opens;
+
     // Actions from the command line or file.
     // Must read in on_handle_local_options() but parse in on_startup(). This is done as we must
     // have a valid app before initializing extensions which must be done before parsing.
@@ -176,6 +193,9 @@ protected:
     void shell();
 
     void _start_main_option_section(const Glib::ustring& section_name = "");
+
+    bool _open_in_background(const Glib::RefPtr<Gio::File>& file);
+    void _finish_open(const Glib::RefPtr<Gio::File>& file, SPDocument *document, bool cancelled);
 };
 
 #endif // INKSCAPE_APPLICATION_H
@@ -450,6 +450,10 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &filename_in)
         objects.emplace_back(); // So we do loop at least once for root.
     }
 
+    // Unless other objects are hidden, all objects are exported together once their areas are
+    // known, rendering them from one drawing.
+    std::vector<PngExportJob> jobs;
+
     for (auto object_id : objects) {
 
         std::string filename_out = get_filename_out(filename_in, Glib::filename_from_utf8(object_id));
@@ -682,6 +686,20 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &filename_in)
                   << width << " x " << height << " pixels (" << dpi << " dpi)" << std::endl;
 #endif
 
+        if (!export_id_only) {
+            PngExportJob job;
+            job.filename = filename_out;
+            job.area = area;
+            job.width = width;
+            job.height = height;
+            job.xdpi = xdpi;
+            job.ydpi = ydpi;
+            job.color_type = color_type;
+            job.bit_depth = bit_depth;
+            jobs.push_back(std::move(job));
+            continue;
+        }
+
         reverse(items.begin(),items.end()); // But there was only one item!
 
         if( sp_export_png_file(doc, filename_out.c_str(), area, width, height, xdpi, ydpi,
@@ -693,6 +711,16 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &filename_in)
         }
 
     } // End loop over objects.
+
+    if (!jobs.empty()) {
+        sp_export_png_files(doc, jobs, bgcolor);
+        for (auto const &job : jobs) {
+            if (job.result != EXPORT_OK) {
+                std::cerr << "InkFileExport::do_export_png: Failed to export to " << job.filename << std::endl;
+            }
+        }
+    }
+
     prefs->setBool("/options/dithering/value", old_dither);
     return 0;
 }
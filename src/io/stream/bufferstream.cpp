@@ -133,6 +133,17 @@ int BufferOutputStream::put(char ch)
     return 1;
 }
 
+/**
+ * Writes the specified bytes to this output stream.
+ */
+int BufferOutputStream::write(char const *data, std::size_t len)
+{
+    if (closed)
+        return -1;
+    buffer.insert(buffer.end(), data, data + len);
+    return len;
+}
+
 
 
 
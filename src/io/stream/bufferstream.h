@@ -76,6 +76,7 @@ public:
     void close() override;
     void flush() override;
     int put(char ch) override;
+    int write(char const *data, std::size_t len) override;
     virtual std::vector<unsigned char> &getBuffer()
         { return buffer; }
 
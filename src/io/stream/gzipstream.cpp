@@ -373,26 +373,16 @@ void GzipOutputStream::flush()
     }
 	
     uLong srclen = inputBuf.size();
-    Bytef *srcbuf = new (std::nothrow) Bytef [srclen];
-    if (!srcbuf)
-        {
-        return;
-        }
-        
-    uLong destlen = srclen;
-    Bytef *destbuf = new (std::nothrow) Bytef [(destlen + (srclen/100) + 13)];
+    Bytef const *srcbuf = inputBuf.data();
+
+    uLong destlen = compressBound(srclen);
+    Bytef *destbuf = new (std::nothrow) Bytef [destlen];
     if (!destbuf)
         {
-        delete[] srcbuf;
         return;
         }
         
-    std::vector<unsigned char>::iterator iter;
-    Bytef *p = srcbuf;
-    for (iter=inputBuf.begin() ; iter != inputBuf.end() ; ++iter)
-        *p++ = *iter;
-        
-    crc = crc32(crc, const_cast<const Bytef *>(srcbuf), srclen);
+    crc = crc32(crc, srcbuf, srclen);
     
     int zerr = compress(destbuf, static_cast<uLongf *>(&destlen), srcbuf, srclen);
     if (zerr != Z_OK)
@@ -402,15 +392,14 @@ void GzipOutputStream::flush()
 
     totalOut += destlen;
     //skip the redundant zlib header and checksum
-    for (uLong i=2; i<destlen-4 ; i++)
+    if (destlen > 6)
         {
-        destination.put((int)destbuf[i]);
+        destination.write(reinterpret_cast<char const *>(destbuf + 2), destlen - 6);
         }
         
     destination.flush();
 
     inputBuf.clear();
-    delete[] srcbuf;
     delete[] destbuf;
 }
 
@@ -434,6 +423,21 @@ int GzipOutputStream::put(char ch)
     return 1;
 }
 
+/**
+ * Writes the specified bytes to this output stream.
+ */ 
+int GzipOutputStream::write(char const *data, std::size_t len)
+{
+    if (closed)
+        {
+        return -1;
+        }
+
+    inputBuf.insert(inputBuf.end(), data, data + len);
+    totalIn += len;
+    return len;
+}
+
 
 
 } // namespace IO
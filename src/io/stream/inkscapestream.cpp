@@ -12,7 +12,10 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <algorithm>
+#include <cstdarg>
 #include <cstdlib>
+#include <cstring>
 #include "inkscapestream.h"
 
 namespace Inkscape
@@ -87,6 +90,25 @@ int BasicInputStream::get()
    
 
 
+//#########################################################################
+//# O U T P U T    S T R E A M
+//#########################################################################
+
+/**
+ * Writes the specified bytes to this output stream.
+ */
+int OutputStream::write(char const *data, std::size_t len)
+{
+    for (std::size_t i = 0; i < len; i++) {
+        if (put(data[i]) < 0) {
+            return -1;
+        }
+    }
+    return len;
+}
+
+
+
 //#########################################################################
 //# B A S I C    O U T P U T    S T R E A M
 //#########################################################################
@@ -469,12 +491,36 @@ void BasicWriter::put(char ch)
         destination->put(ch);
 }
 
+/**
+ * Writes the specified bytes to this output writer.
+ */ 
+Writer &BasicWriter::write(char const *data, std::size_t len)
+{
+    for (std::size_t i = 0; i < len; i++) {
+        put(data[i]);
+    }
+    return *this;
+}
+
 /**
  * Provide printf()-like formatting
  */ 
 Writer &BasicWriter::printf(char const *fmt, ...)
 {
+    // Short output is formatted on the stack, to save an allocation.
+    char small[256];
     va_list args;
+    va_start(args, fmt);
+    int len = g_vsnprintf(small, sizeof(small), fmt, args);
+    va_end(args);
+    if (len < 0) {
+        return *this;
+    }
+    if (len < static_cast<int>(sizeof(small))) {
+        write(small, len);
+        return *this;
+    }
+
     va_start(args, fmt);
     gchar *buf = g_strdup_vprintf(fmt, args);
     va_end(args);
@@ -508,9 +554,7 @@ Writer &BasicWriter::writeUString(const Glib::ustring &str)
  */ 
 Writer &BasicWriter::writeStdString(const std::string &str)
 {
-    for (char it : str) {
-        put(it);
-    }
+    write(str.data(), str.size());
     return *this;
 }
 
@@ -519,12 +563,9 @@ Writer &BasicWriter::writeStdString(const std::string &str)
  */ 
 Writer &BasicWriter::writeString(const char *str)
 {
-    std::string tmp;
-    if (str)
-        tmp = str;
-    else
-        tmp = "null";
-    writeStdString(tmp);
+    if (!str)
+        str = "null";
+    write(str, std::strlen(str));
     return *this;
 }
 
@@ -740,6 +781,137 @@ void OutputStreamWriter::put(char ch)
     outputStream.put(ch);
 }
 
+/**
+ *  Overloaded to pass blocks of chars to the OutputStream at once.
+ */
+Writer &OutputStreamWriter::write(char const *data, std::size_t len)
+{
+    outputStream.write(data, len);
+    return *this;
+}
+
+
+
+//#########################################################################
+//# B U F F E R E D    O U T P U T    S T R E A M    W R I T E R
+//#########################################################################
+
+
+BufferedOutputStreamWriter::BufferedOutputStreamWriter(OutputStream &outputStreamDest,
+                                                       std::size_t capacity)
+    : outputStream(outputStreamDest)
+    , buffer(std::max<std::size_t>(capacity, 256))
+    , length(0)
+    , closed(false)
+{
+}
+
+/**
+ *  Send what is left in the buffer, but leave the OutputStream open.
+ */
+BufferedOutputStreamWriter::~BufferedOutputStreamWriter()
+{
+    try {
+        drain();
+    } catch (StreamException &e) {
+        g_warning("%s", e.what());
+    }
+}
+
+/**
+ *  Send the buffer and close the underlying OutputStream
+ */
+void BufferedOutputStreamWriter::close()
+{
+    if (closed)
+        return;
+    flush();
+    outputStream.close();
+    closed = true;
+}
+
+/**
+ *  Send the buffer and flush the underlying OutputStream
+ */
+void BufferedOutputStreamWriter::flush()
+{
+    drain();
+    outputStream.flush();
+}
+
+/**
+ *  Append a char to the buffer, sending the buffer first if it is full.
+ */
+void BufferedOutputStreamWriter::put(char ch)
+{
+    if (length == buffer.size()) {
+        drain();
+    }
+    buffer[length++] = ch;
+}
+
+/**
+ *  Append a block of chars to the buffer.  Blocks larger than the
+ *  buffer go straight to the OutputStream.
+ */
+Writer &BufferedOutputStreamWriter::write(char const *data, std::size_t len)
+{
+    if (len > buffer.size() - length) {
+        drain();
+        if (len >= buffer.size()) {
+            outputStream.write(data, len);
+            return *this;
+        }
+    }
+    std::memcpy(buffer.data() + length, data, len);
+    length += len;
+    return *this;
+}
+
+/**
+ *  Format straight into the free space of the buffer.
+ */
+Writer &BufferedOutputStreamWriter::printf(char const *fmt, ...)
+{
+    for (int attempt = 0; attempt < 2; attempt++) {
+        std::size_t const space = buffer.size() - length;
+        va_list args;
+        va_start(args, fmt);
+        int len = g_vsnprintf(buffer.data() + length, space, fmt, args);
+        va_end(args);
+        if (len < 0) {
+            return *this;
+        }
+        if (static_cast<std::size_t>(len) < space) {
+            length += len;
+            return *this;
+        }
+        if (static_cast<std::size_t>(len) >= buffer.size()) {
+            break;
+        }
+        drain();
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    gchar *buf = g_strdup_vprintf(fmt, args);
+    va_end(args);
+    if (buf) {
+        write(buf, std::strlen(buf));
+        g_free(buf);
+    }
+    return *this;
+}
+
+void BufferedOutputStreamWriter::drain()
+{
+    if (length > 0) {
+        std::size_t const len = length;
+        length = 0;
+        outputStream.write(buffer.data(), len);
+    }
+}
+
 //#########################################################################
 //# S T D    W R I T E R
 //#########################################################################
@@ -10,7 +10,9 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <cstddef>
 #include <cstdio>
+#include <vector>
 #include <glibmm/ustring.h>
 
 namespace Inkscape
@@ -190,6 +192,13 @@ public:
      */
     virtual int put(char ch) = 0;
 
+    /**
+     * Send a block of bytes to the destination stream.  The default
+     * implementation puts them one by one; endpoints which can take
+     * a whole block at once should override it.
+     */
+    virtual int write(char const *data, std::size_t len);
+
 
 }; // class OutputStream
 
@@ -470,6 +479,8 @@ public:
     virtual void flush() = 0;
     
     virtual void put(char ch) = 0;
+
+    virtual Writer& write(char const *data, std::size_t len) = 0;
     
     /* Formatted output */
     virtual Writer& printf(char const *fmt, ...) G_GNUC_PRINTF(2,3) = 0;
@@ -524,6 +535,8 @@ public:
     void flush() override;
     
     void put(char ch) override;
+
+    Writer& write(char const *data, std::size_t len) override;
     
     
     
@@ -616,11 +629,57 @@ public:
     
     void put(char ch) override;
 
+    Writer& write(char const *data, std::size_t len) override;
+
+
+private:
+
+    OutputStream &outputStream;
+
+
+};
+
+
+/**
+ * Class for placing a Writer on an open OutputStream, which collects
+ * the output in a large buffer and sends it to the stream in blocks.
+ *
+ * Output only reaches the stream when the buffer is full, on flush()
+ * and on close(), so the stream must not be written to by other means
+ * while the writer is in use.  Destroying the writer sends what is
+ * left in the buffer, but does not flush or close the stream.
+ */
+class BufferedOutputStreamWriter : public BasicWriter
+{
+public:
+
+    BufferedOutputStreamWriter(OutputStream &outputStreamDest,
+                               std::size_t capacity = 1 << 20);
+
+    ~BufferedOutputStreamWriter() override;
+
+    void close() override;
+
+    void flush() override;
+
+    void put(char ch) override;
+
+    Writer& write(char const *data, std::size_t len) override;
+
+    Writer &printf(char const *fmt, ...) override G_GNUC_PRINTF(2,3);
+
 
 private:
 
+    void drain();
+
     OutputStream &outputStream;
 
+    std::vector<char> buffer;
+
+    std::size_t length;
+
+    bool closed;
 
 };
 
@@ -115,6 +115,15 @@ int StringOutputStream::put(char ch)
 	return 1;
 }
 
+/**
+ * Writes the specified bytes to this output stream.
+ */
+int StringOutputStream::write(char const *data, std::size_t len)
+{
+    buffer.append(data, data + len);
+    return len;
+}
+
 
 } // namespace IO
 } // namespace Inkscape
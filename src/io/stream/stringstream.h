@@ -78,6 +78,8 @@ public:
     
     int put(char ch) override;
 
+    int write(char const *data, std::size_t len) override;
+
     virtual Glib::ustring &getString()
         { return buffer; }
 
@@ -38,6 +38,7 @@
 #include "libnrtype/font-instance.h"
 
 #include "display/cairo-utils.h"  // Inkscape::Pixbuf
+#include "display/glyph-cache.h"
 
 #ifndef USE_PANGO_WIN32
 /*
@@ -147,6 +148,7 @@ font_instance::~font_instance()
     //    if ( theFace ) FT_Done_Face(theFace); // owned by pFont. don't touch
     theFace = nullptr;
 
+    Inkscape::GlyphCache::get().forget(this);
     for (int i=0;i<nbGlyph;i++) {
         if ( glyphs[i].pathvector ) {
             delete glyphs[i].pathvector;
@@ -394,6 +396,12 @@ static inline Geom::Point pointfx_to_nrpoint(const POINTFX &p, double scale)
 #endif
 
 void font_instance::LoadGlyph(int glyph_id)
+{
+    std::lock_guard<std::mutex> lock(_glyph_mutex);
+    _loadGlyph(glyph_id);
+}
+
+void font_instance::_loadGlyph(int glyph_id)
 {
     if ( pFont == nullptr ) {
         return;
@@ -650,19 +658,24 @@ bool font_instance::FontSlope(double &run, double &rise)
     return true;
 }
 
-Geom::OptRect font_instance::BBox(int glyph_id)
+int font_instance::_glyphNumber(int glyph_id)
 {
-    int no = -1;
-    if ( id_to_no.find(glyph_id) == id_to_no.end() ) {
-        LoadGlyph(glyph_id);
-        if ( id_to_no.find(glyph_id) == id_to_no.end() ) {
+    auto it = id_to_no.find(glyph_id);
+    if ( it == id_to_no.end() ) {
+        _loadGlyph(glyph_id);
+        it = id_to_no.find(glyph_id);
+        if ( it == id_to_no.end() ) {
             // didn't load
-        } else {
-            no = id_to_no[glyph_id];
+            return -1;
         }
-    } else {
-        no = id_to_no[glyph_id];
     }
+    return it->second;
+}
+
+Geom::OptRect font_instance::BBox(int glyph_id)
+{
+    std::lock_guard<std::mutex> lock(_glyph_mutex);
+    int no = _glyphNumber(glyph_id);
     if ( no < 0 ) {
         return Geom::OptRect();
     } else {
@@ -674,17 +687,8 @@ Geom::OptRect font_instance::BBox(int glyph_id)
 
 Geom::PathVector* font_instance::PathVector(int glyph_id)
 {
-    int no = -1;
-    if ( id_to_no.find(glyph_id) == id_to_no.end() ) {
-        LoadGlyph(glyph_id);
-        if ( id_to_no.find(glyph_id) == id_to_no.end() ) {
-            // didn't load
-        } else {
-            no = id_to_no[glyph_id];
-        }
-    } else {
-        no = id_to_no[glyph_id];
-    }
+    std::lock_guard<std::mutex> lock(_glyph_mutex);
+    int no = _glyphNumber(glyph_id);
     if ( no < 0 ) return nullptr;
     return glyphs[no].pathvector;
 }
@@ -702,6 +706,8 @@ Inkscape::Pixbuf* font_instance::PixBuf(int glyph_id)
         // To do: cache pixbuf.
         // To do: Error handling.
 
+        // Text is rendered concurrently, so only one thread may build the pixbuf.
+        std::lock_guard<std::mutex> lock(_svg_glyph_mutex);
         pixbuf = glyph_iter->second.pixbuf;
         if (!pixbuf) {
             Glib::ustring svg = glyph_iter->second.svg;
@@ -806,17 +812,8 @@ Inkscape::Pixbuf* font_instance::PixBuf(int glyph_id)
 
 double font_instance::Advance(int glyph_id, bool vertical)
 {
-    int no = -1;
-    if ( id_to_no.find(glyph_id) == id_to_no.end() ) {
-        LoadGlyph(glyph_id);
-        if ( id_to_no.find(glyph_id) == id_to_no.end() ) {
-            // didn't load
-        } else {
-            no=id_to_no[glyph_id];
-        }
-    } else {
-        no = id_to_no[glyph_id];
-    }
+    std::lock_guard<std::mutex> lock(_glyph_mutex);
+    int no = _glyphNumber(glyph_id);
     if ( no >= 0 ) {
         if ( vertical ) {
             return glyphs[no].v_advance;
@@ -11,6 +11,9 @@
  */
 
 #include <iomanip>
+#include <list>
+#include <map>
+#include <unordered_map>
 
 #include "Layout-TNG.h"
 #include "style.h"
@@ -167,6 +170,38 @@ class Layout::Calculator
     };
 
 
+    /** The itemization and shaping of a paragraph, kept by ShapingCache across
+    layouts. It owns its items, fonts and glyph strings; paragraphs being laid
+    out get copies of them. */
+    struct ShapedParagraph {
+        Direction direction;
+        std::vector<PangoItemInfo> pango_items;
+        std::vector<PangoLogAttr> char_attributes;
+        /// Shaped spans, by byte offset in the paragraph text and byte length.
+        std::map<std::pair<unsigned, unsigned>, PangoGlyphString *> glyph_strings;
+        /// Fonts named in the cache key. Referenced so that their addresses stay unique.
+        std::vector<font_instance *> fonts;
+
+        void free();
+    };
+
+    /** Shaped paragraphs keyed by their text, the font, features and language of
+    each run, the base direction and the font map, so that only paragraphs which
+    changed since the last layout are itemized and shaped again. Shared by all
+    layouts; the least recently used paragraphs are dropped. */
+    class ShapingCache {
+    public:
+        static ShapingCache &get();
+        ShapedParagraph *lookup(std::string const &key);
+        ShapedParagraph *insert(std::string const &key);
+
+    private:
+        static constexpr size_t MAX_PARAGRAPHS = 1024;
+        using Entry = std::pair<std::string const, ShapedParagraph>;
+        std::list<Entry> _lru; ///< most recently used first
+        std::unordered_map<std::string, std::list<Entry>::iterator> _index;
+    };
+
     /** Used to provide storage for anything that applies to the current
     paragraph only. Since we're only processing one paragraph at a time,
     there's only one instantiation of this struct, on the stack of
@@ -180,6 +215,7 @@ class Layout::Calculator
         std::vector<PangoItemInfo> pango_items;
         std::vector<PangoLogAttr> char_attributes;    ///< For every character in the paragraph.
         std::vector<UnbrokenSpan> unbroken_spans;
+        ShapedParagraph *shaped = nullptr;            ///< Cached shaping of this paragraph.
 
         template<typename T> static void free_sequence(T &seq)
         {
@@ -195,6 +231,7 @@ class Layout::Calculator
             free_sequence(input_items);
             free_sequence(pango_items);
             free_sequence(unbroken_spans);
+            shaped = nullptr;
         }
     };
 
@@ -1320,13 +1357,56 @@ void Layout::Calculator::BrokenSpan::setZero()
 //    }
 //}
 
+void Layout::Calculator::ShapedParagraph::free()
+{
+    ParagraphInfo::free_sequence(pango_items);
+    for (auto &glyph_string : glyph_strings) {
+        pango_glyph_string_free(glyph_string.second);
+    }
+    glyph_strings.clear();
+    for (auto font : fonts) {
+        font->Unref();
+    }
+    fonts.clear();
+}
+
+Layout::Calculator::ShapingCache &Layout::Calculator::ShapingCache::get()
+{
+    // Never destroyed: the cached fonts must not outlive the font factory.
+    static ShapingCache *cache = new ShapingCache();
+    return *cache;
+}
+
+Layout::Calculator::ShapedParagraph *Layout::Calculator::ShapingCache::lookup(std::string const &key)
+{
+    auto it = _index.find(key);
+    if (it == _index.end()) {
+        return nullptr;
+    }
+    _lru.splice(_lru.begin(), _lru, it->second);
+    return &it->second->second;
+}
+
+Layout::Calculator::ShapedParagraph *Layout::Calculator::ShapingCache::insert(std::string const &key)
+{
+    while (_lru.size() >= MAX_PARAGRAPHS) {
+        _lru.back().second.free();
+        _index.erase(_lru.back().first);
+        _lru.pop_back();
+    }
+    _lru.emplace_front(key, ShapedParagraph());
+    _index[key] = _lru.begin();
+    return &_lru.front().second;
+}
+
 /**
  * Take all the text from \a _para.first_input_index to the end of the
  * paragraph and stitch it together so that pango_itemize() can be called on
- * the whole thing.
+ * the whole thing. If the paragraph was itemized before with the same text and
+ * attributes, the cached result is used instead.
  *
  * Input: para.first_input_index.
- * Output: para.direction, para.pango_items, para.char_attributes.
+ * Output: para.direction, para.pango_items, para.char_attributes, para.shaped.
  * Returns: the number of spans created by pango_itemize
  */
 void  Layout::Calculator::_buildPangoItemizationForPara(ParagraphInfo *para) const
@@ -1336,6 +1416,17 @@ void  Layout::Calculator::_buildPangoItemizationForPara(ParagraphInfo *para) con
 
     TRACE(("itemizing para, first input %d\n", para->first_input_index));
 
+    // The cache key holds everything pango_itemize() and pango_shape() depend on.
+    std::string key;
+    auto append_key = [&key] (auto const &value) {
+        key.append(reinterpret_cast<char const *>(&value), sizeof(value));
+    };
+    auto append_key_string = [&] (std::string const &value) {
+        append_key(value.size());
+        key.append(value);
+    };
+    std::vector<font_instance *> fonts; // referenced until the key has been looked up
+
     PangoAttrList *attributes_list = pango_attr_list_new();
     for (unsigned input_index = para->first_input_index ; input_index < _flow._input_stream.size() ; input_index++) {
         if (_flow._input_stream[input_index]->Type() == CONTROL_CODE) {
@@ -1353,11 +1444,12 @@ void  Layout::Calculator::_buildPangoItemizationForPara(ParagraphInfo *para) con
             if (font == nullptr)
                 continue;  // bad news: we'll have to ignore all this text because we know of no font to render it
 
+            std::string const font_features = text_source->style->getFontFeatureString();
             PangoAttribute *attribute_font_description = pango_attr_font_desc_new(font->descr);
             attribute_font_description->start_index = para->text.bytes();
 
             PangoAttribute *attribute_font_features =
-                pango_attr_font_features_new( text_source->style->getFontFeatureString().c_str());
+                pango_attr_font_features_new(font_features.c_str());
             attribute_font_features->start_index = para->text.bytes();
             para->text.append(&*text_source->text_begin.base(), text_source->text_length);     // build the combined text
 
@@ -1375,22 +1467,60 @@ void  Layout::Calculator::_buildPangoItemizationForPara(ParagraphInfo *para) con
                 pango_attr_list_insert(attributes_list, attribute_language);
             }
 
+            append_key(font);
+            append_key(attribute_font_description->start_index);
+            append_key(attribute_font_description->end_index);
+            append_key_string(font_features);
+            append_key_string(object->lang.raw());
+
             // ownership of attribute is assumed by the list
-            font->Unref();
+            fonts.push_back(font);
         }
     }
 
     TRACE(("whole para: \"%s\"\n", para->text.data()));
 //    TRACE(("%d input sources used\n", input_index - para->first_input_index));
 
+    Layout::InputStreamTextSource const *first_source = nullptr;
+    if (_flow._input_stream[para->first_input_index]->Type() == TEXT_SOURCE) {
+        first_source = static_cast<Layout::InputStreamTextSource *>(_flow._input_stream[para->first_input_index]);
+    }
+
+    append_key_string(para->text.raw());
+    append_key(first_source ? (int)first_source->style->direction.computed : -1);
+    append_key(pango_context_get_base_gravity(_pango_context));
+    append_key(pango_context_get_gravity_hint(_pango_context));
+    append_key(pango_font_map_get_serial(pango_context_get_font_map(_pango_context)));
+
+    ShapingCache &cache = ShapingCache::get();
+    para->shaped = cache.lookup(key);
+    if (para->shaped) {
+        TRACE(("para itemization found in cache\n"));
+        pango_attr_list_unref(attributes_list);
+        for (auto font : fonts) {
+            font->Unref();
+        }
+        para->direction = para->shaped->direction;
+        para->pango_items.reserve(para->shaped->pango_items.size());
+        for (auto const &cached_item : para->shaped->pango_items) {
+            PangoItemInfo new_item;
+            new_item.item = pango_item_copy(cached_item.item);
+            new_item.font = cached_item.font;
+            if (new_item.font) {
+                new_item.font->Ref();
+            }
+            para->pango_items.push_back(new_item);
+        }
+        para->char_attributes = para->shaped->char_attributes;
+        return;
+    }
+
     // Pango Itemize
     GList *pango_items_glist = nullptr;
     para->direction = LEFT_TO_RIGHT; // CSS default
-    if (_flow._input_stream[para->first_input_index]->Type() == TEXT_SOURCE) {
-        Layout::InputStreamTextSource const *text_source = static_cast<Layout::InputStreamTextSource *>(_flow._input_stream[para->first_input_index]);
-
-        para->direction =                (text_source->style->direction.computed == SP_CSS_DIRECTION_LTR) ? LEFT_TO_RIGHT : RIGHT_TO_LEFT;
-        PangoDirection pango_direction = (text_source->style->direction.computed == SP_CSS_DIRECTION_LTR) ? PANGO_DIRECTION_LTR : PANGO_DIRECTION_RTL;
+    if (first_source) {
+        para->direction =                (first_source->style->direction.computed == SP_CSS_DIRECTION_LTR) ? LEFT_TO_RIGHT : RIGHT_TO_LEFT;
+        PangoDirection pango_direction = (first_source->style->direction.computed == SP_CSS_DIRECTION_LTR) ? PANGO_DIRECTION_LTR : PANGO_DIRECTION_RTL;
         pango_items_glist = pango_itemize_with_base_dir(_pango_context, pango_direction, para->text.data(), 0, para->text.bytes(), attributes_list, nullptr);
     }
 
@@ -1422,6 +1552,21 @@ void  Layout::Calculator::_buildPangoItemizationForPara(ParagraphInfo *para) con
     // This breaks Inkscape's multiline text (i.e. sodipodi:role line).
     para->char_attributes[para->text.length()].is_mandatory_break = 0;
 
+    // Remember the result; the shaped spans are added by _buildSpansForPara().
+    para->shaped = cache.insert(key);
+    para->shaped->direction = para->direction;
+    for (auto const &item : para->pango_items) {
+        PangoItemInfo cached_item;
+        cached_item.item = pango_item_copy(item.item);
+        cached_item.font = item.font;
+        if (cached_item.font) {
+            cached_item.font->Ref();
+        }
+        para->shaped->pango_items.push_back(cached_item);
+    }
+    para->shaped->char_attributes = para->char_attributes;
+    para->shaped->fonts = std::move(fonts);
+
     TRACE(("end para itemize, direction = %d\n", para->direction));
 }
 
@@ -1611,54 +1756,64 @@ unsigned Layout::Calculator::_buildSpansForPara(ParagraphInfo *para) const
                     auto gnew = std::string_view(para->text.data()         + para_text_index,           new_span.text_bytes);
                     assert (gold == gnew);
 
-                    // Convert characters to glyphs
-                    pango_shape_full(para->text.data() + para_text_index,
-                                     new_span.text_bytes,
-                                     para->text.data(),
-                                     -1,
-                                     &para->pango_items[pango_item_index].item->analysis,
-                                     new_span.glyph_string);
-
-                    if (para->pango_items[pango_item_index].item->analysis.level & 1) {
-                        // Right to left text (Arabic, Hebrew, etc.)
-
-                        // pango_shape() will reorder glyphs in rtl sections into visual order
-                        // (start offsets in accending order) which messes us up because the svg
-                        // spec requires us to draw glyphs in logical order so let's reverse the
-                        // glyphstring.
-
-                        const unsigned nglyphs = new_span.glyph_string->num_glyphs;
-                        std::vector<PangoGlyphInfo> infos(nglyphs);
-                        std::vector<gint>           clusters(nglyphs);
-
-                        for (int i = 0; i < nglyphs; ++i) {
-                            std::copy(&new_span.glyph_string->glyphs[i],       &new_span.glyph_string->glyphs[i+1],       infos.end() - i - 1);
-                            std::copy(&new_span.glyph_string->log_clusters[i], &new_span.glyph_string->log_clusters[i+1], clusters.end() - i - 1);
-                        }
+                    // Reuse the glyphs from an earlier layout of the same paragraph.
+                    auto const shaped_key = std::make_pair(para_text_index, new_span.text_bytes);
+                    auto const shaped = para->shaped->glyph_strings.find(shaped_key);
+                    if (shaped != para->shaped->glyph_strings.end()) {
+                        pango_glyph_string_free(new_span.glyph_string);
+                        new_span.glyph_string = pango_glyph_string_copy(shaped->second);
+                    } else {
+                        // Convert characters to glyphs
+                        pango_shape_full(para->text.data() + para_text_index,
+                                         new_span.text_bytes,
+                                         para->text.data(),
+                                         -1,
+                                         &para->pango_items[pango_item_index].item->analysis,
+                                         new_span.glyph_string);
+
+                        if (para->pango_items[pango_item_index].item->analysis.level & 1) {
+                            // Right to left text (Arabic, Hebrew, etc.)
+
+                            // pango_shape() will reorder glyphs in rtl sections into visual order
+                            // (start offsets in accending order) which messes us up because the svg
+                            // spec requires us to draw glyphs in logical order so let's reverse the
+                            // glyphstring.
+
+                            const unsigned nglyphs = new_span.glyph_string->num_glyphs;
+                            std::vector<PangoGlyphInfo> infos(nglyphs);
+                            std::vector<gint>           clusters(nglyphs);
+
+                            for (int i = 0; i < nglyphs; ++i) {
+                                std::copy(&new_span.glyph_string->glyphs[i],       &new_span.glyph_string->glyphs[i+1],       infos.end() - i - 1);
+                                std::copy(&new_span.glyph_string->log_clusters[i], &new_span.glyph_string->log_clusters[i+1], clusters.end() - i - 1);
+                            }
+
+                            std::copy(infos.begin(), infos.end(), new_span.glyph_string->glyphs);
+                            std::copy(clusters.begin(), clusters.end(), new_span.glyph_string->log_clusters);
 
-                        std::copy(infos.begin(), infos.end(), new_span.glyph_string->glyphs);
-                        std::copy(clusters.begin(), clusters.end(), new_span.glyph_string->log_clusters);
+                            // We've messed up the flag that tells a glyph it is first in a cluster.
+                            for (int i = 0; i < nglyphs; ++i) {
 
-                        // We've messed up the flag that tells a glyph it is first in a cluster.
-                        for (int i = 0; i < nglyphs; ++i) {
+                                // Set flag for start of cluster, we skip all other glyphs in cluster below.
+                                new_span.glyph_string->glyphs[i].attr.is_cluster_start = 1;
 
-                            // Set flag for start of cluster, we skip all other glyphs in cluster below.
-                            new_span.glyph_string->glyphs[i].attr.is_cluster_start = 1;
+                                // Find index of first glyph in next cluster
+                                int j = i + 1;
+                                while( (j < nglyphs) &&
+                                       (new_span.glyph_string->log_clusters[j] == new_span.glyph_string->log_clusters[i])
+                                    ) {
+                                    new_span.glyph_string->glyphs[j].attr.is_cluster_start = 0; // Zero
+                                    j++;
+                                }
 
-                            // Find index of first glyph in next cluster
-                            int j = i + 1;
-                            while( (j < nglyphs) &&
-                                   (new_span.glyph_string->log_clusters[j] == new_span.glyph_string->log_clusters[i])
-                                ) {
-                                new_span.glyph_string->glyphs[j].attr.is_cluster_start = 0; // Zero
-                                j++;
+                                // Move on to next cluster.
+                                i = j;
                             }
 
-                            // Move on to next cluster.
-                            i = j;
-                        }
+                        } // End right to left text.
 
-                    } // End right to left text.
+                        para->shaped->glyph_strings.emplace(shaped_key, pango_glyph_string_copy(new_span.glyph_string));
+                    }
 
                     //  The following sorting doesn't seem to be necessary, and causes
                     //  https://gitlab.com/inkscape/inkscape/-/issues/394 ...
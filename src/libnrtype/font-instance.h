@@ -11,6 +11,7 @@
 #define SEEN_LIBNRTYPE_FONT_INSTANCE_H
 
 #include <map>
+#include <mutex>
 
 #include <pango/pango-types.h>
 #include <pango/pango-font.h>
@@ -82,6 +83,9 @@ public:
     void                 LoadGlyph(int glyph_id);    // the main backend-dependent function
     // loads the given glyph's info
 
+    // The glyph functions below may be called from several threads at once: text is rendered and
+    // exported concurrently. The pointers they return stay valid while the font instance lives.
+
     // nota: all coordinates returned by these functions are on a [0..1] scale; you need to multiply
     // by the fontsize to get the real sizes
 
@@ -91,7 +95,8 @@ public:
     // Return font has SVG OpenType enties.
     bool                 FontHasSVG() { return fontHasSVG; };
 
-    // Return pixbuf of SVG glyph or nullptr if no SVG glyph exists.
+    // Return pixbuf of SVG glyph or nullptr if no SVG glyph exists. Built on first use, which may
+    // happen on several rendering threads at once.
     Inkscape::Pixbuf*    PixBuf(int glyph_id);
 
 
@@ -115,6 +120,8 @@ public:
 
 private:
     void                 FreeTheFace();
+    void                 _loadGlyph(int glyph_id);  // requires _glyph_mutex
+    int                  _glyphNumber(int glyph_id); // index in glyphs, loading it if needed; requires _glyph_mutex
     // Find ascent, descent, x-height, and baselines.
     void                 FindFontMetrics();
 
@@ -141,6 +148,11 @@ private:
 
     // Baselines
     double _baselines[SP_CSS_BASELINE_SIZE];
+
+    // Guards id_to_no and glyphs.
+    std::mutex _glyph_mutex;
+    // Guards the pixbufs of openTypeSVGGlyphs.
+    std::mutex _svg_glyph_mutex;
 };
 
 
@@ -39,6 +39,7 @@
 #include "path/path-util.h" // curve_for_item
 #include "preferences.h"
 #include "snap-enums.h"
+#include "snap-target-index.h"
 #include "style.h"
 #include "svg/svg.h"
 #include "text-editing.h"
@@ -47,6 +48,7 @@
 Inkscape::ObjectSnapper::ObjectSnapper(SnapManager *sm, Geom::Coord const d)
     : Snapper(sm, d)
 {
+    _index = std::make_unique<SnapTargetIndex>(sm);
     _points_to_snap_to = std::make_unique<std::vector<SnapCandidatePoint>>();
     _paths_to_snap_to = std::make_unique<std::vector<SnapCandidatePath>>();
 }
@@ -54,7 +56,7 @@ Inkscape::ObjectSnapper::ObjectSnapper(SnapManager *sm, Geom::Coord const d)
 Inkscape::ObjectSnapper::~ObjectSnapper()
 {
     _points_to_snap_to->clear();
-    _clear_paths();
+    _paths_to_snap_to->clear();
 }
 
 Geom::Coord Inkscape::ObjectSnapper::getSnapperTolerance() const
@@ -70,127 +72,42 @@ bool Inkscape::ObjectSnapper::getSnapperAlwaysSnap() const
 }
 
 void Inkscape::ObjectSnapper::_collectNodes(SnapSourceType const &t,
-                                            bool const &first_point) const
+                                            Geom::Rect const &area) const
 {
-    // Now, let's first collect all points to snap to. If we have a whole bunch of points to snap,
-    // e.g. when translating an item using the selector tool, then we will only do this for the
-    // first point and store the collection for later use. This significantly improves the performance
-    if (first_point) {
-        _points_to_snap_to->clear();
-
-         // Determine the type of bounding box we should snap to
-        SPItem::BBoxType bbox_type = SPItem::GEOMETRIC_BBOX;
-
-        bool p_is_a_node = t & SNAPSOURCE_NODE_CATEGORY;
-        bool p_is_a_bbox = t & SNAPSOURCE_BBOX_CATEGORY;
-        bool p_is_other = (t & SNAPSOURCE_OTHERS_CATEGORY) || (t & SNAPSOURCE_DATUMS_CATEGORY);
-
-        // A point considered for snapping should be either a node, a bbox corner or a guide/other. Pick only ONE!
-        if (((p_is_a_node && p_is_a_bbox) || (p_is_a_bbox && p_is_other) || (p_is_a_node && p_is_other))) {
-            g_warning("Snap warning: node type is ambiguous");
-        }
-
-        if (_snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_BBOX_CORNER, SNAPTARGET_BBOX_EDGE_MIDPOINT, SNAPTARGET_BBOX_MIDPOINT)) {
-            Preferences *prefs = Preferences::get();
-            bool prefs_bbox = prefs->getBool("/tools/bounding_box");
-            bbox_type = !prefs_bbox ?
-                SPItem::VISUAL_BBOX : SPItem::GEOMETRIC_BBOX;
-        }
-
-        // Consider the page border for snapping to
-        if (_snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_PAGE_CORNER)) {
-            if (auto document = _snapmanager->getDocument()) {
-                auto ignore_page = _snapmanager->getPageToIgnore();
-                for (auto page : document->getPageManager().getPages()) {
-                    if (ignore_page == page)
-                        continue;
-                    getBBoxPoints(page->getDesktopRect(), _points_to_snap_to.get(), true,
-                        SNAPSOURCE_PAGE_CORNER, SNAPTARGET_PAGE_CORNER,
-                        SNAPSOURCE_UNDEFINED, SNAPTARGET_UNDEFINED, // No edges
-                        SNAPSOURCE_PAGE_CENTER, SNAPTARGET_PAGE_CENTER);
-                }
-                // Only the corners get added here.
-                getBBoxPoints(document->preferredBounds(), _points_to_snap_to.get(), false,
-                    SNAPSOURCE_UNDEFINED, SNAPTARGET_PAGE_CORNER,
-                    SNAPSOURCE_UNDEFINED, SNAPTARGET_UNDEFINED,
-                    SNAPSOURCE_UNDEFINED, SNAPTARGET_UNDEFINED);
-            }
-        }
-
-        for (const auto & _candidate : *_snapmanager->obj_snapper_candidates) {
-            //Geom::Affine i2doc(Geom::identity());
-            SPItem *root_item = _candidate.item;
-
-            SPUse *use = dynamic_cast<SPUse *>(_candidate.item);
-            if (use) {
-                root_item = use->root();
-            }
-            g_return_if_fail(root_item);
-
-            //Collect all nodes so we can snap to them
-            if (p_is_a_node || p_is_other || (p_is_a_bbox && !_snapmanager->snapprefs.getStrictSnapping())) {
-                // Note: there are two ways in which intersections are considered:
-                // Method 1: Intersections are calculated for each shape individually, for both the
-                //           snap source and snap target (see sp_shape_snappoints)
-                // Method 2: Intersections are calculated for each curve or line that we've snapped to, i.e. only for
-                //           the target (see the intersect() method in the SnappedCurve and SnappedLine classes)
-                // Some differences:
-                // - Method 1 doesn't find intersections within a set of multiple objects
-                // - Method 2 only works for targets
-                // When considering intersections as snap targets:
-                // - Method 1 only works when snapping to nodes, whereas
-                // - Method 2 only works when snapping to paths
-                // - There will be performance differences too!
-                // If both methods are being used simultaneously, then this might lead to duplicate targets!
-
-                // Well, here we will be looking for snap TARGETS. Both methods can therefore be used.
-                // When snapping to paths, we will get a collection of snapped lines and snapped curves. findBestSnap() will
-                // go hunting for intersections (but only when asked to in the prefs of course). In that case we can just
-                // temporarily block the intersections in sp_item_snappoints, we don't need duplicates. If we're not snapping to
-                // paths though but only to item nodes then we should still look for the intersections in sp_item_snappoints()
-                bool old_pref = _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_PATH_INTERSECTION);
-                if (_snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_PATH)) {
-                    // So if we snap to paths, then findBestSnap will find the intersections
-                    // and therefore we temporarily disable SNAPTARGET_PATH_INTERSECTION, which will
-                    // avoid root_item->getSnappoints() below from returning intersections
-                    _snapmanager->snapprefs.setTargetSnappable(SNAPTARGET_PATH_INTERSECTION, false);
-                }
-
-                // We should not snap a transformation center to any of the centers of the items in the
-                // current selection (see the comment in SelTrans::centerRequest())
-                bool old_pref2 = _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_ROTATION_CENTER);
-                if (old_pref2) {
-                	std::vector<SPItem*> rotationSource=_snapmanager->getRotationCenterSource();
-                    for (auto itemlist : rotationSource) {
-                        if (_candidate.item == itemlist) {
-                            // don't snap to this item's rotation center
-                            _snapmanager->snapprefs.setTargetSnappable(SNAPTARGET_ROTATION_CENTER, false);
-                            break;
-                        }
-                    }
-                }
+    // Collect the points to snap to within the area. The nodes and bounding boxes of the items are
+    // kept in the snap target index between snap sessions, so we only have to look up the ones nearby
+    _points_to_snap_to->clear();
 
-                root_item->getSnappoints(*_points_to_snap_to, &_snapmanager->snapprefs);
+    bool p_is_a_node = t & SNAPSOURCE_NODE_CATEGORY;
+    bool p_is_a_bbox = t & SNAPSOURCE_BBOX_CATEGORY;
+    bool p_is_other = (t & SNAPSOURCE_OTHERS_CATEGORY) || (t & SNAPSOURCE_DATUMS_CATEGORY);
 
-                // restore the original snap preferences
-                _snapmanager->snapprefs.setTargetSnappable(SNAPTARGET_PATH_INTERSECTION, old_pref);
-                _snapmanager->snapprefs.setTargetSnappable(SNAPTARGET_ROTATION_CENTER, old_pref2);
-            }
+    // A point considered for snapping should be either a node, a bbox corner or a guide/other. Pick only ONE!
+    if (((p_is_a_node && p_is_a_bbox) || (p_is_a_bbox && p_is_other) || (p_is_a_node && p_is_other))) {
+        g_warning("Snap warning: node type is ambiguous");
+    }
 
-            //Collect the bounding box's corners so we can snap to them
-            if (p_is_a_bbox || (!_snapmanager->snapprefs.getStrictSnapping() && p_is_a_node) || p_is_other) {
-                // Discard the bbox of a clipped path / mask, because we don't want to snap to both the bbox
-                // of the item AND the bbox of the clipping path at the same time
-                if (!_candidate.clip_or_mask) {
-                    Geom::OptRect b = root_item->desktopBounds(bbox_type);
-                    getBBoxPoints(b, _points_to_snap_to.get(), true,
-                            _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_BBOX_CORNER),
-                            _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_BBOX_EDGE_MIDPOINT),
-                            _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_BBOX_MIDPOINT));
-                }
+    // Consider the page border for snapping to
+    if (_snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_PAGE_CORNER)) {
+        if (auto document = _snapmanager->getDocument()) {
+            auto ignore_page = _snapmanager->getPageToIgnore();
+            for (auto page : document->getPageManager().getPages()) {
+                if (ignore_page == page)
+                    continue;
+                getBBoxPoints(page->getDesktopRect(), _points_to_snap_to.get(), true,
+                    SNAPSOURCE_PAGE_CORNER, SNAPTARGET_PAGE_CORNER,
+                    SNAPSOURCE_UNDEFINED, SNAPTARGET_UNDEFINED, // No edges
+                    SNAPSOURCE_PAGE_CENTER, SNAPTARGET_PAGE_CENTER);
             }
+            // Only the corners get added here.
+            getBBoxPoints(document->preferredBounds(), _points_to_snap_to.get(), false,
+                SNAPSOURCE_UNDEFINED, SNAPTARGET_PAGE_CORNER,
+                SNAPSOURCE_UNDEFINED, SNAPTARGET_UNDEFINED,
+                SNAPSOURCE_UNDEFINED, SNAPTARGET_UNDEFINED);
         }
     }
+
+    _index->findPoints(area, t, *_points_to_snap_to);
 }
 
 void Inkscape::ObjectSnapper::_snapNodes(IntermSnapResults &isr,
@@ -199,9 +116,11 @@ void Inkscape::ObjectSnapper::_snapNodes(IntermSnapResults &isr,
                                          SnapConstraint const &c,
                                          Geom::Point const &p_proj_on_constraint) const
 {
-    // Iterate through all nodes, find out which one is the closest to p, and snap to it!
-
-    _collectNodes(p.getSourceType(), p.getSourceNum() <= 0);
+    // Iterate through all nodes near p, find out which one is the closest to p, and snap to it!
+    Geom::Point const p_area = c.isUndefined() ? p.getPoint() : p_proj_on_constraint;
+    Geom::Rect area(p_area, p_area);
+    area.expandBy(getSnapperTolerance());
+    _collectNodes(p.getSourceType(), area);
 
     if (unselected_nodes != nullptr && unselected_nodes->size() > 0) {
         g_assert(_points_to_snap_to != nullptr);
@@ -244,10 +163,9 @@ void Inkscape::ObjectSnapper::_snapTranslatingGuide(IntermSnapResults &isr,
                                          Geom::Point const &guide_normal) const
 {
     // Iterate through all nodes, find out which one is the closest to this guide, and snap to it!
-    _collectNodes(SNAPSOURCE_GUIDE, true);
+    _index->update(nullptr);
 
     if (_snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_PATH, SNAPTARGET_PATH_INTERSECTION, SNAPTARGET_BBOX_EDGE, SNAPTARGET_PAGE_BORDER, SNAPTARGET_TEXT_BASELINE)) {
-        _collectPaths(p, SNAPSOURCE_GUIDE, true);
         _snapPaths(isr, SnapCandidatePoint(p, SNAPSOURCE_GUIDE), nullptr, nullptr);
     }
 
@@ -255,6 +173,13 @@ void Inkscape::ObjectSnapper::_snapTranslatingGuide(IntermSnapResults &isr,
 
     Geom::Coord tol = getSnapperTolerance();
 
+    // Nodes within the tolerance of the guide and of p are within tol * sqrt(2) of p
+    Geom::Rect area = getSnapperAlwaysSnap() ? Geom::Rect::infinite() : Geom::Rect(p, p);
+    if (!getSnapperAlwaysSnap()) {
+        area.expandBy(tol * M_SQRT2);
+    }
+    _collectNodes(SNAPSOURCE_GUIDE, area);
+
     for (const auto & k : *_points_to_snap_to) {
         Geom::Point target_pt = k.getPoint();
         // Project each node (*k) on the guide line (running through point p)
@@ -269,115 +194,17 @@ void Inkscape::ObjectSnapper::_snapTranslatingGuide(IntermSnapResults &isr,
 }
 
 
-/// @todo investigate why Geom::Point p is passed in but ignored.
-void Inkscape::ObjectSnapper::_collectPaths(Geom::Point /*p*/,
-                                         SnapSourceType const source_type,
-                                         bool const &first_point) const
+void Inkscape::ObjectSnapper::_collectPaths(SnapSourceType const source_type) const
 {
-    // Now, let's first collect all paths to snap to. If we have a whole bunch of points to snap,
-    // e.g. when translating an item using the selector tool, then we will only do this for the
-    // first point and store the collection for later use. This significantly improves the performance
-    if (first_point) {
-        _clear_paths();
-
-        // Determine the type of bounding box we should snap to
-        SPItem::BBoxType bbox_type = SPItem::GEOMETRIC_BBOX;
-
-        bool p_is_a_node = source_type & SNAPSOURCE_NODE_CATEGORY;
-        bool p_is_a_bbox = source_type & SNAPSOURCE_BBOX_CATEGORY;
-        bool p_is_other = (source_type & SNAPSOURCE_OTHERS_CATEGORY) || (source_type & SNAPSOURCE_DATUMS_CATEGORY);
-
-        if (_snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_BBOX_EDGE)) {
-            Preferences *prefs = Preferences::get();
-            int prefs_bbox = prefs->getBool("/tools/bounding_box", false);
-            bbox_type = !prefs_bbox ?
-                SPItem::VISUAL_BBOX : SPItem::GEOMETRIC_BBOX;
-        }
-
-        // Consider the page border for snapping
-        if (_snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_PAGE_BORDER) && _snapmanager->snapprefs.isAnyCategorySnappable()) {
-            Geom::PathVector *border_path = _getBorderPathv();
-            if (border_path != nullptr) {
-                _paths_to_snap_to->push_back(SnapCandidatePath(border_path, SNAPTARGET_PAGE_BORDER, Geom::OptRect()));
-            }
-        }
-
-        for (const auto & _candidate : *_snapmanager->obj_snapper_candidates) {
-
-            /* Transform the requested snap point to this item's coordinates */
-            Geom::Affine i2doc(Geom::identity());
-            SPItem *root_item = nullptr;
-            /* We might have a clone at hand, so make sure we get the root item */
-            SPUse *use = dynamic_cast<SPUse *>(_candidate.item);
-            if (use) {
-                i2doc = use->get_root_transform();
-                root_item = use->root();
-                g_return_if_fail(root_item);
-            } else {
-                i2doc = _candidate.item->i2doc_affine();
-                root_item = _candidate.item;
-            }
-
-            //Build a list of all paths considered for snapping to
-
-            //Add the item's path to snap to
-            if (_snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_PATH, SNAPTARGET_PATH_INTERSECTION, SNAPTARGET_TEXT_BASELINE)) {
-                if (p_is_other || p_is_a_node || (!_snapmanager->snapprefs.getStrictSnapping() && p_is_a_bbox)) {
-                    if (dynamic_cast<SPText *>(root_item) || dynamic_cast<SPFlowtext *>(root_item)) {
-                        if (_snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_TEXT_BASELINE)) {
-                            // Snap to the text baseline
-                            Text::Layout const *layout = te_get_layout(static_cast<SPItem *>(root_item));
-                            if (layout != nullptr && layout->outputExists()) {
-                                Geom::PathVector *pv = new Geom::PathVector();
-                                pv->push_back(layout->baseline() * root_item->i2dt_affine() * _candidate.additional_affine * _snapmanager->getDesktop()->doc2dt());
-                                _paths_to_snap_to->push_back(SnapCandidatePath(pv, SNAPTARGET_TEXT_BASELINE, Geom::OptRect()));
-                            }
-                        }
-                    } else {
-                        // Snapping for example to a traced bitmap is very stressing for
-                        // the CPU, so we'll only snap to paths having no more than 500 nodes
-                        // This also leads to a lag of approx. 500 msec (in my lousy test set-up).
-                        bool very_complex_path = false;
-                        SPPath *path = dynamic_cast<SPPath *>(root_item);
-                        if (path) {
-                            very_complex_path = path->nodesInPath() > 500;
-                        }
-
-                        if (!very_complex_path && root_item && _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_PATH, SNAPTARGET_PATH_INTERSECTION)) {
-                            std::unique_ptr<SPCurve> curve;
-                            SPShape *shape = dynamic_cast<SPShape *>(root_item);
-                            if (shape) {
-                                curve = SPCurve::copy(shape->curve());
-                            }/* else if (dynamic_cast<SPText *>(root_item) || dynamic_cast<SPFlowtext *>(root_item)) {
-                               curve = te_get_layout(root_item)->convertToCurves();
-                            }*/
-                            if (curve) {
-                                // We will get our own copy of the pathvector, which must be freed at some point
-                                Geom::PathVector *pv = new Geom::PathVector(curve->get_pathvector());
-                                (*pv) *= root_item->i2dt_affine() * _candidate.additional_affine * _snapmanager->getDesktop()->doc2dt(); // (_edit_transform * _i2d_transform);
-
-                                _paths_to_snap_to->push_back(SnapCandidatePath(pv, SNAPTARGET_PATH, Geom::OptRect())); // Perhaps for speed, get a reference to the Geom::pathvector, and store the transformation besides it.
-                            }
-                        }
-                    }
-                }
-            }
+    // Collect the paths to snap to which are not in the snap target index. The paths of the items
+    // in the document are looked up in the index for each snap source
+    _paths_to_snap_to->clear();
 
-            //Add the item's bounding box to snap to
-            if (_snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_BBOX_EDGE)) {
-                if (p_is_other || p_is_a_bbox || (!_snapmanager->snapprefs.getStrictSnapping() && p_is_a_node)) {
-                    // Discard the bbox of a clipped path / mask, because we don't want to snap to both the bbox
-                    // of the item AND the bbox of the clipping path at the same time
-                    if (!_candidate.clip_or_mask) {
-                        Geom::OptRect rect = root_item->bounds(bbox_type, i2doc);
-                        if (rect) {
-                            Geom::PathVector *path = _getPathvFromRect(*rect);
-                            rect = root_item->desktopBounds(bbox_type);
-                            _paths_to_snap_to->push_back(SnapCandidatePath(path, SNAPTARGET_BBOX_EDGE, rect));
-                        }
-                    }
-                }
-            }
+    // Consider the page border for snapping
+    if (_snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_PAGE_BORDER) && _snapmanager->snapprefs.isAnyCategorySnappable()) {
+        auto border_path = _getBorderPathv();
+        if (border_path != nullptr) {
+            _paths_to_snap_to->push_back(SnapCandidatePath(border_path, SNAPTARGET_PAGE_BORDER, Geom::OptRect()));
         }
     }
 }
@@ -387,7 +214,7 @@ void Inkscape::ObjectSnapper::_snapPaths(IntermSnapResults &isr,
                                      std::vector<SnapCandidatePoint> *unselected_nodes,
                                      SPPath const *selected_path) const
 {
-    _collectPaths(p.getPoint(), p.getSourceType(), p.getSourceNum() <= 0);
+    _collectPaths(p.getSourceType());
     // Now we can finally do the real snapping, using the paths collected above
 
     SPDesktop const *dt = _snapmanager->getDesktop();
@@ -396,21 +223,19 @@ void Inkscape::ObjectSnapper::_snapPaths(IntermSnapResults &isr,
 
     bool const node_tool_active = _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_PATH, SNAPTARGET_PATH_INTERSECTION) && selected_path != nullptr;
 
-    if (p.getSourceNum() <= 0) {
-        /* findCandidates() is used for snapping to both paths and nodes. It ignores the path that is
-         * currently being edited, because that path requires special care: when snapping to nodes
-         * only the unselected nodes of that path should be considered, and these will be passed on separately.
-         * This path must not be ignored however when snapping to the paths, so we add it here
-         * manually when applicable.
-         * */
-        if (node_tool_active) {
-            // TODO fix the function to be const correct:
-            auto curve = curve_for_item(const_cast<SPPath *>(selected_path));
-            if (curve) {
-                Geom::PathVector *pathv = new Geom::PathVector(curve->get_pathvector()); // Must be freed.
-                *pathv *= selected_path->i2doc_affine();
-                _paths_to_snap_to->push_back(SnapCandidatePath(pathv, SNAPTARGET_PATH, Geom::OptRect(), true));
-            }
+    /* The snap target index is used for snapping to both paths and nodes. It ignores the path that is
+     * currently being edited, because that path requires special care: when snapping to nodes
+     * only the unselected nodes of that path should be considered, and these will be passed on separately.
+     * This path must not be ignored however when snapping to the paths, so we add it here
+     * manually when applicable.
+     * */
+    if (node_tool_active) {
+        // TODO fix the function to be const correct:
+        auto curve = curve_for_item(const_cast<SPPath *>(selected_path));
+        if (curve) {
+            auto pathv = std::make_shared<Geom::PathVector>(curve->get_pathvector());
+            *pathv *= selected_path->i2doc_affine();
+            _paths_to_snap_to->push_back(SnapCandidatePath(pathv, SNAPTARGET_PATH, Geom::OptRect(), true));
         }
     }
 
@@ -422,70 +247,80 @@ void Inkscape::ObjectSnapper::_snapPaths(IntermSnapResults &isr,
     bool snap_perp = _snapmanager->snapprefs.isTargetSnappable(Inkscape::SNAPTARGET_PATH_PERPENDICULAR);
     bool snap_tang = _snapmanager->snapprefs.isTargetSnappable(Inkscape::SNAPTARGET_PATH_TANGENTIAL);
 
+    // Examine the nearest point on a curve, and determine whether it's within snapping range and if we should snap to it
+    auto snap_to_curve = [&] (SnapCandidatePath const &target, bool being_edited, int path_id, unsigned index, Geom::Curve const *curve) {
+        Geom::Coord const np = curve->nearestTime(p_doc);
+        Geom::Point const sp_doc = curve->pointAt(np);
+        //dt->snapindicator->set_new_debugging_point(sp_doc*dt->doc2dt());
+        bool c1 = true;
+        bool c2 = true;
+        if (being_edited) {
+            /* If the path is being edited, then we should only snap though to stationary pieces of the path
+             * and not to the pieces that are being dragged around. This way we avoid
+             * self-snapping. For this we check whether the nodes at both ends of the current
+             * piece are unselected; if they are then this piece must be stationary
+             */
+            g_assert(unselected_nodes != nullptr);
+            Geom::Point start_pt = dt->doc2dt(curve->pointAt(0));
+            Geom::Point end_pt = dt->doc2dt(curve->pointAt(1));
+            c1 = isUnselectedNode(start_pt, unselected_nodes);
+            c2 = isUnselectedNode(end_pt, unselected_nodes);
+            /* Unfortunately, this might yield false positives for coincident nodes. Inkscape might therefore mistakenly
+             * snap to path segments that are not stationary. There are at least two possible ways to overcome this:
+             * - Linking the individual nodes of the SPPath we have here, to the nodes of the NodePath::SubPath class as being
+             *   used in sp_nodepath_selected_nodes_move. This class has a member variable called "selected". For this the nodes
+             *   should be in the exact same order for both classes, so we can index them
+             * - Replacing the SPPath being used here by the NodePath::SubPath class; but how?
+             */
+        }
+
+        Geom::Point const sp_dt = dt->doc2dt(sp_doc);
+        if (!being_edited || (c1 && c2)) {
+            Geom::Coord dist = Geom::distance(sp_doc, p_doc);
+            // std::cout << "  dist -> " << dist << std::endl;
+            if (dist < getSnapperTolerance()) {
+                // Add the curve we have snapped to
+                Geom::Point sp_tangent_dt = Geom::Point(0,0);
+                if (p.getSourceType() == Inkscape::SNAPSOURCE_GUIDE_ORIGIN) {
+                    // We currently only use the tangent when snapping guides, so only in this case we will
+                    // actually calculate the tangent to avoid wasting CPU cycles
+                    Geom::Point sp_tangent_doc = curve->unitTangentAt(np);
+                    sp_tangent_dt = dt->doc2dt(sp_tangent_doc) - dt->doc2dt(Geom::Point(0,0));
+                }
+                isr.curves.emplace_back(sp_dt, sp_tangent_dt, path_id, index, dist, getSnapperTolerance(), getSnapperAlwaysSnap(), false, curve, p.getSourceType(), p.getSourceNum(), target.target_type, target.target_bbox);
+                if (snap_tang || snap_perp) {
+                    // For each curve that's within snapping range, we will now also search for tangential and perpendicular snaps
+                    _snapPathsTangPerp(snap_tang, snap_perp, isr, p, curve, dt);
+                }
+            }
+        }
+    };
+
     //dt->snapindicator->remove_debugging_points();
     for (const auto & it_p : *_paths_to_snap_to) {
         if (_allowSourceToSnapToTarget(p.getSourceType(), it_p.target_type, strict_snapping)) {
             bool const being_edited = node_tool_active && it_p.currently_being_edited;
             //if true then this pathvector it_pv is currently being edited in the node tool
 
-            for(Geom::PathVector::iterator it_pv = (it_p.path_vector)->begin(); it_pv != (it_p.path_vector)->end(); ++it_pv) {
+            for (auto const &path : *it_p.path_vector) {
                 // Find a nearest point for each curve within this path
-                // n curves will return n time values with 0 <= t <= 1
-                std::vector<double> anp = (*it_pv).nearestTimePerCurve(p_doc);
-
-                //std::cout << "#nearest points = " << anp.size() << " | p = " << p.getPoint() << std::endl;
-                // Now we will examine each of the nearest points, and determine whether it's within snapping range and if we should snap to it
-                std::vector<double>::const_iterator np = anp.begin();
-                unsigned int index = 0;
-                for (; np != anp.end(); ++np, index++) {
-                    Geom::Curve const *curve = &(it_pv->at(index));
-                    Geom::Point const sp_doc = curve->pointAt(*np);
-                    //dt->snapindicator->set_new_debugging_point(sp_doc*dt->doc2dt());
-                    bool c1 = true;
-                    bool c2 = true;
-                    if (being_edited) {
-                        /* If the path is being edited, then we should only snap though to stationary pieces of the path
-                         * and not to the pieces that are being dragged around. This way we avoid
-                         * self-snapping. For this we check whether the nodes at both ends of the current
-                         * piece are unselected; if they are then this piece must be stationary
-                         */
-                        g_assert(unselected_nodes != nullptr);
-                        Geom::Point start_pt = dt->doc2dt(curve->pointAt(0));
-                        Geom::Point end_pt = dt->doc2dt(curve->pointAt(1));
-                        c1 = isUnselectedNode(start_pt, unselected_nodes);
-                        c2 = isUnselectedNode(end_pt, unselected_nodes);
-                        /* Unfortunately, this might yield false positives for coincident nodes. Inkscape might therefore mistakenly
-                         * snap to path segments that are not stationary. There are at least two possible ways to overcome this:
-                         * - Linking the individual nodes of the SPPath we have here, to the nodes of the NodePath::SubPath class as being
-                         *   used in sp_nodepath_selected_nodes_move. This class has a member variable called "selected". For this the nodes
-                         *   should be in the exact same order for both classes, so we can index them
-                         * - Replacing the SPPath being used here by the NodePath::SubPath class; but how?
-                         */
-                    }
-
-                    Geom::Point const sp_dt = dt->doc2dt(sp_doc);
-                    if (!being_edited || (c1 && c2)) {
-                        Geom::Coord dist = Geom::distance(sp_doc, p_doc);
-                        // std::cout << "  dist -> " << dist << std::endl;
-                        if (dist < getSnapperTolerance()) {
-                            // Add the curve we have snapped to
-                            Geom::Point sp_tangent_dt = Geom::Point(0,0);
-                            if (p.getSourceType() == Inkscape::SNAPSOURCE_GUIDE_ORIGIN) {
-                                // We currently only use the tangent when snapping guides, so only in this case we will
-                                // actually calculate the tangent to avoid wasting CPU cycles
-                                Geom::Point sp_tangent_doc = curve->unitTangentAt(*np);
-                                sp_tangent_dt = dt->doc2dt(sp_tangent_doc) - dt->doc2dt(Geom::Point(0,0));
-                            }
-                            isr.curves.emplace_back(sp_dt, sp_tangent_dt, num_path, index, dist, getSnapperTolerance(), getSnapperAlwaysSnap(), false, curve, p.getSourceType(), p.getSourceNum(), it_p.target_type, it_p.target_bbox);
-                            if (snap_tang || snap_perp) {
-                                // For each curve that's within snapping range, we will now also search for tangential and perpendicular snaps
-                                _snapPathsTangPerp(snap_tang, snap_perp, isr, p, curve, dt);
-                            }
-                        }
-                    }
+                for (unsigned index = 0; index < path.size_default(); index++) {
+                    snap_to_curve(it_p, being_edited, num_path, index, &path[index]);
                 }
                 num_path++;
-            } // End of: for (Geom::PathVector::iterator ....)
+            }
+        }
+    }
+
+    // The paths of the items in the document; only the curves that might be within snapping range are considered
+    Geom::Rect area(p_doc, p_doc);
+    area.expandBy(getSnapperTolerance());
+    std::vector<SnapTargetIndex::CurveTarget> curves;
+    _index->findCurves(area, p.getSourceType(), curves);
+    for (auto const &c : curves) {
+        SnapCandidatePath const &target = c.target->path;
+        if (_allowSourceToSnapToTarget(p.getSourceType(), target.target_type, strict_snapping)) {
+            snap_to_curve(target, false, num_path + c.target->first_path + c.path, c.curve, &(*target.path_vector)[c.path][c.curve]);
         }
     }
 }
@@ -518,7 +353,7 @@ void Inkscape::ObjectSnapper::_snapPathsConstrained(IntermSnapResults &isr,
                                      SPPath const *selected_path) const
 {
 
-    _collectPaths(p_proj_on_constraint, p.getSourceType(), p.getSourceNum() <= 0);
+    _collectPaths(p.getSourceType());
 
     // Now we can finally do the real snapping, using the paths collected above
 
@@ -556,28 +391,40 @@ void Inkscape::ObjectSnapper::_snapPathsConstrained(IntermSnapResults &isr,
     bool const node_tool_active = _snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_PATH, SNAPTARGET_PATH_INTERSECTION) && selected_path != nullptr;
 
     //TODO: code duplication
-	if (p.getSourceNum() <= 0) {
-        /* findCandidates() is used for snapping to both paths and nodes. It ignores the path that is
-         * currently being edited, because that path requires special care: when snapping to nodes
-         * only the unselected nodes of that path should be considered, and these will be passed on separately.
-         * This path must not be ignored however when snapping to the paths, so we add it here
-         * manually when applicable.
-         * */
-        if (node_tool_active) {
-            // TODO fix the function to be const correct:
-            auto curve = curve_for_item(const_cast<SPPath *>(selected_path));
-            if (curve) {
-                Geom::PathVector *pathv = new Geom::PathVector(curve->get_pathvector()); // Must be freed.
-                *pathv *= selected_path->i2doc_affine();
-                _paths_to_snap_to->push_back(SnapCandidatePath(pathv, SNAPTARGET_PATH, Geom::OptRect(), true));
-            }
+    /* The snap target index is used for snapping to both paths and nodes. It ignores the path that is
+     * currently being edited, because that path requires special care: when snapping to nodes
+     * only the unselected nodes of that path should be considered, and these will be passed on separately.
+     * This path must not be ignored however when snapping to the paths, so we add it here
+     * manually when applicable.
+     * */
+    if (node_tool_active) {
+        // TODO fix the function to be const correct:
+        auto curve = curve_for_item(const_cast<SPPath *>(selected_path));
+        if (curve) {
+            auto pathv = std::make_shared<Geom::PathVector>(curve->get_pathvector());
+            *pathv *= selected_path->i2doc_affine();
+            _paths_to_snap_to->push_back(SnapCandidatePath(pathv, SNAPTARGET_PATH, Geom::OptRect(), true));
         }
     }
 
     bool strict_snapping = _snapmanager->snapprefs.getStrictSnapping();
 
-    // Find all intersections of the constrained path with the snap target candidates
+    // Only the paths of the items in the document that come close to the constraint can intersect it
+    std::vector<SnapCandidatePath const *> targets;
     for (const auto & k : *_paths_to_snap_to) {
+        targets.push_back(&k);
+    }
+    if (Geom::OptRect constraint_bounds = constraint_path.boundsFast()) {
+        std::vector<SnapTargetIndex::PathTarget const *> indexed;
+        _index->findPaths(*constraint_bounds, p.getSourceType(), indexed);
+        for (auto target : indexed) {
+            targets.push_back(&target->path);
+        }
+    }
+
+    // Find all intersections of the constrained path with the snap target candidates
+    for (auto const target : targets) {
+        SnapCandidatePath const &k = *target;
         if (k.path_vector && _allowSourceToSnapToTarget(p.getSourceType(), k.target_type, strict_snapping)) {
             // Do the intersection math
             std::vector<Geom::PVIntersection> inters = constraint_path.intersect(*(k.path_vector));
@@ -619,7 +466,7 @@ void Inkscape::ObjectSnapper::_snapPathsConstrained(IntermSnapResults &isr,
 
 void Inkscape::ObjectSnapper::freeSnap(IntermSnapResults &isr,
                                             SnapCandidatePoint const &p,
-                                            Geom::OptRect const &bbox_to_snap,
+                                            Geom::OptRect const &/*bbox_to_snap*/,
                                             std::vector<SPObject const *> const *it,
                                             std::vector<SnapCandidatePoint> *unselected_nodes) const
 {
@@ -627,12 +474,15 @@ void Inkscape::ObjectSnapper::freeSnap(IntermSnapResults &isr,
         return;
     }
 
-    /* Get a list of all the SPItems that we will try to snap to; this only needs to be done for the object snapper,
+    /* Bring the snap targets of the items up to date; this only needs to be done for the object snapper,
     not for the grid snappers, so we'll do this here and not in the Snapmanager::freeSnap(). This saves us from wasting
     precious CPU cycles */
     if (p.getSourceNum() <= 0) {
-        Geom::Rect const local_bbox_to_snap = bbox_to_snap ? *bbox_to_snap : Geom::Rect(p.getPoint(), p.getPoint());
-        _snapmanager->_findCandidates(_snapmanager->getDocument()->getRoot(), it, p.getSourceNum() <= 0, local_bbox_to_snap, false, Geom::identity());
+        _index->update(it);
+        // The alignment and distribution snappers still need a list of the items on the desktop
+        if (_snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_ALIGNMENT_CATEGORY, SNAPTARGET_DISTRIBUTION_CATEGORY)) {
+            _snapmanager->_findCandidates(_snapmanager->getDocument()->getRoot(), it, true, false, Geom::identity());
+        }
     }
 
     _snapNodes(isr, p, unselected_nodes);
@@ -662,7 +512,7 @@ void Inkscape::ObjectSnapper::freeSnap(IntermSnapResults &isr,
 
 void Inkscape::ObjectSnapper::constrainedSnap( IntermSnapResults &isr,
                                                   SnapCandidatePoint const &p,
-                                                  Geom::OptRect const &bbox_to_snap,
+                                                  Geom::OptRect const &/*bbox_to_snap*/,
                                                   SnapConstraint const &c,
                                                   std::vector<SPObject const *> const *it,
                                                   std::vector<SnapCandidatePoint> *unselected_nodes) const
@@ -674,12 +524,15 @@ void Inkscape::ObjectSnapper::constrainedSnap( IntermSnapResults &isr,
     // project the mouse pointer onto the constraint. Only the projected point will be considered for snapping
     Geom::Point pp = c.projection(p.getPoint());
 
-    /* Get a list of all the SPItems that we will try to snap to; this only needs to be done for the object snapper,
+    /* Bring the snap targets of the items up to date; this only needs to be done for the object snapper,
     not for the grid snappers, so we'll do this here and not in the Snapmanager::freeSnap(). This saves us from wasting
     precious CPU cycles */
     if (p.getSourceNum() <= 0) {
-        Geom::Rect const local_bbox_to_snap = bbox_to_snap ? *bbox_to_snap : Geom::Rect(pp, pp); // Using the projected point here! Not so in freeSnap()!
-        _snapmanager->_findCandidates(_snapmanager->getDocument()->getRoot(), it, p.getSourceNum() <= 0, local_bbox_to_snap, false, Geom::identity());
+        _index->update(it);
+        // The alignment and distribution snappers still need a list of the items on the desktop
+        if (_snapmanager->snapprefs.isTargetSnappable(SNAPTARGET_ALIGNMENT_CATEGORY, SNAPTARGET_DISTRIBUTION_CATEGORY)) {
+            _snapmanager->_findCandidates(_snapmanager->getDocument()->getRoot(), it, true, false, Geom::identity());
+        }
     }
 
     // A constrained snap, is a snap in only one degree of freedom (specified by the constraint line).
@@ -717,26 +570,17 @@ bool Inkscape::ObjectSnapper::ThisSnapperMightSnap() const
     return true;
 }
 
-void Inkscape::ObjectSnapper::_clear_paths() const
-{
-    for (const auto & k : *_paths_to_snap_to) {
-        delete k.path_vector;
-    }
-    _paths_to_snap_to->clear();
-}
-
-Geom::PathVector* Inkscape::ObjectSnapper::_getBorderPathv() const
+std::shared_ptr<Geom::PathVector> Inkscape::ObjectSnapper::_getBorderPathv() const
 {
     Geom::Rect const border_rect = Geom::Rect(Geom::Point(0,0), Geom::Point((_snapmanager->getDocument())->getWidth().value("px"),(_snapmanager->getDocument())->getHeight().value("px")));
     return _getPathvFromRect(border_rect);
 }
 
-Geom::PathVector* Inkscape::ObjectSnapper::_getPathvFromRect(Geom::Rect const rect) const
+std::shared_ptr<Geom::PathVector> Inkscape::ObjectSnapper::_getPathvFromRect(Geom::Rect const rect) const
 {
     auto const border_curve = SPCurve::new_from_rect(rect, true);
     if (border_curve) {
-        Geom::PathVector *dummy = new Geom::PathVector(border_curve->get_pathvector());
-        return dummy;
+        return std::make_shared<Geom::PathVector>(border_curve->get_pathvector());
     } else {
         return nullptr;
     }
@@ -24,6 +24,8 @@ class SPDesktop;
 namespace Inkscape
 {
 
+class SnapTargetIndex;
+
 /**
  * Snapping things to objects.
  */
@@ -60,8 +62,9 @@ public:
                   std::vector<SnapCandidatePoint> *unselected_nodes) const override;
 
 private:
-    std::unique_ptr<std::vector<SnapCandidatePoint>> _points_to_snap_to;
-    std::unique_ptr<std::vector<SnapCandidatePath >> _paths_to_snap_to;
+    std::unique_ptr<SnapTargetIndex> _index; // the nodes, paths and bounding boxes of the items in the document
+    std::unique_ptr<std::vector<SnapCandidatePoint>> _points_to_snap_to; // targets near the current snap source
+    std::unique_ptr<std::vector<SnapCandidatePath >> _paths_to_snap_to; // targets not in the index, e.g. the page border
 
     void _snapNodes(IntermSnapResults &isr,
                       Inkscape::SnapCandidatePoint const &p, // in desktop coordinates
@@ -74,7 +77,7 @@ private:
                      Geom::Point const &guide_normal) const;
 
     void _collectNodes(Inkscape::SnapSourceType const &t,
-                  bool const &first_point) const;
+                  Geom::Rect const &area) const;
 
     void _snapPaths(IntermSnapResults &isr,
                       Inkscape::SnapCandidatePoint const &p, // in desktop coordinates
@@ -97,16 +100,10 @@ private:
 
     bool isUnselectedNode(Geom::Point const &point, std::vector<Inkscape::SnapCandidatePoint> const *unselected_nodes) const;
 
-    /**
-     * Returns index of first NR_END bpath in array.
-     */
-    void _collectPaths(Geom::Point p,
-                      Inkscape::SnapSourceType const source_type,
-                      bool const &first_point) const;
+    void _collectPaths(Inkscape::SnapSourceType const source_type) const;
 
-    void _clear_paths() const;
-    Geom::PathVector* _getBorderPathv() const;
-    Geom::PathVector* _getPathvFromRect(Geom::Rect const rect) const;
+    std::shared_ptr<Geom::PathVector> _getBorderPathv() const;
+    std::shared_ptr<Geom::PathVector> _getPathvFromRect(Geom::Rect const rect) const;
     bool _allowSourceToSnapToTarget(SnapSourceType source, SnapTargetType target, bool strict_snapping) const;
 
 }; // end of ObjectSnapper class
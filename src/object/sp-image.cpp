@@ -39,6 +39,10 @@
 #include "document.h"
 #include "sp-image.h"
 #include "sp-clippath.h"
+#include "sp-marker.h"
+#include "sp-root.h"
+#include "sp-symbol.h"
+#include "sp-use.h"
 #include "xml/quote.h"
 #include "preferences.h"
 #include "io/sys.h"
@@ -118,7 +122,6 @@ SPImage::SPImage() : SPItem(), SPViewBox() {
 
     this->href = nullptr;
     this->color_profile = nullptr;
-    this->pixbuf = nullptr;
 }
 
 SPImage::~SPImage() = default;
@@ -150,8 +153,9 @@ void SPImage::release() {
         this->href = nullptr;
     }
 
-    delete this->pixbuf;
-    this->pixbuf = nullptr;
+    this->pixbuf.reset();
+    _decoding_connection.disconnect();
+    _decoding = {};
 
     if (this->color_profile) {
         g_free (this->color_profile);
@@ -317,37 +321,35 @@ void SPImage::update(SPCtx *ctx, unsigned int flags) {
 
     SPItem::update(ctx, flags);
     if (flags & SP_IMAGE_HREF_MODIFIED_FLAG) {
-        delete this->pixbuf;
-        this->pixbuf = nullptr;
+        this->pixbuf.reset();
+        _decoding_connection.disconnect();
+        _decoding = {};
         if (this->href) {
-            Inkscape::Pixbuf *pixbuf = nullptr;
             double svgdpi = 96;
             if (this->getRepr()->attribute("inkscape:svg-dpi")) {
                 svgdpi = g_ascii_strtod(this->getRepr()->attribute("inkscape:svg-dpi"), nullptr);
             }
             this->dpi = svgdpi;
-            pixbuf = readImage(this->getRepr()->attribute("xlink:href"),
-                               this->getRepr()->attribute("sodipodi:absref"),
-                               doc->getDocumentBase(), svgdpi);
-            if (!pixbuf) {
-                // Passing in our previous size allows us to preserve the image's expected size.
-                auto broken_width = width._set ? width.computed : 640;
-                auto broken_height = height._set ? height.computed : 640;
-                pixbuf = getBrokenImage(broken_width, broken_height); 
-            }
-
-            if (pixbuf) {
-                if ( this->color_profile ) apply_profile( pixbuf );
-                this->pixbuf = pixbuf;
+            if (!startDecoding(this->getRepr()->attribute("xlink:href"), doc->getDocumentBase(), svgdpi)) {
+                setPixbuf(readImage(this->getRepr()->attribute("xlink:href"),
+                                    this->getRepr()->attribute("sodipodi:absref"),
+                                    doc->getDocumentBase(), svgdpi));
             }
         }
     }
+    if (_decoding && _decoding.ready()) {
+        takeDecoded();
+    }
 
     SPItemCtx *ictx = (SPItemCtx *) ctx;
 
     // Why continue without a pixbuf? So we can display "Missing Image" png.
     // Eventually, we should properly support SVG image type (i.e. render it ourselves).
-    if (this->pixbuf) {
+    // While the image is decoded, it is laid out with the size read from its header.
+    bool const has_size = this->pixbuf || _decoding;
+    int const image_width = this->pixbuf ? this->pixbuf->width() : _decoding_width;
+    int const image_height = this->pixbuf ? this->pixbuf->height() : _decoding_height;
+    if (has_size) {
         if (!this->x._set) {
             this->x.unit = SVGLength::PX;
             this->x.computed = 0;
@@ -360,12 +362,12 @@ void SPImage::update(SPCtx *ctx, unsigned int flags) {
 
         if (!this->width._set) {
             this->width.unit = SVGLength::PX;
-            this->width.computed = this->pixbuf->width();
+            this->width.computed = image_width;
         }
 
         if (!this->height._set) {
             this->height.unit = SVGLength::PX;
-            this->height.computed = this->pixbuf->height();
+            this->height.computed = image_height;
         }
     }
 
@@ -381,10 +383,10 @@ void SPImage::update(SPCtx *ctx, unsigned int flags) {
     this->ox = this->x.computed;
     this->oy = this->y.computed;
 
-    if (this->pixbuf) {
+    if (has_size) {
 
         // Viewbox is either from SVG (not supported) or dimensions of pixbuf (PNG, JPG)
-        this->viewBox = Geom::Rect::from_xywh(0, 0, this->pixbuf->width(), this->pixbuf->height()); 
+        this->viewBox = Geom::Rect::from_xywh(0, 0, image_width, image_height);
         this->viewBox_set = true;
 
         // SPItemCtx rctx =
@@ -529,17 +531,18 @@ gchar* SPImage::description() const {
         href_desc = g_strdup("(null_pointer)"); // we call g_free() on href_desc
     }
 
-    char *ret = ( this->pixbuf == nullptr
+    bool const has_size = this->pixbuf || _decoding;
+    char *ret = ( !has_size
                   ? g_strdup_printf(_("[bad reference]: %s"), href_desc)
                   : g_strdup_printf(_("%d &#215; %d: %s"),
-                                    this->pixbuf->width(),
-                                    this->pixbuf->height(),
+                                    this->pixbuf ? this->pixbuf->width() : _decoding_width,
+                                    this->pixbuf ? this->pixbuf->height() : _decoding_height,
                                     href_desc) );
                                     
-    if (this->pixbuf == nullptr && 
+    if (!has_size &&
         this->document) 
     {
-        Inkscape::Pixbuf * pb = nullptr;
+        std::shared_ptr<Inkscape::Pixbuf> pb;
         double svgdpi = 96;
         if (this->getRepr()->attribute("inkscape:svg-dpi")) {
             svgdpi = g_ascii_strtod(this->getRepr()->attribute("inkscape:svg-dpi"), nullptr);
@@ -553,7 +556,6 @@ gchar* SPImage::description() const {
                                         pb->width(),
                                         pb->height(),
                                         href_desc);
-            delete pb;
         } else {
             ret = g_strdup(_("{Broken Image}"));
         }
@@ -572,9 +574,14 @@ Inkscape::DrawingItem* SPImage::show(Inkscape::Drawing &drawing, unsigned int /*
 }
 
 
-Inkscape::Pixbuf *SPImage::readImage(gchar const *href, gchar const *absref, gchar const *base, double svgdpi)
+/**
+ * Decode an image, or share it with the other image elements showing the same data URI or
+ * unchanged file.
+ */
+std::shared_ptr<Inkscape::Pixbuf> SPImage::readImage(gchar const *href, gchar const *absref, gchar const *base, double svgdpi)
 {
-    Inkscape::Pixbuf *inkpb = nullptr;
+    auto &cache = Inkscape::ImageCache::get();
+    std::shared_ptr<Inkscape::Pixbuf> inkpb;
 
     gchar const *filename = href;
     
@@ -582,17 +589,21 @@ Inkscape::Pixbuf *SPImage::readImage(gchar const *href, gchar const *absref, gch
         if (g_ascii_strncasecmp(filename, "data:", 5) == 0) {
             /* data URI - embedded image */
             filename += 5;
-            inkpb = Inkscape::Pixbuf::create_from_data_uri(filename, svgdpi);
+            inkpb = cache.pixbuf(Inkscape::ImageCache::data_uri_key(filename, svgdpi), [=] {
+                return Inkscape::Pixbuf::create_from_data_uri(filename, svgdpi);
+            });
         } else {
             auto url = Inkscape::URI::from_href_and_basedir(href, base);
 
             if (url.hasScheme("file")) {
                 auto native = url.toNativeFilename();
-                inkpb = Inkscape::Pixbuf::create_from_file(native.c_str(), svgdpi);
+                inkpb = cache.pixbuf(Inkscape::ImageCache::file_key(native, svgdpi), [&] {
+                    return Inkscape::Pixbuf::create_from_file(native.c_str(), svgdpi);
+                });
             } else {
                 try {
                     auto contents = url.getContents();
-                    inkpb = Inkscape::Pixbuf::create_from_buffer(contents, svgdpi);
+                    inkpb.reset(Inkscape::Pixbuf::create_from_buffer(contents, svgdpi));
                 } catch (const Gio::Error &e) {
                     g_warning("URI::getContents failed for '%.100s'", href);
                 }
@@ -614,7 +625,9 @@ Inkscape::Pixbuf *SPImage::readImage(gchar const *href, gchar const *absref, gch
             g_warning ("xlink:href did not resolve to a valid image file, now trying sodipodi:absref=\"%s\"", absref);
         }
 
-        inkpb = Inkscape::Pixbuf::create_from_file(filename, svgdpi);
+        inkpb = cache.pixbuf(Inkscape::ImageCache::file_key(filename, svgdpi), [=] {
+            return Inkscape::Pixbuf::create_from_file(filename, svgdpi);
+        });
         if (inkpb != nullptr) {
             return inkpb;
         }
@@ -622,6 +635,140 @@ Inkscape::Pixbuf *SPImage::readImage(gchar const *href, gchar const *absref, gch
     return inkpb;
 }
 
+/**
+ * Decode a raster image on a worker thread, unless it is decoded or being decoded already.
+ *
+ * @return False if the image has to be read with readImage(), e.g. because it is an SVG image,
+ *         which is rendered with a document, or its size cannot be read from its header.
+ */
+bool SPImage::startDecoding(gchar const *href, gchar const *base, double svgdpi)
+{
+    if (!href) {
+        return false;
+    }
+    auto &cache = Inkscape::ImageCache::get();
+    int width = 0;
+    int height = 0;
+    if (g_ascii_strncasecmp(href, "data:", 5) == 0) {
+        gchar const *data = href + 5;
+        if (!Inkscape::Pixbuf::size_from_data_uri(data, width, height)) {
+            return false;
+        }
+        // The attribute may change while the worker reads it.
+        _decoding = cache.pixbuf_async(Inkscape::ImageCache::data_uri_key(data, svgdpi),
+                                       [data = std::string(data), svgdpi] {
+            return Inkscape::Pixbuf::create_from_data_uri(data.c_str(), svgdpi);
+        });
+    } else {
+        auto url = Inkscape::URI::from_href_and_basedir(href, base);
+        if (!url.hasScheme("file")) {
+            return false;
+        }
+        auto native = url.toNativeFilename();
+        auto key = Inkscape::ImageCache::file_key(native, svgdpi);
+        if (key.empty() || !Inkscape::Pixbuf::size_from_file(native, width, height)) {
+            return false;
+        }
+        _decoding = cache.pixbuf_async(key, [native, svgdpi] {
+            return Inkscape::Pixbuf::create_from_file(native, svgdpi);
+        });
+    }
+
+    _decoding_width = width;
+    _decoding_height = height;
+    _decoding_connection = _decoding.connectReady([this] {
+        requestDisplayUpdate(SP_OBJECT_MODIFIED_FLAG);
+    });
+    return true;
+}
+
+/// Show the image decoded on a worker thread, waiting for it if needed.
+void SPImage::takeDecoded()
+{
+    auto decoded = _decoding.get();
+    _decoding_connection.disconnect();
+    _decoding = {};
+    setPixbuf(std::move(decoded));
+}
+
+void SPImage::finishDecoding()
+{
+    if (_decoding) {
+        takeDecoded();
+        requestDisplayUpdate(SP_OBJECT_MODIFIED_FLAG);
+    }
+}
+
+/// Show a pixbuf, or the broken image if it could not be read.
+void SPImage::setPixbuf(std::shared_ptr<Inkscape::Pixbuf> pixbuf)
+{
+    if (!pixbuf) {
+        // Passing in our previous size allows us to preserve the image's expected size.
+        auto broken_width = width._set ? width.computed : 640;
+        auto broken_height = height._set ? height.computed : 640;
+        pixbuf.reset(getBrokenImage(broken_width, broken_height));
+    }
+
+    if (pixbuf) {
+        if ( this->color_profile ) {
+            // Other images may share the pixels; apply the profile to a copy.
+            pixbuf = std::make_shared<Inkscape::Pixbuf>(*pixbuf);
+            apply_profile(pixbuf.get());
+        }
+        this->pixbuf = std::move(pixbuf);
+    }
+}
+
+/// Collect the images being decoded, including the clones shown by <use> elements, which are not
+/// registered as resources of the document.
+static void sp_image_collect_decoding(SPObject *object, std::vector<SPImage *> &images)
+{
+    if (auto image = dynamic_cast<SPImage *>(object)) {
+        if (image->isDecoding()) {
+            images.push_back(image);
+        }
+    }
+    for (auto &child : object->children) {
+        sp_image_collect_decoding(&child, images);
+    }
+    if (auto use = dynamic_cast<SPUse *>(object)) {
+        if (use->child) {
+            sp_image_collect_decoding(use->child, images);
+        }
+    }
+}
+
+void sp_image_finish_decoding(SPDocument *document, Geom::OptRect const &area)
+{
+    if (!document->getRoot()) {
+        return;
+    }
+    std::vector<SPImage *> images;
+    sp_image_collect_decoding(document->getRoot(), images);
+
+    bool finished = false;
+    for (auto image : images) {
+        if (area) {
+            // Images in patterns, markers, masks and the like are shown elsewhere than their
+            // bounding box; always wait for them. The clone of a symbol is shown in place.
+            bool shown_in_place = true;
+            for (auto parent = image->parent; parent && shown_in_place; parent = parent->parent) {
+                shown_in_place = dynamic_cast<SPItem *>(parent) && !dynamic_cast<SPMarker *>(parent) &&
+                                 !(dynamic_cast<SPSymbol *>(parent) && !parent->cloned);
+            }
+            auto bbox = image->documentVisualBounds();
+            if (shown_in_place && !(bbox && area->intersects(*bbox))) {
+                continue;
+            }
+        }
+        image->finishDecoding();
+        finished = true;
+    }
+    if (finished) {
+        document->ensureUpToDate();
+    }
+}
+
 static std::string broken_image_svg = R"A(
 <svg xmlns:xlink="http://www.w3.org/1999/xlink" xmlns="http://www.w3.org/2000/svg" width="{width}" height="{height}">
   <defs>
@@ -664,7 +811,8 @@ static void
 sp_image_update_arenaitem (SPImage *image, Inkscape::DrawingImage *ai)
 {
     ai->setStyle(image->style);
-    ai->setPixbuf(image->pixbuf);
+    ai->setPixbuf(image->pixbuf.get());
+    ai->setPlaceholder(image->isDecoding());
     ai->setOrigin(Geom::Point(image->ox, image->oy));
     ai->setScale(image->sx, image->sy);
     ai->setClipbox(image->clipbox);
@@ -20,6 +20,7 @@
 #endif
 
 #include <glibmm/ustring.h>
+#include "display/image-cache.h"
 #include "svg/svg-length.h"
 #include "sp-item.h"
 #include "viewbox.h"
@@ -48,7 +49,7 @@ public:
     char *href;
     char *color_profile;
 
-    Inkscape::Pixbuf *pixbuf;
+    std::shared_ptr<Inkscape::Pixbuf> pixbuf; ///< may be shared with other images of the same content
 
     void build(SPDocument *document, Inkscape::XML::Node *repr) override;
     void release() override;
@@ -70,15 +71,36 @@ public:
 
     std::unique_ptr<SPCurve> get_curve() const;
     void refresh_if_outdated();
+
+    /// Whether the image is being decoded on a worker thread; a placeholder is shown meanwhile.
+    bool isDecoding() const { return bool(_decoding); }
+    /// Wait until the image is decoded, e.g. before it is exported.
+    void finishDecoding();
+
 private:
-    static Inkscape::Pixbuf *readImage(gchar const *href, gchar const *absref, gchar const *base, double svgdpi = 0);
+    static std::shared_ptr<Inkscape::Pixbuf> readImage(gchar const *href, gchar const *absref, gchar const *base, double svgdpi = 0);
     static Inkscape::Pixbuf *getBrokenImage(double width, double height);
+    bool startDecoding(gchar const *href, gchar const *base, double svgdpi);
+    void takeDecoded();
+    void setPixbuf(std::shared_ptr<Inkscape::Pixbuf> pixbuf);
+
+    Inkscape::ImageCache::Pending _decoding;
+    sigc::connection _decoding_connection;
+    int _decoding_width = 0;  ///< size of the image being decoded, read from its header
+    int _decoding_height = 0;
 };
 
 /* Return duplicate of curve or NULL */
 void sp_embed_image(Inkscape::XML::Node *imgnode, Inkscape::Pixbuf *pb);
 void sp_embed_svg(Inkscape::XML::Node *image_node, std::string const &fn);
 
+/**
+ * Wait for the images of a document being decoded to be ready, and update the document. With an
+ * area in document coordinates, only wait for the images which may be visible in it. The clones
+ * of images shown by <use> elements are waited for too.
+ */
+void sp_image_finish_decoding(SPDocument *document, Geom::OptRect const &area = Geom::OptRect());
+
 MAKE_SP_OBJECT_DOWNCAST_FUNCTIONS(SP_IMAGE, SPImage)
 MAKE_SP_OBJECT_TYPECHECK_FUNCTIONS(SP_IS_IMAGE, SPImage)
 
@@ -11,7 +11,14 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#ifdef HAVE_CONFIG_H
+# include "config.h"  // only include where actually required!
+#endif
+
 #include <vector>
+#if HAVE_OPENMP
+#include <omp.h>
+#endif
 
 #include <glibmm/i18n.h>
 #include <2geom/intersection-graph.h>
@@ -23,6 +30,7 @@
 
 #include "message-stack.h"
 #include "path-chemistry.h"     // copy_object_properties()
+#include "preferences.h"
 
 #include "helper/geom.h"        // pathv_to_linear_and_cubic_beziers()
 
@@ -414,6 +422,130 @@ static void transformLivarotPath(Path *res, Geom::Affine const &affine)
     res->LoadPathVector(res->MakePathVector() * affine);
 }
 
+/**
+ * Combine two shapes with a boolean operation, deleting them and returning the result.
+ *
+ * Due to quantization of the input shape coordinates, we may end up with A or B being empty.
+ * If this is a union or symdiff operation, we just use the non-empty shape as the result:
+ *   A=0  =>  (0 or B) == B
+ *   B=0  =>  (A or 0) == A
+ *   A=0  =>  (0 xor B) == B
+ *   B=0  =>  (A xor 0) == A
+ * If this is an intersection operation, we just use the empty shape as the result:
+ *   A=0  =>  (0 and B) == 0 == A
+ *   B=0  =>  (A and 0) == 0 == B
+ */
+static Shape *boolop_combine(Shape *a, Shape *b, bool_op bop)
+{
+    bool zeroA = a->numberOfEdges() == 0;
+    bool zeroB = b->numberOfEdges() == 0;
+    if (zeroA || zeroB) {
+        bool resultIsB = ((bop == bool_op_union || bop == bool_op_symdiff) && zeroA)
+                         || (bop == bool_op_inters && zeroB);
+        if (resultIsB) {
+            std::swap(a, b);
+        }
+        delete b;
+        return a;
+    }
+
+    Shape *result = new Shape;
+    // les elements arrivent en ordre inverse dans la liste
+    result->Booleen(b, a, bop);
+    delete a;
+    delete b;
+    return result;
+}
+
+/**
+ * Combine the livarot paths of several items with union, intersection or symmetric difference.
+ *
+ * These operations are associative, so instead of folding the paths into a result that grows
+ * with every step, and is swept again each time, the paths are reduced pairwise in a balanced
+ * tree: every path takes part in log2(n) operations on shapes of similar size. The conversion of
+ * the paths to shapes and the operations of each level of the tree run concurrently.
+ *
+ * Each path is filled with its index as path ID, so the result can be converted back with
+ * ConvertToForme(), just like the result of the sequential fold.
+ *
+ * @param originaux The paths, converted to polylines with back data.
+ * @param origWind The fill rule of each path.
+ * @param thresholds The conversion threshold of each path.
+ */
+static Shape *boolop_reduce(std::vector<Path *> const &originaux, std::vector<FillRule> const &origWind,
+                            std::vector<double> const &thresholds, bool_op bop)
+{
+    int const count = originaux.size();
+#if HAVE_OPENMP
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    int const num_threads = prefs->getIntLimited("/options/threading/numthreads", omp_get_num_procs(), 1, 256);
+#endif
+
+    std::vector<Shape *> shapes(count);
+    #if HAVE_OPENMP
+    #pragma omp parallel for num_threads(num_threads) schedule(dynamic, 1) if (num_threads > 1 && count > 1)
+    #endif
+    for (int i = 0; i < count; ++i) {
+        originaux[i]->ConvertWithBackData(thresholds[i]);
+        Shape filled;
+        originaux[i]->Fill(&filled, i);
+        shapes[i] = new Shape;
+        shapes[i]->ConvertToShape(&filled, origWind[i]);
+    }
+
+    while (shapes.size() > 1) {
+        int const pairs = shapes.size() / 2;
+        std::vector<Shape *> combined((shapes.size() + 1) / 2);
+        #if HAVE_OPENMP
+        #pragma omp parallel for num_threads(num_threads) schedule(dynamic, 1) if (num_threads > 1 && pairs > 1)
+        #endif
+        for (int i = 0; i < pairs; ++i) {
+            combined[i] = boolop_combine(shapes[2 * i], shapes[2 * i + 1], bop);
+        }
+        if (shapes.size() % 2) {
+            combined.back() = shapes.back();
+        }
+        shapes.swap(combined);
+    }
+    return shapes.front();
+}
+
+// boolean operations on any number of PathVectors -> PathVector result, using livarot.
+// bop must be bool_op_union, bool_op_inters or bool_op_symdiff; fill_rules has an entry per path.
+Geom::PathVector
+sp_pathvector_boolop(std::vector<Geom::PathVector> const &pathvs, std::vector<FillRule> const &fill_rules, bool_op bop)
+{
+    g_assert(bop == bool_op_union || bop == bool_op_inters || bop == bool_op_symdiff);
+    g_assert(pathvs.size() == fill_rules.size());
+    if (pathvs.empty()) {
+        return Geom::PathVector();
+    }
+
+    int const nbOriginaux = pathvs.size();
+    std::vector<Path *> originaux(nbOriginaux);
+    std::vector<double> thresholds(nbOriginaux);
+    for (int i = 0; i < nbOriginaux; i++) {
+        // Livarot's outline of arcs is broken. So convert the path to linear and cubics only.
+        originaux[i] = Path_for_pathvector(pathv_to_linear_and_cubic_beziers(pathvs[i]));
+        thresholds[i] = get_threshold(pathvs[i], 0.1);
+    }
+
+    Shape *theShape = boolop_reduce(originaux, fill_rules, thresholds, bop);
+    Path *res = new Path;
+    res->SetBackData(false);
+    theShape->ConvertToForme(res, nbOriginaux, &originaux[0]);
+
+    delete theShape;
+    for (int i = 0; i < nbOriginaux; i++)  delete originaux[i];
+
+    gchar *result_str = res->svg_dump_path();
+    Geom::PathVector outres =  Geom::parse_svg_path(result_str);
+    g_free(result_str);
+
+    delete res;
+    return outres;
+}
+
 // boolean operations on the desktop
 // take the source paths from the file, do the operation, delete the originals and add the results
 BoolOpErrors Inkscape::ObjectSet::pathBoolOp(bool_op bop, const bool skip_undo, const bool checked,
@@ -598,7 +730,17 @@ BoolOpErrors Inkscape::ObjectSet::pathBoolOp(bool_op bop, const bool skip_undo,
     Path::cut_position  *toCut=nullptr;
     int                  nbToCut=0;
 
-    if ( bop == bool_op_inters || bop == bool_op_union || bop == bool_op_diff || bop == bool_op_symdiff ) {
+    if ( bop == bool_op_inters || bop == bool_op_union || bop == bool_op_symdiff ) {
+        // true boolean op, combining any number of paths
+        std::vector<double> thresholds;
+        thresholds.reserve(nbOriginaux);
+        for (auto item : il) {
+            thresholds.push_back(get_threshold(item, 0.1));
+        }
+        delete theShape;
+        theShape = boolop_reduce(originaux, origWind, thresholds, bop);
+
+    } else if ( bop == bool_op_diff ) {
         // true boolean op
         // get the polygons of each path, with the winding rule specified, and apply the operation iteratively
         originaux[0]->ConvertWithBackData(get_threshold(il[0], 0.1));
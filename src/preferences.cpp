@@ -353,9 +353,7 @@ std::vector<Glib::ustring> Preferences::getAllDirs(Glib::ustring const &path)
 
 Preferences::Entry const Preferences::getEntry(Glib::ustring const &pref_path)
 {
-    gchar const *v;
-    _getRawValue(pref_path, v);
-    return Entry(pref_path, v);
+    return Entry(pref_path, _getRawValue(pref_path));
 }
 
 // setter methods
@@ -476,8 +474,11 @@ void Preferences::mergeStyle(Glib::ustring const &pref_path, SPCSSAttr *style)
  */
 void Preferences::remove(Glib::ustring const &pref_path)
 {
-    auto it = cachedRawValue.find(pref_path.c_str());
-    if (it != cachedRawValue.end()) cachedRawValue.erase(it);
+    {
+        std::lock_guard<std::mutex> lock(_cache_mutex);
+        auto it = cachedRawValue.find(pref_path.c_str());
+        if (it != cachedRawValue.end()) cachedRawValue.erase(it);
+    }
 
     Inkscape::XML::Node *node = _getNode(pref_path, false);
     if (node && node->parent()) {
@@ -711,21 +712,29 @@ Inkscape::XML::Node *Preferences::_getNode(Glib::ustring const &pref_key, bool c
     return node;
 }
 
-void Preferences::_getRawValue(Glib::ustring const &path, gchar const *&result)
+/**
+ * Get the raw value of a preference, or nothing if it is not set.
+ *
+ * The value is copied while the cache is locked, because preferences are also read from
+ * rendering threads while the main thread may change them.
+ */
+std::optional<std::string> Preferences::_getRawValue(Glib::ustring const &path)
 {
+    std::lock_guard<std::mutex> lock(_cache_mutex);
+
     // will return empty string if `path` was not in the cache yet
     auto& cacheref = cachedRawValue[path.c_str()];
 
     // check in cache first
     if (_initialized && !cacheref.empty()) {
         if (cacheref == RAWCACHE_CODE_NULL) {
-            result = nullptr;
-        } else {
-            result = cacheref.c_str() + RAWCACHE_CODE_VALUE.length();
+            return {};
         }
-        return;
+        return cacheref.raw().substr(RAWCACHE_CODE_VALUE.length());
     }
 
+    gchar const *result = nullptr;
+
     // create node and attribute keys
     Glib::ustring node_key, attr_key;
     _keySplit(path, node_key, attr_key);
@@ -749,6 +758,11 @@ void Preferences::_getRawValue(Glib::ustring const &path, gchar const *&result)
     } else {
         cacheref = RAWCACHE_CODE_NULL;
     }
+
+    if (!result) {
+        return {};
+    }
+    return std::string(result);
 }
 
 void Preferences::_setRawValue(Glib::ustring const &path, Glib::ustring const &value)
@@ -760,6 +774,7 @@ void Preferences::_setRawValue(Glib::ustring const &path, Glib::ustring const &v
     // update cache first, so by the time notification change fires and observers are called,
     // they have access to current settings even if they watch a group
     if (_initialized) {
+        std::lock_guard<std::mutex> lock(_cache_mutex);
         cachedRawValue[path.c_str()] = RAWCACHE_CODE_VALUE + value;
     }
 
@@ -775,7 +790,7 @@ bool Preferences::_extractBool(Entry const &v)
 {
     if (v.cached_bool) return v.value_bool;
     v.cached_bool = true;
-    gchar const *s = static_cast<gchar const *>(v._value);
+    gchar const *s = v._value->c_str();
     if ( !s[0] || !strcmp(s, "0") || !strcmp(s, "false") ) {
         return false;
     } else {
@@ -788,7 +803,7 @@ int Preferences::_extractInt(Entry const &v)
 {
     if (v.cached_int) return v.value_int;
     v.cached_int = true;
-    gchar const *s = static_cast<gchar const *>(v._value);
+    gchar const *s = v._value->c_str();
     if ( !strcmp(s, "true") ) {
         v.value_int = 1;
         return true;
@@ -821,7 +836,7 @@ unsigned int Preferences::_extractUInt(Entry const &v)
 {
     if (v.cached_uint) return v.value_uint;
     v.cached_uint = true;
-    gchar const *s = static_cast<gchar const *>(v._value);
+    gchar const *s = v._value->c_str();
 
     // Note: 'strtoul' can also read overflowed (i.e. negative) signed int values that we used to save before we
     //       had the unsigned type, so this is fully backwards compatible and can be replaced seamlessly
@@ -841,7 +856,7 @@ double Preferences::_extractDouble(Entry const &v)
 {
     if (v.cached_double) return v.value_double;
     v.cached_double = true;
-    gchar const *s = static_cast<gchar const *>(v._value);
+    gchar const *s = v._value->c_str();
     v.value_double = g_ascii_strtod(s, nullptr);
     return v.value_double;
 }
@@ -860,7 +875,7 @@ double Preferences::_extractDouble(Entry const &v, Glib::ustring const &requeste
 
 Glib::ustring Preferences::_extractString(Entry const &v)
 {
-    return Glib::ustring(static_cast<gchar const *>(v._value));
+    return Glib::ustring(v._value->c_str());
 }
 
 Glib::ustring Preferences::_extractUnit(Entry const &v)
@@ -868,7 +883,7 @@ Glib::ustring Preferences::_extractUnit(Entry const &v)
     if (v.cached_unit) return v.value_unit;
     v.cached_unit = true;
     v.value_unit = "";
-    gchar const *str = static_cast<gchar const *>(v._value);
+    gchar const *str = v._value->c_str();
     gchar const *e;
     g_ascii_strtod(str, (char **) &e);
     if (e == str) {
@@ -888,7 +903,7 @@ guint32 Preferences::_extractColor(Entry const &v)
 {
     if (v.cached_color) return v.value_color;
     v.cached_color = true;
-    gchar const *s = static_cast<gchar const *>(v._value);
+    gchar const *s = v._value->c_str();
     std::istringstream hr(s);
     guint32 color;
     if (s[0] == '#') {
@@ -906,7 +921,7 @@ SPCSSAttr *Preferences::_extractStyle(Entry const &v)
     if (v.cached_style) return v.value_style;
     v.cached_style = true;
     SPCSSAttr *style = sp_repr_css_attr_new();
-    sp_repr_css_attr_add_from_string(style, static_cast<gchar const*>(v._value));
+    sp_repr_css_attr_add_from_string(style, v._value->c_str());
     v.value_style = style;
     return style;
 }
@@ -19,6 +19,9 @@
 #include <glibmm/ustring.h>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -147,7 +150,7 @@ public:
          *
          * @return If false, the default value will be returned by the getters.
          */
-        bool isValid() const { return _value != nullptr; }
+        bool isValid() const { return _value.has_value(); }
 
         /**
          * Interpret the preference as a Boolean value.
@@ -253,10 +256,17 @@ public:
     private:
         Entry(Glib::ustring path, void const *v)
             : _pref_path(std::move(path))
-            , _value(v) {}
+        {
+            if (v) {
+                _value = static_cast<char const *>(v);
+            }
+        }
+        Entry(Glib::ustring path, std::optional<std::string> v)
+            : _pref_path(std::move(path))
+            , _value(std::move(v)) {}
 
         Glib::ustring _pref_path;
-        void const *_value = nullptr;
+        std::optional<std::string> _value; ///< a copy, since preferences may change while the entry is in use
 
         mutable bool value_bool = false;
         mutable int value_int = 0;
@@ -634,7 +644,7 @@ private:
     ~Preferences();
     void _loadDefaults();
     void _load();
-    void _getRawValue(Glib::ustring const &path, gchar const *&result);
+    std::optional<std::string> _getRawValue(Glib::ustring const &path);
     void _setRawValue(Glib::ustring const &path, Glib::ustring const &value);
     void _reportError(Glib::ustring const &, Glib::ustring const &);
     void _keySplit(Glib::ustring const &pref_path, Glib::ustring &node_key, Glib::ustring &attr_key);
@@ -650,6 +660,7 @@ private:
     bool _hasError = false; ///< Indication that some error has occurred;
     bool _initialized = false; ///< Is this instance fully initialized? Caching should be avoided before.
     std::unordered_map<std::string, Glib::ustring> cachedRawValue;
+    std::mutex _cache_mutex; ///< Guards cachedRawValue; preferences are also read from rendering threads.
 
     /// Wrapper class for XML node observers
     class PrefNodeObserver;
@@ -10,6 +10,8 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <algorithm>
+
 #include "inkscape.h"
 #include "snap-preferences.h"
 
@@ -244,6 +246,14 @@ void Inkscape::SnapPreferences::clearTargetMask(int enabled)
     }
 }
 
+bool Inkscape::SnapPreferences::hasSameTargets(SnapPreferences const &other) const
+{
+    return std::equal(std::begin(_active_snap_targets), std::end(_active_snap_targets), std::begin(other._active_snap_targets)) &&
+           std::equal(std::begin(_active_mask_targets), std::end(_active_mask_targets), std::begin(other._active_mask_targets)) &&
+           std::equal(std::begin(_simple_snapping), std::end(_simple_snapping), std::begin(other._simple_snapping)) &&
+           _strict_snapping == other._strict_snapping;
+}
+
 bool Inkscape::SnapPreferences::isTargetSnappable(Inkscape::SnapTargetType const target) const
 {
     bool always_on = false;
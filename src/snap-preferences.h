@@ -61,6 +61,9 @@ public:
 
     void setTargetMask(Inkscape::SnapTargetType const target, int enabled = 1);
     void clearTargetMask(int enabled = -1);
+
+    /// True if both preferences snap to the same targets; tolerances and the global toggles are not compared.
+    bool hasSameTargets(SnapPreferences const &other) const;
 private:
 
     /**
@@ -0,0 +1,515 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Spatial index of the snap targets of a document.
+ *
+ * Authors:
+ *   see git history
+ *
+ * Copyright (C) 2022 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "snap-target-index.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "desktop.h"
+#include "display/curve.h"
+#include "document.h"
+#include "object-snapper.h"
+#include "preferences.h"
+#include "snap.h"
+#include "style.h"
+#include "text-editing.h"
+#include "live_effects/effect-enum.h"
+#include "object/sp-filter.h"
+#include "object/sp-flowtext.h"
+#include "object/sp-item-group.h"
+#include "object/sp-lpe-item.h"
+#include "object/sp-path.h"
+#include "object/sp-root.h"
+#include "object/sp-shape.h"
+#include "object/sp-text.h"
+#include "object/sp-use.h"
+
+namespace Inkscape {
+
+namespace {
+
+/**
+ * Whether an item is hidden from snapping while another such item is being snapped, to avoid
+ * self-snapping of boolean operation LPEs (see SnapManager::_findCandidates()).
+ */
+bool hides_boolop_snapping(SPObject const *object)
+{
+    auto item = dynamic_cast<SPItem const *>(object);
+    if (!item || !item->style) {
+        return false;
+    }
+    SPFilter const *filt = item->style->getFilter();
+    if (filt && filt->getId() && std::strcmp(filt->getId(), "selectable_hidder_filter") == 0) {
+        return true;
+    }
+    auto lpeitem = dynamic_cast<SPLPEItem const *>(item);
+    return lpeitem && lpeitem->hasPathEffectOfType(LivePathEffect::EffectType::BOOL_OP);
+}
+
+} // namespace
+
+SnapTargetIndex::SnapTargetIndex(SnapManager *snapmanager)
+    : _snapmanager(snapmanager)
+{
+}
+
+SnapTargetIndex::~SnapTargetIndex()
+{
+    _clear();
+}
+
+void SnapTargetIndex::update(std::vector<SPObject const *> const *objects_to_ignore)
+{
+    SPDesktop const *desktop = _snapmanager->getDesktop();
+    SPDocument *document = _snapmanager->getDocument();
+    bool const visual_bbox = !Preferences::get()->getBool("/tools/bounding_box", false);
+
+    if (!_built || desktop != _desktop || document != _document || !desktop || desktop->doc2dt() != _doc2dt ||
+        visual_bbox != _visual_bbox || !_snapmanager->snapprefs.hasSameTargets(_snapprefs)) {
+        _clear();
+        _desktop = desktop;
+        _document = document;
+        _visual_bbox = visual_bbox;
+        _snapprefs = _snapmanager->snapprefs;
+        if (desktop && document) {
+            _doc2dt = desktop->doc2dt();
+            _build();
+        }
+    }
+
+    _ignored.clear();
+    _ignored_hide_boolops = false;
+    if (objects_to_ignore) {
+        for (auto object : *objects_to_ignore) {
+            _ignored.insert(object);
+            if (!_ignored_hide_boolops && hides_boolop_snapping(object)) {
+                _ignored_hide_boolops = true;
+            }
+        }
+    }
+
+    // Collect the targets of the items modified since the last session. Ignored items, typically
+    // the ones being dragged, are modified all the time; leave them until they are snapped to again.
+    std::vector<SPItem *> dirty;
+    dirty.swap(_dirty);
+    for (auto item : dirty) {
+        Record *record = _records.find(item);
+        if (!record || !record->dirty) {
+            continue;
+        }
+        if (_isIgnored(item, item)) {
+            _dirty.push_back(item);
+            continue;
+        }
+        record->dirty = false;
+        _collect(item);
+    }
+}
+
+void SnapTargetIndex::findPoints(Geom::Rect const &area, SnapSourceType source, std::vector<SnapCandidatePoint> &points) const
+{
+    bool const nodes = _allowCategory(source, false);
+    bool const bbox = _allowCategory(source, true);
+    if (!nodes && !bbox) {
+        return;
+    }
+
+    // We should not snap a transformation center to any of the centers of the items in the
+    // current selection (see the comment in SelTrans::centerRequest())
+    auto const &rotation_source = _snapmanager->getRotationCenterSource();
+
+    _points.query(area, [&] (PointTarget const &target) {
+        if ((target.bbox ? bbox : nodes) && !_isIgnored(target.item, target.owner)) {
+            if (target.point.getTargetType() == SNAPTARGET_ROTATION_CENTER &&
+                std::find(rotation_source.begin(), rotation_source.end(), target.item) != rotation_source.end()) {
+                return;
+            }
+            points.push_back(target.point);
+        }
+    });
+}
+
+void SnapTargetIndex::findCurves(Geom::Rect const &area, SnapSourceType source, std::vector<CurveTarget> &curves) const
+{
+    bool const nodes = _allowCategory(source, false);
+    bool const bbox = _allowCategory(source, true);
+    if (!nodes && !bbox) {
+        return;
+    }
+
+    _segments.query(area, [&] (Segment const &segment) {
+        PathTarget const &target = _paths[segment.target];
+        if ((target.bbox ? bbox : nodes) && !_isIgnored(target.item, target.owner)) {
+            curves.push_back({&target, segment.path, segment.curve});
+        }
+    });
+}
+
+void SnapTargetIndex::findPaths(Geom::Rect const &area, SnapSourceType source, std::vector<PathTarget const *> &paths) const
+{
+    std::vector<CurveTarget> curves;
+    findCurves(area, source, curves);
+
+    std::vector<PathTarget const *> found;
+    found.reserve(curves.size());
+    for (auto const &curve : curves) {
+        found.push_back(curve.target);
+    }
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+    paths.insert(paths.end(), found.begin(), found.end());
+}
+
+void SnapTargetIndex::_clear()
+{
+    _records.for_each([] (SPObject *, Record const &record) {
+        // connections are shared handles, so disconnecting a copy disconnects the signal
+        sigc::connection(record.modified_connection).disconnect();
+        sigc::connection(record.release_connection).disconnect();
+    });
+    _records.clear();
+    _dirty.clear();
+    _points.clear();
+    _segments.clear();
+    _paths.clear();
+    _free_paths.clear();
+    _path_count = 0;
+    _built = false;
+}
+
+void SnapTargetIndex::_build()
+{
+    SPRoot *root = _document->getRoot();
+    if (root) {
+        _watch(root, root, true);
+        _collect(root);
+    }
+    _built = true;
+}
+
+SnapTargetIndex::Record &SnapTargetIndex::_watch(SPObject *object, SPItem *dependent, bool group)
+{
+    Record *record = _records.find(object);
+    if (!record) {
+        Record created;
+        created.group = group;
+        created.modified_connection = object->connectModified([this] (SPObject *object, unsigned flags) {
+            _objectModified(object, flags);
+        });
+        created.release_connection = object->connectRelease([this] (SPObject *object) {
+            _objectReleased(object);
+        });
+        _records.insert_or_assign(object, std::move(created));
+        record = _records.find(object);
+    }
+    if (std::find(record->dependents.begin(), record->dependents.end(), dependent) == record->dependents.end()) {
+        record->dependents.push_back(dependent);
+    }
+    return *record;
+}
+
+/**
+ * Collect the targets of an item of the document tree, the same way as SnapManager::_findCandidates()
+ * finds the items to snap to, and start watching its children if it is a group.
+ */
+void SnapTargetIndex::_collect(SPItem *item)
+{
+    bool const group = _records.find(item)->group;
+
+    if (group) {
+        for (auto &child : item->children) {
+            auto child_item = dynamic_cast<SPItem *>(&child);
+            if (child_item && !_records.contains(child_item)) {
+                _watch(child_item, child_item, dynamic_cast<SPGroup *>(child_item) != nullptr);
+                _collect(child_item);
+            }
+        }
+    }
+
+    // The root is not a snap candidate itself; nor are hidden items, unless they're a clipping
+    // path or a mask. Items in locked layers are snapped to.
+    if (item == _document->getRoot() || _desktop->itemIsHidden(item)) {
+        return;
+    }
+
+    // The item might be the subject of clipping or masking; if so, then we should also
+    // consider that path or mask for snapping to
+    if (SPObject *clip = item->getClipObject()) {
+        if (_snapprefs.isTargetSnappable(SNAPTARGET_PATH_CLIP)) {
+            _collectClipOrMask(clip, item, item->i2doc_affine());
+        }
+    }
+    if (SPObject *mask = item->getMaskObject()) {
+        if (_snapprefs.isTargetSnappable(SNAPTARGET_PATH_MASK)) {
+            _collectClipOrMask(mask, item, item->i2doc_affine());
+        }
+    }
+
+    if (!group) {
+        _addTargets(item, item, false, Geom::identity());
+    }
+}
+
+void SnapTargetIndex::_collectClipOrMask(SPObject *container, SPItem *owner, Geom::Affine const &additional_affine)
+{
+    _watch(container, owner, false);
+    for (auto &child : container->children) {
+        if (auto item = dynamic_cast<SPItem *>(&child)) {
+            _watch(item, owner, false);
+            if (dynamic_cast<SPGroup *>(item)) {
+                _collectClipOrMask(item, owner, additional_affine);
+            } else {
+                _addTargets(item, owner, true, additional_affine);
+            }
+        }
+    }
+}
+
+/**
+ * Add the nodes, paths and bounding box of an item; see ObjectSnapper::_collectNodes() and
+ * ObjectSnapper::_collectPaths() for the details.
+ */
+void SnapTargetIndex::_addTargets(SPItem *item, SPItem *owner, bool clip_or_mask, Geom::Affine const &additional_affine)
+{
+    SPItem::BBoxType const bbox_type = _visual_bbox ? SPItem::VISUAL_BBOX : SPItem::GEOMETRIC_BBOX;
+
+    Geom::OptRect bbox_of_item;
+    if (clip_or_mask) {
+        bbox_of_item = item->bounds(bbox_type, item->i2doc_affine() * additional_affine * _doc2dt);
+    } else {
+        bbox_of_item = item->desktopBounds(bbox_type);
+    }
+    if (!bbox_of_item) {
+        return;
+    }
+
+    Geom::Affine i2doc;
+    SPItem *root_item = item;
+    if (auto use = dynamic_cast<SPUse *>(item)) {
+        i2doc = use->get_root_transform();
+        root_item = use->root();
+    } else {
+        i2doc = item->i2doc_affine();
+    }
+    if (!root_item) {
+        return;
+    }
+
+    Record &record = *_records.find(owner);
+    auto add_point = [&] (SnapCandidatePoint const &point, bool bbox) {
+        PointTarget target;
+        target.point = point;
+        target.item = item;
+        target.owner = owner;
+        target.bbox = bbox;
+        record.points.push_back(_points.insert(Geom::Rect(point.getPoint(), point.getPoint()), target));
+    };
+    auto add_path = [&] (Geom::PathVector pathv, SnapTargetType type, Geom::OptRect target_bbox, bool bbox) {
+        PathTarget target;
+        target.path = SnapCandidatePath(std::make_shared<Geom::PathVector>(std::move(pathv)), type, target_bbox);
+        target.item = item;
+        target.owner = owner;
+        target.bbox = bbox;
+        _addPath(record, std::move(target));
+    };
+
+    // Nodes. Intersections are found both by getSnappoints(), for each shape individually, and by
+    // findBestSnap(), for the curves that have been snapped to. When snapping to paths we leave
+    // them to findBestSnap(), because we don't want duplicate targets.
+    std::vector<SnapCandidatePoint> points;
+    SnapPreferences prefs = _snapprefs;
+    if (prefs.isTargetSnappable(SNAPTARGET_PATH)) {
+        prefs.setTargetSnappable(SNAPTARGET_PATH_INTERSECTION, false);
+    }
+    root_item->getSnappoints(points, &prefs);
+    for (auto const &point : points) {
+        add_point(point, false);
+    }
+
+    // Discard the bbox of a clipped path / mask, because we don't want to snap to both the bbox
+    // of the item AND the bbox of the clipping path at the same time
+    if (!clip_or_mask) {
+        points.clear();
+        getBBoxPoints(root_item->desktopBounds(bbox_type), &points, true,
+                      _snapprefs.isTargetSnappable(SNAPTARGET_BBOX_CORNER),
+                      _snapprefs.isTargetSnappable(SNAPTARGET_BBOX_EDGE_MIDPOINT),
+                      _snapprefs.isTargetSnappable(SNAPTARGET_BBOX_MIDPOINT));
+        for (auto const &point : points) {
+            add_point(point, true);
+        }
+    }
+
+    Geom::Affine const i2doc_full = root_item->i2dt_affine() * additional_affine * _doc2dt;
+    if (dynamic_cast<SPText *>(root_item) || dynamic_cast<SPFlowtext *>(root_item)) {
+        if (_snapprefs.isTargetSnappable(SNAPTARGET_TEXT_BASELINE)) {
+            Text::Layout const *layout = te_get_layout(root_item);
+            if (layout != nullptr && layout->outputExists()) {
+                add_path(Geom::PathVector(layout->baseline() * i2doc_full), SNAPTARGET_TEXT_BASELINE, Geom::OptRect(), false);
+            }
+        }
+    } else if (_snapprefs.isTargetSnappable(SNAPTARGET_PATH, SNAPTARGET_PATH_INTERSECTION)) {
+        // Snapping for example to a traced bitmap is very stressing for
+        // the CPU, so we'll only snap to paths having no more than 500 nodes
+        auto path = dynamic_cast<SPPath *>(root_item);
+        bool const very_complex_path = path && path->nodesInPath() > 500;
+        auto shape = dynamic_cast<SPShape *>(root_item);
+        if (!very_complex_path && shape && shape->curve()) {
+            add_path(shape->curve()->get_pathvector() * i2doc_full, SNAPTARGET_PATH, Geom::OptRect(), false);
+        }
+    }
+
+    if (!clip_or_mask && _snapprefs.isTargetSnappable(SNAPTARGET_BBOX_EDGE)) {
+        if (Geom::OptRect rect = root_item->bounds(bbox_type, i2doc)) {
+            auto const border_curve = SPCurve::new_from_rect(*rect, true);
+            add_path(border_curve->get_pathvector(), SNAPTARGET_BBOX_EDGE, root_item->desktopBounds(bbox_type), true);
+        }
+    }
+}
+
+void SnapTargetIndex::_addPath(Record &record, PathTarget target)
+{
+    int index;
+    if (_free_paths.empty()) {
+        index = _paths.size();
+        _paths.emplace_back();
+    } else {
+        index = _free_paths.back();
+        _free_paths.pop_back();
+    }
+
+    Geom::PathVector const &pathv = *target.path.path_vector;
+    target.first_path = _path_count;
+    _path_count += pathv.size();
+    for (unsigned i = 0; i < pathv.size(); ++i) {
+        for (unsigned j = 0; j < pathv[i].size_default(); ++j) {
+            Segment segment;
+            segment.target = index;
+            segment.path = i;
+            segment.curve = j;
+            target.segments.push_back(_segments.insert(pathv[i][j].boundsFast(), segment));
+        }
+    }
+
+    _paths[index] = std::move(target);
+    record.paths.push_back(index);
+}
+
+void SnapTargetIndex::_removeTargets(Record &record)
+{
+    for (auto handle : record.points) {
+        _points.remove(handle);
+    }
+    for (auto index : record.paths) {
+        for (auto handle : _paths[index].segments) {
+            _segments.remove(handle);
+        }
+        _paths[index] = PathTarget();
+        _free_paths.push_back(index);
+    }
+    record.points.clear();
+    record.paths.clear();
+}
+
+void SnapTargetIndex::_invalidate(SPItem *item)
+{
+    Record *record = _records.find(item);
+    if (!record || record->dirty) {
+        return;
+    }
+    _removeTargets(*record);
+    record->dirty = true;
+    _dirty.push_back(item);
+}
+
+void SnapTargetIndex::_objectModified(SPObject *object, unsigned flags)
+{
+    Record *record = _records.find(object);
+    if (!record) {
+        return;
+    }
+    // Changes below a group are handled by the records of its children
+    if (record->group && !(flags & ~SP_OBJECT_CHILD_MODIFIED_FLAG)) {
+        return;
+    }
+    auto const dependents = record->dependents;
+    for (auto item : dependents) {
+        _invalidate(item);
+    }
+}
+
+void SnapTargetIndex::_objectReleased(SPObject *object)
+{
+    Record *record = _records.find(object);
+    if (!record) {
+        return;
+    }
+    auto const dependents = record->dependents;
+    _removeTargets(*record);
+    record->modified_connection.disconnect();
+    record->release_connection.disconnect();
+    _records.erase(object);
+
+    for (auto item : dependents) {
+        if (item != object) {
+            _invalidate(item);
+        }
+    }
+}
+
+/// Whether the item, the item it clips or masks, or one of their ancestors is to be ignored.
+bool SnapTargetIndex::_isIgnored(SPItem const *item, SPItem const *owner) const
+{
+    if (_ignored.empty()) {
+        return false;
+    }
+    for (SPItem const *start : {item, owner}) {
+        for (SPObject const *object = start; object; object = object->parent) {
+            if (_ignored.count(object) || (_ignored_hide_boolops && hides_boolop_snapping(object))) {
+                return true;
+            }
+        }
+        if (owner == item) {
+            break;
+        }
+    }
+    return false;
+}
+
+/**
+ * Whether a source may snap to the node and path targets, or to the bounding box targets.
+ * A point considered for snapping should be either a node, a bbox corner or a guide/other.
+ */
+bool SnapTargetIndex::_allowCategory(SnapSourceType source, bool bbox) const
+{
+    bool const p_is_a_node = source & SNAPSOURCE_NODE_CATEGORY;
+    bool const p_is_a_bbox = source & SNAPSOURCE_BBOX_CATEGORY;
+    bool const p_is_other = (source & SNAPSOURCE_OTHERS_CATEGORY) || (source & SNAPSOURCE_DATUMS_CATEGORY);
+    bool const strict = _snapprefs.getStrictSnapping();
+    if (bbox) {
+        return p_is_a_bbox || p_is_other || (p_is_a_node && !strict);
+    }
+    return p_is_a_node || p_is_other || (p_is_a_bbox && !strict);
+}
+
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
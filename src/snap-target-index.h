@@ -0,0 +1,177 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+#ifndef SEEN_SNAP_TARGET_INDEX_H
+#define SEEN_SNAP_TARGET_INDEX_H
+
+/**
+ * @file
+ * Spatial index of the nodes, bounding boxes and paths of a document that can be snapped to.
+ */
+/*
+ * Authors:
+ *   see git history
+ *
+ * Copyright (C) 2022 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include <unordered_set>
+#include <vector>
+#include <2geom/affine.h>
+#include <2geom/pathvector.h>
+#include <sigc++/connection.h>
+
+#include "snap-candidate.h"
+#include "snap-preferences.h"
+#include "util/aabb-tree.h"
+#include "util/flat-hash-map.h"
+
+class SnapManager;
+class SPDesktop;
+class SPDocument;
+class SPItem;
+class SPObject;
+
+namespace Inkscape {
+
+/**
+ * The snap targets of all the items of a document, kept between snap sessions.
+ *
+ * Node and bounding box points are stored in desktop coordinates, and the curves of paths,
+ * text baselines and bounding box edges in document coordinates, each in a bounding volume
+ * hierarchy, so that a snap query only visits the targets close to the snap source.
+ *
+ * The targets of an item are collected when the index is built and again after the item is
+ * modified; the index is rebuilt from scratch when the desktop, the document or the snap
+ * preferences change. Targets of the items that are ignored while snapping (e.g. the items being
+ * dragged) are only filtered out of the query results, so that the ignore list can change
+ * between snap sessions without invalidating anything.
+ */
+class SnapTargetIndex
+{
+public:
+    /// A path, baseline or bounding box edge of an item.
+    struct PathTarget
+    {
+        SnapCandidatePath path;
+        SPItem *item = nullptr;  ///< item whose geometry this is
+        SPItem *owner = nullptr; ///< item that is clipped or masked by item, or item itself
+        bool bbox = false;       ///< bounding box edge rather than geometry
+        int first_path = 0;      ///< unique number of the first path of the path vector
+        std::vector<int> segments;
+
+        PathTarget() : path(nullptr, SNAPTARGET_UNDEFINED, Geom::OptRect()) {}
+    };
+
+    /// A curve of a path target, near a snap source.
+    struct CurveTarget
+    {
+        PathTarget const *target;
+        unsigned path;  ///< index of the path in the path vector
+        unsigned curve; ///< index of the curve in the path
+    };
+
+    SnapTargetIndex(SnapManager *snapmanager);
+    ~SnapTargetIndex();
+
+    SnapTargetIndex(SnapTargetIndex const &) = delete;
+    SnapTargetIndex &operator=(SnapTargetIndex const &) = delete;
+
+    /**
+     * Prepare the index for a snap session: rebuild it if the snap preferences or the desktop
+     * have changed, and collect the targets of the items modified since the last session.
+     *
+     * @param objects_to_ignore Items not to snap to, together with their descendants.
+     */
+    void update(std::vector<SPObject const *> const *objects_to_ignore);
+
+    /// Append the points within the area (desktop coordinates) that a source of this type may snap to.
+    void findPoints(Geom::Rect const &area, SnapSourceType source, std::vector<SnapCandidatePoint> &points) const;
+
+    /// Append the curves whose bounds intersect the area (document coordinates).
+    void findCurves(Geom::Rect const &area, SnapSourceType source, std::vector<CurveTarget> &curves) const;
+
+    /// Append the path targets with a curve whose bounds intersect the area (document coordinates).
+    void findPaths(Geom::Rect const &area, SnapSourceType source, std::vector<PathTarget const *> &paths) const;
+
+private:
+    struct PointTarget
+    {
+        SnapCandidatePoint point;
+        SPItem *item = nullptr;
+        SPItem *owner = nullptr;
+        bool bbox = false;
+    };
+
+    struct Segment
+    {
+        int target = -1;
+        unsigned path = 0;
+        unsigned curve = 0;
+    };
+
+    /// An object whose modification invalidates the targets of some items.
+    struct Record
+    {
+        sigc::connection modified_connection;
+        sigc::connection release_connection;
+        std::vector<SPItem *> dependents; ///< items whose targets depend on this object
+        std::vector<int> points;          ///< targets collected for this item
+        std::vector<int> paths;
+        bool group = false; ///< a group of the document tree, whose children have their own records
+        bool dirty = false; ///< the targets have to be collected again
+    };
+
+    SnapManager *_snapmanager;
+
+    // The context the index has been built in
+    SPDesktop const *_desktop = nullptr;
+    SPDocument *_document = nullptr;
+    Geom::Affine _doc2dt;
+    bool _visual_bbox = false;
+    SnapPreferences _snapprefs;
+    bool _built = false;
+
+    Util::AABBTree<PointTarget> _points;
+    Util::AABBTree<Segment> _segments;
+    std::vector<PathTarget> _paths;
+    std::vector<int> _free_paths;
+    int _path_count = 0;
+
+    Util::FlatHashMap<SPObject *, Record> _records;
+    std::vector<SPItem *> _dirty;
+
+    std::unordered_set<SPObject const *> _ignored;
+    bool _ignored_hide_boolops = false;
+
+    void _clear();
+    void _build();
+    Record &_watch(SPObject *object, SPItem *dependent, bool group);
+    void _collect(SPItem *item);
+    void _collectClipOrMask(SPObject *container, SPItem *owner, Geom::Affine const &additional_affine);
+    void _addTargets(SPItem *item, SPItem *owner, bool clip_or_mask, Geom::Affine const &additional_affine);
+    void _addPath(Record &record, PathTarget target);
+    void _removeTargets(Record &record);
+    void _invalidate(SPItem *item);
+
+    void _objectModified(SPObject *object, unsigned flags);
+    void _objectReleased(SPObject *object);
+
+    bool _isIgnored(SPItem const *item, SPItem const *owner) const;
+    bool _allowCategory(SnapSourceType source, bool bbox) const;
+};
+
+} // namespace Inkscape
+
+#endif // SEEN_SNAP_TARGET_INDEX_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -66,13 +66,11 @@ SnapManager::SnapManager(SPNamedView const *v, Inkscape::SnapPreferences& prefer
     _snapindicator(true),
     _unselected_nodes(nullptr)
 {
-    obj_snapper_candidates = std::make_unique<std::vector<Inkscape::SnapCandidateItem>>();
     align_snapper_candidates = std::make_unique<std::vector<Inkscape::SnapCandidateItem>>();
 }
 
 SnapManager::~SnapManager()
 {
-    obj_snapper_candidates->clear();
     align_snapper_candidates->clear();
 }
 
@@ -832,7 +830,6 @@ SPPage const *SnapManager::getPageToIgnore() const
 void SnapManager::_findCandidates(SPObject* parent,
                                  std::vector<SPObject const *> const *it,
                                  bool const &first_point,
-                                 Geom::Rect const &bbox_to_snap,
                                  bool const clip_or_mask,
                                  Geom::Affine const additional_affine) const
 {
@@ -844,13 +841,9 @@ void SnapManager::_findCandidates(SPObject* parent,
     }
 
     if (first_point) {
-        obj_snapper_candidates->clear();
         align_snapper_candidates->clear();
     }
 
-    Geom::Rect bbox_to_snap_incl = bbox_to_snap; // _incl means: will include the snapper tolerance
-    bbox_to_snap_incl.expandBy(object.getSnapperTolerance()); // see?
-
     for (auto& o: parent->children) {
         SPItem *item = dynamic_cast<SPItem *>(&o);
         if (item && !(dt->itemIsHidden(item) && !clip_or_mask)) {
@@ -910,16 +903,16 @@ void SnapManager::_findCandidates(SPObject* parent,
                         // we should also consider that path or mask for snapping to
                         SPObject *obj = item->getClipObject();
                         if (obj && snapprefs.isTargetSnappable(Inkscape::SNAPTARGET_PATH_CLIP)) {
-                            _findCandidates(obj, it, false, bbox_to_snap, true, item->i2doc_affine());
+                            _findCandidates(obj, it, false, true, item->i2doc_affine());
                         }
                         obj = item->getMaskObject();
                         if (obj && snapprefs.isTargetSnappable(Inkscape::SNAPTARGET_PATH_MASK)) {
-                            _findCandidates(obj, it, false, bbox_to_snap, true, item->i2doc_affine());
+                            _findCandidates(obj, it, false, true, item->i2doc_affine());
                         }
                     }
 
                     if (dynamic_cast<SPGroup *>(item)) {
-                        _findCandidates(&o, it, false, bbox_to_snap, clip_or_mask, additional_affine);
+                        _findCandidates(&o, it, false, clip_or_mask, additional_affine);
                     } else {
                         Geom::OptRect bbox_of_item;
                         Inkscape::Preferences *prefs = Inkscape::Preferences::get();
@@ -947,15 +940,6 @@ void SnapManager::_findCandidates(SPObject* parent,
                                 // SPObject *obj = (SPObject*)item;
                                 // std::cout << "Snap candidate added: " << obj->getId() << std::endl;
 
-                                if (bbox_to_snap_incl.intersects(*bbox_of_item)
-                                        || (snapprefs.isTargetSnappable(Inkscape::SNAPTARGET_ROTATION_CENTER) && bbox_to_snap_incl.contains(item->getCenter()))) { // rotation center might be outside of the bounding box
-                                    // This item is within snapping range, so record it as a candidate
-                                    obj_snapper_candidates->push_back(Inkscape::SnapCandidateItem(item, clip_or_mask, additional_affine));
-                                    // For debugging: print the id of the candidate to the console
-                                    // SPObject *obj = (SPObject*)item;
-                                    // std::cout << "Snap candidate added: " << obj->getId() << std::endl;
-                                }
-
                                 if (align_snapper_candidates->size() > 200) { // This makes Inkscape crawl already
                                     overflow = true;
                                 }
@@ -1204,7 +1204,7 @@ SPIString::read( gchar const *str ) {
         }
 
         set = true;
-        _value = g_strdup(str);
+        _value = g_intern_string(str);
     }
 }
 
@@ -1252,7 +1252,6 @@ char const *SPIString::get_default_value() const
 void
 SPIString::clear() {
     SPIBase::clear();
-    g_free(_value);
     _value = nullptr;
 }
 
@@ -1260,8 +1259,7 @@ void
 SPIString::cascade( const SPIBase* const parent ) {
     if( const SPIString* p = dynamic_cast<const SPIString*>(parent) ) {
         if( inherits && (!set || inherit) ) {
-            g_free(_value);
-            _value = g_strdup(p->_value);
+            _value = p->_value;
         }
     } else {
         std::cerr << "SPIString::cascade(): Incorrect parent type" << std::endl;
@@ -1275,8 +1273,7 @@ SPIString::merge( const SPIBase* const parent ) {
             if( (!set || inherit) && p->set && !(p->inherit) ) {
                 set     = p->set;
                 inherit = p->inherit;
-                g_free(_value);
-                _value = g_strdup(p->_value);
+                _value = p->_value;
             }
         }
     }
@@ -1285,7 +1282,8 @@ SPIString::merge( const SPIBase* const parent ) {
 bool
 SPIString::operator==(const SPIBase& rhs) const {
     if( const SPIString* r = dynamic_cast<const SPIString*>(&rhs) ) {
-        return g_strcmp0(_value, r->_value) == 0 && SPIBase::operator==(rhs);
+        // Interned, so equal values are the same pointer.
+        return _value == r->_value && SPIBase::operator==(rhs);
     } else {
         return false;
     }
@@ -599,6 +599,8 @@ public:
 
 /// String type internal to SPStyle.
 // Used for 'marker', ..., 'font', 'font-family', 'inkscape-font-specification'
+// Values are interned: styles with the same value, e.g. all those inheriting one font family,
+// share a single copy of it, and cascading or copying a value does not allocate.
 class SPIString : public SPIBase
 {
 
@@ -609,9 +611,8 @@ public:
 
     SPIString(const SPIString &rhs) { *this = rhs; }
 
-    ~SPIString() override {
-        g_free(_value);
-    }
+    ~SPIString() override
+    = default;
 
     void read( gchar const *str ) override;
     const Glib::ustring get_value() const override;
@@ -624,8 +625,7 @@ public:
             return *this;
         }
         SPIBase::operator=(rhs);
-        g_free(_value);
-        _value = g_strdup(rhs._value);
+        _value = rhs._value;
         return *this;
     }
 
@@ -637,7 +637,7 @@ public:
   private:
     char const *get_default_value() const;
 
-    gchar *_value = nullptr;
+    char const *_value = nullptr; ///< From g_intern_string(); never freed
 };
 
 /// Shapes type internal to SPStyle.
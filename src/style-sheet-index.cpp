@@ -0,0 +1,278 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Index of the style sheet rules of a document by selector.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2022 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include "style-sheet-index.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+#include "xml/node.h"
+
+namespace Inkscape {
+
+namespace {
+
+char const *cr_str(CRString const *s)
+{
+    return s && s->stryng ? s->stryng->str : nullptr;
+}
+
+/// Same as cr_utils_is_white_space(), which libcroco uses to split the class attribute.
+bool is_white_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f';
+}
+
+/// Element name without namespace prefix, like libcroco sees it.
+char const *local_name(XML::Node const *node)
+{
+    char const *name = node->name();
+    char const *colon = name ? std::strrchr(name, ':') : nullptr;
+    return colon ? colon + 1 : name;
+}
+
+} // namespace
+
+StyleSheetIndex::StyleSheetIndex(CRCascade *cascade)
+{
+    if (!cascade) {
+        return;
+    }
+    for (int origin = ORIGIN_UA; origin < NB_ORIGINS; ++origin) {
+        for (auto sheet = cr_cascade_get_sheet(cascade, static_cast<CRStyleOrigin>(origin)); sheet; sheet = sheet->next) {
+            _addSheet(sheet);
+        }
+    }
+}
+
+/**
+ * Add the rule sets of a style sheet in the order cr_sel_eng_get_matched_rulesets() visits them,
+ * with imported sheets in place of their import rule.
+ *
+ * Matched @media rules never contribute properties in libcroco, so they are left out.
+ */
+void StyleSheetIndex::_addSheet(CRStyleSheet *sheet)
+{
+    for (auto statement = sheet->statements; statement; statement = statement->next) {
+        if (statement->type == RULESET_STMT && statement->kind.ruleset && statement->parent_sheet) {
+            for (auto sel = statement->kind.ruleset->sel_list; sel; sel = sel->next) {
+                if (sel->simple_sel) {
+                    _addRule(statement, sel->simple_sel);
+                }
+            }
+        } else if (statement->type == AT_IMPORT_RULE_STMT && statement->kind.import_rule &&
+                   statement->kind.import_rule->sheet) {
+            _addSheet(statement->kind.import_rule->sheet);
+        }
+    }
+}
+
+void StyleSheetIndex::_addRule(CRStatement *statement, CRSimpleSel *selector)
+{
+    // The right-most compound is the last one of the list.
+    CRSimpleSel *compound = selector;
+    while (compound->next) {
+        compound = compound->next;
+    }
+
+    cr_simple_sel_compute_specificity(selector);
+
+    Rule rule;
+    rule.statement = statement;
+    rule.selector = selector;
+    rule.specificity = selector->specificity;
+    rule.context_free = (compound == selector);
+
+    char const *id = nullptr;
+    char const *klass = nullptr;
+    for (auto add_sel = compound->add_sel; add_sel; add_sel = add_sel->next) {
+        if (add_sel->type == ID_ADD_SELECTOR) {
+            id = id ? id : cr_str(add_sel->content.id_name);
+        } else if (add_sel->type == CLASS_ADD_SELECTOR) {
+            klass = klass ? klass : cr_str(add_sel->content.class_name);
+        } else {
+            rule.context_free = false;
+        }
+    }
+    char const *name = nullptr;
+    if ((compound->type_mask & TYPE_SELECTOR) && !(compound->type_mask & UNIVERSAL_SELECTOR)) {
+        name = cr_str(compound->name);
+    }
+
+    unsigned const index = _rules.size();
+    _rules.push_back(rule);
+
+    auto add_to = [index] (Buckets &buckets, char const *key) {
+        if (auto bucket = buckets.find(std::string_view(key))) {
+            bucket->push_back(index);
+        } else {
+            buckets.insert_or_assign(key, std::vector<unsigned>{index});
+        }
+    };
+    if (id) {
+        add_to(_by_id, id);
+    } else if (klass) {
+        add_to(_by_class, klass);
+    } else if (name) {
+        add_to(_by_name, name);
+    } else {
+        _universal.push_back(index);
+    }
+}
+
+std::vector<CRDeclaration *> StyleSheetIndex::match(CRSelEng *sel_eng, XML::Node const *node)
+{
+    if (_rules.empty() || !node || node->type() != XML::NodeType::ELEMENT_NODE) {
+        return {};
+    }
+
+    // Gather the candidate rules from the buckets of the element.
+    std::vector<unsigned> candidates = _universal;
+    auto add_bucket = [&] (Buckets const &buckets, std::string_view key) -> bool {
+        if (auto bucket = buckets.find(key)) {
+            candidates.insert(candidates.end(), bucket->begin(), bucket->end());
+            return true;
+        }
+        return false;
+    };
+
+    char const *name = local_name(node);
+    if (name) {
+        add_bucket(_by_name, name);
+    }
+    char const *id = node->attribute("id");
+    bool const id_used = id && add_bucket(_by_id, id);
+    char const *klass = node->attribute("class");
+    if (klass) {
+        for (char const *c = klass; *c;) {
+            while (*c && is_white_space(*c)) {
+                ++c;
+            }
+            char const *start = c;
+            while (*c && !is_white_space(*c)) {
+                ++c;
+            }
+            if (c != start) {
+                add_bucket(_by_class, std::string_view(start, c - start));
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    bool const context_free = std::all_of(candidates.begin(), candidates.end(),
+                                          [this] (unsigned i) { return _rules[i].context_free; });
+    std::string signature;
+    if (context_free) {
+        // An id which no rule names does not affect the result.
+        signature.append(name ? name : "").append(1, '\0');
+        signature.append(id_used ? id : "").append(1, '\0');
+        signature.append(klass ? klass : "");
+        if (auto memoized = _memo.find(std::string_view(signature))) {
+            return *memoized;
+        }
+    }
+
+    std::vector<Rule const *> matched;
+    for (unsigned i : candidates) {
+        gboolean matches = FALSE;
+        CRStatus status = cr_sel_eng_matches_node(sel_eng, _rules[i].selector, node, &matches);
+        if (status == CR_OK && matches) {
+            matched.push_back(&_rules[i]);
+        }
+    }
+
+    auto result = _cascade(matched);
+    if (context_free) {
+        _memo.insert_or_assign(std::move(signature), result);
+    }
+    return result;
+}
+
+/**
+ * Apply the precedence rules between the declarations of matched rules, like libcroco's
+ * put_css_properties_in_props_list() does: a declaration replaces an earlier one of the same
+ * property if it comes from a later origin, or the same origin with at least the same
+ * specificity, unless only the earlier one is important. A replacing declaration moves to the
+ * end of the list.
+ */
+std::vector<CRDeclaration *> StyleSheetIndex::_cascade(std::vector<Rule const *> const &matched) const
+{
+    // libcroco stores the specificity of the last selector of a statement matching the element
+    // in the statement, and compares statements by it.
+    std::vector<std::pair<CRStatement const *, gulong>> specificities;
+    for (auto rule : matched) {
+        auto it = std::find_if(specificities.begin(), specificities.end(),
+                               [rule] (auto const &s) { return s.first == rule->statement; });
+        if (it == specificities.end()) {
+            specificities.emplace_back(rule->statement, rule->specificity);
+        } else {
+            it->second = rule->specificity;
+        }
+    }
+    auto specificity = [&] (CRStatement const *statement) {
+        for (auto const &s : specificities) {
+            if (s.first == statement) {
+                return s.second;
+            }
+        }
+        return gulong(0);
+    };
+
+    std::vector<CRDeclaration *> props;
+    for (auto rule : matched) {
+        CRStatement *statement = rule->statement;
+        auto const origin = statement->parent_sheet->origin;
+        for (auto decl = statement->kind.ruleset->decl_list; decl; decl = decl->next) {
+            char const *property = cr_str(decl->property);
+            if (!property) {
+                continue;
+            }
+            auto existing = std::find_if(props.begin(), props.end(), [property] (CRDeclaration *d) {
+                char const *p = cr_str(d->property);
+                return p && !std::strcmp(p, property);
+            });
+            if (existing == props.end()) {
+                props.push_back(decl);
+                continue;
+            }
+
+            CRDeclaration *old = *existing;
+            CRStyleSheet const *old_sheet = old->parent_statement ? old->parent_statement->parent_sheet : nullptr;
+            if (old_sheet && old_sheet->origin < origin) {
+                if (old->important && !decl->important && old_sheet->origin != ORIGIN_UA) {
+                    continue;
+                }
+            } else if (old_sheet && old_sheet->origin > origin) {
+                continue;
+            } else if (specificity(statement) < specificity(old->parent_statement) ||
+                       (old->important && !decl->important)) {
+                continue;
+            }
+            props.erase(existing);
+            props.push_back(decl);
+        }
+    }
+    return props;
+}
+
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Index of the style sheet rules of a document by selector.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2022 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_INKSCAPE_STYLE_SHEET_INDEX_H
+#define SEEN_INKSCAPE_STYLE_SHEET_INDEX_H
+
+#include <string>
+#include <vector>
+
+#include "3rdparty/libcroco/cr-sel-eng.h"
+#include "util/flat-hash-map.h"
+
+namespace Inkscape {
+
+namespace XML {
+class Node;
+}
+
+/**
+ * The rules of a style cascade, bucketed by the right-most compound selector of each selector.
+ *
+ * A rule whose right-most compound names an id is found under that id, else under its first
+ * class, else under its element name; the rest are tested against every element. Only the rules
+ * of the buckets of an element are then matched with libcroco, instead of the whole cascade.
+ *
+ * When all rules which may match an element consist of a single compound of type, id and class
+ * selectors, the result only depends on the element name, id and classes. It is memoized for
+ * these, so that elements looking alike are not matched again.
+ *
+ * The index refers to the statements of the cascade, so it must be rebuilt whenever a style
+ * sheet of the cascade changes; see SPDocument::invalidateStyleSheetIndex().
+ */
+class StyleSheetIndex
+{
+public:
+    explicit StyleSheetIndex(CRCascade *cascade);
+
+    /**
+     * Find the declarations of the cascade which apply to an element, after applying the
+     * precedence rules between them. The result is in the order of the property list returned
+     * by cr_sel_eng_get_matched_properties_from_cascade(), with the winning declaration of each
+     * property appearing once.
+     */
+    std::vector<CRDeclaration *> match(CRSelEng *sel_eng, XML::Node const *node);
+
+private:
+    struct Rule
+    {
+        CRStatement *statement;
+        CRSimpleSel *selector;
+        gulong specificity;
+        bool context_free; ///< matching depends only on element name, id and classes
+    };
+
+    void _addSheet(CRStyleSheet *sheet);
+    void _addRule(CRStatement *statement, CRSimpleSel *selector);
+    std::vector<CRDeclaration *> _cascade(std::vector<Rule const *> const &matched) const;
+
+    using Buckets = Util::FlatHashMap<std::string, std::vector<unsigned>, Util::StringHash>;
+
+    std::vector<Rule> _rules; ///< in cascade order
+    Buckets _by_id;
+    Buckets _by_class;
+    Buckets _by_name;
+    std::vector<unsigned> _universal;
+    Util::FlatHashMap<std::string, std::vector<CRDeclaration *>, Util::StringHash> _memo;
+};
+
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_STYLE_SHEET_INDEX_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
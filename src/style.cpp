@@ -23,6 +23,8 @@
 #include "style.h"
 
 #include <cstring>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <algorithm>
 #include <unordered_map>
@@ -34,6 +36,7 @@
 #include "bad-uri-exception.h"
 #include "document.h"
 #include "preferences.h"
+#include "style-sheet-index.h"
 
 #include "3rdparty/libcroco/cr-sel-eng.h"
 
@@ -44,6 +47,7 @@
 #include "svg/css-ostringstream.h"
 #include "svg/svg.h"
 
+#include "util/flat-hash-map.h"
 #include "util/units.h"
 
 #include "xml/croco-node-iface.h"
@@ -220,6 +224,13 @@ public:
         return get(style, sp_attribute_lookup(name.c_str()));
     }
 
+    /**
+     * Get the member pointers of all properties, in the order of registration
+     */
+    std::vector<SPIBasePtr> const &members() const {
+        return m_vector;
+    }
+
     /**
      * Get a vector of property pointers
      * \todo provide iterator instead
@@ -250,6 +261,78 @@ private:
 
 auto &_prop_helper = SPStylePropHelper::instance();
 
+/**
+ * A declaration of a style attribute, with its value as readIfUnset() takes it.
+ */
+struct SPStyleDeclaration {
+    SPAttr id;
+    std::string property;
+    std::string value;
+    bool important;
+};
+
+/**
+ * The parsed declarations of style attributes, shared by all styles.
+ *
+ * Documents often repeat the same style attribute on many elements. Instead of parsing it with
+ * libcroco and converting every value back to a string for each of them, every distinct
+ * attribute is parsed once into an immutable list of declarations, which is then merged into
+ * each style. When there are too many distinct attributes, the table is emptied.
+ */
+class SPStyleDeclarationCache {
+public:
+    using Declarations = std::vector<SPStyleDeclaration>;
+
+    static SPStyleDeclarationCache &instance() {
+        static SPStyleDeclarationCache _instance;
+        return _instance;
+    }
+
+    /**
+     * Get the declarations of a style attribute, in the order they appear in it
+     */
+    std::shared_ptr<Declarations const> get(char const *css) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (auto declarations = _entries.find(std::string_view(css))) {
+            return *declarations;
+        }
+
+        auto declarations = std::make_shared<Declarations>();
+        CRDeclaration *const decl_list
+            = cr_declaration_parse_list_from_buf(reinterpret_cast<guchar const *>(css), CR_UTF_8);
+        for (auto decl = decl_list; decl; decl = decl->next) {
+            gchar const *property = decl->property->stryng->str;
+            auto value = reinterpret_cast<gchar *>(cr_term_to_string(decl->value));
+            SPStyleDeclaration declaration{sp_attribute_lookup(property), property, value ? value : "",
+                                           static_cast<bool>(decl->important)};
+            // Add "!important" rule if necessary as this is not handled by cr_term_to_string().
+            if (declaration.id != SPAttr::INVALID && declaration.important) {
+                declaration.value += " !important";
+            }
+            declarations->push_back(std::move(declaration));
+            g_free(value);
+        }
+        if (decl_list) {
+            cr_declaration_destroy(decl_list);
+        }
+
+        if (_entries.size() >= MAX_ENTRIES) {
+            _entries.clear();
+        }
+        _entries.insert_or_assign(css, declarations);
+        return declarations;
+    }
+
+private:
+    SPStyleDeclarationCache() = default;
+    SPStyleDeclarationCache(SPStyleDeclarationCache const &) = delete;
+
+    static constexpr std::size_t MAX_ENTRIES = 4096;
+
+    std::mutex _mutex;
+    Inkscape::Util::FlatHashMap<std::string, std::shared_ptr<Declarations const>, Inkscape::Util::StringHash> _entries;
+};
+
 // C++11 allows one constructor to call another... might be useful. The original C code
 // had separate calls to create SPStyle, one with only SPDocument and the other with only
 // SPObject as parameters.
@@ -466,9 +549,6 @@ SPStyle::SPStyle(SPDocument *document_in, SPObject *object_in) :
     marker_ptrs[SP_MARKER_LOC_MID]   = &marker_mid;
     marker_ptrs[SP_MARKER_LOC_END]   = &marker_end;
 
-
-    // This might be too resource hungary... but for now it possible to loop over properties
-    _properties = _prop_helper.get_vector(this);
 }
 
 SPStyle::~SPStyle() {
@@ -505,7 +585,7 @@ SPStyle::~SPStyle() {
     // std::cout << "SPStyle::~SPStyle(): Exit\n" << std::endl;
 }
 
-const std::vector<SPIBase *> SPStyle::properties() { return this->_properties; }
+const std::vector<SPIBase *> SPStyle::properties() { return _prop_helper.get_vector(this); }
 
 void
 SPStyle::clear(SPAttr id) {
@@ -519,8 +599,8 @@ SPStyle::clear(SPAttr id) {
 
 void
 SPStyle::clear() {
-    for (auto * p : _properties) {
-        p->clear();
+    for (auto ptr : _prop_helper.members()) {
+        (this->*ptr).clear();
     }
 
     // Release connection to object, created in constructor.
@@ -594,7 +674,8 @@ SPStyle::read( SPObject *object, Inkscape::XML::Node *repr ) {
     }
 
     /* 3 Presentation attributes */
-    for (auto * p : _properties) {
+    for (auto ptr : _prop_helper.members()) {
+        auto p = &(this->*ptr);
         // Shorthands are not allowed as presentation properties. Note: text-decoration and
         // font-variant are converted to shorthands in CSS 3 but can still be read as a
         // non-shorthand for compatibility with older renders, so they should not be in this list.
@@ -777,11 +858,11 @@ SPStyle::write( guint const flags, SPStyleSrc const style_src_req, SPStyle const
     }
 
     Glib::ustring style_string;
-    for(std::vector<SPIBase*>::size_type i = 0; i != _properties.size(); ++i) {
+    for (auto ptr : _prop_helper.members()) {
         if( base != nullptr ) {
-            style_string += _properties[i]->write( flags, style_src_req, base->_properties[i] );
+            style_string += (this->*ptr).write( flags, style_src_req, &(base->*ptr) );
         } else {
-            style_string += _properties[i]->write( flags, style_src_req, nullptr );
+            style_string += (this->*ptr).write( flags, style_src_req, nullptr );
         }
     }
 
@@ -837,8 +918,8 @@ Glib::ustring SPStyle::writeIfDiff(SPStyle const *base) const
 void
 SPStyle::cascade( SPStyle const *const parent ) {
     // std::cout << "SPStyle::cascade: " << (object->getId()?object->getId():"null") << std::endl;
-    for(std::vector<SPIBase*>::size_type i = 0; i != _properties.size(); ++i) {
-        _properties[i]->cascade( parent->_properties[i] );
+    for (auto ptr : _prop_helper.members()) {
+        (this->*ptr).cascade( &(parent->*ptr) );
     }
 }
 
@@ -863,8 +944,8 @@ SPStyle::cascade( SPStyle const *const parent ) {
 void
 SPStyle::merge( SPStyle const *const parent ) {
     // std::cout << "SPStyle::merge" << std::endl;
-    for(std::vector<SPIBase*>::size_type i = 0; i != _properties.size(); ++i) {
-        _properties[i]->merge( parent->_properties[i] );
+    for (auto ptr : _prop_helper.members()) {
+        (this->*ptr).merge( &(parent->*ptr) );
     }
 }
 
@@ -897,16 +978,16 @@ bool
 SPStyle::operator==(const SPStyle& rhs) {
 
     // Uncomment for testing
-    // for(std::vector<SPIBase*>::size_type i = 0; i != _properties.size(); ++i) {
-    //     if( *_properties[i] != *rhs._properties[i])
-    //     std::cout << _properties[i]->name << ": "
-    //               << _properties[i]->write(SP_STYLE_FLAG_ALWAYS,NULL) << " " 
-    //               << rhs._properties[i]->write(SP_STYLE_FLAG_ALWAYS,NULL)
-    //               << (*_properties[i]  == *rhs._properties[i]) << std::endl;
+    // for (auto ptr : _prop_helper.members()) {
+    //     if( (this->*ptr) != (rhs.*ptr) )
+    //     std::cout << (this->*ptr).name() << ": "
+    //               << (this->*ptr).write(SP_STYLE_FLAG_ALWAYS,NULL) << " "
+    //               << (rhs.*ptr).write(SP_STYLE_FLAG_ALWAYS,NULL)
+    //               << ((this->*ptr) == (rhs.*ptr)) << std::endl;
     // }
 
-    for(std::vector<SPIBase*>::size_type i = 0; i != _properties.size(); ++i) {
-        if( *_properties[i] != *rhs._properties[i]) return false;
+    for (auto ptr : _prop_helper.members()) {
+        if( (this->*ptr) != (rhs.*ptr) ) return false;
     }
     return true;
 }
@@ -915,11 +996,11 @@ void
 SPStyle::_mergeString( gchar const *const p ) {
 
     // std::cout << "SPStyle::_mergeString: " << (p?p:"null") << std::endl;
-    CRDeclaration *const decl_list
-        = cr_declaration_parse_list_from_buf(reinterpret_cast<guchar const *>(p), CR_UTF_8);
-    if (decl_list) {
-        _mergeDeclList( decl_list, SPStyleSrc::STYLE_PROP );
-        cr_declaration_destroy(decl_list);
+    auto const declarations = SPStyleDeclarationCache::instance().get(p);
+
+    // In reverse order, as later declarations to take precedence over earlier ones.
+    for (auto it = declarations->rbegin(); it != declarations->rend(); ++it) {
+        _mergeDecl(it->id, it->property.c_str(), it->value.c_str(), it->important, SPStyleSrc::STYLE_PROP);
     }
 }
 
@@ -962,32 +1043,29 @@ SPStyle::_mergeDecl(  CRDeclaration const *const decl, SPStyleSrc const &source
             g_free(str_value);
         }
     } else {
-        gchar const *key = decl->property->stryng->str;
         auto value = reinterpret_cast<gchar *>(cr_term_to_string(decl->value));
-
-        if (g_str_has_prefix(key, "--")) {
-            g_warning("Ignoring CSS variable: %s", key);
-        } else if (g_str_has_prefix(key, "-")) {
-            extended_properties[key] = value;
-        } else {
-            g_warning("Ignoring unrecognized CSS property: %s", key);
-        }
-
+        _mergeDecl(prop_idx, decl->property->stryng->str, value, decl->important, source);
         g_free(value);
     }
 }
 
+/**
+ * Merge a declaration whose value has already been converted to a string, including the
+ * "!important" rule for known properties.
+ */
 void
-SPStyle::_mergeProps( CRPropList *const props ) {
-
-    // std::cout << "SPStyle::_mergeProps" << std::endl;
+SPStyle::_mergeDecl( SPAttr id, gchar const *property, gchar const *value, bool important, SPStyleSrc const &source ) {
 
-    // In reverse order, as later declarations to take precedence over earlier ones.
-    if (props) {
-        _mergeProps( cr_prop_list_get_next( props ) );
-        CRDeclaration *decl = nullptr;
-        cr_prop_list_get_decl(props, &decl);
-        _mergeDecl( decl, SPStyleSrc::STYLE_SHEET );
+    if (id != SPAttr::INVALID) {
+        if (!isSet(id) || important) {
+            readIfUnset(id, value, source);
+        }
+    } else if (g_str_has_prefix(property, "--")) {
+        g_warning("Ignoring CSS variable: %s", property);
+    } else if (g_str_has_prefix(property, "-")) {
+        extended_properties[property] = value;
+    } else {
+        g_warning("Ignoring unrecognized CSS property: %s", property);
     }
 }
 
@@ -1010,19 +1088,12 @@ SPStyle::_mergeObjectStylesheet( SPObject const *const object, SPDocument *const
         _mergeObjectStylesheet(object, parent);
     }
 
-    CRPropList *props = nullptr;
-
     //XML Tree being directly used here while it shouldn't be.
-    CRStatus status =
-        cr_sel_eng_get_matched_properties_from_cascade(sel_eng,
-                                                       document->getStyleCascade(),
-                                                       object->getRepr(),
-                                                       &props);
-    g_return_if_fail(status == CR_OK);
-    /// \todo Check what errors can occur, and handle them properly.
-    if (props) {
-        _mergeProps(props);
-        cr_prop_list_destroy(props);
+    auto const decls = document->getStyleSheetIndex().match(sel_eng, object->getRepr());
+
+    // In reverse order, as later declarations to take precedence over earlier ones.
+    for (auto it = decls.rbegin(); it != decls.rend(); ++it) {
+        _mergeDecl(*it, SPStyleSrc::STYLE_SHEET);
     }
 }
 
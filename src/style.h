@@ -79,7 +79,7 @@ private:
     void _mergeString( char const *const p );
     void _mergeDeclList( CRDeclaration const *const decl_list, SPStyleSrc const &source );
     void _mergeDecl(     CRDeclaration const *const decl,      SPStyleSrc const &source );
-    void _mergeProps( CRPropList *const props );
+    void _mergeDecl( SPAttr id, char const *property, char const *value, bool important, SPStyleSrc const &source );
     void _mergeObjectStylesheet( SPObject const *const object );
     void _mergeObjectStylesheet( SPObject const *const object, SPDocument *const document );
 
@@ -95,9 +95,6 @@ public:
     SPDocument *document;
 
 private:
-    /// Pointers to all the properties (for looping through them)
-    std::vector<SPIBase *> _properties;
-
     // Shorthand for better readability
     template <SPAttr Id, class Base>
     using T = TypedSPI<Id, Base>;
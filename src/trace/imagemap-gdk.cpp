@@ -43,7 +43,7 @@ GrayMap *gdkPixbufToGrayMap(GdkPixbuf *buf)
             int white = 3 * (255-alpha);
             unsigned long sample = (int)p[0] + (int)p[1] +(int)p[2];
             unsigned long bright = sample * alpha / 256 + white;
-            grayMap->setPixel(grayMap, x, y, bright);
+            grayMap->set(x, y, bright);
             p += n_channels;
             }
         row += rowstride;
@@ -80,7 +80,7 @@ GdkPixbuf *grayMapToGdkPixbuf(GrayMap *grayMap)
         guchar *p = pixdata + row;
         for (x=0 ; x<grayMap->width ; x++)
             {
-            unsigned long pix = grayMap->getPixel(grayMap, x, y) / 3;
+            unsigned long pix = grayMap->get(x, y) / 3;
             p[0] = p[1] = p[2] = (guchar)(pix & 0xff);
             p += n_channels;
             }
@@ -124,7 +124,7 @@ RgbMap *gdkPixbufToRgbMap(GdkPixbuf *buf)
             int g     = (int)p[1];  g = g * alpha / 256 + white;
             int b     = (int)p[2];  b = b * alpha / 256 + white;
 
-            rgbMap->setPixel(rgbMap, x, y, r, g, b);
+            rgbMap->set(x, y, RGB{(unsigned char)r, (unsigned char)g, (unsigned char)b});
             p += n_channels;
             }
         row += rowstride;
@@ -168,7 +168,7 @@ GdkPixbuf *indexedMapToGdkPixbuf(IndexedMap *iMap)
         guchar *p = pixdata + row;
         for (x=0 ; x<iMap->width ; x++)
             {
-            RGB rgb = iMap->getPixelValue(iMap, x, y);
+            RGB rgb = iMap->getValue(x, y);
             p[0] = rgb.r & 0xff;
             p[1] = rgb.g & 0xff;
             p[2] = rgb.b & 0xff;
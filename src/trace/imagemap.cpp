@@ -20,16 +20,12 @@
 
 static void gSetPixel(GrayMap *me, int x, int y, unsigned long val)
 {
-    if (val>765)
-        val = 765;
-    unsigned long *pix = me->rows[y] + x;
-    *pix = val;
+    me->set(x, y, val);
 }
 
 static unsigned long gGetPixel(GrayMap *me, int x, int y)
 {
-    unsigned long *pix = me->rows[y] + x;
-    return *pix;
+    return me->get(x, y);
 }
 
 
@@ -48,7 +44,7 @@ static int gWritePPM(GrayMap *me, char *fileName)
         {
         for (int x=0 ; x<me->width ; x++)
             {
-            unsigned long pix  = me->getPixel(me, x, y) / 3;
+            unsigned long pix  = me->get(x, y) / 3;
             unsigned char pixb = (unsigned char) (pix & 0xff);
             fputc(pixb, f);
             fputc(pixb, f);
@@ -131,14 +127,12 @@ static void rSetPixel(RgbMap *me, int x, int y, int r, int g, int b)
 
 static void rSetPixelRGB(RgbMap *me, int x, int y, RGB rgb)
 {
-    RGB *pix = me->rows[y] + x;
-    *pix = rgb;
+    me->set(x, y, rgb);
 }
 
 static RGB rGetPixel(RgbMap *me, int x, int y)
 {
-    RGB *pix = me->rows[y] + x;
-    return *pix;
+    return me->get(x, y);
 }
 
 
@@ -158,7 +152,7 @@ static int rWritePPM(RgbMap *me, char *fileName)
         {
         for (int x=0 ; x<me->width ; x++)
             {
-            RGB rgb = me->getPixel(me, x, y);
+            RGB rgb = me->get(x, y);
             fputc(rgb.r, f);
             fputc(rgb.g, f);
             fputc(rgb.b, f);
@@ -235,22 +229,18 @@ RgbMap *RgbMapCreate(int width, int height)
 
 static void iSetPixel(IndexedMap *me, int x, int y, unsigned int index)
 {
-    unsigned int *pix = me->rows[y] + x;
-    *pix = index;
+    me->set(x, y, index);
 }
 
 
 static unsigned int iGetPixel(IndexedMap *me, int x, int y)
 {
-    unsigned int *pix = me->rows[y] + x;
-    return *pix;
+    return me->get(x, y);
 }
 
 static RGB iGetPixelValue(IndexedMap *me, int x, int y)
 {
-    unsigned int *pix = me->rows[y] + x;
-    RGB rgb = me->clut[((*pix)&0xff)];
-    return rgb;
+    return me->getValue(x, y);
 }
 
 
@@ -270,7 +260,7 @@ static int iWritePPM(IndexedMap *me, char *fileName)
         {
         for (int x=0 ; x<me->width ; x++)
             {
-            RGB rgb = me->getPixelValue(me, x, y);
+            RGB rgb = me->getValue(x, y);
             fputc(rgb.r, f);
             fputc(rgb.g, f);
             fputc(rgb.b, f);
@@ -87,6 +87,24 @@ struct GrayMap_def
      */
     unsigned long **rows;
 
+    /*#################
+    ### INLINE ACCESSORS
+    #################*/
+
+    /*
+     * The pixels are stored row by row, without padding. Loops over many pixels should use
+     * these instead of the methods above, which cost an indirect call per pixel.
+     */
+    unsigned long get(int x, int y) const
+    {
+        return pixels[(long)y * width + x];
+    }
+
+    void set(int x, int y, unsigned long val)
+    {
+        pixels[(long)y * width + x] = val < GRAYMAP_WHITE ? val : GRAYMAP_WHITE;
+    }
+
 };
 
 #ifdef __cplusplus
@@ -180,6 +198,20 @@ struct RgbMap_def
      */
     RGB **rows;
 
+    /*#################
+    ### INLINE ACCESSORS
+    #################*/
+
+    RGB get(int x, int y) const
+    {
+        return pixels[(long)y * width + x];
+    }
+
+    void set(int x, int y, RGB rgb)
+    {
+        pixels[(long)y * width + x] = rgb;
+    }
+
 };
 
 
@@ -278,6 +310,25 @@ struct IndexedMap_def
      */
     RGB clut[256];
 
+    /*#################
+    ### INLINE ACCESSORS
+    #################*/
+
+    unsigned int get(int x, int y) const
+    {
+        return pixels[(long)y * width + x];
+    }
+
+    void set(int x, int y, unsigned int index)
+    {
+        pixels[(long)y * width + x] = index;
+    }
+
+    RGB getValue(int x, int y) const
+    {
+        return clut[get(x, y) & 0xff];
+    }
+
 };
 
 
@@ -15,8 +15,15 @@
  *
  */
 
+#ifdef HAVE_CONFIG_H
+# include "config.h"  // only include where actually required!
+#endif
+
 #include "inkscape-potrace.h"
 
+#if HAVE_OPENMP
+#include <omp.h>
+#endif
 #include <glibmm/i18n.h>
 #include <gtkmm/main.h>
 #include <iomanip>
@@ -28,6 +35,7 @@
 #include <inkscape.h>
 #include "desktop.h"
 #include "message-stack.h"
+#include "preferences.h"
 
 #include "object/sp-path.h"
 
@@ -59,6 +67,32 @@ static void potraceStatusCallback(double /*progress*/, void *userData) /* callba
     //      (Inkscape::Trace::Potrace::PotraceTracingEngine *)userData;
 }
 
+/**
+ * Progress callback for scans traced concurrently: only the thread that started the
+ * trace may run the main loop.
+ */
+static void potraceConcurrentStatusCallback(double progress, void *userData)
+{
+#if HAVE_OPENMP
+    if (omp_get_thread_num() != 0)
+        return;
+#endif
+    potraceStatusCallback(progress, userData);
+}
+
+/**
+ * Number of scans of a multiple scan trace that are traced at the same time.
+ */
+static int concurrentScans()
+{
+#if HAVE_OPENMP
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    return prefs->getIntLimited("/options/threading/numthreads", omp_get_num_procs(), 1, 256);
+#else
+    return 1;
+#endif
+}
+
 
 namespace {
 ustring twohex( int value )
@@ -213,6 +247,60 @@ static long writePaths(PotraceTracingEngine *engine, potrace_path_t *plist,
 }
 
 
+/**
+ * Make a black and white map of the pixels of a gray map whose brightness is between floor
+ * and cutoff, on a 0..765 scale.
+ */
+static GrayMap *brightnessBand(GrayMap const *gm, double floor, double cutoff, bool invert)
+{
+    GrayMap *newGm = GrayMapCreate(gm->width, gm->height);
+    if (!newGm)
+        return nullptr;
+
+    unsigned long const inside = invert ? GRAYMAP_WHITE : GRAYMAP_BLACK;
+    unsigned long const outside = invert ? GRAYMAP_BLACK : GRAYMAP_WHITE;
+    for (int y=0 ; y<gm->height ; y++)
+        {
+        unsigned long const *src = gm->rows[y];
+        unsigned long *dest = newGm->rows[y];
+        for (int x=0 ; x<gm->width ; x++)
+            {
+            double brightness = (double)src[x];
+            dest[x] = (brightness >= floor && brightness < cutoff) ? inside : outside;
+            }
+        }
+    return newGm;
+}
+
+/**
+ * Make a black and white map of the pixels of an indexed map with the given color index, or
+ * with any color index up to it if the scans are stacked.
+ */
+static GrayMap *indexedBand(IndexedMap const *iMap, unsigned int colorIndex, bool stack)
+{
+    GrayMap *gm = GrayMapCreate(iMap->width, iMap->height);
+    if (!gm)
+        return nullptr;
+
+    for (int y=0 ; y<iMap->height ; y++)
+        {
+        unsigned int const *src = iMap->rows[y];
+        unsigned long *dest = gm->rows[y];
+        if (stack)
+            {
+            for (int x=0 ; x<iMap->width ; x++)
+                dest[x] = src[x] <= colorIndex ? GRAYMAP_BLACK : GRAYMAP_WHITE;
+            }
+        else
+            {
+            for (int x=0 ; x<iMap->width ; x++)
+                dest[x] = src[x] == colorIndex ? GRAYMAP_BLACK : GRAYMAP_WHITE;
+            }
+        }
+    return gm;
+}
+
+
 static GrayMap *filter(PotraceTracingEngine &engine, GdkPixbuf * pixbuf)
 {
     if (!pixbuf)
@@ -241,29 +329,15 @@ static GrayMap *filter(PotraceTracingEngine &engine, GdkPixbuf * pixbuf)
         if (!gm)
             return nullptr;
 
-        newGm = GrayMapCreate(gm->width, gm->height);
-        if (!newGm)
-            {
-            gm->destroy(gm);
-            return nullptr;
-            }
         double floor =  3.0 *
                ( engine.brightnessFloor * 256.0 );
         double cutoff =  3.0 *
                ( engine.brightnessThreshold * 256.0 );
-        for (int y=0 ; y<gm->height ; y++)
-            {
-            for (int x=0 ; x<gm->width ; x++)
-                {
-                double brightness = (double)gm->getPixel(gm, x, y);
-                if (brightness >= floor && brightness < cutoff)
-                    newGm->setPixel(newGm, x, y, GRAYMAP_BLACK);  //black pixel
-                else
-                    newGm->setPixel(newGm, x, y, GRAYMAP_WHITE); //white pixel
-                }
-            }
+        newGm = brightnessBand(gm, floor, cutoff, false);
 
         gm->destroy(gm);
+        if (!newGm)
+            return nullptr;
         //newGm->writePPM(newGm, "brightness.ppm");
         //return newGm;
         }
@@ -285,12 +359,9 @@ static GrayMap *filter(PotraceTracingEngine &engine, GdkPixbuf * pixbuf)
         {
         for (int y=0 ; y<newGm->height ; y++)
             {
+            unsigned long *row = newGm->rows[y];
             for (int x=0 ; x<newGm->width ; x++)
-                {
-                unsigned long brightness = newGm->getPixel(newGm, x, y);
-                brightness = 765 - brightness;
-                newGm->setPixel(newGm, x, y, brightness);
-                }
+                row[x] = GRAYMAP_WHITE - row[x];
             }
         }
 
@@ -375,7 +446,7 @@ PotraceTracingEngine::preview(Glib::RefPtr<Gdk::Pixbuf> thePixbuf)
 
 
 //*This is the core inkscape-to-potrace binding
-std::string PotraceTracingEngine::grayMapToPath(GrayMap *grayMap, long *nodeCount)
+std::string PotraceTracingEngine::grayMapToPath(GrayMap *grayMap, long *nodeCount, potrace_param_t const *params)
 {
     if (!keepGoing)
     {
@@ -393,10 +464,10 @@ std::string PotraceTracingEngine::grayMapToPath(GrayMap *grayMap, long *nodeCoun
     //##Read the data out of the GrayMap
     for (int y=0 ; y<grayMap->height ; y++)
         {
+        unsigned long const *row = grayMap->rows[y];
         for (int x=0 ; x<grayMap->width ; x++)
             {
-            BM_UPUT(potraceBitmap, x, y,
-                  grayMap->getPixel(grayMap, x, y) ? 0 : 1);
+            BM_UPUT(potraceBitmap, x, y, row[x] ? 0 : 1);
             }
         }
 
@@ -408,7 +479,7 @@ std::string PotraceTracingEngine::grayMapToPath(GrayMap *grayMap, long *nodeCoun
     */
 
     /* trace a bitmap*/
-    potrace_state_t *potraceState = potrace_trace(potraceParams,
+    potrace_state_t *potraceState = potrace_trace(params ? params : potraceParams,
                                                   potraceBitmap);
 
     //## Free the Potrace bitmap
@@ -496,8 +567,26 @@ std::vector<TracingEngineResult> PotraceTracingEngine::traceGrayMap(GrayMap *gra
     return results;
 }
 
+namespace {
+
+/**
+ *  A scan of a multiple scan trace
+ */
+struct PotraceScan
+{
+    std::string d;
+    long nodeCount = 0L;
+    double floor = 0.0; ///< bottom of the brightness range the scan was traced with
+};
+
+} // namespace
+
 /**
  *  Called for multiple-scanning algorithms
+ *
+ *  The scans are traced concurrently. Unless they are stacked, each scan starts at the
+ *  threshold of the previous non-empty scan; it is traced assuming that the previous scan
+ *  is not empty, and traced again in the rare case that it was.
  */
 std::vector<TracingEngineResult> PotraceTracingEngine::traceBrightnessMulti(GdkPixbuf * thePixbuf)
 {
@@ -510,40 +599,68 @@ std::vector<TracingEngineResult> PotraceTracingEngine::traceBrightnessMulti(GdkP
 
         brightnessFloor = 0.0; //Set bottom to black
 
-        int traceCount = 0;
-
+        std::vector<double> thresholds;
         for ( brightnessThreshold = low ;
               brightnessThreshold <= high ;
               brightnessThreshold += delta) {
-            GrayMap *grayMap = filter(*this, thePixbuf);
-            if ( grayMap ) {
-                long nodeCount = 0L;
-                std::string d = grayMapToPath(grayMap, &nodeCount);
+            thresholds.push_back(brightnessThreshold);
+        }
+        int const nrScans = thresholds.size();
 
-                grayMap->destroy(grayMap);
+        GrayMap *gm = gdkPixbufToGrayMap(thePixbuf);
+        if (!gm)
+            return results;
+
+        std::vector<PotraceScan> scans(nrScans);
+        auto traceScan = [&] (int i, double floor, potrace_param_t const *params) {
+            scans[i].floor = floor;
+            scans[i].d.clear();
+            scans[i].nodeCount = 0L;
+            GrayMap *band = brightnessBand(gm, 3.0 * (floor * 256.0), 3.0 * (thresholds[i] * 256.0), invert);
+            if (band) {
+                scans[i].d = grayMapToPath(band, &scans[i].nodeCount, params);
+                band->destroy(band);
+            }
+        };
+
+        potrace_param_t concurrentParams = *potraceParams;
+        concurrentParams.progress.callback = potraceConcurrentStatusCallback;
+        int const numThreads = concurrentScans();
+        #if HAVE_OPENMP
+        #pragma omp parallel for num_threads(numThreads) schedule(dynamic, 1) if (numThreads > 1)
+        #endif
+        for (int i = 0; i < nrScans; i++) {
+            traceScan(i, (multiScanStack || i == 0) ? 0.0 : thresholds[i - 1], &concurrentParams);
+        }
 
-                if ( !d.empty() ) {
-                    //### get style info
-                    int grayVal = (int)(256.0 * brightnessThreshold);
-                    ustring style = ustring::compose("fill-opacity:1.0;fill:#%1%2%3", twohex(grayVal), twohex(grayVal), twohex(grayVal) );
+        int traceCount = 0;
+        for (int i = 0; i < nrScans && keepGoing; i++) {
+            if (scans[i].floor != brightnessFloor) {
+                traceScan(i, brightnessFloor, potraceParams);
+            }
+            if ( !scans[i].d.empty() ) {
+                //### get style info
+                int grayVal = (int)(256.0 * thresholds[i]);
+                ustring style = ustring::compose("fill-opacity:1.0;fill:#%1%2%3", twohex(grayVal), twohex(grayVal), twohex(grayVal) );
 
-                    //g_message("### GOT '%s' \n", style.c_str());
-                    TracingEngineResult result(style.raw(), d, nodeCount);
-                    results.push_back(result);
+                //g_message("### GOT '%s' \n", style.c_str());
+                TracingEngineResult result(style.raw(), scans[i].d, scans[i].nodeCount);
+                results.push_back(result);
 
-                    if (!multiScanStack) {
-                        brightnessFloor = brightnessThreshold;
-                    }
+                if (!multiScanStack) {
+                    brightnessFloor = thresholds[i];
+                }
 
-                    SPDesktop *desktop = SP_ACTIVE_DESKTOP;
-                    if (desktop) {
-                        ustring msg = ustring::compose(_("Trace: %1.  %2 nodes"), traceCount++, nodeCount);
-                        desktop->getMessageStack()->flash(Inkscape::NORMAL_MESSAGE, msg);
-                    }
+                SPDesktop *desktop = SP_ACTIVE_DESKTOP;
+                if (desktop) {
+                    ustring msg = ustring::compose(_("Trace: %1.  %2 nodes"), traceCount++, scans[i].nodeCount);
+                    desktop->getMessageStack()->flash(Inkscape::NORMAL_MESSAGE, msg);
                 }
             }
         }
 
+        gm->destroy(gm);
+
         //# Remove the bottom-most scan, if requested
         if (results.size() > 1 && multiScanRemoveBackground) {
             results.erase(results.end() - 1);
@@ -556,6 +673,9 @@ std::vector<TracingEngineResult> PotraceTracingEngine::traceBrightnessMulti(GdkP
 
 /**
  *  Quantization
+ *
+ *  The gray map of each color index only depends on the indexed map, so all of them are
+ *  made and traced concurrently.
  */
 std::vector<TracingEngineResult> PotraceTracingEngine::traceQuant(GdkPixbuf * thePixbuf)
 {
@@ -564,49 +684,43 @@ std::vector<TracingEngineResult> PotraceTracingEngine::traceQuant(GdkPixbuf * th
     if (thePixbuf) {
         IndexedMap *iMap = filterIndexed(*this, thePixbuf);
         if ( iMap ) {
-            //Create and clear a gray map
-            GrayMap *gm = GrayMapCreate(iMap->width, iMap->height);
-            for (int row=0 ; row<gm->height ; row++) {
-                for (int col=0 ; col<gm->width ; col++) {
-                    gm->setPixel(gm, col, row, GRAYMAP_WHITE);
-                }
-            }
-
+            std::vector<PotraceScan> scans(iMap->nrColors);
+
+            potrace_param_t concurrentParams = *potraceParams;
+            concurrentParams.progress.callback = potraceConcurrentStatusCallback;
+            int const numThreads = concurrentScans();
+            #if HAVE_OPENMP
+            #pragma omp parallel for num_threads(numThreads) schedule(dynamic, 1) if (numThreads > 1)
+            #endif
             for (int colorIndex=0 ; colorIndex<iMap->nrColors ; colorIndex++) {
                 // Make a gray map for each color index
-                for (int row=0 ; row<iMap->height ; row++) {
-                    for (int col=0 ; col<iMap->width ; col++) {
-                        int indx = (int) iMap->getPixel(iMap, col, row);
-                        if (indx == colorIndex) {
-                            gm->setPixel(gm, col, row, GRAYMAP_BLACK); //black
-                        } else if (!multiScanStack) {
-                            gm->setPixel(gm, col, row, GRAYMAP_WHITE); //white
-                        }
-                    }
+                GrayMap *gm = indexedBand(iMap, colorIndex, multiScanStack);
+                if (gm) {
+                    //## Now we have a traceable graymap
+                    scans[colorIndex].d = grayMapToPath(gm, &scans[colorIndex].nodeCount, &concurrentParams);
+                    gm->destroy(gm);
                 }
+            }
 
-                //## Now we have a traceable graymap
-                long nodeCount = 0L;
-                std::string d = grayMapToPath(gm, &nodeCount);
-
-                if ( !d.empty() ) {
+            for (int colorIndex=0 ; colorIndex<iMap->nrColors && keepGoing ; colorIndex++) {
+                PotraceScan const &scan = scans[colorIndex];
+                if ( !scan.d.empty() ) {
                     //### get style info
                     RGB rgb = iMap->clut[colorIndex];
                     ustring style = ustring::compose("fill:#%1%2%3", twohex(rgb.r), twohex(rgb.g), twohex(rgb.b) );
 
                     //g_message("### GOT '%s' \n", style.c_str());
-                    TracingEngineResult result(style.raw(), d, nodeCount);
+                    TracingEngineResult result(style.raw(), scan.d, scan.nodeCount);
                     results.push_back(result);
 
                     SPDesktop *desktop = SP_ACTIVE_DESKTOP;
                     if (desktop) {
-                        ustring msg = ustring::compose(_("Trace: %1.  %2 nodes"), colorIndex, nodeCount);
+                        ustring msg = ustring::compose(_("Trace: %1.  %2 nodes"), colorIndex, scan.nodeCount);
                         desktop->getMessageStack()->flash(Inkscape::NORMAL_MESSAGE, msg);
                     }
                 }
             }// for colorIndex
 
-            gm->destroy(gm);
             iMap->destroy(iMap);
         }
 
@@ -113,8 +113,9 @@ class PotraceTracingEngine : public TracingEngine
     /**
      * This is the actual wrapper of the call to Potrace.  nodeCount
      * returns the count of nodes created.  May be NULL if ignored.
+     * params defaults to potraceParams.
      */
-    std::string grayMapToPath(GrayMap *gm, long *nodeCount);
+    std::string grayMapToPath(GrayMap *gm, long *nodeCount, potrace_param_t const *params = nullptr);
 
     std::vector<TracingEngineResult>traceBrightnessMulti(GdkPixbuf *pixbuf);
     std::vector<TracingEngineResult>traceQuant(GdkPixbuf *pixbuf);
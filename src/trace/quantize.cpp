@@ -449,7 +449,7 @@ static void octreeBuildArea(pool<Ocnode> *pool, RgbMap *rgbmap, Ocnode **ref,
     Ocnode *ref1 = nullptr;
     Ocnode *ref2 = nullptr;
     if (dx == 1 && dy == 1)
-        ocnodeLeaf(pool, ref, rgbmap->getPixel(rgbmap, x1, y1));
+        ocnodeLeaf(pool, ref, rgbmap->get(x1, y1));
     else if (dx > dy)
         {
 	octreeBuildArea(pool, rgbmap, &ref1, x1, y1, xm, y2, ncolor);
@@ -586,9 +586,9 @@ IndexedMap *rgbMapQuantize(RgbMap *rgbmap, int ncolor)
             // fill in new map pixels
             for (int y = 0; y < rgbmap->height; y++) {
                 for (int x = 0; x < rgbmap->width; x++) {
-                    RGB rgb = rgbmap->getPixel(rgbmap, x, y);
+                    RGB rgb = rgbmap->get(x, y);
                     int index = findRGB(rgbpal, ncolor, rgb);
-                    newmap->setPixel(newmap, x, y, index);
+                    newmap->set(x, y, index);
                 }
             }
         }
@@ -330,6 +330,7 @@ Glib::RefPtr<Gdk::Pixbuf> Tracer::getSelectedImage()
     if (!img)
         return Glib::RefPtr<Gdk::Pixbuf>(nullptr);
 
+    img->finishDecoding();
     if (!img->pixbuf)
         return Glib::RefPtr<Gdk::Pixbuf>(nullptr);
 
@@ -415,6 +416,7 @@ void Tracer::traceThread()
         engine = nullptr;
         return;
         }
+    img->finishDecoding();
 
     GdkPixbuf *trace_pb = gdk_pixbuf_copy(img->pixbuf->getPixbufRaw(false));
     if (img->pixbuf->pixelFormat() == Inkscape::Pixbuf::PF_CAIRO) {
@@ -1936,14 +1936,8 @@ guint32 CloneTiler::trace_pick(Geom::Rect box)
     /* Item integer bbox in points */
     Geom::IntRect ibox = (box * Geom::Scale(trace_zoom)).roundOutwards();
 
-    /* Find visible area */
-    cairo_surface_t *s = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, ibox.width(), ibox.height());
-    Inkscape::DrawingContext dc(s, ibox.min());
-    /* Render */
-    trace_drawing->render(dc, ibox);
     double R = 0, G = 0, B = 0, A = 0;
-    ink_cairo_surface_average_color(s, R, G, B, A);
-    cairo_surface_destroy(s);
+    trace_drawing->average_color_unpremul(ibox, R, G, B, A);
 
     return SP_RGBA32_F_COMPOSE (R, G, B, A);
 }
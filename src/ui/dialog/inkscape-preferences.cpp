@@ -2783,6 +2783,8 @@ void InkscapePreferences::initPageRendering()
     add_devmode_line(_("Coarsener glue size"), _canvas_coarsener_glue_size, C_("pixel abbreviation", "px"), _("Absorb nearby rectangles within this distance."));
     _canvas_coarsener_min_fullness.init("/options/rendering/coarsener_min_fullness", 0.0, 1.0, 0.0, 0.0, 0.3, false, false);
     add_devmode_line(_("Coarsener min fullness"), _canvas_coarsener_min_fullness, "", _("Refuse coarsening attempt if result would be more empty than this."));
+    _canvas_multithreaded.init("", "/options/rendering/multithreaded", false);
+    add_devmode_line(_("Multithreaded rendering"), _canvas_multithreaded, "", _("Render several tiles at once, using the configured number of threads"));
 
     add_devmode_group_header(_("Debugging, profiling, and experiments"));
     _canvas_debug_framecheck.init("", "/options/rendering/debug_framecheck", false);
@@ -18,10 +18,18 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#ifdef HAVE_CONFIG_H
+# include "config.h"  // only include where actually required!
+#endif
+
 #include "flood-tool.h"
 
+#include <algorithm>
 #include <cmath>
-#include <queue>
+
+#if HAVE_OPENMP
+#include <omp.h>
+#endif
 
 #include <gdk/gdkkeysyms.h>
 #include <glibmm/i18n.h>
@@ -126,6 +134,7 @@ FloodTool::FloodTool(SPDesktop *desktop)
 
 FloodTool::~FloodTool() {
     this->sel_changed_connection.disconnect();
+    releaseDrawing();
 
     delete shape_editor;
     shape_editor = nullptr;
@@ -174,14 +183,18 @@ inline static guint32 compose_onto(guint32 px, guint32 bg)
  * @param y The Y coordinate.
  * @param stride The rowstride of the pixel buffer.
  */
-inline guint32 get_pixel(guchar *px, int x, int y, int stride) {
-    return *reinterpret_cast<guint32*>(px + y * stride + x * 4);
+inline guint32 get_pixel(guchar const *px, int x, int y, int stride) {
+    return *reinterpret_cast<guint32 const *>(px + y * stride + x * 4);
 }
 
 inline unsigned char * get_trace_pixel(guchar *trace_px, int x, int y, int width) {
     return trace_px + (x + y * width);
 }
 
+inline unsigned char const *get_trace_pixel(guchar const *trace_px, int x, int y, int width) {
+    return trace_px + (x + y * width);
+}
+
 /**
  * \brief Check whether two unsigned integers are close to each other
  *
@@ -273,35 +286,19 @@ static bool compare_pixels(guint32 check, guint32 orig, guint32 merged_orig_pixe
     return false;
 }
 
+/**
+ * Marks of the pixels in the trace pixel buffer.
+ */
 enum {
-  PIXEL_CHECKED = 1,
-  PIXEL_QUEUED  = 2,
-  PIXEL_PAINTABLE = 4,
-  PIXEL_NOT_PAINTABLE = 8,
-  PIXEL_COLORED = 16
+    PIXEL_PAINTABLE = 1, ///< close enough to the color of the current fill point
+    PIXEL_PASSABLE = 2,  ///< the fill may spread through it, see mark_paintable_pixels()
+    PIXEL_FILLED = 4,    ///< reached by the fill from the current fill point
+    PIXEL_COLORED = 8    ///< part of the area to trace
 };
 
-static inline bool is_pixel_checked(unsigned char *t) { return (*t & PIXEL_CHECKED) == PIXEL_CHECKED; }
-static inline bool is_pixel_queued(unsigned char *t) { return (*t & PIXEL_QUEUED) == PIXEL_QUEUED; }
-static inline bool is_pixel_paintability_checked(unsigned char *t) {
-  return !((*t & PIXEL_PAINTABLE) == 0) && ((*t & PIXEL_NOT_PAINTABLE) == 0);
-}
-static inline bool is_pixel_paintable(unsigned char *t) { return (*t & PIXEL_PAINTABLE) == PIXEL_PAINTABLE; }
-static inline bool is_pixel_colored(unsigned char *t) { return (*t & PIXEL_COLORED) == PIXEL_COLORED; }
-
-static inline void mark_pixel_checked(unsigned char *t) { *t |= PIXEL_CHECKED; }
-static inline void mark_pixel_queued(unsigned char *t) { *t |= PIXEL_QUEUED; }
-static inline void mark_pixel_paintable(unsigned char *t) { *t |= PIXEL_PAINTABLE; *t ^= PIXEL_NOT_PAINTABLE; }
-static inline void mark_pixel_not_paintable(unsigned char *t) { *t |= PIXEL_NOT_PAINTABLE; *t ^= PIXEL_PAINTABLE; }
-static inline void mark_pixel_colored(unsigned char *t) { *t |= PIXEL_COLORED; }
-
-static inline void clear_pixel_paintability(unsigned char *t) { *t ^= PIXEL_PAINTABLE; *t ^= PIXEL_NOT_PAINTABLE; }
+static inline bool is_pixel_colored(unsigned char const *t) { return (*t & PIXEL_COLORED) == PIXEL_COLORED; }
 
 struct bitmap_coords_info {
-    bool is_left;
-    unsigned int x;
-    unsigned int y;
-    int y_limit;
     unsigned int width;
     unsigned int height;
     unsigned int stride;
@@ -310,36 +307,231 @@ struct bitmap_coords_info {
     PaintBucketChannels method;
     guint32 dtc;
     guint32 merged_orig_pixel;
-    Geom::Rect bbox;
-    Geom::Rect screen;
-    unsigned int max_queue_size;
-    unsigned int current_step;
+    int threads;
 };
 
 /**
- * Check if a pixel can be included in the fill.
- * @param px The rendered pixel buffer to check.
- * @param trace_t The pixel in the trace pixel buffer to check or mark.
- * @param x The X coordinate.
- * @param y The y coordinate.
+ * Number of threads for the passes over all pixels of the fill.
+ */
+static int flood_threads()
+{
+#if HAVE_OPENMP
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    return prefs->getIntLimited("/options/threading/numthreads", omp_get_num_procs(), 1, 256);
+#else
+    return 1;
+#endif
+}
+
+/**
+ * Find the pixels of an area which have a pixel passing a test within the autogap radius,
+ * horizontally and vertically. Pixels outside of the trace pixel buffer are not tested.
+ * @param trace_px The trace pixel buffer.
+ * @param bci The bitmap_coords_info structure.
+ * @param area The area, within the trace pixel buffer.
+ * @param test The test of a pixel of the trace pixel buffer.
+ * @return One value per pixel of the area, row by row, non-zero for the pixels found.
+ */
+template <typename Test>
+static std::vector<unsigned char> find_pixels_near(guchar const *trace_px, bitmap_coords_info const &bci,
+                                                   Geom::IntRect const &area, Test test)
+{
+    int const radius = bci.radius;
+    int const width = area.width();
+    int const height = area.height();
+    int const x_end = std::min<int>(area.right() + radius, bci.width);
+    int const y_begin = std::max(area.top() - radius, 0);
+    int const y_end = std::min<int>(area.bottom() + radius, bci.height);
+
+    // Count the passing pixels within the radius along the rows, with a sliding window.
+    std::vector<unsigned char> in_row(width * (y_end - y_begin));
+#if HAVE_OPENMP
+    #pragma omp parallel for num_threads(bci.threads) if (bci.threads > 1)
+#endif
+    for (int y = y_begin; y < y_end; y++) {
+        guchar const *trace_t = get_trace_pixel(trace_px, 0, y, bci.width);
+        unsigned char *out = in_row.data() + (y - y_begin) * width;
+        int count = 0;
+        int entering = std::max(area.left() - radius, 0);
+        int leaving = entering;
+        for (int x = area.left(); x < area.right(); x++) {
+            for (; entering < x_end && entering <= x + radius; entering++) {
+                count += test(trace_t[entering]);
+            }
+            for (; leaving < x - radius; leaving++) {
+                count -= test(trace_t[leaving]);
+            }
+            out[x - area.left()] = count > 0;
+        }
+    }
+
+    // Then the rows having one within the radius along the columns.
+    std::vector<unsigned char> found(width * height);
+#if HAVE_OPENMP
+    #pragma omp parallel for num_threads(bci.threads) if (bci.threads > 1)
+#endif
+    for (int x = 0; x < width; x++) {
+        int count = 0;
+        int entering = y_begin;
+        int leaving = y_begin;
+        for (int y = area.top(); y < area.bottom(); y++) {
+            for (; entering < y_end && entering <= y + radius; entering++) {
+                count += in_row[(entering - y_begin) * width + x];
+            }
+            for (; leaving < y - radius; leaving++) {
+                count -= in_row[(leaving - y_begin) * width + x];
+            }
+            found[(y - area.top()) * width + x] = count > 0;
+        }
+    }
+    return found;
+}
+
+/**
+ * Mark the pixels which can be included in the fill of a color as paintable.
+ *
+ * The fill spreads through the passable pixels. Without autogap, these are the paintable ones.
+ * With autogap, they are the pixels without any unpaintable pixel within the autogap radius, so
+ * that the fill does not leak through gaps narrower than twice the radius.
+ * @param px The rendered pixel buffer.
+ * @param trace_px The trace pixel buffer.
  * @param orig_color The original selected pixel to use as the fill target color.
  * @param bci The bitmap_coords_info structure.
  */
-inline static bool check_if_pixel_is_paintable(guchar *px, unsigned char *trace_t, int x, int y, guint32 orig_color, bitmap_coords_info bci) {
-    if (is_pixel_paintability_checked(trace_t)) {
-        return is_pixel_paintable(trace_t);
-    } else {
-        guint32 pixel = get_pixel(px, x, y, bci.stride);
-        if (compare_pixels(pixel, orig_color, bci.merged_orig_pixel, bci.dtc, bci.threshold, bci.method)) {
-            mark_pixel_paintable(trace_t);
-            return true;
-        } else {
-            mark_pixel_not_paintable(trace_t);
-            return false;
+static void mark_paintable_pixels(guchar const *px, guchar *trace_px, guint32 orig_color, bitmap_coords_info const &bci)
+{
+    int const width = bci.width;
+    int const height = bci.height;
+    unsigned char const passable = bci.radius == 0 ? PIXEL_PASSABLE : 0;
+
+#if HAVE_OPENMP
+    #pragma omp parallel for num_threads(bci.threads) if (bci.threads > 1)
+#endif
+    for (int y = 0; y < height; y++) {
+        unsigned char *trace_t = get_trace_pixel(trace_px, 0, y, width);
+        for (int x = 0; x < width; x++, trace_t++) {
+            *trace_t &= ~(PIXEL_PAINTABLE | PIXEL_PASSABLE);
+            guint32 pixel = get_pixel(px, x, y, bci.stride);
+            if (compare_pixels(pixel, orig_color, bci.merged_orig_pixel, bci.dtc, bci.threshold, bci.method)) {
+                *trace_t |= PIXEL_PAINTABLE | passable;
+            }
+        }
+    }
+
+    if (bci.radius > 0) {
+        auto const blocked = find_pixels_near(trace_px, bci, Geom::IntRect(0, 0, width, height),
+                                              [] (unsigned char t) { return !(t & PIXEL_PAINTABLE); });
+#if HAVE_OPENMP
+        #pragma omp parallel for num_threads(bci.threads) if (bci.threads > 1)
+#endif
+        for (int i = 0; i < width * height; i++) {
+            if (!blocked[i]) {
+                trace_px[i] |= PIXEL_PASSABLE;
+            }
         }
     }
 }
 
+/**
+ * Fill the passable pixels connected to a point, one span of a row at a time. The point itself
+ * is filled if it is paintable, even if it is not passable.
+ * @param trace_px The trace pixel buffer.
+ * @param bci The bitmap_coords_info structure.
+ * @param x The X coordinate.
+ * @param y The Y coordinate.
+ * @return The bounding box of the filled pixels.
+ */
+static Geom::OptIntRect fill_spans(guchar *trace_px, bitmap_coords_info const &bci, int x, int y)
+{
+    int const width = bci.width;
+    int const height = bci.height;
+
+    unsigned char *start_t = get_trace_pixel(trace_px, x, y, width);
+    if (!(*start_t & PIXEL_PAINTABLE) || (*start_t & (PIXEL_FILLED | PIXEL_COLORED))) {
+        return {};
+    }
+    if (!(*start_t & PIXEL_PASSABLE)) {
+        *start_t |= PIXEL_FILLED;
+        return Geom::IntRect::from_xywh(x, y, 1, 1);
+    }
+
+    auto fillable = [] (unsigned char t) { return (t & (PIXEL_PASSABLE | PIXEL_FILLED)) == PIXEL_PASSABLE; };
+
+    Geom::OptIntRect filled;
+    std::vector<Geom::IntPoint> seeds;
+    seeds.emplace_back(x, y);
+    while (!seeds.empty()) {
+        Geom::IntPoint const seed = seeds.back();
+        seeds.pop_back();
+
+        unsigned char *row = get_trace_pixel(trace_px, 0, seed.y(), width);
+        if (!fillable(row[seed.x()])) {
+            continue;
+        }
+        int left = seed.x();
+        int right = seed.x() + 1;
+        while (left > 0 && fillable(row[left - 1])) {
+            left--;
+        }
+        while (right < width && fillable(row[right])) {
+            right++;
+        }
+        for (int i = left; i < right; i++) {
+            row[i] |= PIXEL_FILLED;
+        }
+        filled.unionWith(Geom::IntRect(left, seed.y(), right, seed.y() + 1));
+
+        // Seed every run of fillable pixels above and below the span.
+        for (int next_y : {seed.y() - 1, seed.y() + 1}) {
+            if (next_y < 0 || next_y >= height) {
+                continue;
+            }
+            unsigned char const *next_row = get_trace_pixel(trace_px, 0, next_y, width);
+            bool in_run = false;
+            for (int i = left; i < right; i++) {
+                bool const can_fill = fillable(next_row[i]);
+                if (can_fill && !in_run) {
+                    seeds.emplace_back(i, next_y);
+                }
+                in_run = can_fill;
+            }
+        }
+    }
+    return filled;
+}
+
+/**
+ * Color the paintable pixels within the autogap radius of the filled pixels, and clear the
+ * filled marks for the next fill point.
+ * @param trace_px The trace pixel buffer.
+ * @param bci The bitmap_coords_info structure.
+ * @param filled The bounding box of the filled pixels.
+ * @return The bounding box of the pixels which may have been colored.
+ */
+static Geom::IntRect color_filled_pixels(guchar *trace_px, bitmap_coords_info const &bci, Geom::IntRect const &filled)
+{
+    Geom::IntPoint const radius(bci.radius, bci.radius);
+    Geom::IntRect const area = *Geom::intersect(Geom::IntRect(filled.min() - radius, filled.max() + radius),
+                                                Geom::IntRect(0, 0, bci.width, bci.height));
+
+    auto const near_filled = find_pixels_near(trace_px, bci, area,
+                                              [] (unsigned char t) { return (t & PIXEL_FILLED) != 0; });
+#if HAVE_OPENMP
+    #pragma omp parallel for num_threads(bci.threads) if (bci.threads > 1)
+#endif
+    for (int y = area.top(); y < area.bottom(); y++) {
+        unsigned char *trace_t = get_trace_pixel(trace_px, area.left(), y, bci.width);
+        unsigned char const *near_t = near_filled.data() + (y - area.top()) * area.width();
+        for (int x = area.left(); x < area.right(); x++, trace_t++, near_t++) {
+            if (*near_t && (*trace_t & PIXEL_PAINTABLE)) {
+                *trace_t |= PIXEL_COLORED;
+            }
+            *trace_t &= ~PIXEL_FILLED;
+        }
+    }
+    return area;
+}
+
 /**
  * Perform the bitmap-to-vector tracing and place the traced path onto the document.
  * @param px The trace pixel buffer to trace to SVG.
@@ -347,27 +539,26 @@ inline static bool check_if_pixel_is_paintable(guchar *px, unsigned char *trace_
  * @param transform The transform to apply to the final SVG path.
  * @param union_with_selection If true, merge the final SVG path with the current selection.
  */
-static void do_trace(bitmap_coords_info bci, guchar *trace_px, SPDesktop *desktop, Geom::Affine transform, unsigned int min_x, unsigned int max_x, unsigned int min_y, unsigned int max_y, bool union_with_selection) {
+static void do_trace(bitmap_coords_info const &bci, guchar const *trace_px, SPDesktop *desktop, Geom::Affine transform, unsigned int min_x, unsigned int max_x, unsigned int min_y, unsigned int max_y, bool union_with_selection) {
     SPDocument *document = desktop->getDocument();
 
-    unsigned char *trace_t;
-
     GrayMap *gray_map = GrayMapCreate((max_x - min_x + 1), (max_y - min_y + 1));
     if (!gray_map) {
         desktop->messageStack()->flash(Inkscape::ERROR_MESSAGE, _("Failed mid-operation, no objects created."));
         return;
     }
-    unsigned int gray_map_y = 0;
-    for (unsigned int y = min_y; y <= max_y; y++) {
-        unsigned long *gray_map_t = gray_map->rows[gray_map_y];
+#if HAVE_OPENMP
+    #pragma omp parallel for num_threads(bci.threads) if (bci.threads > 1)
+#endif
+    for (int y = min_y; y <= (int)max_y; y++) {
+        unsigned long *gray_map_t = gray_map->rows[y - min_y];
 
-        trace_t = get_trace_pixel(trace_px, min_x, y, bci.width);
+        unsigned char const *trace_t = get_trace_pixel(trace_px, min_x, y, bci.width);
         for (unsigned int x = min_x; x <= max_x; x++) {
             *gray_map_t = is_pixel_colored(trace_t) ? GRAYMAP_BLACK : GRAYMAP_WHITE;
             gray_map_t++;
             trace_t++;
         }
-        gray_map_y++;
     }
 
     Inkscape::Trace::Potrace::PotraceTracingEngine pte;
@@ -481,257 +672,16 @@ static void do_trace(bitmap_coords_info bci, guchar *trace_px, SPDesktop *deskto
     }
 }
 
-/**
- * The possible return states of perform_bitmap_scanline_check().
- */
-enum ScanlineCheckResult {
-    SCANLINE_CHECK_OK,
-    SCANLINE_CHECK_ABORTED,
-    SCANLINE_CHECK_BOUNDARY
-};
-
-/**
- * Determine if the provided coordinates are within the pixel buffer limits.
- * @param x The X coordinate.
- * @param y The Y coordinate.
- * @param bci The bitmap_coords_info structure.
- */
-inline static bool coords_in_range(unsigned int x, unsigned int y, bitmap_coords_info bci) {
-    return (x < bci.width) &&
-           (y < bci.height);
-}
-
-#define PAINT_DIRECTION_LEFT 1
-#define PAINT_DIRECTION_RIGHT 2
-#define PAINT_DIRECTION_UP 4
-#define PAINT_DIRECTION_DOWN 8
-#define PAINT_DIRECTION_ALL 15
-
-/**
- * Paint a pixel or a square (if autogap is enabled) on the trace pixel buffer.
- * @param px The rendered pixel buffer to check.
- * @param trace_px The trace pixel buffer.
- * @param orig_color The original selected pixel to use as the fill target color.
- * @param bci The bitmap_coords_info structure.
- * @param original_point_trace_t The original pixel in the trace pixel buffer to check.
- */
-inline static unsigned int paint_pixel(guchar *px, guchar *trace_px, guint32 orig_color, bitmap_coords_info bci, unsigned char *original_point_trace_t) {
-    if (bci.radius == 0) {
-        mark_pixel_colored(original_point_trace_t); 
-        return PAINT_DIRECTION_ALL;
-    } else {
-        unsigned char *trace_t;
-  
-        bool can_paint_up = true;
-        bool can_paint_down = true;
-        bool can_paint_left = true;
-        bool can_paint_right = true;
-      
-        for (unsigned int ty = bci.y - bci.radius; ty <= bci.y + bci.radius; ty++) {
-            for (unsigned int tx = bci.x - bci.radius; tx <= bci.x + bci.radius; tx++) {
-                if (coords_in_range(tx, ty, bci)) {
-                    trace_t = get_trace_pixel(trace_px, tx, ty, bci.width);
-                    if (!is_pixel_colored(trace_t)) {
-                        if (check_if_pixel_is_paintable(px, trace_t, tx, ty, orig_color, bci)) {
-                            mark_pixel_colored(trace_t); 
-                        } else {
-                            if (tx < bci.x) { can_paint_left = false; }
-                            if (tx > bci.x) { can_paint_right = false; }
-                            if (ty < bci.y) { can_paint_up = false; }
-                            if (ty > bci.y) { can_paint_down = false; }
-                        }
-                    }
-                }
-            }
-        }
-    
-        unsigned int paint_directions = 0;
-        if (can_paint_left) { paint_directions += PAINT_DIRECTION_LEFT; }
-        if (can_paint_right) { paint_directions += PAINT_DIRECTION_RIGHT; }
-        if (can_paint_up) { paint_directions += PAINT_DIRECTION_UP; }
-        if (can_paint_down) { paint_directions += PAINT_DIRECTION_DOWN; }
-        
-        return paint_directions;
-    }
-}
-
-/**
- * Push a point to be checked onto the bottom of the rendered pixel buffer check queue.
- * @param fill_queue The fill queue to add the point to.
- * @param max_queue_size The maximum size of the fill queue.
- * @param trace_t The trace pixel buffer pixel.
- * @param x The X coordinate.
- * @param y The Y coordinate.
- */
-static void push_point_onto_queue(std::deque<Geom::Point> *fill_queue, unsigned int max_queue_size, unsigned char *trace_t, unsigned int x, unsigned int y) {
-    if (!is_pixel_queued(trace_t)) {
-        if ((fill_queue->size() < max_queue_size)) {
-            fill_queue->push_back(Geom::Point(x, y));
-            mark_pixel_queued(trace_t);
-        }
-    }
-}
-
-/**
- * Shift a point to be checked onto the top of the rendered pixel buffer check queue.
- * @param fill_queue The fill queue to add the point to.
- * @param max_queue_size The maximum size of the fill queue.
- * @param trace_t The trace pixel buffer pixel.
- * @param x The X coordinate.
- * @param y The Y coordinate.
- */
-static void shift_point_onto_queue(std::deque<Geom::Point> *fill_queue, unsigned int max_queue_size, unsigned char *trace_t, unsigned int x, unsigned int y) {
-    if (!is_pixel_queued(trace_t)) {
-        if ((fill_queue->size() < max_queue_size)) {
-            fill_queue->push_front(Geom::Point(x, y));
-            mark_pixel_queued(trace_t);
-        }
-    }
-}
-
-/**
- * Scan a row in the rendered pixel buffer and add points to the fill queue as necessary.
- * @param fill_queue The fill queue to add the point to.
- * @param px The rendered pixel buffer.
- * @param trace_px The trace pixel buffer.
- * @param orig_color The original selected pixel to use as the fill target color.
- * @param bci The bitmap_coords_info structure.
- */
-static ScanlineCheckResult perform_bitmap_scanline_check(std::deque<Geom::Point> *fill_queue, guchar *px, guchar *trace_px, guint32 orig_color, bitmap_coords_info bci, unsigned int *min_x, unsigned int *max_x) {
-    bool aborted = false;
-    bool reached_screen_boundary = false;
-    bool ok;
-
-    bool keep_tracing;
-    bool initial_paint = true;
-
-    unsigned char *current_trace_t = get_trace_pixel(trace_px, bci.x, bci.y, bci.width);
-    unsigned int paint_directions;
-
-    bool currently_painting_top = false;
-    bool currently_painting_bottom = false;
-
-    unsigned int top_ty = (bci.y > 0) ? bci.y - 1 : 0;
-    unsigned int bottom_ty = bci.y + 1;
-
-    bool can_paint_top = (top_ty > 0);
-    bool can_paint_bottom = (bottom_ty < bci.height);
-
-    Geom::Point front_of_queue = fill_queue->empty() ? Geom::Point() : fill_queue->front();
-
-    do {
-        ok = false;
-        if (bci.is_left) {
-            keep_tracing = (bci.x != 0);
-        } else {
-            keep_tracing = (bci.x < bci.width);
-        }
-
-        *min_x = MIN(*min_x, bci.x);
-        *max_x = MAX(*max_x, bci.x);
-
-        if (keep_tracing) {
-            if (check_if_pixel_is_paintable(px, current_trace_t, bci.x, bci.y, orig_color, bci)) {
-                paint_directions = paint_pixel(px, trace_px, orig_color, bci, current_trace_t);
-                if (bci.radius == 0) {
-                    mark_pixel_checked(current_trace_t);
-                    if ((!fill_queue->empty()) &&
-                        (front_of_queue[Geom::X] == bci.x) &&
-                        (front_of_queue[Geom::Y] == bci.y)) {
-                        fill_queue->pop_front();
-                        front_of_queue = fill_queue->empty() ? Geom::Point() : fill_queue->front();
-                    }
-                }
-
-                if (can_paint_top) {
-                    if (paint_directions & PAINT_DIRECTION_UP) { 
-                        unsigned char *trace_t = current_trace_t - bci.width;
-                        if (!is_pixel_queued(trace_t)) {
-                            bool ok_to_paint = check_if_pixel_is_paintable(px, trace_t, bci.x, top_ty, orig_color, bci);
-
-                            if (initial_paint) { currently_painting_top = !ok_to_paint; }
-
-                            if (ok_to_paint && (!currently_painting_top)) {
-                                currently_painting_top = true;
-                                push_point_onto_queue(fill_queue, bci.max_queue_size, trace_t, bci.x, top_ty);
-                            }
-                            if ((!ok_to_paint) && currently_painting_top) {
-                                currently_painting_top = false;
-                            }
-                        }
-                    }
-                }
-
-                if (can_paint_bottom) {
-                    if (paint_directions & PAINT_DIRECTION_DOWN) { 
-                        unsigned char *trace_t = current_trace_t + bci.width;
-                        if (!is_pixel_queued(trace_t)) {
-                            bool ok_to_paint = check_if_pixel_is_paintable(px, trace_t, bci.x, bottom_ty, orig_color, bci);
-
-                            if (initial_paint) { currently_painting_bottom = !ok_to_paint; }
-
-                            if (ok_to_paint && (!currently_painting_bottom)) {
-                                currently_painting_bottom = true;
-                                push_point_onto_queue(fill_queue, bci.max_queue_size, trace_t, bci.x, bottom_ty);
-                            }
-                            if ((!ok_to_paint) && currently_painting_bottom) {
-                                currently_painting_bottom = false;
-                            }
-                        }
-                    }
-                }
-
-                if (bci.is_left) {
-                    if (paint_directions & PAINT_DIRECTION_LEFT) {
-                        bci.x--; current_trace_t--;
-                        ok = true;
-                    }
-                } else {
-                    if (paint_directions & PAINT_DIRECTION_RIGHT) {
-                        bci.x++; current_trace_t++;
-                        ok = true;
-                    }
-                }
-
-                initial_paint = false;
-            }
-        } else {
-            if (bci.bbox.min()[Geom::X] > bci.screen.min()[Geom::X]) {
-                aborted = true; break;
-            } else {
-                reached_screen_boundary = true;
-            }
-        }
-    } while (ok);
-
-    if (aborted) { return SCANLINE_CHECK_ABORTED; }
-    if (reached_screen_boundary) { return SCANLINE_CHECK_BOUNDARY; }
-    return SCANLINE_CHECK_OK;
-}
-
-/**
- * Sort the rendered pixel buffer check queue vertically.
- */
-static bool sort_fill_queue_vertical(Geom::Point a, Geom::Point b) {
-    return a[Geom::Y] > b[Geom::Y];
-}
-
-/**
- * Sort the rendered pixel buffer check queue horizontally.
- */
-static bool sort_fill_queue_horizontal(Geom::Point a, Geom::Point b) {
-    return a[Geom::X] > b[Geom::X];
-}
-
 /**
  * Perform a flood fill operation.
  * @param desktop The desktop of this tool's event context.
+ * @param tool The tool, which keeps the render of the document between fills.
  * @param event The details of this event.
  * @param union_with_selection If true, union the new fill with the current selection.
  * @param is_point_fill If false, use the Rubberband "touch selection" to get the initial points for the fill.
  * @param is_touch_fill If true, use only the initial contact point in the Rubberband "touch selection" as the fill target color.
  */
-static void sp_flood_do_flood_fill(SPDesktop *desktop, GdkEvent *event,
+static void sp_flood_do_flood_fill(SPDesktop *desktop, FloodTool *tool, GdkEvent *event,
                                    bool union_with_selection, bool is_point_fill, bool is_touch_fill) {
 
     SPDocument *document = desktop->getDocument();
@@ -759,66 +709,16 @@ static void sp_flood_do_flood_fill(SPDesktop *desktop, GdkEvent *event,
     auto const width = img_dims.x();
     auto const height = img_dims.y();
 
-    int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, width);
-    guchar *px = g_new(guchar, stride * height);
-    guint32 bgcolor, dtc;
-
-    // Draw image into data block px
-    { // this block limits the lifetime of Drawing and DrawingContext
-        /* Create DrawingItems and set transform */
-        unsigned dkey = SPItem::display_key_new(1);
-        Inkscape::Drawing drawing;
-        Inkscape::DrawingItem *root = document->getRoot()->invoke_show( drawing, dkey, SP_ITEM_SHOW_DISPLAY);
-        root->setTransform(doc2img);
-        drawing.setRoot(root);
-
-        Geom::IntRect final_bbox = Geom::IntRect::from_xywh(0, 0, width, height);
-        drawing.update(final_bbox);
-
-        cairo_surface_t *s = cairo_image_surface_create_for_data(
-            px, CAIRO_FORMAT_ARGB32, width, height, stride);
-        Inkscape::DrawingContext dc(s, Geom::Point(0,0));
-        // cairo_translate not necessary here - surface origin is at 0,0
-
-        bgcolor = document->getPageManager().background_color;
+    guint32 bgcolor = document->getPageManager().background_color;
 
-        // bgcolor is 0xrrggbbaa, we need 0xaarrggbb
-        dtc = (bgcolor >> 8) | (bgcolor << 24);
-
-        dc.setSource(bgcolor);
-        dc.setOperator(CAIRO_OPERATOR_SOURCE);
-        dc.paint();
-        dc.setOperator(CAIRO_OPERATOR_OVER);
-
-        drawing.render(dc, final_bbox);
-
-        //cairo_surface_write_to_png( s, "cairo.png" );
-
-        cairo_surface_flush(s);
-        cairo_surface_destroy(s);
-        
-        // Hide items
-        document->getRoot()->invoke_hide(dkey);
-    }
+    // bgcolor is 0xrrggbbaa, we need 0xaarrggbb
+    guint32 dtc = (bgcolor >> 8) | (bgcolor << 24);
 
-    // {
-    //     // Dump data to png
-    //     cairo_surface_t *s = cairo_image_surface_create_for_data(
-    //         px, CAIRO_FORMAT_ARGB32, width, height, stride);
-    //     cairo_surface_write_to_png( s, "cairo2.png" );
-    //     std::cout << "  Wrote cairo2.png" << std::endl;
-    // }
+    int stride = 0;
+    guchar const *px = tool->renderDocument(doc2img, img_dims, bgcolor, stride);
 
-    guchar *trace_px = g_new(guchar, width * height);
-    memset(trace_px, 0x00, width * height);
-    
-    std::deque<Geom::Point> fill_queue;
-    std::queue<Geom::Point> color_queue;
-    
-    std::vector<Geom::Point> fill_points;
-    
-    bool aborted = false;
-    int y_limit = height - 1;
+    std::vector<guchar> trace_buffer(width * height, 0);
+    guchar *trace_px = trace_buffer.data();
 
     Inkscape::Preferences *prefs = Inkscape::Preferences::get();
     PaintBucketChannels method = (PaintBucketChannels) prefs->getInt("/tools/paintbucket/channels", 0);
@@ -840,19 +740,16 @@ static void sp_flood_do_flood_fill(SPDesktop *desktop, GdkEvent *event,
 
     bitmap_coords_info bci;
     
-    bci.y_limit = y_limit;
     bci.width = width;
     bci.height = height;
     bci.stride = stride;
     bci.threshold = threshold;
     bci.method = method;
-    bci.bbox = *bbox;
-    bci.screen = screen;
     bci.dtc = dtc;
     bci.radius = prefs->getIntLimited("/tools/paintbucket/autogap", 0, 0, 3);
-    bci.max_queue_size = (width * height) / 4;
-    bci.current_step = 0;
+    bci.threads = flood_threads();
 
+    std::vector<Geom::Point> fill_points;
     if (is_point_fill) {
         fill_points.emplace_back(event->button.x, event->button.y);
     } else {
@@ -862,190 +759,72 @@ static void sp_flood_do_flood_fill(SPDesktop *desktop, GdkEvent *event,
 
     auto const img_max_indices = Geom::Rect::from_xywh(0, 0, width - 1, height - 1);
 
-    for (unsigned int i = 0; i < fill_points.size(); i++) {
-        Geom::Point pw = fill_points[i] * world2img;
-
-        pw = img_max_indices.clamp(pw);
-
-        if (is_touch_fill) {
-            if (i == 0) {
-                color_queue.push(pw);
-            } else {
-                unsigned char *trace_t = get_trace_pixel(trace_px, (int)pw[Geom::X], (int)pw[Geom::Y], width);
-                push_point_onto_queue(&fill_queue, bci.max_queue_size, trace_t, (int)pw[Geom::X], (int)pw[Geom::Y]);
-            }
-        } else {
-            color_queue.push(pw);
-        }
+    std::vector<Geom::IntPoint> points;
+    for (auto const &point : fill_points) {
+        Geom::Point pw = img_max_indices.clamp(point * world2img);
+        points.emplace_back((int)pw[Geom::X], (int)pw[Geom::Y]);
     }
 
-    bool reached_screen_boundary = false;
-
-    bool first_run = true;
-
-    unsigned long sort_size_threshold = 5;
+    // Every point is filled with its own color, except in a touch fill, where the color of the
+    // first point is filled from all points.
+    std::size_t const color_points = is_touch_fill ? std::min<std::size_t>(points.size(), 1) : points.size();
 
-    unsigned int min_y = height;
-    unsigned int max_y = 0;
-    unsigned int min_x = width;
-    unsigned int max_x = 0;
+    Geom::OptIntRect filled_area;
+    Geom::OptIntRect colored_area;
+    guint32 paintable_color = 0;
+    bool paintable_marked = false;
 
-    while (!color_queue.empty() && !aborted) {
-        Geom::Point color_point = color_queue.front();
-        color_queue.pop();
-
-        int cx = (int)color_point[Geom::X];
-        int cy = (int)color_point[Geom::Y];
-
-        guint32 orig_color = get_pixel(px, cx, cy, stride);
-        bci.merged_orig_pixel = compose_onto(orig_color, dtc);
-
-        unsigned char *trace_t = get_trace_pixel(trace_px, cx, cy, width);
-        if (!is_pixel_checked(trace_t) && !is_pixel_colored(trace_t)) {
-            if (check_if_pixel_is_paintable(px, trace_px, cx, cy, orig_color, bci)) {
-                shift_point_onto_queue(&fill_queue, bci.max_queue_size, trace_t, cx, cy);
-
-                if (!first_run) {
-                    for (unsigned int y = 0; y < height; y++) {
-                        trace_t = get_trace_pixel(trace_px, 0, y, width);
-                        for (unsigned int x = 0; x < width; x++) {
-                            clear_pixel_paintability(trace_t);
-                            trace_t++;
-                        }
-                    }
-                }
-                first_run = false;
-            }
+    for (std::size_t i = 0; i < color_points; i++) {
+        Geom::IntPoint const cp = points[i];
+        if (is_pixel_colored(get_trace_pixel(trace_px, cp.x(), cp.y(), width))) {
+            continue;
         }
 
-        unsigned long old_fill_queue_size = fill_queue.size();
-
-        while (!fill_queue.empty() && !aborted) {
-            Geom::Point cp = fill_queue.front();
-
-            if (bci.radius == 0) {
-                unsigned long new_fill_queue_size = fill_queue.size();
-
-                /*
-                 * To reduce the number of points in the fill queue, periodically
-                 * resort all of the points in the queue so that scanline checks
-                 * can complete more quickly.  A point cannot be checked twice
-                 * in a normal scanline checks, so forcing scanline checks to start
-                 * from one corner of the rendered area as often as possible
-                 * will reduce the number of points that need to be checked and queued.
-                 */
-                if (new_fill_queue_size > sort_size_threshold) {
-                    if (new_fill_queue_size > old_fill_queue_size) {
-                        std::sort(fill_queue.begin(), fill_queue.end(), sort_fill_queue_vertical);
-
-                        std::deque<Geom::Point>::iterator start_sort = fill_queue.begin();
-                        std::deque<Geom::Point>::iterator end_sort = fill_queue.begin();
-                        unsigned int sort_y = (unsigned int)cp[Geom::Y];
-                        unsigned int current_y;
-                        
-                        for (std::deque<Geom::Point>::iterator i = fill_queue.begin(); i != fill_queue.end(); ++i) {
-                            Geom::Point current = *i;
-                            current_y = (unsigned int)current[Geom::Y];
-                            if (current_y != sort_y) {
-                                if (start_sort != end_sort) {
-                                    std::sort(start_sort, end_sort, sort_fill_queue_horizontal);
-                                }
-                                sort_y = current_y;
-                                start_sort = i;
-                            }
-                            end_sort = i;
-                        }
-                        if (start_sort != end_sort) {
-                            std::sort(start_sort, end_sort, sort_fill_queue_horizontal);
-                        }
-                        
-                        cp = fill_queue.front();
-                    }
-                }
-
-                old_fill_queue_size = new_fill_queue_size;
-            }
-
-            fill_queue.pop_front();
-
-            int x = (int)cp[Geom::X];
-            int y = (int)cp[Geom::Y];
-
-            min_y = MIN((unsigned int)y, min_y);
-            max_y = MAX((unsigned int)y, max_y);
-
-            unsigned char *trace_t = get_trace_pixel(trace_px, x, y, width);
-            if (!is_pixel_checked(trace_t)) {
-                mark_pixel_checked(trace_t);
-
-                if (y == 0) {
-                    if (bbox->min()[Geom::Y] > screen.min()[Geom::Y]) {
-                        aborted = true; break;
-                    } else {
-                        reached_screen_boundary = true;
-                    }
-                }
-
-                if (y == y_limit) {
-                    if (bbox->max()[Geom::Y] < screen.max()[Geom::Y]) {
-                        aborted = true; break;
-                    } else {
-                        reached_screen_boundary = true;
-                    }
-                }
-
-                bci.is_left = true;
-                bci.x = x;
-                bci.y = y;
-
-                ScanlineCheckResult result = perform_bitmap_scanline_check(&fill_queue, px, trace_px, orig_color, bci, &min_x, &max_x);
-
-                switch (result) {
-                    case SCANLINE_CHECK_ABORTED:
-                        aborted = true;
-                        break;
-                    case SCANLINE_CHECK_BOUNDARY:
-                        reached_screen_boundary = true;
-                        break;
-                    default:
-                        break;
-                }
+        guint32 orig_color = get_pixel(px, cp.x(), cp.y(), stride);
+        if (!paintable_marked || orig_color != paintable_color) {
+            bci.merged_orig_pixel = compose_onto(orig_color, dtc);
+            mark_paintable_pixels(px, trace_px, orig_color, bci);
+            paintable_color = orig_color;
+            paintable_marked = true;
+        }
 
-                if (bci.x < width) {
-                    trace_t++;
-                    if (!is_pixel_checked(trace_t) && !is_pixel_queued(trace_t)) {
-                        mark_pixel_checked(trace_t);
-                        bci.is_left = false;
-                        bci.x = x + 1;
-
-                        result = perform_bitmap_scanline_check(&fill_queue, px, trace_px, orig_color, bci, &min_x, &max_x);
-
-                        switch (result) {
-                            case SCANLINE_CHECK_ABORTED:
-                                aborted = true;
-                                break;
-                            case SCANLINE_CHECK_BOUNDARY:
-                                reached_screen_boundary = true;
-                                break;
-                            default:
-                                break;
-                        }
-                    }
-                }
+        Geom::OptIntRect filled;
+        if (is_touch_fill) {
+            for (auto const &p : points) {
+                filled.unionWith(fill_spans(trace_px, bci, p.x(), p.y()));
             }
+        } else {
+            filled = fill_spans(trace_px, bci, cp.x(), cp.y());
+        }
+        if (filled) {
+            filled_area.unionWith(filled);
+            colored_area.unionWith(color_filled_pixels(trace_px, bci, *filled));
+        }
+    }
 
-            bci.current_step++;
+    if (!filled_area) {
+        return;
+    }
 
-            if (bci.current_step > bci.max_queue_size) {
+    // A fill reaching the edge of the render leaks out of it, unless the drawing extends past
+    // the screen on that side, where the area may still be closed.
+    bool aborted = false;
+    bool reached_screen_boundary = false;
+    auto check_edge = [&] (bool reached, bool drawing_beyond_screen) {
+        if (reached) {
+            if (drawing_beyond_screen) {
+                reached_screen_boundary = true;
+            } else {
                 aborted = true;
             }
         }
-    }
-    
-    g_free(px);
-    
+    };
+    check_edge(filled_area->left() == 0, bbox->min()[Geom::X] <= screen.min()[Geom::X]);
+    check_edge(filled_area->right() == width, bbox->max()[Geom::X] >= screen.max()[Geom::X]);
+    check_edge(filled_area->top() == 0, bbox->min()[Geom::Y] <= screen.min()[Geom::Y]);
+    check_edge(filled_area->bottom() == height, bbox->max()[Geom::Y] >= screen.max()[Geom::Y]);
+
     if (aborted) {
-        g_free(trace_px);
         desktop->messageStack()->flash(Inkscape::WARNING_MESSAGE, _("<b>Area is not bounded</b>, cannot fill."));
         return;
     }
@@ -1054,18 +833,20 @@ static void sp_flood_do_flood_fill(SPDesktop *desktop, GdkEvent *event,
         desktop->messageStack()->flash(Inkscape::WARNING_MESSAGE, _("<b>Only the visible part of the bounded area was filled.</b> If you want to fill all of the area, undo, zoom out, and fill again.")); 
     }
 
-    unsigned int trace_padding = bci.radius + 1;
-    if (min_y > trace_padding) { min_y -= trace_padding; }
-    if (max_y < (y_limit - trace_padding)) { max_y += trace_padding; }
-    if (min_x > trace_padding) { min_x -= trace_padding; }
-    if (max_x < (width - 1 - trace_padding)) { max_x += trace_padding; }
+    int const trace_padding = bci.radius + 1;
+    Geom::IntPoint const trace_margin(trace_padding, trace_padding);
+    Geom::IntRect const trace_area = *Geom::intersect(Geom::IntRect(colored_area->min() - trace_margin,
+                                                                    colored_area->max() + trace_margin),
+                                                      Geom::IntRect(0, 0, width, height));
+    unsigned int const min_x = trace_area.left();
+    unsigned int const max_x = trace_area.right() - 1;
+    unsigned int const min_y = trace_area.top();
+    unsigned int const max_y = trace_area.bottom() - 1;
 
     Geom::Affine inverted_affine = Geom::Translate(min_x, min_y) * doc2img.inverse();
     
     do_trace(bci, trace_px, desktop, inverted_affine, min_x, max_x, min_y, max_y, union_with_selection);
 
-    g_free(trace_px);
-    
     DocumentUndo::done(document, _("Fill bounded area"), INKSCAPE_ICON("color-fill"));
 }
 
@@ -1162,7 +943,7 @@ bool FloodTool::root_handler(GdkEvent* event) {
                 SPDesktop* current_desktop = _desktop;
 
                 current_desktop->setWaitingCursor();
-                sp_flood_do_flood_fill(current_desktop, event,
+                sp_flood_do_flood_fill(current_desktop, this, event,
                                        event->button.state & GDK_SHIFT_MASK,
                                        is_point_fill, is_touch_fill);
                 current_desktop->clearWaitingCursor();
@@ -1218,6 +999,95 @@ void FloodTool::finishItem() {
     }
 }
 
+/**
+ * Render the document over a background color, in an ARGB32 pixel buffer.
+ *
+ * The document is shown in a drawing of its own once and the drawing is kept, so that only the
+ * items which change between fills are updated. The render is kept as well, and reused until
+ * the document is modified or a fill asks for another transform, size or background.
+ *
+ * @param doc2img The transform from document to pixel coordinates.
+ * @param dims The size of the pixel buffer.
+ * @param bgcolor The background color, in RGBA.
+ * @param stride Set to the rowstride of the pixel buffer.
+ * @return The pixel buffer, valid until the next call or until the tool is destroyed.
+ */
+guchar const *FloodTool::renderDocument(Geom::Affine const &doc2img, Geom::IntPoint const &dims, guint32 bgcolor, int &stride)
+{
+    SPDocument *document = _desktop->getDocument();
+    if (document != _drawing_doc) {
+        releaseDrawing();
+        _drawing = std::make_unique<Inkscape::Drawing>();
+        _dkey = SPItem::display_key_new(1);
+        _drawing->setRoot(document->getRoot()->invoke_show(*_drawing, _dkey, SP_ITEM_SHOW_DISPLAY));
+        _drawing_doc = document;
+        _doc_modified_connection = document->connectModified([this] (unsigned) { _render_valid = false; });
+        _doc_destroy_connection = document->connectDestroy([this] { releaseDrawing(); });
+    }
+
+    int const width = dims.x();
+    int const height = dims.y();
+    stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, width);
+
+    if (_render_valid && _render_transform == doc2img && _render_dims == dims && _render_bgcolor == bgcolor) {
+        return _render.data();
+    }
+
+    _drawing->root()->setTransform(doc2img);
+    _drawing->update(Geom::IntRect::from_xywh(0, 0, width, height));
+    _render.resize(stride * height);
+
+    // The drawing is up to date, so bands of the render can be drawn concurrently.
+    int const bands = flood_threads();
+    int const band_height = (height + bands - 1) / bands;
+#if HAVE_OPENMP
+    #pragma omp parallel for num_threads(bands) schedule(dynamic, 1) if (bands > 1)
+#endif
+    for (int b = 0; b < bands; b++) {
+        int const top = b * band_height;
+        int const rows = std::min(band_height, height - top);
+        if (rows <= 0) {
+            continue;
+        }
+        cairo_surface_t *s = cairo_image_surface_create_for_data(
+            _render.data() + top * stride, CAIRO_FORMAT_ARGB32, width, rows, stride);
+        { // this block limits the lifetime of the DrawingContext
+            Inkscape::DrawingContext dc(s, Geom::Point(0, top));
+
+            dc.setSource(bgcolor);
+            dc.setOperator(CAIRO_OPERATOR_SOURCE);
+            dc.paint();
+            dc.setOperator(CAIRO_OPERATOR_OVER);
+
+            _drawing->render(dc, Geom::IntRect::from_xywh(0, top, width, rows));
+        }
+        cairo_surface_flush(s);
+        cairo_surface_destroy(s);
+    }
+
+    _render_transform = doc2img;
+    _render_dims = dims;
+    _render_bgcolor = bgcolor;
+    _render_valid = true;
+    return _render.data();
+}
+
+/**
+ * Hide the document from the drawing of renderDocument() and drop the drawing and its render.
+ */
+void FloodTool::releaseDrawing()
+{
+    _doc_modified_connection.disconnect();
+    _doc_destroy_connection.disconnect();
+    if (_drawing_doc) {
+        _drawing_doc->getRoot()->invoke_hide(_dkey);
+        _drawing_doc = nullptr;
+    }
+    _drawing.reset();
+    std::vector<guchar>().swap(_render);
+    _render_valid = false;
+}
+
 void FloodTool::set_channels(gint channels) {
     Inkscape::Preferences *prefs = Inkscape::Preferences::get();
     prefs->setInt("/tools/paintbucket/channels", channels);
@@ -12,8 +12,11 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <memory>
 #include <vector>
 
+#include <2geom/affine.h>
+#include <2geom/int-point.h>
 #include <sigc++/connection.h>
 
 #include "ui/tools/tool-base.h"
@@ -21,8 +24,11 @@
 #define SP_FLOOD_CONTEXT(obj) (dynamic_cast<Inkscape::UI::Tools::FloodTool*>((Inkscape::UI::Tools::ToolBase*)obj))
 #define SP_IS_FLOOD_CONTEXT(obj) (dynamic_cast<const Inkscape::UI::Tools::FloodTool*>((const Inkscape::UI::Tools::ToolBase*)obj) != NULL)
 
+class SPDocument;
+
 namespace Inkscape {
 
+class Drawing;
 class Selection;
 
 namespace UI {
@@ -44,9 +50,24 @@ public:
 	static const std::vector<Glib::ustring> channel_list;
 	static const std::vector<Glib::ustring> gap_list;
 
+	guchar const *renderDocument(Geom::Affine const &doc2img, Geom::IntPoint const &dims, guint32 bgcolor, int &stride);
+
 private:
 	void selection_changed(Inkscape::Selection* selection);
 	void finishItem();
+	void releaseDrawing();
+
+	// The document shown for renderDocument(), and its last render.
+	std::unique_ptr<Inkscape::Drawing> _drawing;
+	SPDocument *_drawing_doc = nullptr;
+	unsigned _dkey = 0;
+	sigc::connection _doc_modified_connection;
+	sigc::connection _doc_destroy_connection;
+	std::vector<guchar> _render;
+	Geom::Affine _render_transform;
+	Geom::IntPoint _render_dims;
+	guint32 _render_bgcolor = 0;
+	bool _render_valid = false;
 };
 
 enum PaintBucketChannels {
@@ -14,6 +14,10 @@
 #include <algorithm> // Sort
 #include <set> // Coarsener
 
+#ifdef HAVE_OPENMP
+#include <omp.h>
+#endif
+
 #include <glibmm/i18n.h>
 
 #include <2geom/rect.h>
@@ -57,8 +61,10 @@
  *                      unclean into rectangles that are small enough to render quickly, and renders them outwards
  *                      from the mouse with a call to:
  *
- *   * paint_rect_internal() Which paints the rectangle using paint_single_buffer(). It renders onto a Cairo
- *                           surface "backing_store". After a piece is rendered there is a call to:
+ *   * paint_rects_internal() Which paints a batch of rectangles using paint_single_buffer(). It renders onto a
+ *                            Cairo surface "backing_store". With multithreaded rendering enabled, the rectangles
+ *                            of a batch are rendered concurrently, one per thread; otherwise batches hold a single
+ *                            rectangle. After a batch is rendered there is a call to:
  *
  *   * queue_draw_area() A Gtk function for marking areas of the window as needing a repaint, which when
  *                       the time is right calls:
@@ -138,6 +144,15 @@ struct Pref<double> : PrefBase<double>
     double changed(const Preferences::Entry &e) {return e.getDoubleLimited(def, min, max);}
 };
 
+int default_num_threads()
+{
+#ifdef HAVE_OPENMP
+    return omp_get_num_procs();
+#else
+    return 1;
+#endif
+}
+
 struct Prefs
 {
     // Original parameters
@@ -147,6 +162,7 @@ struct Prefs
     Pref<bool>   from_display             = Pref<bool>  ("/options/displayprofile/from_display");
     Pref<int>    grabsize                 = Pref<int>   ("/options/grabsize/value", 3, 1, 15);
     Pref<int>    outline_overlay_opacity  = Pref<int>   ("/options/rendering/outline-overlay-opacity", 50, 1, 100);
+    Pref<int>    num_threads              = Pref<int>   ("/options/threading/numthreads", default_num_threads(), 1, 256);
 
     // New parameters
     Pref<int>    update_strategy          = Pref<int>   ("/options/rendering/update_strategy", 3, 1, 3);
@@ -158,6 +174,7 @@ struct Prefs
     Pref<int>    coarsener_min_size       = Pref<int>   ("/options/rendering/coarsener_min_size", 200, 0, 1000);
     Pref<int>    coarsener_glue_size      = Pref<int>   ("/options/rendering/coarsener_glue_size", 80, 0, 1000);
     Pref<double> coarsener_min_fullness   = Pref<double>("/options/rendering/coarsener_min_fullness", 0.3, 0.0, 1.0);
+    Pref<bool>   multithreaded            = Pref<bool>  ("/options/rendering/multithreaded");
 
     // Debug switches
     Pref<bool>   debug_framecheck         = Pref<bool>  ("/options/rendering/debug_framecheck");
@@ -187,6 +204,7 @@ void Prefs::set_devmode(bool on)
     coarsener_min_size.set_enabled(on);
     coarsener_glue_size.set_enabled(on);
     coarsener_min_fullness.set_enabled(on);
+    multithreaded.set_enabled(on);
     debug_framecheck.set_enabled(on);
     debug_logging.set_enabled(on);
     debug_slow_redraw.set_enabled(on);
@@ -519,8 +537,10 @@ public:
 
     // Drawing
     bool on_idle();
-    void paint_rect_internal(Geom::IntRect const &rect);
+    void paint_rects_internal(std::vector<Geom::IntRect> const &rects);
+    void paint_buffers(std::vector<Geom::IntRect> const &rects, Cairo::RefPtr<Cairo::ImageSurface> const &store);
     void paint_single_buffer(Geom::IntRect const &paint_rect, Cairo::RefPtr<Cairo::ImageSurface> const &store);
+    void finish_single_buffer(Geom::IntRect const &paint_rect, Cairo::RefPtr<Cairo::ImageSurface> const &store);
     std::optional<Geom::Dim2> old_bisector(const Geom::IntRect &rect);
     std::optional<Geom::Dim2> new_bisector(const Geom::IntRect &rect);
 
@@ -2457,8 +2477,26 @@ CanvasPrivate::on_idle()
         mouse_loc = geom_act(_store_affine * q->_affine.inverse(), mouse_loc);
     }
 
+    // Number of rectangles to paint at once; each one of a batch is rendered on its own thread.
+    auto const batch_size = prefs.multithreaded ? (size_t)prefs.num_threads : 1;
+    std::vector<Geom::IntRect> batch;
+    batch.reserve(batch_size);
+
     // Begin processing redraws.
     auto start_time = g_get_monotonic_time();
+    auto paint_batch = [&, this] {
+        // Paint the batch, and check for timeout.
+        paint_rects_internal(batch);
+        batch.clear();
+        auto now = g_get_monotonic_time();
+        auto elapsed = now - start_time;
+        if (elapsed > prefs.render_time_limit) {
+            if (prefs.debug_logging) std::cout << "Timed out: " << g_get_monotonic_time() - start_time << " us" << std::endl;
+            framecheckobj.subtype = 1;
+            return true;
+        }
+        return false;
+    };
     while (true) {
         // Get the clean region for the next redraw as reported by the updater.
         auto clean_region = updater->get_next_clean_region();
@@ -2524,20 +2562,22 @@ CanvasPrivate::on_idle()
                 continue;
             }
 
-            // Paint the rectangle.
-            paint_rect_internal(rect);
-
-            // Check for timeout.
-            auto now = g_get_monotonic_time();
-            auto elapsed = now - start_time;
-            if (elapsed > prefs.render_time_limit) {
+            // Add the rectangle to the batch, and paint the batch once it is full.
+            batch.emplace_back(rect);
+            if (batch.size() < batch_size) {
+                continue;
+            }
+            if (paint_batch()) {
                 // Timed out. Temporarily return to GTK main loop, and come back here when next idle.
-                if (prefs.debug_logging) std::cout << "Timed out: " << g_get_monotonic_time() - start_time << " us" << std::endl;
-                framecheckobj.subtype = 1;
                 return true;
             }
         }
 
+        // Paint the last, incomplete batch.
+        if (!batch.empty() && paint_batch()) {
+            return true;
+        }
+
         // Report the redraw as finished. Exit if there's no more redraws to process.
         bool keep_going = updater->report_finished();
         if (!keep_going) break;
@@ -2571,56 +2611,88 @@ CanvasPrivate::on_idle()
 }
 
 void
-CanvasPrivate::paint_rect_internal(Geom::IntRect const &rect)
+CanvasPrivate::paint_rects_internal(std::vector<Geom::IntRect> const &rects)
 {
-    // Paint the rectangle.
+    // Paint the rectangles.
     q->_drawing->setColorMode(q->_color_mode);
     q->_drawing->setRenderMode(q->_render_mode);
-    paint_single_buffer(rect, _backing_store);
+    paint_buffers(rects, _backing_store);
 
     if (_outline_store) {
         q->_drawing->setRenderMode(Inkscape::RenderMode::OUTLINE);
-        paint_single_buffer(rect, _outline_store);
+        paint_buffers(rects, _outline_store);
     }
 
-    // Introduce an artificial delay for each rectangle.
-    if (prefs.debug_slow_redraw) g_usleep(prefs.debug_slow_redraw_time);
+    for (auto const &rect : rects) {
+        // Introduce an artificial delay for each rectangle.
+        if (prefs.debug_slow_redraw) g_usleep(prefs.debug_slow_redraw_time);
 
-    // Mark the rectangle as clean.
-    updater->mark_clean(rect);
-
-    // Mark the screen dirty.
-    if (!decoupled_mode) {
-        // Get rectangle needing repaint
-        auto repaint_rect = rect - q->_pos;
+        // Mark the rectangle as clean.
+        updater->mark_clean(rect);
 
-        // Assert that a repaint actually occurs (guaranteed because we are only asked to paint fully on-screen rectangles)
-        auto screen_rect = Geom::IntRect(0, 0, q->get_allocation().get_width(), q->get_allocation().get_height());
-        assert(repaint_rect & screen_rect);
+        // Mark the screen dirty.
+        if (!decoupled_mode) {
+            // Get rectangle needing repaint
+            auto repaint_rect = rect - q->_pos;
 
-        // Schedule repaint
-        queue_draw_area(repaint_rect); // Guarantees on_draw will be called in the future.
-        if (bucket_emptier_tick_callback) {q->remove_tick_callback(*bucket_emptier_tick_callback); bucket_emptier_tick_callback.reset();}
-        pending_draw = true;
-    } else {
-        // Get rectangle needing repaint (transform into screen space, take bounding box, round outwards)
-        auto pl = Geom::Parallelogram(rect);
-        pl *= q->_affine * _store_affine.inverse();
-        pl *= Geom::Translate(-q->_pos);
-        auto b = pl.bounds();
-        auto repaint_rect = Geom::IntRect(b.min().floor(), b.max().ceil());
+            // Assert that a repaint actually occurs (guaranteed because we are only asked to paint fully on-screen rectangles)
+            auto screen_rect = Geom::IntRect(0, 0, q->get_allocation().get_width(), q->get_allocation().get_height());
+            assert(repaint_rect & screen_rect);
 
-        // Check if repaint is necessary - some rectangles could be entirely off-screen.
-        auto screen_rect = Geom::IntRect(0, 0, q->get_allocation().get_width(), q->get_allocation().get_height());
-        if (repaint_rect & screen_rect) {
             // Schedule repaint
-            queue_draw_area(repaint_rect);
+            queue_draw_area(repaint_rect); // Guarantees on_draw will be called in the future.
             if (bucket_emptier_tick_callback) {q->remove_tick_callback(*bucket_emptier_tick_callback); bucket_emptier_tick_callback.reset();}
             pending_draw = true;
+        } else {
+            // Get rectangle needing repaint (transform into screen space, take bounding box, round outwards)
+            auto pl = Geom::Parallelogram(rect);
+            pl *= q->_affine * _store_affine.inverse();
+            pl *= Geom::Translate(-q->_pos);
+            auto b = pl.bounds();
+            auto repaint_rect = Geom::IntRect(b.min().floor(), b.max().ceil());
+
+            // Check if repaint is necessary - some rectangles could be entirely off-screen.
+            auto screen_rect = Geom::IntRect(0, 0, q->get_allocation().get_width(), q->get_allocation().get_height());
+            if (repaint_rect & screen_rect) {
+                // Schedule repaint
+                queue_draw_area(repaint_rect);
+                if (bucket_emptier_tick_callback) {q->remove_tick_callback(*bucket_emptier_tick_callback); bucket_emptier_tick_callback.reset();}
+                pending_draw = true;
+            }
         }
     }
 }
 
+void
+CanvasPrivate::paint_buffers(std::vector<Geom::IntRect> const &rects, const Cairo::RefPtr<Cairo::ImageSurface> &store)
+{
+    store->flush();
+
+    // Bring the drawing up to date here, so that the renders below only read it. Rendering never
+    // updates the drawing, and the main thread is busy rendering too, so the tree cannot change
+    // until they finish.
+    q->_drawing->update();
+
+    int const n = rects.size();
+
+    #ifdef HAVE_OPENMP
+    #pragma omp parallel for num_threads(n) schedule(dynamic, 1) if (n > 1)
+    #endif
+    for (int i = 0; i < n; i++) {
+        paint_single_buffer(rects[i], store);
+    }
+
+    // Post-processing is not thread-safe, so is done serially.
+    for (auto const &rect : rects) {
+        finish_single_buffer(rect, store);
+    }
+
+    store->mark_dirty();
+}
+
+/*
+ * Render the drawing and canvas items into a rectangle of the store. Called concurrently for disjoint rectangles.
+ */
 void
 CanvasPrivate::paint_single_buffer(Geom::IntRect const &paint_rect, const Cairo::RefPtr<Cairo::ImageSurface> &store)
 {
@@ -2630,7 +2702,6 @@ CanvasPrivate::paint_single_buffer(Geom::IntRect const &paint_rect, const Cairo:
     assert(_store_rect.contains(paint_rect)); // FIXME: Observed to fail once when hitting Ctrl+O while Canvas was busy. Haven't managed to reproduce it. Doesn't mean it's fixed.
 
     // Create temporary surface that draws directly to store.
-    store->flush();
     unsigned char *data = store->get_data();
     int stride = store->get_stride();
 
@@ -2671,8 +2742,34 @@ CanvasPrivate::paint_single_buffer(Geom::IntRect const &paint_rect, const Cairo:
         q->_canvas_item_root->render(&buf);
     }
 
+    imgs->flush();
+}
+
+/*
+ * Apply debugging overlays and color correction to a freshly rendered rectangle of the store.
+ */
+void
+CanvasPrivate::finish_single_buffer(Geom::IntRect const &paint_rect, const Cairo::RefPtr<Cairo::ImageSurface> &store)
+{
+    if (!prefs.debug_show_redraw && !q->_cms_active) {
+        return;
+    }
+
+    // Create temporary surface that draws directly to store, as in paint_single_buffer().
+    unsigned char *data = store->get_data();
+    int stride = store->get_stride();
+    data += stride * (paint_rect.top() - _store_rect.top()) * _device_scale;
+    data += 4 * (paint_rect.left() - _store_rect.left()) * _device_scale;
+    auto imgs = Cairo::ImageSurface::create(data, Cairo::FORMAT_ARGB32,
+                                            paint_rect.width()  * _device_scale,
+                                            paint_rect.height() * _device_scale,
+                                            stride);
+
+    cairo_surface_set_device_scale(imgs->cobj(), _device_scale, _device_scale); // No C++ API!
+
     // Paint over newly drawn content with a translucent random colour.
     if (prefs.debug_show_redraw) {
+        auto cr = Cairo::Context::create(imgs);
         cr->set_source_rgba((rand() % 255) / 255.0, (rand() % 255) / 255.0, (rand() % 255) / 255.0, 0.2);
         cr->set_operator(Cairo::OPERATOR_OVER);
         cr->rectangle(0, 0, imgs->get_width(), imgs->get_height());
@@ -2696,7 +2793,7 @@ CanvasPrivate::paint_single_buffer(Geom::IntRect const &paint_rect, const Cairo:
         }
     }
 
-    store->mark_dirty();
+    imgs->flush();
 }
 
 } // namespace Widget
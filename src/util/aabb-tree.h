@@ -0,0 +1,379 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Dynamic bounding volume hierarchy over axis-aligned rectangles.
+ *//*
+ * Authors:
+ *   see git history
+ *
+ * Copyright (C) 2022 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_INKSCAPE_UTIL_AABB_TREE_H
+#define SEEN_INKSCAPE_UTIL_AABB_TREE_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <vector>
+#include <2geom/rect.h>
+
+namespace Inkscape {
+namespace Util {
+
+/**
+ * An incrementally maintained bounding volume hierarchy.
+ *
+ * Each leaf stores a rectangle and a value; internal nodes store the union of
+ * the rectangles below them. Leaves are inserted next to the sibling that
+ * increases the total perimeter of the tree the least, and the tree is kept
+ * height-balanced with rotations, so that insertion, removal and update cost
+ * O(log n) and a query visits O(log n + k) nodes for k results.
+ *
+ * Leaves are addressed by the integer handle returned from insert(), which
+ * stays valid until the leaf is removed.
+ */
+template <typename T>
+class AABBTree
+{
+public:
+    using Handle = int;
+    static constexpr Handle null_handle = -1;
+
+    AABBTree() = default;
+
+    /// Add a leaf and return its handle.
+    Handle insert(Geom::Rect const &bounds, T const &value)
+    {
+        Handle leaf = _allocate();
+        _nodes[leaf].bounds = bounds;
+        _nodes[leaf].value = value;
+        _insertLeaf(leaf);
+        ++_size;
+        return leaf;
+    }
+
+    /// Remove a leaf. The handle becomes invalid.
+    void remove(Handle leaf)
+    {
+        assert(_isLeaf(leaf));
+        _removeLeaf(leaf);
+        _release(leaf);
+        --_size;
+    }
+
+    /// Change the bounds of a leaf, moving it in the tree if required.
+    void update(Handle leaf, Geom::Rect const &bounds)
+    {
+        assert(_isLeaf(leaf));
+        if (_nodes[leaf].bounds == bounds) {
+            return;
+        }
+        _removeLeaf(leaf);
+        _nodes[leaf].bounds = bounds;
+        _insertLeaf(leaf);
+    }
+
+    T const &value(Handle leaf) const { return _nodes[leaf].value; }
+    Geom::Rect const &bounds(Handle leaf) const { return _nodes[leaf].bounds; }
+
+    /// Call f(value) for every leaf whose bounds intersect the area.
+    template <typename F>
+    void query(Geom::Rect const &area, F &&f) const
+    {
+        _query([&] (Geom::Rect const &r) { return r.intersects(area); }, f);
+    }
+
+    /// Call f(value) for every leaf whose bounds contain the point.
+    template <typename F>
+    void query(Geom::Point const &p, F &&f) const
+    {
+        _query([&] (Geom::Rect const &r) { return r.contains(p); }, f);
+    }
+
+    /// Bounds of all the leaves.
+    Geom::OptRect bounds() const
+    {
+        if (_root == null_handle) {
+            return Geom::OptRect();
+        }
+        return _nodes[_root].bounds;
+    }
+
+    std::size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    int height() const { return _root == null_handle ? 0 : _nodes[_root].height; }
+
+    void clear()
+    {
+        _nodes.clear();
+        _root = null_handle;
+        _free = null_handle;
+        _size = 0;
+    }
+
+    /// Check the structural invariants. Intended for tests.
+    bool valid() const { return _root == null_handle || (_nodes[_root].parent == null_handle && _valid(_root)); }
+
+private:
+    struct Node
+    {
+        Geom::Rect bounds;
+        T value {};
+        Handle parent = null_handle; ///< Parent for nodes in the tree, next free node otherwise
+        Handle left = null_handle;
+        Handle right = null_handle;
+        int height = -1;             ///< 0 for leaves, -1 for free nodes
+    };
+
+    std::vector<Node> _nodes;
+    Handle _root = null_handle;
+    Handle _free = null_handle;
+    std::size_t _size = 0;
+
+    bool _isLeaf(Handle n) const { return n >= 0 && n < (Handle)_nodes.size() && _nodes[n].height == 0; }
+
+    static double _perimeter(Geom::Rect const &r) { return 2.0 * (r.width() + r.height()); }
+    static Geom::Rect _union(Geom::Rect const &a, Geom::Rect const &b) { return Geom::unify(a, b); }
+
+    Handle _allocate()
+    {
+        Handle n;
+        if (_free != null_handle) {
+            n = _free;
+            _free = _nodes[n].parent;
+            _nodes[n] = Node();
+        } else {
+            n = _nodes.size();
+            _nodes.emplace_back();
+        }
+        _nodes[n].height = 0;
+        return n;
+    }
+
+    void _release(Handle n)
+    {
+        _nodes[n] = Node();
+        _nodes[n].parent = _free;
+        _free = n;
+    }
+
+    void _refit(Handle n)
+    {
+        Node &node = _nodes[n];
+        node.bounds = _union(_nodes[node.left].bounds, _nodes[node.right].bounds);
+        node.height = 1 + std::max(_nodes[node.left].height, _nodes[node.right].height);
+    }
+
+    void _insertLeaf(Handle leaf)
+    {
+        _nodes[leaf].parent = null_handle;
+        if (_root == null_handle) {
+            _root = leaf;
+            return;
+        }
+
+        // Descend to the best sibling, choosing at each level the cheaper of
+        // adopting the leaf here or pushing it further down.
+        Geom::Rect const box = _nodes[leaf].bounds;
+        Handle index = _root;
+        while (_nodes[index].height > 0) {
+            Node const &node = _nodes[index];
+            double area = _perimeter(node.bounds);
+            double combined = _perimeter(_union(node.bounds, box));
+            double cost = 2.0 * combined;
+            double inheritance = 2.0 * (combined - area);
+
+            auto descend_cost = [&] (Handle child) {
+                Geom::Rect u = _union(_nodes[child].bounds, box);
+                double c = _perimeter(u);
+                if (_nodes[child].height > 0) {
+                    c -= _perimeter(_nodes[child].bounds);
+                }
+                return c + inheritance;
+            };
+            double cost_left = descend_cost(node.left);
+            double cost_right = descend_cost(node.right);
+
+            if (cost < cost_left && cost < cost_right) {
+                break;
+            }
+            index = cost_left < cost_right ? node.left : node.right;
+        }
+
+        // Make a new parent for the sibling and the leaf.
+        Handle sibling = index;
+        Handle old_parent = _nodes[sibling].parent;
+        Handle new_parent = _allocate();
+        _nodes[new_parent].parent = old_parent;
+        _nodes[new_parent].left = sibling;
+        _nodes[new_parent].right = leaf;
+        _nodes[sibling].parent = new_parent;
+        _nodes[leaf].parent = new_parent;
+        _refit(new_parent);
+
+        if (old_parent == null_handle) {
+            _root = new_parent;
+        } else if (_nodes[old_parent].left == sibling) {
+            _nodes[old_parent].left = new_parent;
+        } else {
+            _nodes[old_parent].right = new_parent;
+        }
+
+        _fixUpwards(_nodes[leaf].parent);
+    }
+
+    void _removeLeaf(Handle leaf)
+    {
+        if (leaf == _root) {
+            _root = null_handle;
+            return;
+        }
+
+        Handle parent = _nodes[leaf].parent;
+        Handle grandparent = _nodes[parent].parent;
+        Handle sibling = _nodes[parent].left == leaf ? _nodes[parent].right : _nodes[parent].left;
+
+        if (grandparent == null_handle) {
+            _root = sibling;
+            _nodes[sibling].parent = null_handle;
+        } else {
+            if (_nodes[grandparent].left == parent) {
+                _nodes[grandparent].left = sibling;
+            } else {
+                _nodes[grandparent].right = sibling;
+            }
+            _nodes[sibling].parent = grandparent;
+            _fixUpwards(grandparent);
+        }
+        _release(parent);
+        _nodes[leaf].parent = null_handle;
+    }
+
+    /// Rebalance and refit every node from n up to the root.
+    void _fixUpwards(Handle n)
+    {
+        while (n != null_handle) {
+            n = _balance(n);
+            _refit(n);
+            n = _nodes[n].parent;
+        }
+    }
+
+    /// If the subtree at a is unbalanced, rotate it and return the new subtree root.
+    Handle _balance(Handle a)
+    {
+        Node &A = _nodes[a];
+        if (A.height < 2) {
+            return a;
+        }
+        int balance = _nodes[A.right].height - _nodes[A.left].height;
+        if (balance > 1) {
+            return _rotate(a, A.right);
+        }
+        if (balance < -1) {
+            return _rotate(a, A.left);
+        }
+        return a;
+    }
+
+    /// Promote child c of a, which is taller than its sibling by two or more.
+    Handle _rotate(Handle a, Handle c)
+    {
+        Handle f = _nodes[c].left;
+        Handle g = _nodes[c].right;
+        bool c_is_right = _nodes[a].right == c;
+
+        // c takes the place of a.
+        _nodes[c].left = a;
+        _nodes[c].parent = _nodes[a].parent;
+        _nodes[a].parent = c;
+
+        Handle cp = _nodes[c].parent;
+        if (cp == null_handle) {
+            _root = c;
+        } else if (_nodes[cp].left == a) {
+            _nodes[cp].left = c;
+        } else {
+            _nodes[cp].right = c;
+        }
+
+        // The taller grandchild stays under c; the other one replaces c under a.
+        Handle keep = _nodes[f].height > _nodes[g].height ? f : g;
+        Handle move = keep == f ? g : f;
+        _nodes[c].right = keep;
+        if (c_is_right) {
+            _nodes[a].right = move;
+        } else {
+            _nodes[a].left = move;
+        }
+        _nodes[move].parent = a;
+        _refit(a);
+        _refit(c);
+        return c;
+    }
+
+    template <typename Test, typename F>
+    void _query(Test const &test, F &f) const
+    {
+        if (_root == null_handle) {
+            return;
+        }
+        std::vector<Handle> stack;
+        stack.reserve(64);
+        stack.push_back(_root);
+        while (!stack.empty()) {
+            Handle n = stack.back();
+            stack.pop_back();
+            Node const &node = _nodes[n];
+            if (!test(node.bounds)) {
+                continue;
+            }
+            if (node.height == 0) {
+                f(node.value);
+            } else {
+                stack.push_back(node.left);
+                stack.push_back(node.right);
+            }
+        }
+    }
+
+    bool _valid(Handle n) const
+    {
+        Node const &node = _nodes[n];
+        if (node.height == 0) {
+            return node.left == null_handle && node.right == null_handle;
+        }
+        if (node.left == null_handle || node.right == null_handle) {
+            return false;
+        }
+        Node const &l = _nodes[node.left];
+        Node const &r = _nodes[node.right];
+        if (l.parent != n || r.parent != n) {
+            return false;
+        }
+        if (node.height != 1 + std::max(l.height, r.height) || std::abs(l.height - r.height) > 1) {
+            return false;
+        }
+        if (!node.bounds.contains(l.bounds) || !node.bounds.contains(r.bounds)) {
+            return false;
+        }
+        return _valid(node.left) && _valid(node.right);
+    }
+};
+
+} // namespace Util
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_UTIL_AABB_TREE_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,229 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Open-addressing hash map.
+ *//*
+ * Authors:
+ *   see git history
+ *
+ * Copyright (C) 2022 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#ifndef SEEN_INKSCAPE_UTIL_FLAT_HASH_MAP_H
+#define SEEN_INKSCAPE_UTIL_FLAT_HASH_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Inkscape {
+namespace Util {
+
+/// Hash for std::string keys which also accepts std::string_view and C strings.
+struct StringHash
+{
+    using is_transparent = void;
+    std::size_t operator()(std::string_view s) const { return std::hash<std::string_view>()(s); }
+};
+
+/**
+ * A hash map storing its entries in a single array, using linear probing.
+ *
+ * Lookups touch a few adjacent slots instead of chasing tree or bucket pointers.
+ * Removal shifts the following entries back, so there are no tombstones and the
+ * probe sequences stay short however many entries are removed.
+ *
+ * If Hash and Equal are transparent (like StringHash and std::equal_to<>), find()
+ * and erase() accept any type they accept, e.g. std::string_view for string keys.
+ *
+ * Pointers to values are invalidated by insert() and erase().
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename Equal = std::equal_to<>>
+class FlatHashMap
+{
+public:
+    FlatHashMap() = default;
+
+    std::size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+
+    void clear()
+    {
+        _slots.clear();
+        _size = 0;
+        _shift = 64;
+    }
+
+    /// Return a pointer to the value for the key, or null if there is none.
+    template <typename K>
+    Value *find(K const &key)
+    {
+        std::size_t i = _lookup(key);
+        return i == npos ? nullptr : &_slots[i].value;
+    }
+
+    template <typename K>
+    Value const *find(K const &key) const
+    {
+        std::size_t i = _lookup(key);
+        return i == npos ? nullptr : &_slots[i].value;
+    }
+
+    template <typename K>
+    bool contains(K const &key) const { return _lookup(key) != npos; }
+
+    /// Insert or overwrite the value for the key. Returns true if the key was not present.
+    bool insert_or_assign(Key key, Value value)
+    {
+        std::uint64_t h = _hash(key);
+        if (!_slots.empty()) {
+            std::size_t i = _probe(key, h);
+            if (i != npos) {
+                _slots[i].value = std::move(value);
+                return false;
+            }
+        }
+        if ((_size + 1) * 8 > _slots.size() * 7) {
+            _grow();
+        }
+        _place(h, std::move(key), std::move(value));
+        ++_size;
+        return true;
+    }
+
+    /// Remove the entry for the key. Returns true if there was one.
+    template <typename K>
+    bool erase(K const &key)
+    {
+        std::size_t i = _lookup(key);
+        if (i == npos) {
+            return false;
+        }
+
+        // Shift back the entries of the cluster that would have been placed earlier without
+        // the removed one, i.e. those whose home slot is not between the hole and them.
+        std::size_t const mask = _slots.size() - 1;
+        for (std::size_t j = (i + 1) & mask; _slots[j].hash != 0; j = (j + 1) & mask) {
+            std::size_t home = _index(_slots[j].hash);
+            if (((j - home) & mask) < ((j - i) & mask)) {
+                continue;
+            }
+            _slots[i] = std::move(_slots[j]);
+            i = j;
+        }
+        _slots[i] = Slot();
+        --_size;
+        return true;
+    }
+
+    /// Call f(key, value) for every entry, in no particular order.
+    template <typename F>
+    void for_each(F &&f) const
+    {
+        for (auto const &slot : _slots) {
+            if (slot.hash != 0) {
+                f(slot.key, slot.value);
+            }
+        }
+    }
+
+private:
+    struct Slot
+    {
+        std::uint64_t hash = 0; ///< 0 for empty slots
+        Key key {};
+        Value value {};
+    };
+
+    static constexpr std::size_t npos = -1;
+
+    std::vector<Slot> _slots;
+    std::size_t _size = 0;
+    int _shift = 64; ///< 64 - log2(number of slots)
+
+    template <typename K>
+    static std::uint64_t _hash(K const &key)
+    {
+        std::uint64_t h = Hash()(key);
+        return h == 0 ? 1 : h;
+    }
+
+    /// Home slot of a hash. Fibonacci hashing spreads keys like aligned pointers.
+    std::size_t _index(std::uint64_t h) const
+    {
+        return (h * UINT64_C(0x9E3779B97F4A7C15)) >> _shift;
+    }
+
+    template <typename K>
+    std::size_t _lookup(K const &key) const
+    {
+        if (_size == 0) {
+            return npos;
+        }
+        return _probe(key, _hash(key));
+    }
+
+    template <typename K>
+    std::size_t _probe(K const &key, std::uint64_t h) const
+    {
+        std::size_t const mask = _slots.size() - 1;
+        for (std::size_t i = _index(h); ; i = (i + 1) & mask) {
+            Slot const &slot = _slots[i];
+            if (slot.hash == 0) {
+                return npos;
+            }
+            if (slot.hash == h && Equal()(slot.key, key)) {
+                return i;
+            }
+        }
+    }
+
+    void _place(std::uint64_t h, Key &&key, Value &&value)
+    {
+        std::size_t const mask = _slots.size() - 1;
+        std::size_t i = _index(h);
+        while (_slots[i].hash != 0) {
+            i = (i + 1) & mask;
+        }
+        _slots[i].hash = h;
+        _slots[i].key = std::move(key);
+        _slots[i].value = std::move(value);
+    }
+
+    void _grow()
+    {
+        std::vector<Slot> old;
+        old.swap(_slots);
+        std::size_t capacity = old.empty() ? 16 : old.size() * 2;
+        _slots.resize(capacity);
+        _shift = 64;
+        while (capacity > 1) {
+            capacity >>= 1;
+            --_shift;
+        }
+        for (auto &slot : old) {
+            if (slot.hash != 0) {
+                _place(slot.hash, std::move(slot.key), std::move(slot.value));
+            }
+        }
+    }
+};
+
+} // namespace Util
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_UTIL_FLAT_HASH_MAP_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -11,9 +11,14 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstring>
+#include <future>
 #include <string>
 #include <stdexcept>
+#include <utility>
 
 #include <libxml/parser.h>
 #include <libxml/xinclude.h>
@@ -37,6 +42,7 @@
 
 #include "preferences.h"
 
+#include <glibmm/main.h>
 #include <glibmm/miscutils.h>
 
 using Inkscape::IO::Writer;
@@ -77,7 +83,10 @@ public:
           cachedData(),
           cachedPos(0),
           instr(nullptr),
-          gzin(nullptr)
+          gzin(nullptr),
+          allowNetAccess(false),
+          cancel(nullptr),
+          bytesRead(0)
     {
         for (unsigned char & k : firstFew)
         {
@@ -103,6 +112,11 @@ public:
     char const* getEncoding() const { return encoding; }
     int read( char * buffer, int len );
     int close();
+
+    /// Make read() fail as soon as the flag is set, which aborts the parser.
+    void setCancel(std::atomic<bool> const *flag) { cancel = flag; }
+    /// Number of bytes passed to the parser so far; may be called from any thread.
+    std::size_t getBytesRead() const { return bytesRead; }
 private:
     const char* filename;
     char* encoding;
@@ -114,6 +128,9 @@ private:
     unsigned int cachedPos;
     Inkscape::IO::FileInputStream* instr;
     Inkscape::IO::GzipInputStream* gzin;
+    bool allowNetAccess;
+    std::atomic<bool> const *cancel;
+    std::atomic<std::size_t> bytesRead;
 };
 
 int XmlSource::setFile(char const *filename, bool load_entities=false)
@@ -122,6 +139,10 @@ int XmlSource::setFile(char const *filename, bool load_entities=false)
 
     this->filename = filename;
 
+    // Read here rather than in readXml(), which may run on a worker thread.
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    allowNetAccess = prefs->getBool("/options/externalresources/xml/allow_net_access", false);
+
     fp = Inkscape::IO::fopen_utf8name(filename, "r");
     if ( fp ) {
         // First peek in the file to see what it is
@@ -214,8 +235,6 @@ xmlDocPtr XmlSource::readXml()
 {
     int parse_options = XML_PARSE_HUGE | XML_PARSE_RECOVER;
 
-    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
-    bool allowNetAccess = prefs->getBool("/options/externalresources/xml/allow_net_access", false);
     if (!allowNetAccess) parse_options |= XML_PARSE_NONET;
 
     // Allow NOENT only if we're filtering out SYSTEM and PUBLIC entities
@@ -256,12 +275,17 @@ int XmlSource::read( char *buffer, int len )
     int retVal = 0;
     size_t got = 0;
 
+    if ( cancel && *cancel ) {
+        return -1;
+    }
+
     if ( LoadEntities ) {
         if (cachedPos >= cachedData.length()) {
             return -1;
         } else {
             retVal = cachedData.copy(buffer, len, cachedPos);
             cachedPos += retVal;
+            bytesRead += retVal;
             return retVal; // Do NOT continue.
         }
     } else if ( firstFewLen > 0 ) {
@@ -295,6 +319,10 @@ int XmlSource::read( char *buffer, int len )
         retVal = got;
     }
 
+    if ( retVal > 0 ) {
+        bytesRead += retVal;
+    }
+
     return retVal;
 }
 
@@ -318,6 +346,99 @@ int XmlSource::close()
     return 0;
 }
 
+namespace Inkscape {
+namespace XML {
+
+struct ParseJob::Impl
+{
+    XmlSource src;
+    std::atomic<bool> cancel{false};
+    std::future<xmlDocPtr> result;
+    xmlDocPtr doc = nullptr;
+    sigc::connection poll;
+};
+
+ParseJob::ParseJob(std::string filename, Callback done)
+    : _filename(std::move(filename))
+    , _impl(std::make_unique<Impl>())
+{
+    // Opening the source reads preferences, so it stays on this thread.
+    bool const opened = _impl->src.setFile(_filename.c_str()) == 0;
+    _impl->src.setCancel(&_impl->cancel);
+    _impl->result = std::async(std::launch::async, [impl = _impl.get(), opened] () -> xmlDocPtr {
+        if (!opened) {
+            return nullptr;
+        }
+        // libxml2 keeps this setting per thread
+        xmlSubstituteEntitiesDefault(1);
+        return impl->src.readXml();
+    });
+
+    _impl->poll = Glib::signal_timeout().connect([this, done = std::move(done)] {
+        if (_impl->result.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return true;
+        }
+        _impl->doc = _impl->result.get();
+        // The callback may destroy the job; the timeout is removed when it returns.
+        auto callback = done;
+        callback(*this);
+        return false;
+    }, 50);
+}
+
+ParseJob::~ParseJob()
+{
+    _impl->poll.disconnect();
+    _impl->cancel = true;
+    if (_impl->result.valid()) {
+        _impl->doc = _impl->result.get();
+    }
+    if (_impl->doc) {
+        xmlFreeDoc(_impl->doc);
+    }
+}
+
+std::size_t ParseJob::bytesRead() const
+{
+    return _impl->src.getBytesRead();
+}
+
+void ParseJob::cancel()
+{
+    _impl->poll.disconnect();
+    _impl->cancel = true;
+}
+
+static thread_local ParsedFileScope *current_parsed_file = nullptr;
+
+ParsedFileScope::ParsedFileScope(ParseJob &job)
+    : _job(job)
+    , _previous(current_parsed_file)
+{
+    current_parsed_file = this;
+}
+
+ParsedFileScope::~ParsedFileScope()
+{
+    current_parsed_file = _previous;
+}
+
+ParsedFileScope *ParsedFileScope::current()
+{
+    return current_parsed_file;
+}
+
+xmlDocPtr ParsedFileScope::take(char const *filename)
+{
+    if (!filename || _job.filename() != filename) {
+        return nullptr;
+    }
+    return std::exchange(_job._impl->doc, nullptr);
+}
+
+} // namespace XML
+} // namespace Inkscape
+
 /**
  * Reads XML from a file, and returns the Document.
  * The default namespace can also be specified, if desired.
@@ -350,8 +471,16 @@ Document *sp_repr_read_file (const gchar * filename, const gchar *default_ns)
 
     XmlSource src;
 
-    if (src.setFile(filename) == 0) {
-        doc = src.readXml();
+    // The file may have been parsed in the background already (see ParseJob).
+    auto parsed = Inkscape::XML::ParsedFileScope::current();
+    if (parsed) {
+        doc = parsed->take(filename);
+    }
+
+    if (doc || src.setFile(filename) == 0) {
+        if (!doc) {
+            doc = src.readXml();
+        }
         rdoc = sp_repr_do_read(doc, default_ns);
         // For some reason, failed ns loading results in this
         // We try a system check version of load with NOENT for adobe
@@ -659,7 +788,7 @@ static void sp_repr_save_writer(Document *doc, Inkscape::IO::Writer *out,
 Glib::ustring sp_repr_save_buf(Document *doc)
 {   
     Inkscape::IO::StringOutputStream souts;
-    Inkscape::IO::OutputStreamWriter outs(souts);
+    Inkscape::IO::BufferedOutputStreamWriter outs(souts);
 
     sp_repr_save_writer(doc, &outs, SP_INKSCAPE_NS_URI, nullptr, nullptr);
 
@@ -676,9 +805,12 @@ void sp_repr_save_stream(Document *doc, FILE *fp, gchar const *default_ns, bool
 {
     Inkscape::IO::FileOutputStream bout(fp);
     Inkscape::IO::GzipOutputStream *gout = compress ? new Inkscape::IO::GzipOutputStream(bout) : nullptr;
-    Inkscape::IO::OutputStreamWriter *out  = compress ? new Inkscape::IO::OutputStreamWriter( *gout ) : new Inkscape::IO::OutputStreamWriter( bout );
+    // The serializer emits many small pieces; collect them and pass them to the stream in blocks.
+    Inkscape::IO::BufferedOutputStreamWriter *out = compress ? new Inkscape::IO::BufferedOutputStreamWriter( *gout )
+                                                             : new Inkscape::IO::BufferedOutputStreamWriter( bout );
 
     sp_repr_save_writer(doc, out, default_ns, old_href_abs_base, new_href_abs_base);
+    out->flush();
 
     delete out;
     delete gout;
@@ -759,32 +891,62 @@ bool sp_repr_save_file(Document *doc, gchar const *const filename, gchar const *
 static void repr_quote_write (Writer &out, const gchar * val)
 {
     if (val) {
-        for (; *val != '\0'; val++) {
+        // Copy the runs between special characters in one go.
+        for (;;) {
+            size_t const run = strcspn(val, "\"&<>");
+            if (run) {
+                out.write(val, run);
+                val += run;
+            }
             switch (*val) {
-                case '"': out.writeString( "&quot;" ); break;
-                case '&': out.writeString( "&amp;" ); break;
-                case '<': out.writeString( "&lt;" ); break;
-                case '>': out.writeString( "&gt;" ); break;
-                default: out.writeChar( *val ); break;
+                case '"': out.write("&quot;", 6); break;
+                case '&': out.write("&amp;", 5); break;
+                case '<': out.write("&lt;", 4); break;
+                case '>': out.write("&gt;", 4); break;
+                default: return;
             }
+            val++;
         }
     }
 }
 
+/// Write the characters of a string literal, without the terminating null.
+template <size_t N>
+static void repr_write_literal(Writer &out, char const (&str)[N])
+{
+    out.write(str, N - 1);
+}
+
+static void repr_write_string(Writer &out, char const *str)
+{
+    if (str) {
+        out.write(str, strlen(str));
+    }
+}
+
+static void repr_write_indent(Writer &out, gint indentLevel, int indent)
+{
+    static char const spaces[] = "                                                                ";
+    size_t len = size_t(std::max(indentLevel, 0)) * size_t(std::max(indent, 0));
+    while (len > 0) {
+        size_t const n = std::min(len, sizeof(spaces) - 1);
+        out.write(spaces, n);
+        len -= n;
+    }
+}
+
 static void repr_write_comment( Writer &out, const gchar * val, bool addWhitespace, gint indentLevel, int indent )
 {
     if ( indentLevel > 16 ) {
         indentLevel = 16;
     }
     if (addWhitespace && indent) {
-        for (gint i = 0; i < indentLevel; i++) {
-            for (gint j = 0; j < indent; j++) {
-                out.writeChar(' ');
-            }
-        }
+        repr_write_indent(out, indentLevel, indent);
     }
 
-    out.printf("<!--%s-->", val);
+    repr_write_literal(out, "<!--");
+    repr_write_string(out, val);
+    repr_write_literal(out, "-->");
 
     if (addWhitespace) {
         out.writeChar('\n');
@@ -926,7 +1088,9 @@ void sp_repr_write_stream( Node *repr, Writer &out, gint indent_level,
             assert(textnode);
             if (textnode->is_CData()) {
                 // Preserve CDATA sections, not converting '&' to &amp;, etc.
-                out.printf( "<![CDATA[%s]]>", repr->content() );
+                repr_write_literal(out, "<![CDATA[");
+                repr_write_string(out, repr->content());
+                repr_write_literal(out, "]]>");
             } else {
                 repr_quote_write( out, repr->content() );
             }
@@ -978,11 +1142,7 @@ void sp_repr_write_stream_element( Node * repr, Writer & out,
     }
 
     if (add_whitespace && indent) {
-        for (gint i = 0; i < indent_level; i++) {
-            for (gint j = 0; j < indent; j++) {
-                out.writeChar(' ');
-            }
-        }
+        repr_write_indent(out, indent_level, indent);
     }
 
     GQuark code = repr->code();
@@ -992,7 +1152,8 @@ void sp_repr_write_stream_element( Node * repr, Writer & out,
     } else {
         element_name = g_quark_to_string(code);
     }
-    out.printf( "<%s", element_name );
+    out.writeChar('<');
+    repr_write_string(out, element_name);
 
     // If this is a <text> element, suppress formatting whitespace
     // for its content and children:
@@ -1014,14 +1175,12 @@ void sp_repr_write_stream_element( Node * repr, Writer & out,
         if (!inlineattrs) {
             out.writeChar('\n');
             if (indent) {
-                for ( gint i = 0 ; i < indent_level + 1 ; i++ ) {
-                    for ( gint j = 0 ; j < indent ; j++ ) {
-                        out.writeChar(' ');
-                    }
-                }
+                repr_write_indent(out, indent_level + 1, indent);
             }
         }
-        out.printf(" %s=\"", g_quark_to_string(iter.key));
+        out.writeChar(' ');
+        repr_write_string(out, g_quark_to_string(iter.key));
+        repr_write_literal(out, "=\"");
         repr_quote_write(out, iter.value);
         out.writeChar('"');
     }
@@ -1046,15 +1205,13 @@ void sp_repr_write_stream_element( Node * repr, Writer & out,
         }
 
         if (loose && add_whitespace && indent) {
-            for (gint i = 0; i < indent_level; i++) {
-                for ( gint j = 0 ; j < indent ; j++ ) {
-                    out.writeChar(' ');
-                }
-            }
+            repr_write_indent(out, indent_level, indent);
         }
-        out.printf( "</%s>", element_name );
+        repr_write_literal(out, "</");
+        repr_write_string(out, element_name);
+        out.writeChar('>');
     } else {
-        out.writeString( " />" );
+        repr_write_literal(out, " />");
     }
 
     if (add_whitespace_parent) {
@@ -15,6 +15,10 @@
 #ifndef SEEN_SP_REPR_H
 #define SEEN_SP_REPR_H
 
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
 #include <vector>
 #include <glibmm/quark.h>
 
@@ -73,6 +77,79 @@ bool sp_repr_save_rebased_file(Inkscape::XML::Document *doc, char const *filenam
                                char const *default_ns,
                                char const *old_base, char const *new_base_filename);
 
+struct _xmlDoc;
+
+namespace Inkscape {
+namespace XML {
+
+/**
+ * Parses a file on a worker thread before it is opened.
+ *
+ * The parse starts on construction, and the constructor returns right away. Once the parse is
+ * done, the callback is called from the main loop. It opens the file within a ParsedFileScope,
+ * so that sp_repr_read_file() builds the document from the parsed tree instead of parsing the
+ * file again. The callback may destroy the job.
+ *
+ * Only the libxml2 parse runs on the worker; the document is built on the calling thread.
+ * Destroying the job cancels the parse and waits for the worker.
+ */
+class ParseJob
+{
+public:
+    using Callback = std::function<void (ParseJob &job)>;
+
+    ParseJob(std::string filename, Callback done);
+    ~ParseJob();
+
+    ParseJob(ParseJob const &) = delete;
+    ParseJob &operator=(ParseJob const &) = delete;
+
+    std::string const &filename() const { return _filename; }
+
+    /// Number of bytes parsed so far.
+    std::size_t bytesRead() const;
+
+    /// Stop the parse. The callback is not called afterwards.
+    void cancel();
+
+private:
+    struct Impl;
+    std::string _filename;
+    std::unique_ptr<Impl> _impl;
+
+    friend class ParsedFileScope;
+};
+
+/**
+ * Lets sp_repr_read_file() take the tree parsed by a finished ParseJob.
+ *
+ * While an instance exists, the first read of the job's file on the same thread uses the parsed
+ * tree. Other files, and later reads, are parsed as usual.
+ */
+class ParsedFileScope
+{
+public:
+    explicit ParsedFileScope(ParseJob &job);
+    ~ParsedFileScope();
+
+    ParsedFileScope(ParsedFileScope const &) = delete;
+    ParsedFileScope &operator=(ParsedFileScope const &) = delete;
+
+    /// The innermost scope of the calling thread, or null.
+    static ParsedFileScope *current();
+
+    /// The parsed tree if @a filename is the file of the job and it was not taken yet. The
+    /// caller frees it.
+    _xmlDoc *take(char const *filename);
+
+private:
+    ParseJob &_job;
+    ParsedFileScope *_previous;
+};
+
+} // namespace XML
+} // namespace Inkscape
+
 
 /* CSS stuff */
 
@@ -0,0 +1,358 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Rendering benchmark: times the phases of loading and rendering a set of documents.
+ *
+ * Usage: inkscape-bench [--repeat N] [--output FILE] [--markers N] DOCUMENT...
+ *
+ * Every document goes through these phases, each of which is timed separately:
+ *  - parse:        reading the XML into a repr tree;
+ *  - save, save_svgz: serializing the repr tree to a plain and a compressed file;
+ *  - build:        building the SPObject tree;
+ *  - style:        the first document update, which cascades the styles and lays out text;
+ *  - update:       showing the document in a Drawing and updating it at 100% zoom;
+ *  - render_N:     rendering the page at N% zoom, without filters;
+ *  - filters:      rendering the page at 100% zoom, with filters;
+ *  - export:       exporting the page to PNG at 96 dpi.
+ * Rendered areas are limited to MAX_RENDER_SIZE pixels in each direction.
+ *
+ * The timings are written as JSON, with the median and the minimum of all repetitions in
+ * milliseconds, together with the peak resident set size of the process. The size of the saved
+ * plain file is written as well, to compute the serializer throughput from the save time.
+ *
+ * With --markers N, a chart-like document made of N identically styled markers is generated and
+ * benchmarked as well, to measure the time and memory spent on styles.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2022 Authors
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <cairo.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <giomm/init.h>
+#include <glibmm/miscutils.h>
+#include <2geom/transforms.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "document.h"
+#include "inkscape.h"
+#include "inkscape-version.h"
+#include "display/drawing.h"
+#include "display/drawing-context.h"
+#include "display/rendermode.h"
+#include "helper/png-write.h"
+#include "inkgc/gc-core.h"
+#include "object/sp-root.h"
+#include "xml/repr.h"
+
+namespace {
+
+int const MAX_RENDER_SIZE = 4096;
+int const ZOOM_LEVELS[] = {25, 100, 400};
+
+/// Peak resident set size of the process, in KiB.
+long peak_rss_kib()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize / 1024;
+    }
+    return -1;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // bytes
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+std::string json_string(std::string const &s)
+{
+    std::ostringstream out;
+    out << '"';
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (c < 0x20) {
+            char buf[8];
+            g_snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out << buf;
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+    return out.str();
+}
+
+/// Timings of the phases of one document, in milliseconds, one entry per repetition.
+class PhaseTimes
+{
+public:
+    template <typename F>
+    void time(std::string const &phase, F &&f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        auto end = std::chrono::steady_clock::now();
+        if (_times.find(phase) == _times.end()) {
+            _order.push_back(phase);
+        }
+        _times[phase].push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    void write(std::ostream &out) const
+    {
+        out << "{";
+        for (std::size_t i = 0; i < _order.size(); ++i) {
+            auto times = _times.at(_order[i]);
+            std::sort(times.begin(), times.end());
+            out << (i ? ", " : "") << json_string(_order[i]) << ": {\"median\": " << times[times.size() / 2]
+                << ", \"min\": " << times.front() << "}";
+        }
+        out << "}";
+    }
+
+private:
+    std::vector<std::string> _order;
+    std::map<std::string, std::vector<double>> _times;
+};
+
+void render(Inkscape::Drawing &drawing, Geom::IntRect const &area)
+{
+    cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, area.width(), area.height());
+    {
+        Inkscape::DrawingContext dc(surface, area.min());
+        drawing.render(dc, area);
+    }
+    cairo_surface_destroy(surface);
+}
+
+/// Write a document with a grid of identically styled markers to a temporary file.
+std::string write_markers_document(int count)
+{
+    gchar *filename = nullptr;
+    int fd = g_file_open_tmp("inkscape-bench-markers-XXXXXX.svg", &filename, nullptr);
+    if (fd < 0) {
+        return {};
+    }
+    g_close(fd, nullptr);
+    std::string result = filename;
+    g_free(filename);
+
+    int const columns = std::max(1, static_cast<int>(std::sqrt(count)));
+    std::ofstream out(result);
+    out << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << columns * 4 << "\" height=\""
+        << (count + columns - 1) / columns * 4 << "\">\n<g style=\"stroke:#000000;stroke-width:0.25\">\n";
+    for (int i = 0; i < count; ++i) {
+        out << "<circle cx=\"" << i % columns * 4 + 2 << "\" cy=\"" << i / columns * 4 + 2
+            << "\" r=\"1.5\" style=\"fill:#1f77b4;fill-opacity:0.8;stroke-opacity:0.5\"/>\n";
+    }
+    out << "</g>\n</svg>\n";
+    return out ? result : std::string();
+}
+
+/// Time saving a repr tree to a temporary file. Returns the size of the file.
+long save_document(Inkscape::XML::Document *rdoc, PhaseTimes &times, std::string const &phase,
+                   char const *suffix)
+{
+    gchar *filename = nullptr;
+    int fd = g_file_open_tmp((std::string("inkscape-bench-XXXXXX") + suffix).c_str(), &filename, nullptr);
+    if (fd < 0) {
+        return -1;
+    }
+    g_close(fd, nullptr);
+    times.time(phase, [&] { sp_repr_save_file(rdoc, filename, SP_SVG_NS_URI); });
+    GStatBuf st;
+    long size = g_stat(filename, &st) == 0 ? st.st_size : -1;
+    g_remove(filename);
+    g_free(filename);
+    return size;
+}
+
+/// Run all phases on a document once. Returns false if the document cannot be loaded.
+bool run_document(std::string const &filename, PhaseTimes &times, long &saved_bytes)
+{
+    Inkscape::XML::Document *rdoc = nullptr;
+    times.time("parse", [&] { rdoc = sp_repr_read_file(filename.c_str(), SP_SVG_NS_URI); });
+    if (!rdoc || std::strcmp(rdoc->root()->name(), "svg:svg") != 0) {
+        return false;
+    }
+
+    saved_bytes = save_document(rdoc, times, "save", ".svg");
+    save_document(rdoc, times, "save_svgz", ".svgz");
+
+    std::unique_ptr<SPDocument> doc;
+    std::string base = Glib::path_get_dirname(filename);
+    std::string name = Glib::path_get_basename(filename);
+    times.time("build", [&] {
+        doc.reset(SPDocument::createDoc(rdoc, filename.c_str(), base.c_str(), name.c_str(), false, nullptr));
+    });
+    times.time("style", [&] { doc->ensureUpToDate(); });
+
+    Geom::Point dimensions = doc->getDimensions();
+    if (!(dimensions[Geom::X] >= 1 && dimensions[Geom::Y] >= 1)) {
+        return true;
+    }
+
+    auto page_area = [&] (double scale) {
+        int width = std::min<double>(std::ceil(dimensions[Geom::X] * scale), MAX_RENDER_SIZE);
+        int height = std::min<double>(std::ceil(dimensions[Geom::Y] * scale), MAX_RENDER_SIZE);
+        return Geom::IntRect::from_xywh(0, 0, width, height);
+    };
+
+    Inkscape::Drawing drawing;
+    unsigned const dkey = SPItem::display_key_new(1);
+    times.time("update", [&] {
+        drawing.setRoot(doc->getRoot()->invoke_show(drawing, dkey, SP_ITEM_SHOW_DISPLAY));
+        drawing.update(page_area(1.0));
+    });
+
+    drawing.setRenderMode(Inkscape::RenderMode::NO_FILTERS);
+    for (int zoom : ZOOM_LEVELS) {
+        double scale = zoom / 100.0;
+        drawing.root()->setTransform(Geom::Scale(scale));
+        drawing.update(page_area(scale));
+        times.time("render_" + std::to_string(zoom), [&] { render(drawing, page_area(scale)); });
+    }
+
+    drawing.setRenderMode(Inkscape::RenderMode::NORMAL);
+    drawing.root()->setTransform(Geom::identity());
+    drawing.update(page_area(1.0));
+    times.time("filters", [&] { render(drawing, page_area(1.0)); });
+
+    doc->getRoot()->invoke_hide(dkey);
+
+    gchar *png = nullptr;
+    int fd = g_file_open_tmp("inkscape-bench-XXXXXX.png", &png, nullptr);
+    if (fd >= 0) {
+        g_close(fd, nullptr);
+        Geom::IntRect export_size = page_area(1.0);
+        times.time("export", [&] {
+            sp_export_png_file(doc.get(), png, Geom::Rect(Geom::Point(0, 0), dimensions),
+                               export_size.width(), export_size.height(), 96, 96, 0x00000000, nullptr, nullptr, true);
+        });
+        g_remove(png);
+        g_free(png);
+    }
+
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    int repeat = 3;
+    std::string output;
+    int markers = 0;
+    std::vector<std::string> documents;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (std::strcmp(argv[i], "--markers") == 0 && i + 1 < argc) {
+            markers = std::max(0, std::atoi(argv[++i]));
+        } else {
+            documents.emplace_back(argv[i]);
+        }
+    }
+    if (documents.empty() && !markers) {
+        std::cerr << "Usage: " << argv[0] << " [--repeat N] [--output FILE] [--markers N] DOCUMENT..." << std::endl;
+        return 2;
+    }
+
+    std::string markers_document;
+    if (markers) {
+        markers_document = write_markers_document(markers);
+        if (markers_document.empty()) {
+            std::cerr << "inkscape-bench: cannot write the markers document" << std::endl;
+            return 1;
+        }
+        documents.push_back(markers_document);
+    }
+
+    Gio::init();
+    Inkscape::GC::init();
+    Inkscape::Application::create(false);
+
+    std::ostringstream json;
+    json << "{\n  \"version\": " << json_string(Inkscape::version_string) << ",\n  \"repeat\": " << repeat
+         << ",\n  \"documents\": [";
+
+    int failed = 0;
+    bool first = true;
+    for (auto const &filename : documents) {
+        PhaseTimes times;
+        long saved_bytes = -1;
+        bool loaded = true;
+        for (int i = 0; i < repeat && loaded; ++i) {
+            loaded = run_document(filename, times, saved_bytes);
+        }
+        if (!loaded) {
+            std::cerr << "inkscape-bench: cannot load " << filename << std::endl;
+            ++failed;
+            continue;
+        }
+        json << (first ? "\n" : ",\n") << "    {\"file\": " << json_string(filename) << ", \"phases\": ";
+        times.write(json);
+        json << ", \"saved_bytes\": " << saved_bytes << ", \"peak_rss_kib\": " << peak_rss_kib() << "}";
+        first = false;
+    }
+    json << "\n  ],\n  \"peak_rss_kib\": " << peak_rss_kib() << "\n}\n";
+
+    if (!markers_document.empty()) {
+        g_remove(markers_document.c_str());
+    }
+
+    if (output.empty()) {
+        std::cout << json.str();
+    } else {
+        std::ofstream file(output);
+        file << json.str();
+        if (!file) {
+            std::cerr << "inkscape-bench: cannot write " << output << std::endl;
+            return 1;
+        }
+    }
+    return failed ? 1 : 0;
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file
+ * Test the bounding volume hierarchy in src/util/aabb-tree.h
+ */
+/*
+ * Authors:
+ *   see git history
+ *
+ * Copyright (C) 2022 Authors
+ *
+ * Released under GNU GPL v2+, read the file 'COPYING' for more information.
+ */
+
+#include <cmath>
+#include <map>
+#include <random>
+#include <set>
+
+#include "gtest/gtest.h"
+#include "util/aabb-tree.h"
+
+using Inkscape::Util::AABBTree;
+
+TEST(AABBTreeTest, Empty)
+{
+    AABBTree<int> tree;
+    EXPECT_TRUE(tree.empty());
+    EXPECT_FALSE(tree.bounds());
+    int calls = 0;
+    tree.query(Geom::Rect(0, 0, 10, 10), [&] (int) { ++calls; });
+    EXPECT_EQ(calls, 0);
+}
+
+TEST(AABBTreeTest, PointAndRectQueries)
+{
+    AABBTree<int> tree;
+    tree.insert(Geom::Rect(0, 0, 10, 10), 1);
+    auto h2 = tree.insert(Geom::Rect(20, 0, 30, 10), 2);
+    tree.insert(Geom::Rect(5, 5, 25, 8), 3);
+    EXPECT_EQ(tree.size(), 3u);
+    EXPECT_EQ(*tree.bounds(), Geom::Rect(0, 0, 30, 10));
+
+    std::set<int> found;
+    tree.query(Geom::Point(6, 6), [&] (int v) { found.insert(v); });
+    EXPECT_EQ(found, (std::set<int>{1, 3}));
+
+    found.clear();
+    tree.query(Geom::Rect(24, 9, 40, 20), [&] (int v) { found.insert(v); });
+    EXPECT_EQ(found, (std::set<int>{2}));
+
+    tree.update(h2, Geom::Rect(100, 100, 110, 110));
+    found.clear();
+    tree.query(Geom::Rect(24, 9, 40, 20), [&] (int v) { found.insert(v); });
+    EXPECT_TRUE(found.empty());
+
+    tree.remove(h2);
+    EXPECT_EQ(tree.size(), 2u);
+    EXPECT_TRUE(tree.valid());
+}
+
+// Compare with a linear search under random insertions, updates and removals.
+TEST(AABBTreeTest, MatchesLinearSearch)
+{
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> coord(0, 1000);
+    std::uniform_real_distribution<double> extent(0, 50);
+    auto random_rect = [&] {
+        Geom::Point p(coord(gen), coord(gen));
+        return Geom::Rect(p, p + Geom::Point(extent(gen), extent(gen)));
+    };
+
+    AABBTree<int> tree;
+    std::map<AABBTree<int>::Handle, std::pair<int, Geom::Rect>> live;
+    int next = 0;
+
+    for (int i = 0; i < 20000; ++i) {
+        auto op = gen() % 3;
+        if (op == 0 || live.empty()) {
+            auto r = random_rect();
+            live[tree.insert(r, next)] = {next, r};
+            ++next;
+        } else {
+            auto it = std::next(live.begin(), gen() % live.size());
+            if (op == 1) {
+                tree.remove(it->first);
+                live.erase(it);
+            } else {
+                auto r = random_rect();
+                tree.update(it->first, r);
+                it->second.second = r;
+            }
+        }
+
+        if (i % 500 == 0) {
+            ASSERT_TRUE(tree.valid());
+            ASSERT_EQ(tree.size(), live.size());
+
+            auto area = random_rect();
+            std::set<int> found, expected;
+            tree.query(area, [&] (int v) { found.insert(v); });
+            for (auto const &leaf : live) {
+                if (leaf.second.second.intersects(area)) {
+                    expected.insert(leaf.second.first);
+                }
+            }
+            ASSERT_EQ(found, expected);
+        }
+    }
+
+    // Balanced: height stays logarithmic in the number of leaves.
+    EXPECT_LT(tree.height(), 4 * std::log2(tree.size() + 1) + 2);
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,151 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests for the device-space cairo path data of path vectors
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2022 Authors
+ *
+ * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
+ */
+
+#include <gtest/gtest.h>
+#include <2geom/svg-path-parser.h>
+#include <src/display/cairo-path.h>
+#include <src/display/cairo-utils.h>
+
+namespace {
+
+struct Context
+{
+    Context()
+        : surface(cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 16, 16))
+        , ct(cairo_create(surface))
+    {}
+    ~Context()
+    {
+        cairo_destroy(ct);
+        cairo_surface_destroy(surface);
+    }
+    cairo_surface_t *surface;
+    cairo_t *ct;
+};
+
+std::vector<cairo_path_data_t> copy_path(cairo_t *ct)
+{
+    cairo_path_t *path = cairo_copy_path(ct);
+    std::vector<cairo_path_data_t> data(path->data, path->data + path->num_data);
+    cairo_path_destroy(path);
+    return data;
+}
+
+void expect_same_path(std::vector<cairo_path_data_t> const &a, std::vector<cairo_path_data_t> const &b)
+{
+    ASSERT_EQ(a.size(), b.size());
+    for (size_t i = 0; i < a.size(); i += a[i].header.length) {
+        ASSERT_EQ(a[i].header.type, b[i].header.type);
+        ASSERT_EQ(a[i].header.length, b[i].header.length);
+        for (int j = 1; j < a[i].header.length; ++j) {
+            EXPECT_DOUBLE_EQ(a[i + j].point.x, b[i + j].point.x);
+            EXPECT_DOUBLE_EQ(a[i + j].point.y, b[i + j].point.y);
+        }
+    }
+}
+
+} // namespace
+
+TEST(CairoPathTest, BezierPathsMatchFeedPathvector)
+{
+    auto pathv = Geom::parse_svg_path("M 1,1 L 10,2 Q 12,8 6,12 C 4,14 2,10 1,6 Z M 3,3 H 5 V 5 L 4,4");
+    Context expected, actual;
+    feed_pathvector_to_cairo(expected.ct, pathv);
+    Inkscape::CairoPath(&pathv).append(actual.ct);
+    expect_same_path(copy_path(expected.ct), copy_path(actual.ct));
+}
+
+TEST(CairoPathTest, ArcsMatchFeedPathvector)
+{
+    auto pathv = Geom::parse_svg_path("M 2,8 A 6,4 0 1 1 14,8 A 6,4 0 0 1 2,8 Z");
+    Context expected, actual;
+    cairo_scale(expected.ct, 40, 40);
+    cairo_scale(actual.ct, 40, 40);
+    feed_pathvector_to_cairo(expected.ct, pathv);
+    Inkscape::CairoPath(&pathv).append(actual.ct);
+    expect_same_path(copy_path(expected.ct), copy_path(actual.ct));
+}
+
+TEST(CairoPathTest, FollowsTransformChanges)
+{
+    auto pathv = Geom::parse_svg_path("M 1,1 C 4,0 8,3 9,9 A 3,2 30 0 1 2,7 Z");
+    Inkscape::CairoPath path(&pathv);
+
+    // Translated like another tile of the same view, then zoomed in.
+    double const transforms[][6] = {
+        {1, 0, 0, 1, 0, 0},
+        {1, 0, 0, 1, -7.5, 3.25},
+        {4, 0, 0, 4, -20, -12},
+        {4, 0, 0, 4, 5, 1},
+    };
+    for (auto const &t : transforms) {
+        cairo_matrix_t m;
+        cairo_matrix_init(&m, t[0], t[1], t[2], t[3], t[4], t[5]);
+        Context expected, actual;
+        cairo_set_matrix(expected.ct, &m);
+        cairo_set_matrix(actual.ct, &m);
+        feed_pathvector_to_cairo(expected.ct, pathv);
+        path.append(actual.ct);
+        expect_same_path(copy_path(expected.ct), copy_path(actual.ct));
+
+        cairo_matrix_t after;
+        cairo_get_matrix(actual.ct, &after);
+        EXPECT_EQ(after.x0, m.x0);
+        EXPECT_EQ(after.y0, m.y0);
+        EXPECT_EQ(after.xx, m.xx);
+    }
+}
+
+TEST(CairoPathTest, RepeatedAndAlternatingTransforms)
+{
+    auto pathv = Geom::parse_svg_path("M 1,1 C 4,0 8,3 9,9 L 2,7 Z");
+    Inkscape::CairoPath path(&pathv);
+
+    // Kept after the second use of a transform, then fed directly again while they alternate.
+    double const transforms[][6] = {
+        {2, 0, 0, 2, 0, 0},
+        {2, 0, 0, 2, 3, 1},
+        {2, 0, 0, 2, -4, 2},
+        {0, 1, -1, 0, 16, 0},
+        {2, 0, 0, 2, 1, 1},
+        {0, 1, -1, 0, 8, 8},
+    };
+    for (auto const &t : transforms) {
+        cairo_matrix_t m;
+        cairo_matrix_init(&m, t[0], t[1], t[2], t[3], t[4], t[5]);
+        Context expected, actual;
+        cairo_set_matrix(expected.ct, &m);
+        cairo_set_matrix(actual.ct, &m);
+        feed_pathvector_to_cairo(expected.ct, pathv);
+        path.append(actual.ct);
+        expect_same_path(copy_path(expected.ct), copy_path(actual.ct));
+    }
+}
+
+TEST(CairoPathTest, EmptyPathAppendsNothing)
+{
+    Inkscape::CairoPath path;
+    EXPECT_TRUE(path.empty());
+    Context context;
+    path.append(context.ct);
+    EXPECT_FALSE(cairo_has_current_point(context.ct));
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,178 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Bit-exactness tests for the vectorized pixel kernels
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2022 Authors
+ *
+ * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
+ */
+
+#include <cmath>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include <src/display/cairo-simd.h>
+
+using Inkscape::PixelSimd;
+
+namespace {
+
+std::vector<PixelSimd> const all_levels = {PixelSimd::SCALAR, PixelSimd::SSE2, PixelSimd::AVX2};
+
+/// Every combination of alpha and color value, including invalid premultiplied pixels.
+std::vector<guint32> all_alpha_color_pairs()
+{
+    std::vector<guint32> pixels;
+    for (guint32 a = 0; a < 256; ++a) {
+        for (guint32 c = 0; c < 256; ++c) {
+            pixels.push_back((a << 24) | (c << 16) | ((255 - c) << 8) | ((c * 7) & 0xff));
+        }
+    }
+    return pixels;
+}
+
+/// Random pixels, with an odd count so that the partial vector at the end is exercised.
+std::vector<guint32> random_pixels(std::mt19937 &rng, bool premultiplied)
+{
+    std::uniform_int_distribution<guint32> dist;
+    std::vector<guint32> pixels(4099);
+    for (auto &px : pixels) {
+        px = dist(rng);
+        if (premultiplied) {
+            px = Inkscape::pixel_premultiply(px);
+        }
+    }
+    return pixels;
+}
+
+template <typename Span, typename Pixel>
+void expect_matches(std::vector<guint32> const &in, Span span, Pixel pixel)
+{
+    std::vector<guint32> expected(in.size());
+    for (std::size_t i = 0; i < in.size(); ++i) {
+        expected[i] = pixel(in[i]);
+    }
+    for (auto level : all_levels) {
+        if (!Inkscape::pixel_simd_supported(level)) {
+            continue;
+        }
+        std::vector<guint32> out(in.size());
+        span(in.data(), out.data(), in.size(), level);
+        for (std::size_t i = 0; i < in.size(); ++i) {
+            ASSERT_EQ(out[i], expected[i]) << "level " << int(level) << ", pixel " << std::hex << in[i];
+        }
+
+        // in place
+        out = in;
+        span(out.data(), out.data(), out.size(), level);
+        EXPECT_EQ(out, expected) << "level " << int(level);
+    }
+}
+
+} // namespace
+
+TEST(CairoSimdTest, ScalarIsAlwaysSupported)
+{
+    EXPECT_TRUE(Inkscape::pixel_simd_supported(PixelSimd::SCALAR));
+    EXPECT_TRUE(Inkscape::pixel_simd_supported(Inkscape::pixel_simd_best()));
+}
+
+TEST(CairoSimdTest, Premultiply)
+{
+    expect_matches(all_alpha_color_pairs(), Inkscape::pixels_premultiply, Inkscape::pixel_premultiply);
+}
+
+TEST(CairoSimdTest, Unpremultiply)
+{
+    expect_matches(all_alpha_color_pairs(), Inkscape::pixels_unpremultiply, Inkscape::pixel_unpremultiply);
+}
+
+TEST(CairoSimdTest, LuminanceToAlpha)
+{
+    expect_matches(all_alpha_color_pairs(), Inkscape::pixels_luminance_to_alpha,
+                   Inkscape::pixel_luminance_to_alpha);
+}
+
+TEST(CairoSimdTest, ColorMatrix)
+{
+    std::mt19937 rng(20221);
+    std::uniform_int_distribution<gint32> coefficient(-3 * 255, 3 * 255);
+    std::uniform_int_distribution<gint32> offset(-3 * 255 * 255, 3 * 255 * 255);
+
+    for (int round = 0; round < 20; ++round) {
+        gint32 v[20];
+        for (int i = 0; i < 20; ++i) {
+            v[i] = i % 5 == 4 ? offset(rng) : coefficient(rng);
+        }
+        auto span = [&] (guint32 const *in, guint32 *out, int n, PixelSimd level) {
+            Inkscape::pixels_color_matrix(in, out, n, v, level);
+        };
+        auto pixel = [&] (guint32 in) { return Inkscape::pixel_color_matrix(in, v); };
+        expect_matches(random_pixels(rng, true), span, pixel);
+        if (round == 0) {
+            expect_matches(all_alpha_color_pairs(), span, pixel);
+        }
+    }
+}
+
+TEST(CairoSimdTest, HueRotate)
+{
+    std::mt19937 rng(20222);
+    std::uniform_int_distribution<gint32> coefficient(-255, 2 * 255);
+
+    for (int round = 0; round < 20; ++round) {
+        gint32 v[9];
+        for (auto &c : v) {
+            c = coefficient(rng);
+        }
+        auto span = [&] (guint32 const *in, guint32 *out, int n, PixelSimd level) {
+            Inkscape::pixels_hue_rotate(in, out, n, v, level);
+        };
+        auto pixel = [&] (guint32 in) { return Inkscape::pixel_hue_rotate(in, v); };
+        expect_matches(random_pixels(rng, true), span, pixel);
+    }
+}
+
+TEST(CairoSimdTest, Arithmetic)
+{
+    std::mt19937 rng(20223);
+    // includes coefficients large enough for the intermediate sums to wrap around
+    std::uniform_real_distribution<double> k(-40.0, 40.0);
+
+    for (int round = 0; round < 40; ++round) {
+        gint32 kv[4] = {
+            gint32(std::round(k(rng) * 255)),
+            gint32(std::round(k(rng) * 255 * 255)),
+            gint32(std::round(k(rng) * 255 * 255)),
+            gint32(std::round(k(rng) * 255 * 255 * 255)),
+        };
+        auto in1 = random_pixels(rng, round % 2 == 0);
+        auto in2 = random_pixels(rng, round % 2 == 0);
+
+        std::vector<guint32> expected(in1.size());
+        for (std::size_t i = 0; i < in1.size(); ++i) {
+            expected[i] = Inkscape::pixel_arithmetic(in1[i], in2[i], kv);
+        }
+        for (auto level : all_levels) {
+            if (!Inkscape::pixel_simd_supported(level)) {
+                continue;
+            }
+            std::vector<guint32> out(in1.size());
+            Inkscape::pixels_arithmetic(in1.data(), in2.data(), out.data(), out.size(), kv, level);
+            EXPECT_EQ(out, expected) << "level " << int(level);
+        }
+    }
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests for the average colors of drawing areas
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2022 Authors
+ *
+ * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
+ */
+
+#include <memory>
+#include <gtest/gtest.h>
+#include <src/display/cairo-utils.h>
+#include <src/display/drawing-context.h>
+#include <src/display/drawing.h>
+#include <src/document.h>
+#include <src/inkscape.h>
+#include <src/object/sp-item.h>
+#include <src/object/sp-root.h>
+
+using namespace Inkscape;
+
+class DrawingSamplerTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        // setup hidden dependency
+        Application::create(false);
+
+        std::string svg("\
+<svg xmlns='http://www.w3.org/2000/svg' width='400' height='300'>\
+    <rect id='back' width='400' height='300' fill='#336699' />\
+    <circle id='circle' cx='150' cy='120' r='90' fill='#ff8000' fill-opacity='0.5' />\
+    <rect id='rect' x='260' y='-20' width='100' height='250' fill='#20c040' />\
+</svg>");
+        doc.reset(SPDocument::createNewDocFromMem(svg.c_str(), svg.size(), true));
+        doc->ensureUpToDate();
+        dkey = SPItem::display_key_new(1);
+        drawing.setRoot(doc->getRoot()->invoke_show(drawing, dkey, SP_ITEM_SHOW_DISPLAY));
+        drawing.update();
+    }
+
+    void TearDown() override
+    {
+        doc->getRoot()->invoke_hide(dkey);
+    }
+
+    /// Average color of an area as Drawing::average_color() used to compute it.
+    void render_average(Geom::IntRect const &area, double &R, double &G, double &B, double &A)
+    {
+        cairo_surface_t *s = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, area.width(), area.height());
+        {
+            DrawingContext dc(s, area.min());
+            drawing.render(dc, area);
+        }
+        ink_cairo_surface_average_color_premul(s, R, G, B, A);
+        cairo_surface_destroy(s);
+    }
+
+    void expect_same_average(Geom::IntRect const &area)
+    {
+        double er, eg, eb, ea, ar, ag, ab, aa;
+        render_average(area, er, eg, eb, ea);
+        drawing.average_color(area, ar, ag, ab, aa);
+        EXPECT_NEAR(er, ar, 1e-9);
+        EXPECT_NEAR(eg, ag, 1e-9);
+        EXPECT_NEAR(eb, ab, 1e-9);
+        EXPECT_NEAR(ea, aa, 1e-9);
+    }
+
+    std::unique_ptr<SPDocument> doc;
+    Drawing drawing;
+    unsigned dkey = 0;
+};
+
+TEST_F(DrawingSamplerTest, MatchesRenderedAverage)
+{
+    for (int i = 0; i < 2; ++i) {
+        // the second time, the areas are answered from the tiles of the first time
+        expect_same_average(Geom::IntRect::from_xywh(0, 0, 400, 300));
+        expect_same_average(Geom::IntRect::from_xywh(140, 110, 1, 1));
+        expect_same_average(Geom::IntRect::from_xywh(100, 60, 37, 150));
+        expect_same_average(Geom::IntRect::from_xywh(120, 120, 200, 9));
+        expect_same_average(Geom::IntRect::from_xywh(-50, -70, 130, 100));
+        expect_same_average(Geom::IntRect::from_xywh(250, 200, 300, 300));
+    }
+}
+
+TEST_F(DrawingSamplerTest, FollowsChanges)
+{
+    auto area = Geom::IntRect::from_xywh(100, 60, 100, 100);
+    expect_same_average(area);
+
+    doc->getObjectById("circle")->setAttribute("fill", "#0000ff");
+    doc->ensureUpToDate();
+    drawing.update();
+    expect_same_average(area);
+
+    drawing.root()->setTransform(Geom::Scale(0.5));
+    drawing.update();
+    expect_same_average(area);
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
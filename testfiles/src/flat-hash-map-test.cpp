@@ -0,0 +1,195 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests for the open-addressing hash map used for document lookups
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2022 Authors
+ *
+ * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
+ */
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "util/flat-hash-map.h"
+
+using Inkscape::Util::FlatHashMap;
+using Inkscape::Util::StringHash;
+using IdMap = FlatHashMap<std::string, int, StringHash>;
+
+TEST(FlatHashMapTest, Empty)
+{
+    IdMap map;
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(map.find("a"), nullptr);
+    EXPECT_FALSE(map.erase("a"));
+}
+
+TEST(FlatHashMapTest, HeterogeneousLookup)
+{
+    IdMap map;
+    EXPECT_TRUE(map.insert_or_assign("rect1", 1));
+    EXPECT_TRUE(map.insert_or_assign("rect2", 2));
+    EXPECT_FALSE(map.insert_or_assign("rect1", 3));
+    EXPECT_EQ(map.size(), 2u);
+
+    char const *c_string = "rect1";
+    std::string_view view = "xrect2";
+    ASSERT_NE(map.find(c_string), nullptr);
+    EXPECT_EQ(*map.find(c_string), 3);
+    ASSERT_NE(map.find(view.substr(1)), nullptr);
+    EXPECT_EQ(*map.find(view.substr(1)), 2);
+    EXPECT_EQ(map.find(std::string("rect")), nullptr);
+
+    EXPECT_TRUE(map.erase(view.substr(1)));
+    EXPECT_FALSE(map.contains("rect2"));
+    EXPECT_TRUE(map.contains("rect1"));
+}
+
+TEST(FlatHashMapTest, PointerKeys)
+{
+    // Aligned pointers only differ in their upper bits.
+    std::vector<std::unique_ptr<double[]>> blocks;
+    FlatHashMap<double *, int> map;
+    for (int i = 0; i < 1000; ++i) {
+        blocks.emplace_back(new double[4]);
+        map.insert_or_assign(blocks.back().get(), i);
+    }
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_NE(map.find(blocks[i].get()), nullptr);
+        EXPECT_EQ(*map.find(blocks[i].get()), i);
+    }
+    EXPECT_EQ(map.find(static_cast<double *>(nullptr)), nullptr);
+}
+
+TEST(FlatHashMapTest, MatchesStdMap)
+{
+    std::mt19937 rng(6);
+    std::uniform_int_distribution<int> key_dist(0, 2000);
+    std::uniform_int_distribution<int> op_dist(0, 2);
+
+    IdMap map;
+    std::map<std::string, int> reference;
+    for (int i = 0; i < 50000; ++i) {
+        std::string key = "path" + std::to_string(key_dist(rng));
+        switch (op_dist(rng)) {
+            case 0:
+            case 1:
+                EXPECT_EQ(map.insert_or_assign(key, i), reference.count(key) == 0);
+                reference[key] = i;
+                break;
+            case 2:
+                EXPECT_EQ(map.erase(key), reference.erase(key) == 1);
+                break;
+        }
+        ASSERT_EQ(map.size(), reference.size());
+    }
+
+    for (int k = 0; k <= 2000; ++k) {
+        std::string key = "path" + std::to_string(k);
+        auto it = reference.find(key);
+        auto value = map.find(key);
+        if (it == reference.end()) {
+            EXPECT_EQ(value, nullptr) << key;
+        } else {
+            ASSERT_NE(value, nullptr) << key;
+            EXPECT_EQ(*value, it->second);
+        }
+    }
+
+    std::size_t visited = 0;
+    map.for_each([&] (std::string const &key, int value) {
+        EXPECT_EQ(reference.at(key), value);
+        ++visited;
+    });
+    EXPECT_EQ(visited, reference.size());
+}
+
+/*
+ * Timings of the id and repr tables against the std::map they replace, for documents with
+ * 10^5 and 10^6 ids. Not run by default; use --gtest_also_run_disabled_tests.
+ */
+namespace {
+
+template <typename F>
+double time_ms(F &&f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void benchmark_ids(int count)
+{
+    std::vector<std::string> ids;
+    for (int i = 0; i < count; ++i) {
+        ids.push_back("path" + std::to_string(i * 7919LL % count));
+    }
+    std::vector<char const *> lookups;
+    std::mt19937 rng(count);
+    std::uniform_int_distribution<int> pick(0, count - 1);
+    for (int i = 0; i < count; ++i) {
+        lookups.push_back(ids[pick(rng)].c_str());
+    }
+
+    std::size_t found = 0;
+    std::map<std::string, int> tree;
+    double tree_bind = time_ms([&] { for (int i = 0; i < count; ++i) tree[ids[i]] = i; });
+    // getObjectById(char const *) used to build a temporary string for every lookup
+    double tree_find = time_ms([&] { for (auto id : lookups) found += tree.find(std::string(id)) != tree.end(); });
+
+    IdMap hash;
+    double hash_bind = time_ms([&] { for (int i = 0; i < count; ++i) hash.insert_or_assign(ids[i], i); });
+    double hash_find = time_ms([&] { for (auto id : lookups) found += hash.contains(id); });
+
+    EXPECT_EQ(found, 2 * lookups.size());
+    std::cout << count << " ids: bind " << tree_bind << " ms -> " << hash_bind << " ms, lookup "
+              << tree_find << " ms -> " << hash_find << " ms" << std::endl;
+}
+
+void benchmark_reprs(int count)
+{
+    std::vector<std::unique_ptr<int>> nodes;
+    for (int i = 0; i < count; ++i) {
+        nodes.emplace_back(new int(i));
+    }
+    std::size_t found = 0;
+    std::map<int *, int> tree;
+    double tree_bind = time_ms([&] { for (auto &n : nodes) tree[n.get()] = *n; });
+    double tree_find = time_ms([&] { for (auto &n : nodes) found += tree.count(n.get()); });
+
+    FlatHashMap<int *, int> hash;
+    double hash_bind = time_ms([&] { for (auto &n : nodes) hash.insert_or_assign(n.get(), *n); });
+    double hash_find = time_ms([&] { for (auto &n : nodes) found += hash.contains(n.get()); });
+
+    EXPECT_EQ(found, 2 * nodes.size());
+    std::cout << count << " reprs: bind " << tree_bind << " ms -> " << hash_bind << " ms, lookup "
+              << tree_find << " ms -> " << hash_find << " ms" << std::endl;
+}
+
+} // namespace
+
+TEST(FlatHashMapTest, DISABLED_Benchmark)
+{
+    for (int count : {100000, 1000000}) {
+        benchmark_ids(count);
+        benchmark_reprs(count);
+    }
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,144 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests for shared images and their mip pyramids
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2022 Authors
+ *
+ * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <src/display/cairo-utils.h>
+#include <src/display/image-cache.h>
+
+using namespace Inkscape;
+
+namespace {
+
+cairo_surface_t *create_image(int w, int h, std::uint32_t const *pixels)
+{
+    cairo_surface_t *s = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, w, h);
+    unsigned char *data = cairo_image_surface_get_data(s);
+    int const stride = cairo_image_surface_get_stride(s);
+    for (int y = 0; y < h; ++y) {
+        auto row = reinterpret_cast<std::uint32_t *>(data + y * stride);
+        for (int x = 0; x < w; ++x) {
+            row[x] = pixels ? pixels[y * w + x] : 0xff336699;
+        }
+    }
+    cairo_surface_mark_dirty(s);
+    return s;
+}
+
+std::uint32_t pixel(cairo_surface_t *s, int x, int y)
+{
+    cairo_surface_flush(s);
+    auto data = cairo_image_surface_get_data(s) + y * cairo_image_surface_get_stride(s);
+    return reinterpret_cast<std::uint32_t const *>(data)[x];
+}
+
+} // namespace
+
+TEST(ImageCacheTest, FullScaleUsesImage)
+{
+    cairo_surface_t *image = create_image(10, 7, nullptr);
+    cairo_surface_t *level = ImageCache::get().mipmap(image, 0.6);
+    EXPECT_EQ(level, image);
+    cairo_surface_destroy(level);
+    cairo_surface_destroy(image);
+}
+
+TEST(ImageCacheTest, LevelSize)
+{
+    cairo_surface_t *image = create_image(10, 7, nullptr);
+    cairo_surface_t *level = ImageCache::get().mipmap(image, 0.25);
+    EXPECT_EQ(cairo_image_surface_get_width(level), 3);
+    EXPECT_EQ(cairo_image_surface_get_height(level), 2);
+    EXPECT_EQ(pixel(level, 2, 1), 0xff336699);
+
+    // Levels are reused.
+    cairo_surface_t *again = ImageCache::get().mipmap(image, 0.2);
+    EXPECT_EQ(again, level);
+    cairo_surface_destroy(again);
+    cairo_surface_destroy(level);
+    cairo_surface_destroy(image);
+}
+
+TEST(ImageCacheTest, Downsample)
+{
+    std::uint32_t const pixels[] = {0xffff0000, 0xff00ff00,
+                                    0xff0000ff, 0xffffffff};
+    cairo_surface_t *image = create_image(2, 2, pixels);
+    cairo_surface_t *level = ImageCache::get().mipmap(image, 0.5);
+    EXPECT_EQ(cairo_image_surface_get_width(level), 1);
+    EXPECT_EQ(pixel(level, 0, 0), 0xff808080);
+    cairo_surface_destroy(level);
+
+    // Changed pixels are picked up once the image is forgotten.
+    auto data = reinterpret_cast<std::uint32_t *>(cairo_image_surface_get_data(image));
+    data[0] = data[1] = 0;
+    cairo_surface_mark_dirty(image);
+    ImageCache::get().forget(image);
+    level = ImageCache::get().mipmap(image, 0.5);
+    EXPECT_EQ(pixel(level, 0, 0), 0x80404080);
+    cairo_surface_destroy(level);
+    cairo_surface_destroy(image);
+}
+
+TEST(ImageCacheTest, SharedPixbuf)
+{
+    int decoded = 0;
+    auto decode = [&] {
+        ++decoded;
+        return new Pixbuf(create_image(4, 4, nullptr));
+    };
+    auto first = ImageCache::get().pixbuf("test:shared", decode);
+    auto second = ImageCache::get().pixbuf("test:shared", decode);
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(decoded, 1);
+
+    first.reset();
+    second.reset();
+    auto third = ImageCache::get().pixbuf("test:shared", decode);
+    EXPECT_EQ(decoded, 2);
+
+    // Images without a key are not shared.
+    auto unshared = ImageCache::get().pixbuf({}, decode);
+    EXPECT_NE(unshared, third);
+    EXPECT_EQ(decoded, 3);
+}
+
+TEST(ImageCacheTest, AsyncDecoding)
+{
+    std::atomic<int> decoded{0};
+    auto decode = [&] {
+        ++decoded;
+        return new Pixbuf(create_image(4, 4, nullptr));
+    };
+    auto first = ImageCache::get().pixbuf_async("test:async", decode);
+    auto second = ImageCache::get().pixbuf_async("test:async", decode);
+    auto image = first.get();
+    ASSERT_TRUE(image);
+    EXPECT_TRUE(first.ready());
+    EXPECT_EQ(second.get(), image);
+    EXPECT_EQ(decoded, 1);
+
+    // The decoded image is shared with synchronous requests while it is held.
+    EXPECT_EQ(ImageCache::get().pixbuf("test:async", decode), image);
+    EXPECT_EQ(decoded, 1);
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -83,4 +83,35 @@ TEST_F(PathBoolopTest, DifferenceOutside){
     comparePaths(pvRectangleDifference, pvBothPaths);
 }
 
+TEST_F(PathBoolopTest, UnionMany){
+    // test that the union of many overlapping objects is the same as combining them one by one
+    std::vector<Geom::PathVector> pvs;
+    for (int i = 0; i < 7; i++) {
+        std::string d = "M " + std::to_string(i) + ",0 L " + std::to_string(i + 1.5) + ",0 L " +
+                        std::to_string(i + 1.5) + ",1 L " + std::to_string(i) + ",1 z";
+        pvs.push_back(sp_svg_read_pathv(d.c_str()));
+    }
+    std::vector<FillRule> fill_rules(pvs.size(), fill_nonZero);
+
+    Geom::PathVector folded = pvs[0];
+    for (size_t i = 1; i < pvs.size(); i++) {
+        folded = sp_pathvector_boolop(pvs[i], folded, bool_op_union, fill_nonZero, fill_nonZero, true, false);
+    }
+    Geom::PathVector pvUnion = sp_pathvector_boolop(pvs, fill_rules, bool_op_union);
+
+    ASSERT_EQ(pvUnion.size(), 1u);
+    EXPECT_EQ(pvUnion.size(), folded.size());
+    EXPECT_EQ(*pvUnion.boundsExact(), Geom::Rect(0, 0, 7.5, 1));
+    EXPECT_EQ(*pvUnion.boundsExact(), *folded.boundsExact());
+}
+
+TEST_F(PathBoolopTest, IntersectionMany){
+    // test that the intersection of nested objects is the innermost one
+    std::vector<Geom::PathVector> pvs = {pvRectangleBigger, pvRectangleSmaller, pvRectangleBigger};
+    std::vector<FillRule> fill_rules(pvs.size(), fill_oddEven);
+    Geom::PathVector pvIntersection = sp_pathvector_boolop(pvs, fill_rules, bool_op_inters);
+    ASSERT_EQ(pvIntersection.size(), 1u);
+    EXPECT_EQ(*pvIntersection.boundsExact(), *pvRectangleSmaller.boundsExact());
+}
+
 //
\ No newline at end of file
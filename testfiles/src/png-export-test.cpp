@@ -0,0 +1,171 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Tests for the batch export of document areas to PNG files
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2022 Authors
+ *
+ * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
+ */
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <cairo.h>
+#include <glib/gstdio.h>
+#include <glibmm/convert.h>
+#include <glibmm/miscutils.h>
+#include <gtest/gtest.h>
+#include <src/document.h>
+#include <src/helper/png-write.h>
+#include <src/inkscape.h>
+
+namespace {
+
+/// A job for an area, sized like do_export_png() sizes it at a resolution.
+PngExportJob make_job(Geom::Rect const &area, double dpi)
+{
+    PngExportJob job;
+    job.filename = "unused.png";
+    job.area = area;
+    job.width = static_cast<unsigned long>(area.width() / 96.0 * dpi + 0.5);
+    job.height = static_cast<unsigned long>(area.height() / 96.0 * dpi + 0.5);
+    job.xdpi = job.ydpi = dpi;
+    return job;
+}
+
+} // namespace
+
+TEST(PngExportTest, ObjectsAtOneResolutionShareAGroup)
+{
+    // Areas snapped to the pixel grid at 150 dpi, whose scales only differ by rounding errors.
+    std::vector<PngExportJob> jobs;
+    for (int k : {0, 17, 33, 50, 70}) {
+        double const x = 0.64 * k;
+        double const y = 1.28 + 0.64 * (k % 3);
+        jobs.push_back(make_job(Geom::Rect(x, y, x + 10.24, y + 10.24), 150));
+    }
+
+    auto const groups = sp_export_png_groups(jobs);
+    ASSERT_EQ(groups.size(), 1u);
+    ASSERT_EQ(groups[0].jobs.size(), jobs.size());
+    for (std::size_t k = 0; k < jobs.size(); ++k) {
+        auto const i = groups[0].jobs[k];
+        auto const expected = jobs[i].area.min() * Geom::Scale(150 / 96.0);
+        EXPECT_EQ(groups[0].origins[k], expected.round());
+    }
+}
+
+TEST(PngExportTest, AreasOffTheGridGetTheirOwnGroup)
+{
+    std::vector<PngExportJob> jobs;
+    jobs.push_back(make_job(Geom::Rect(0, 0, 10.24, 10.24), 150));
+    jobs.push_back(make_job(Geom::Rect(0.3, 0.3, 10.3, 10.3), 150)); // 15.625 pixels, rounded up
+    jobs.push_back(make_job(Geom::Rect(20.48, 0, 30.72, 10.24), 150));
+
+    auto const groups = sp_export_png_groups(jobs);
+    ASSERT_EQ(groups.size(), 2u);
+    EXPECT_EQ(groups[0].jobs, (std::vector<std::size_t>{0, 2}));
+    EXPECT_EQ(groups[1].jobs, (std::vector<std::size_t>{1}));
+    EXPECT_EQ(groups[1].origins[0], Geom::IntPoint(0, 0));
+}
+
+TEST(PngExportTest, InvalidJobsAreLeftOut)
+{
+    std::vector<PngExportJob> jobs;
+    jobs.push_back(make_job(Geom::Rect(0, 0, 10, 10), 96));
+    jobs.back().filename.clear();
+    jobs.push_back(make_job(Geom::Rect(0, 0, 0, 10), 96));
+
+    EXPECT_TRUE(sp_export_png_groups(jobs).empty());
+}
+
+class PngExportDocumentTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        // setup hidden dependency
+        Inkscape::Application::create(false);
+
+        image_file = Glib::build_filename(Glib::get_tmp_dir(), "png-export-test-image.png");
+        export_file = Glib::build_filename(Glib::get_tmp_dir(), "png-export-test-export.png");
+
+        cairo_surface_t *s = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 8, 8);
+        cairo_t *ct = cairo_create(s);
+        cairo_set_source_rgb(ct, 1, 0, 0);
+        cairo_paint(ct);
+        cairo_destroy(ct);
+        ASSERT_EQ(cairo_surface_write_to_png(s, image_file.c_str()), CAIRO_STATUS_SUCCESS);
+        cairo_surface_destroy(s);
+    }
+
+    void TearDown() override
+    {
+        g_unlink(image_file.c_str());
+        g_unlink(export_file.c_str());
+    }
+
+    /// Export the whole 100x100 document at 96 dpi and return the color at a pixel of the file.
+    std::uint32_t export_pixel(std::string const &content, int x, int y)
+    {
+        std::string svg = "<svg xmlns='http://www.w3.org/2000/svg' xmlns:xlink='http://www.w3.org/1999/xlink'"
+                          " width='100' height='100'>" + content + "</svg>";
+        std::unique_ptr<SPDocument> doc(SPDocument::createNewDocFromMem(svg.c_str(), svg.size(), true));
+        EXPECT_TRUE(doc);
+        if (!doc) {
+            return 0;
+        }
+
+        auto const result = sp_export_png_file(doc.get(), export_file.c_str(), Geom::Rect(0, 0, 100, 100),
+                                               100, 100, 96, 96, 0, nullptr, nullptr, true);
+        EXPECT_EQ(result, EXPORT_OK);
+
+        cairo_surface_t *s = cairo_image_surface_create_from_png(export_file.c_str());
+        std::uint32_t color = 0;
+        if (cairo_surface_status(s) == CAIRO_STATUS_SUCCESS) {
+            auto const data = cairo_image_surface_get_data(s);
+            auto const stride = cairo_image_surface_get_stride(s);
+            color = reinterpret_cast<std::uint32_t const *>(data + y * stride)[x];
+        } else {
+            ADD_FAILURE() << "can't read " << export_file;
+        }
+        cairo_surface_destroy(s);
+        return color;
+    }
+
+    /// An image element showing the red test image, at the center of the document.
+    std::string image_element() const
+    {
+        return "<image id='image' x='40' y='40' width='20' height='20' xlink:href='" +
+               Glib::filename_to_uri(image_file) + "' />";
+    }
+
+    std::string image_file;
+    std::string export_file;
+};
+
+TEST_F(PngExportDocumentTest, ClonedImagesAreDecoded)
+{
+    // The image is only shown by the clone of a <use>, not in the <defs> it lives in.
+    auto const content = "<defs>" + image_element() + "</defs><use xlink:href='#image' />";
+    EXPECT_EQ(export_pixel(content, 50, 50), 0xffff0000);
+}
+
+TEST_F(PngExportDocumentTest, ImagesInClonedSymbolsAreDecoded)
+{
+    auto const content = "<symbol id='symbol'>" + image_element() + "</symbol><use xlink:href='#symbol' />";
+    EXPECT_EQ(export_pixel(content, 50, 50), 0xffff0000);
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** @file
+ * Test that the style sheet index finds the same declarations as libcroco.
+ *//*
+ * Authors: see git history
+ *
+ * Copyright (C) 2022 Authors
+ *
+ * Released under GNU GPL version 2 or later, read the file 'COPYING' for more information
+ */
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include <doc-per-case-test.h>
+
+#include <src/style-sheet-index.h>
+#include <src/object/sp-root.h>
+#include <src/xml/croco-node-iface.h>
+#include <src/xml/node.h>
+
+class StyleSheetIndexTest : public DocPerCaseTest
+{
+public:
+    StyleSheetIndexTest()
+    {
+        char const *docString = "\
+<svg xmlns='http://www.w3.org/2000/svg'>\
+<style>\
+rect { fill: #808080; opacity: 0.5; }\
+* { stroke-linecap: round; }\
+.a { fill: #00ff00; }\
+.b.a { fill: #0000ff; stroke: #000000 !important; }\
+#one, .c { opacity: 0.25; }\
+rect.c { opacity: 0.75; }\
+g > rect { stroke-width: 3; }\
+g .a { stroke: #ff0000; }\
+rect:first-child, circle:first-child { stroke-opacity: 0.5; }\
+#two { fill: #ffffff !important; }\
+.a { fill: #111111; }\
+</style>\
+<g id='g'>\
+  <rect id='one'/>\
+  <rect id='two' class='a b'/>\
+  <rect id='three' class=' c   a '/>\
+  <circle id='four' class='a'/>\
+  <circle id='five' class='b'/>\
+</g>\
+<rect id='six' class='a'/>\
+<rect id='seven' class='a b'/>\
+</svg>";
+        doc.reset(SPDocument::createNewDocFromMem(docString, static_cast<int>(strlen(docString)), false));
+    }
+
+    std::unique_ptr<SPDocument> doc;
+};
+
+namespace {
+
+std::vector<CRDeclaration *> libcroco_matches(CRSelEng *sel_eng, CRCascade *cascade, Inkscape::XML::Node *node)
+{
+    std::vector<CRDeclaration *> result;
+    CRPropList *props = nullptr;
+    cr_sel_eng_get_matched_properties_from_cascade(sel_eng, cascade, node, &props);
+    for (CRPropList *cur = props; cur; cur = cr_prop_list_get_next(cur)) {
+        CRDeclaration *decl = nullptr;
+        cr_prop_list_get_decl(cur, &decl);
+        result.push_back(decl);
+    }
+    if (props) {
+        cr_prop_list_destroy(props);
+    }
+    return result;
+}
+
+void collect_elements(Inkscape::XML::Node *node, std::vector<Inkscape::XML::Node *> &elements)
+{
+    if (node->type() == Inkscape::XML::NodeType::ELEMENT_NODE) {
+        elements.push_back(node);
+    }
+    for (auto child = node->firstChild(); child; child = child->next()) {
+        collect_elements(child, elements);
+    }
+}
+
+} // namespace
+
+TEST_F(StyleSheetIndexTest, MatchesLikeLibcroco)
+{
+    ASSERT_TRUE(doc);
+    CRSelEng *sel_eng = cr_sel_eng_new(&Inkscape::XML::croco_node_iface);
+
+    std::vector<Inkscape::XML::Node *> elements;
+    collect_elements(doc->getRoot()->getRepr(), elements);
+    ASSERT_GT(elements.size(), 8u);
+
+    Inkscape::StyleSheetIndex index(doc->getStyleCascade());
+    // Twice, so that memoized results are compared as well.
+    for (int pass = 0; pass < 2; ++pass) {
+        for (auto node : elements) {
+            auto const expected = libcroco_matches(sel_eng, doc->getStyleCascade(), node);
+            EXPECT_EQ(index.match(sel_eng, node), expected) << "element " << (node->attribute("id") ? node->attribute("id") : node->name());
+        }
+    }
+
+    cr_sel_eng_destroy(sel_eng);
+}
+
+TEST_F(StyleSheetIndexTest, StyleChangesRebuildIndex)
+{
+    ASSERT_TRUE(doc);
+    auto rect = doc->getObjectById("one");
+    ASSERT_TRUE(rect);
+    EXPECT_EQ(rect->style->opacity.get_value(), Glib::ustring("0.25"));
+
+    auto style = doc->getRoot()->getRepr()->firstChild();
+    while (style && std::strcmp(style->name(), "svg:style")) {
+        style = style->next();
+    }
+    ASSERT_TRUE(style && style->firstChild());
+    style->firstChild()->setContent("#one { opacity: 0.125; }");
+    doc->ensureUpToDate();
+    EXPECT_EQ(rect->style->opacity.get_value(), Glib::ustring("0.125"));
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -589,6 +589,43 @@ TEST(StyleTest, Cascade) {
   }
 }
 
+TEST(StyleTest, SharedDeclarations) {
+  // The declarations of a style attribute are parsed once and shared; merging them again must
+  // give the same result, including precedence and extended properties.
+  char const *css = "fill:#ff0000 !important;fill:#0000ff;stroke-width:2;-inkscape-font-specification-x:Sans";
+  for (int i = 0; i < 2; ++i) {
+    SPStyle style;
+    style.stroke_width.read("3");
+    style.mergeString(css);
+
+    EXPECT_TRUE(style.fill.isColor());
+    EXPECT_EQ(style.fill.value.color.toRGBA32(0xff), 0xff0000ffu);
+    EXPECT_TRUE(style.fill.important);
+    EXPECT_EQ(style.stroke_width.value, 3);
+    EXPECT_EQ(style.extended_properties["-inkscape-font-specification-x"], "Sans");
+  }
+}
+
+TEST(StyleTest, SharedStringValues) {
+  // String values are shared by all styles that have them, whether read or inherited.
+  SPStyle parent;
+  parent.font_family.read("'DejaVu Sans'");
+  SPStyle a, b, c;
+  a.cascade(&parent);
+  b.cascade(&parent);
+  c.font_family.read("DejaVu Sans");
+
+  EXPECT_STREQ(a.font_family.value(), "DejaVu Sans");
+  EXPECT_EQ(a.font_family.value(), parent.font_family.value());
+  EXPECT_EQ(b.font_family.value(), parent.font_family.value());
+  EXPECT_EQ(c.font_family.value(), parent.font_family.value());
+  EXPECT_TRUE(a.font_family == c.font_family);
+
+  c.font_family.read("serif");
+  EXPECT_STREQ(c.font_family.value(), "serif");
+  EXPECT_STREQ(a.font_family.value(), "DejaVu Sans");
+  EXPECT_FALSE(a.font_family == c.font_family);
+}
 
 } // namespace
 